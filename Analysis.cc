@@ -19,6 +19,7 @@
 #include "Environment.hh"
 #include "BuiltinFunctions.hh"
 #include "Types/Dictionary.hh"
+#include "Types/Int.hh"
 #include "Types/List.hh"
 
 using namespace std;
@@ -37,16 +38,18 @@ BuiltinFragmentDefinition::BuiltinFragmentDefinition(
 
 BuiltinFunctionDefinition::BuiltinFunctionDefinition(const char* name,
     const std::vector<Variable>& arg_types, Variable return_type,
-    const void* compiled, bool pass_exception_block, bool register_globally) :
-    name(name), fragments({{arg_types, return_type, compiled}}),
+    const void* compiled, bool pass_exception_block, bool register_globally,
+    const std::vector<std::string>& arg_names) : name(name),
+    fragments({{arg_types, return_type, compiled}}),
     pass_exception_block(pass_exception_block),
-    register_globally(register_globally) { }
+    register_globally(register_globally), arg_names(arg_names) { }
 
 BuiltinFunctionDefinition::BuiltinFunctionDefinition(const char* name,
     const std::vector<BuiltinFragmentDefinition>& fragments,
-    bool pass_exception_block, bool register_globally) : name(name),
+    bool pass_exception_block, bool register_globally,
+    const std::vector<std::string>& arg_names) : name(name),
     fragments(fragments), pass_exception_block(pass_exception_block),
-    register_globally(register_globally) { }
+    register_globally(register_globally), arg_names(arg_names) { }
 
 BuiltinClassDefinition::BuiltinClassDefinition(const char* name,
     const std::map<std::string, Variable>& attributes,
@@ -117,13 +120,19 @@ FunctionContext::FunctionContext(ModuleAnalysis* module, int64_t id) :
 
 FunctionContext::FunctionContext(ModuleAnalysis* module, int64_t id,
     const char* name, const vector<BuiltinFragmentDefinition>& fragments,
-    bool pass_exception_block) : module(module), id(id), class_id(0),
-    name(name), ast_root(NULL), num_splits(0),
-    pass_exception_block(pass_exception_block) {
+    bool pass_exception_block, const vector<string>& arg_names) :
+    module(module), id(id), class_id(0), name(name), ast_root(NULL),
+    num_splits(0), pass_exception_block(pass_exception_block) {
 
   // populate the arguments from the first fragment definition
+  if (arg_names.size() > fragments[0].arg_types.size()) {
+    throw invalid_argument("builtin function has more argument names than arguments");
+  }
   for (const auto& arg : fragments[0].arg_types) {
     this->args.emplace_back();
+    if (this->args.size() <= arg_names.size()) {
+      this->args.back().name = arg_names[this->args.size() - 1];
+    }
     if (arg.type == ValueType::Indeterminate) {
       throw invalid_argument("builtin functions must have known argument types");
     } else if (arg.value_known) {
@@ -156,8 +165,10 @@ FunctionContext::FunctionContext(ModuleAnalysis* module, int64_t id,
     string signature = type_signature_for_variables(fragment_def.arg_types, true);
     int64_t fragment_id = this->arg_signature_to_fragment_id.size() + 1;
     this->arg_signature_to_fragment_id.emplace(signature, fragment_id);
-    this->fragments.emplace(piecewise_construct, forward_as_tuple(fragment_id),
-        forward_as_tuple(fragment_def.return_type, fragment_def.compiled));
+    auto& fragment = this->fragments.emplace(piecewise_construct,
+        forward_as_tuple(fragment_id),
+        forward_as_tuple(fragment_def.return_type, fragment_def.compiled)).first->second;
+    fragment.arg_types = fragment_def.arg_types;
   }
 }
 
@@ -523,6 +534,11 @@ FunctionContext::Fragment GlobalAnalysis::compile_scope(ModuleAnalysis* module,
     return_type = *v->return_types().begin();
   }
 
+  // __init__ returns the instance object (as in AnalysisVisitor)
+  if (fn && fn->is_class_init()) {
+    return_type = Variable(ValueType::Instance, fn->id, nullptr);
+  }
+
   string compiled = v->assembler().assemble(patch_offsets, &compiled_labels);
   const void* executable = this->code.append(compiled, &patch_offsets);
   module->compiled_size += compiled.size();
@@ -693,6 +709,32 @@ const UnicodeObject* GlobalAnalysis::get_or_create_constant(const wstring& s,
   return o;
 }
 
+const BytesFormatProgram* GlobalAnalysis::get_or_create_format_program(
+    const string& format) {
+  auto it = this->bytes_format_programs.find(format);
+  if (it == this->bytes_format_programs.end()) {
+    it = this->bytes_format_programs.emplace(format,
+        bytes_compile_format(format)).first;
+  }
+  return &it->second;
+}
+
+const UnicodeFormatProgram* GlobalAnalysis::get_or_create_format_program(
+    const wstring& format) {
+  auto it = this->unicode_format_programs.find(format);
+  if (it == this->unicode_format_programs.end()) {
+    it = this->unicode_format_programs.emplace(format,
+        unicode_compile_format(format)).first;
+  }
+  return &it->second;
+}
+
+DictionaryLookupCache* GlobalAnalysis::get_or_create_dictionary_lookup_cache(
+    const ArrayIndex* site) {
+  // the cache is created empty, so the first lookup at each site misses
+  return &this->dictionary_lookup_caches[site];
+}
+
 size_t GlobalAnalysis::reserve_global_space(size_t extra_space) {
   size_t ret = this->global_space_used;
   this->global_space_used += extra_space;
@@ -738,8 +780,11 @@ int64_t GlobalAnalysis::construct_value(const Variable& value,
     case ValueType::None:
       return 0;
 
-    case ValueType::Bool:
     case ValueType::Int:
+      // the cell owns a reference, if the value is promoted (see Types/Int.hh)
+      return int_add_reference(value.int_value);
+
+    case ValueType::Bool:
     case ValueType::Float:
       // returning int_value for Float here is not an error. this function
       // returns the raw (binary) contents of the cell that this value would
@@ -760,8 +805,10 @@ int64_t GlobalAnalysis::construct_value(const Variable& value,
       return 0;
 
     case ValueType::List: {
+      ValueType item_type = value.extension_types[0].type;
       ListObject* l = list_new(value.list_value->size(),
-          type_has_refcount(value.extension_types[0].type));
+          type_has_refcount(item_type) && (item_type != ValueType::Int));
+      l->items_are_ints = (item_type == ValueType::Int);
       for (size_t x = 0; x < value.list_value->size(); x++) {
         l->items[x] = reinterpret_cast<void*>(
             this->construct_value(*(*value.list_value)[x], false));
@@ -780,8 +827,12 @@ int64_t GlobalAnalysis::construct_value(const Variable& value,
         key_at = reinterpret_cast<uint8_t (*)(const void*, size_t)>(unicode_at);
       }
 
-      uint64_t flags = (type_has_refcount(value.extension_types[0].type) ? DictionaryFlag::KeysAreObjects : 0) |
-          (type_has_refcount(value.extension_types[1].type) ? DictionaryFlag::ValuesAreObjects : 0);
+      ValueType key_type = value.extension_types[0].type;
+      ValueType value_type = value.extension_types[1].type;
+      uint64_t flags = ((key_type == ValueType::Int) ? DictionaryFlag::KeysAreInts :
+            type_has_refcount(key_type) ? DictionaryFlag::KeysAreObjects : 0) |
+          ((value_type == ValueType::Int) ? DictionaryFlag::ValuesAreInts :
+            type_has_refcount(value_type) ? DictionaryFlag::ValuesAreObjects : 0);
       DictionaryObject* d = dictionary_new(key_length, key_at, flags);
 
       for (const auto& item : *value.dict_value) {
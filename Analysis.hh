@@ -13,6 +13,8 @@
 #include "Parser/SourceFile.hh"
 #include "Parser/PythonASTNodes.hh"
 #include "Assembler/CodeBuffer.hh"
+#include "Types/Dictionary.hh"
+#include "Types/Format.hh"
 #include "Types/Strings.hh"
 #include "Environment.hh"
 
@@ -42,13 +44,18 @@ struct BuiltinFunctionDefinition {
   std::vector<BuiltinFragmentDefinition> fragments;
   bool pass_exception_block;
   bool register_globally;
+  // names of the arguments that can be passed by keyword, in order. this may be
+  // shorter than the argument list; unnamed arguments are positional-only
+  std::vector<std::string> arg_names;
 
   BuiltinFunctionDefinition(const char* name,
       const std::vector<Variable>& arg_types, Variable return_type,
-      const void* compiled, bool pass_exception_block, bool register_globally);
+      const void* compiled, bool pass_exception_block, bool register_globally,
+      const std::vector<std::string>& arg_names = {});
   BuiltinFunctionDefinition(const char* name,
       const std::vector<BuiltinFragmentDefinition>& fragments,
-      bool pass_exception_block, bool register_globally);
+      bool pass_exception_block, bool register_globally,
+      const std::vector<std::string>& arg_names = {});
 };
 
 struct BuiltinClassDefinition {
@@ -120,6 +127,7 @@ struct FunctionContext {
   struct Fragment {
     Variable return_type;
     const void* compiled;
+    std::vector<Variable> arg_types; // only set for built-in fragments
     std::multimap<size_t, std::string> compiled_labels;
 
     Fragment(Variable return_type, const void* compiled);
@@ -137,7 +145,8 @@ struct FunctionContext {
   // constructor for builtin functions
   FunctionContext(ModuleAnalysis* module, int64_t id, const char* name,
     const std::vector<BuiltinFragmentDefinition>& fragments,
-    bool pass_exception_block);
+    bool pass_exception_block,
+    const std::vector<std::string>& arg_names = {});
 
   bool is_class_init() const;
 };
@@ -202,6 +211,9 @@ public:
 
   std::unordered_map<std::string, BytesObject*> bytes_constants;
   std::unordered_map<std::wstring, UnicodeObject*> unicode_constants;
+  std::unordered_map<std::string, BytesFormatProgram> bytes_format_programs;
+  std::unordered_map<std::wstring, UnicodeFormatProgram> unicode_format_programs;
+  std::unordered_map<const ArrayIndex*, DictionaryLookupCache> dictionary_lookup_caches;
 
   GlobalAnalysis(const std::vector<std::string>& import_paths);
   ~GlobalAnalysis();
@@ -232,6 +244,14 @@ public:
   const UnicodeObject* get_or_create_constant(const std::wstring& s,
       bool use_shared_constants = true);
 
+  const BytesFormatProgram* get_or_create_format_program(
+      const std::string& format);
+  const UnicodeFormatProgram* get_or_create_format_program(
+      const std::wstring& format);
+
+  DictionaryLookupCache* get_or_create_dictionary_lookup_cache(
+      const ArrayIndex* site);
+
   int64_t construct_value(const Variable& value,
       bool use_shared_constants = true);
 
@@ -37,6 +37,18 @@ void AnalysisVisitor::visit(BinaryOperation* a) {
 
   a->right->accept(this);
 
+  // annotate the AST node with the format string if we know it, so the
+  // compiler can compile it ahead of time
+  if ((a->oper == BinaryOperator::Modulus) && left.value_known) {
+    if (left.type == ValueType::Bytes) {
+      a->format_known = true;
+      a->bytes_format = *left.bytes_value;
+    } else if (left.type == ValueType::Unicode) {
+      a->format_known = true;
+      a->unicode_format = *left.unicode_value;
+    }
+  }
+
   try {
     this->current_value = execute_binary_operator(a->oper, left,
         this->current_value);
@@ -104,18 +116,63 @@ void AnalysisVisitor::visit(TupleConstructor* a) {
 }
 
 void AnalysisVisitor::visit(ListComprehension* a) {
-  // for now, just make these unknown-value lists
-  this->current_value = Variable(ValueType::List);
+  // AnnotationVisitor gave the loop variable a name private to the
+  // comprehension, so it's assigned like any other local or global
+  this->visit_iteration_source(a->source_data.get(), a->file_offset);
+  a->variable->accept(this);
+  if (a->predicate.get()) {
+    a->predicate->accept(this);
+  }
+  a->item_pattern->accept(this);
+
+  // if we can't tell what the items will be, leave the entire result
+  // Indeterminate so CompilationVisitor can fill in the real type later
+  Variable item_type = this->current_value.type_only();
+  if (item_type.type == ValueType::Indeterminate) {
+    this->current_value = Variable();
+  } else {
+    this->current_value = Variable(ValueType::List,
+        vector<Variable>({item_type}));
+  }
 }
 
 void AnalysisVisitor::visit(SetComprehension* a) {
-  // for now, just make these unknown-value sets
-  this->current_value = Variable(ValueType::Set);
+  // same as for ListComprehension
+  this->visit_iteration_source(a->source_data.get(), a->file_offset);
+  a->variable->accept(this);
+  if (a->predicate.get()) {
+    a->predicate->accept(this);
+  }
+  a->item_pattern->accept(this);
+
+  Variable item_type = this->current_value.type_only();
+  if (item_type.type == ValueType::Indeterminate) {
+    this->current_value = Variable();
+  } else {
+    this->current_value = Variable(ValueType::Set,
+        vector<Variable>({item_type}));
+  }
 }
 
 void AnalysisVisitor::visit(DictComprehension* a) {
-  // for now, just make these unknown-value dicts
-  this->current_value = Variable(ValueType::Dict);
+  // same as for ListComprehension, but there are two patterns
+  this->visit_iteration_source(a->source_data.get(), a->file_offset);
+  a->variable->accept(this);
+  if (a->predicate.get()) {
+    a->predicate->accept(this);
+  }
+  a->key_pattern->accept(this);
+  Variable key_type = this->current_value.type_only();
+  a->value_pattern->accept(this);
+  Variable value_type = this->current_value.type_only();
+
+  if ((key_type.type == ValueType::Indeterminate) ||
+      (value_type.type == ValueType::Indeterminate)) {
+    this->current_value = Variable();
+  } else {
+    this->current_value = Variable(ValueType::Dict,
+        vector<Variable>({key_type, value_type}));
+  }
 }
 
 void AnalysisVisitor::visit(LambdaDefinition* a) {
@@ -155,6 +212,57 @@ void AnalysisVisitor::visit(LambdaDefinition* a) {
   this->current_value = Variable(ValueType::Function, a->function_id);
 }
 
+static Variable builtin_return_type(const FunctionContext* fn,
+    vector<Variable>&& arg_types,
+    const unordered_map<string, Variable>& keyword_arg_types) {
+  // fill in keyword arguments and default values for any omitted arguments
+  for (size_t x = arg_types.size(); x < fn->args.size(); x++) {
+    auto keyword_it = fn->args[x].name.empty() ? keyword_arg_types.end() :
+        keyword_arg_types.find(fn->args[x].name);
+    if (keyword_it != keyword_arg_types.end()) {
+      arg_types.emplace_back(keyword_it->second);
+    } else if (fn->args[x].default_value.type == ValueType::Indeterminate) {
+      return Variable();
+    } else {
+      arg_types.emplace_back(fn->args[x].default_value.type_only());
+    }
+  }
+  for (const auto& arg_type : arg_types) {
+    if (arg_type.type == ValueType::Indeterminate) {
+      return Variable();
+    }
+  }
+
+  const FunctionContext::Fragment* match = NULL;
+  vector<Variable> match_bindings;
+  for (const auto& it : fn->fragments) {
+    const auto& fragment_arg_types = it.second.arg_types;
+    if (fragment_arg_types.size() != arg_types.size()) {
+      continue;
+    }
+    vector<Variable> bindings;
+    size_t x;
+    for (x = 0; x < arg_types.size(); x++) {
+      if (!match_extension_type_references(fragment_arg_types[x], arg_types[x],
+          bindings)) {
+        break;
+      }
+    }
+    if (x == arg_types.size()) {
+      if (match) {
+        return Variable(); // ambiguous; CompilationVisitor will choose
+      }
+      match = &it.second;
+      match_bindings = move(bindings);
+    }
+  }
+
+  if (!match) {
+    return Variable();
+  }
+  return resolve_extension_type_references(match->return_type, match_bindings);
+}
+
 void AnalysisVisitor::visit(FunctionCall* a) {
   // the function reference had better be a function
   a->function->accept(this);
@@ -165,11 +273,15 @@ void AnalysisVisitor::visit(FunctionCall* a) {
   Variable function = move(this->current_value);
 
   // now visit the arg values
+  vector<Variable> arg_types;
   for (auto& arg : a->args) {
     arg->accept(this);
+    arg_types.emplace_back(this->current_value.type_only());
   }
+  unordered_map<string, Variable> keyword_arg_types;
   for (auto& it : a->kwargs) {
     it.second->accept(this);
+    keyword_arg_types.emplace(it.first, this->current_value.type_only());
   }
 
   // TODO: typecheck the arguments if the function's arguments have annotations
@@ -186,13 +298,26 @@ void AnalysisVisitor::visit(FunctionCall* a) {
     // Analyzed phase or later or is in the current module, then we should know
     // its possible return types
     auto* callee_fn = this->global->context_for_function(a->callee_function_id);
-    if (!callee_fn->module || (callee_fn->module == this->module) ||
-        (callee_fn->module->phase >= ModuleAnalysis::Phase::Analyzed)) {
+    if (callee_fn && (!callee_fn->module || (callee_fn->module == this->module) ||
+        (callee_fn->module->phase >= ModuleAnalysis::Phase::Analyzed))) {
       if (callee_fn->return_types.empty()) {
         this->current_value = Variable(ValueType::None);
-      } else if (callee_fn->return_types.size() == 1) {
+      } else if ((callee_fn->return_types.size() == 1) &&
+          !has_extension_type_references(*callee_fn->return_types.begin())) {
+        // (generic return types are resolved during compilation)
         this->current_value = *callee_fn->return_types.begin();
+
+      } else if (!callee_fn->module && !callee_fn->class_id &&
+          !a->varargs.get() && !a->varkwargs.get()) {
+        // for built-in functions that aren't methods, we can resolve generic
+        // return types here if exactly one fragment matches the arguments
+        this->current_value = builtin_return_type(callee_fn,
+            move(arg_types), keyword_arg_types);
       }
+
+    // calling a built-in class with no __init__ just creates an instance
+    } else if (!callee_fn && (function.type == ValueType::Class)) {
+      this->current_value = Variable(ValueType::Instance, function.class_id, nullptr);
     }
   }
 
@@ -232,9 +357,16 @@ void AnalysisVisitor::visit(ArrayIndex* a) {
       a->index_value = this->current_value.int_value;
     }
 
-    // if we don't know the array value, we can't know the result type
+    // if we don't know the array value, we can't know the result type (except
+    // for bytes and unicode, where it's always the same)
     if (!array.value_known) {
-      this->current_value = Variable(ValueType::Indeterminate);
+      if (array.type == ValueType::Bytes) {
+        this->current_value = Variable(ValueType::Int);
+      } else if (array.type == ValueType::Unicode) {
+        this->current_value = Variable(ValueType::Unicode);
+      } else {
+        this->current_value = Variable(ValueType::Indeterminate);
+      }
       return;
     }
   }
@@ -244,7 +376,7 @@ void AnalysisVisitor::visit(ArrayIndex* a) {
 
     // if we know the array value but not the index, we can know the result type
     if (!this->current_value.value_known) {
-      this->current_value = Variable(ValueType::Bytes);
+      this->current_value = Variable(ValueType::Int);
       return;
     }
 
@@ -256,8 +388,8 @@ void AnalysisVisitor::visit(ArrayIndex* a) {
     if ((index < 0) || (index >= static_cast<int64_t>(array.bytes_value->size()))) {
       this->current_value = Variable(ValueType::Indeterminate);
     } else {
-      this->current_value = Variable(ValueType::Bytes,
-          array.bytes_value->substr(index, 1));
+      this->current_value = Variable(ValueType::Int,
+          static_cast<int64_t>(static_cast<uint8_t>((*array.bytes_value)[index])));
     }
 
   } else if (array.type == ValueType::Unicode) {
@@ -350,8 +482,33 @@ void AnalysisVisitor::visit(ArrayIndex* a) {
 }
 
 void AnalysisVisitor::visit(ArraySlice* a) {
-  // TODO
-  throw compile_error("array slices are currently not supported", a->file_offset);
+  a->array->accept(this);
+  Variable array = move(this->current_value);
+
+  for (Expression* index : {a->start_index.get(), a->end_index.get(),
+      a->step_size.get()}) {
+    if (!index) {
+      continue;
+    }
+    index->accept(this);
+    if ((this->current_value.type != ValueType::Bool) &&
+        (this->current_value.type != ValueType::Int) &&
+        (this->current_value.type != ValueType::Indeterminate)) {
+      throw compile_error("slice index is not Bool or Int", a->file_offset);
+    }
+  }
+
+  // a slice has the same type as the collection it came from. we don't compute
+  // its value, even if the collection and indexes are known
+  if ((array.type == ValueType::Bytes) || (array.type == ValueType::Unicode) ||
+      (array.type == ValueType::List) ||
+      (array.type == ValueType::Indeterminate)) {
+    this->current_value = array.type_only();
+  } else {
+    string array_str = array.str();
+    throw compile_error(string_printf("cannot slice %s", array_str.c_str()),
+        a->file_offset);
+  }
 }
 
 void AnalysisVisitor::visit(IntegerConstant* a) {
@@ -428,14 +585,15 @@ void AnalysisVisitor::visit(AttributeLookup* a) {
       throw compile_error("attribute lookup on None value", a->file_offset);
     case ValueType::Bool:
       throw compile_error("attribute lookup on Bool value", a->file_offset);
-    case ValueType::Int:
-      throw compile_error("attribute lookup on Int value", a->file_offset);
     case ValueType::Float:
       throw compile_error("attribute lookup on Float value", a->file_offset);
     case ValueType::Function:
       throw compile_error("attribute lookup on Function value", a->file_offset);
 
     // look up the class attribute
+    case ValueType::Int:
+      class_id = Int_class_id;
+      goto AttributeLookup_resume;
     case ValueType::Bytes:
       class_id = BytesObject_class_id;
       goto AttributeLookup_resume;
@@ -510,11 +668,37 @@ void AnalysisVisitor::visit(TupleLValueReference* a) {
   // in this visitor, we visit the values before the unpacking tuples, so we
   // can expect this->current_value to be accurate
 
+  // if we don't know what the value is, we don't know what the items are either
+  if (this->current_value.type == ValueType::Indeterminate) {
+    for (auto& item : a->items) {
+      this->current_value = Variable();
+      item->accept(this);
+    }
+    return;
+  }
+
   if ((this->current_value.type != ValueType::List) && (this->current_value.type != ValueType::Tuple)) {
     throw compile_error("cannot unpack something that\'s not a List or Tuple", a->file_offset);
   }
+
+  // if the value isn't known, the items' types may still be: a Tuple's
+  // extension types are the types of its items, and every item in a List has
+  // the same type (the List's length is checked at runtime)
   if (!this->current_value.value_known) {
-    throw compile_error("cannot unpack unknown values", a->file_offset);
+    Variable base_value = move(this->current_value);
+    if (base_value.type == ValueType::Tuple) {
+      if (base_value.extension_types.size() != a->items.size()) {
+        throw compile_error("unpacking format length doesn\'t match Tuple count", a->file_offset);
+      }
+    } else if (base_value.extension_types.size() != 1) {
+      throw compile_error("cannot unpack List with unknown item type", a->file_offset);
+    }
+    for (size_t x = 0; x < a->items.size(); x++) {
+      this->current_value = base_value.extension_types[
+          (base_value.type == ValueType::Tuple) ? x : 0].type_only();
+      a->items[x]->accept(this);
+    }
+    return;
   }
   if (this->current_value.list_value->size() != a->items.size()) {
     throw compile_error("unpacking format length doesn\'t match List/Tuple count", a->file_offset);
@@ -528,11 +712,25 @@ void AnalysisVisitor::visit(TupleLValueReference* a) {
 }
 
 void AnalysisVisitor::visit(ArrayIndexLValueReference* a) {
-  // TODO: for now ignore these
+  // storing an item doesn't change the collection's type, but the collection
+  // and index expressions still need to be analyzed
+  Variable value = move(this->current_value);
+  a->array->accept(this);
+  a->index->accept(this);
+  this->current_value = move(value);
 }
 
 void AnalysisVisitor::visit(ArraySliceLValueReference* a) {
-  // TODO: for now ignore these
+  // as for ArrayIndexLValueReference, the collection's type doesn't change
+  Variable value = move(this->current_value);
+  a->array->accept(this);
+  for (Expression* index : {a->start_index.get(), a->end_index.get(),
+      a->step_size.get()}) {
+    if (index) {
+      index->accept(this);
+    }
+  }
+  this->current_value = move(value);
 }
 
 void AnalysisVisitor::visit(AttributeLValueReference* a) {
@@ -690,6 +888,14 @@ void AnalysisVisitor::visit(ReturnStatement* a) {
     }
 
     a->value->accept(this);
+
+    // mutable collections may be modified before the function returns (and
+    // can't be hashed anyway), so only their types are meaningful here
+    if ((this->current_value.type == ValueType::List) ||
+        (this->current_value.type == ValueType::Set) ||
+        (this->current_value.type == ValueType::Dict)) {
+      this->current_value.clear_value();
+    }
     fn->return_types.emplace(move(this->current_value));
   } else {
     fn->return_types.emplace(ValueType::None);
@@ -762,8 +968,27 @@ void AnalysisVisitor::visit(ElifStatement* a) {
   }
 }
 
-void AnalysisVisitor::visit(ForStatement* a) {
-  a->collection->accept(this);
+// returns the type of the items in a collection with a known value. if all the
+// items have the same type (including their extension types, so e.g. a list of
+// lists can still be unpacked), then that's the result; otherwise the result is
+// Indeterminate
+static Variable common_item_type(const vector<const Variable*>& items) {
+  Variable ret;
+  for (const Variable* item : items) {
+    if (item->type == ValueType::Indeterminate) {
+      return Variable();
+    } else if (ret.type == ValueType::Indeterminate) {
+      ret = item->type_only();
+    } else if (!ret.types_equal(*item)) {
+      return Variable();
+    }
+  }
+  return ret;
+}
+
+void AnalysisVisitor::visit_iteration_source(Expression* collection,
+    size_t file_offset) {
+  collection->accept(this);
 
   // if the current value is known, we can at least get the types of the values
   if (this->current_value.value_known) {
@@ -787,7 +1012,7 @@ void AnalysisVisitor::visit(ForStatement* a) {
         string target_value = this->current_value.str();
         throw compile_error(string_printf(
             "iteration target %s is not a collection", target_value.c_str()),
-            a->file_offset);
+            file_offset);
       }
 
       // these you can iterate. if all the values are the same type, then we can
@@ -799,64 +1024,30 @@ void AnalysisVisitor::visit(ForStatement* a) {
 
       case ValueType::List:
       case ValueType::Tuple: {
-        ValueType extension_type = ValueType::Indeterminate;
+        vector<const Variable*> items;
         for (const auto& item : *this->current_value.list_value) {
-          // if we encounter a single Indeterminate item, the entire result is
-          // Indeterminate
-          if (item->type == ValueType::Indeterminate) {
-            extension_type = ValueType::Indeterminate;
-            break;
-
-          // if we don't yet know the type, then record it
-          } else if (extension_type == ValueType::Indeterminate) {
-            extension_type = item->type;
-
-          // if this item's type doesn't match the type we've found so far, the
-          // entire result is Indeterminate
-          } else if (extension_type != item->type) {
-            extension_type = ValueType::Indeterminate;
-            break;
-          }
+          items.emplace_back(item.get());
         }
-        this->current_value = Variable(extension_type);
+        this->current_value = common_item_type(items);
         break;
       }
 
       case ValueType::Set: {
-        // same logic as for List/Tuple
-        // TODO: deduplicate this
-        ValueType extension_type = ValueType::Indeterminate;
+        vector<const Variable*> items;
         for (const auto& item : *this->current_value.set_value) {
-          if (item.type == ValueType::Indeterminate) {
-            extension_type = ValueType::Indeterminate;
-            break;
-          } else if (extension_type == ValueType::Indeterminate) {
-            extension_type = item.type;
-          } else if (extension_type != item.type) {
-            extension_type = ValueType::Indeterminate;
-            break;
-          }
+          items.emplace_back(&item);
         }
-        this->current_value = Variable(extension_type);
+        this->current_value = common_item_type(items);
         break;
       }
 
       case ValueType::Dict: {
-        // same logic as for List/Tuple, except just use the keys
-        // TODO: deduplicate this
-        ValueType extension_type = ValueType::Indeterminate;
+        // iterating a dict yields its keys
+        vector<const Variable*> items;
         for (const auto& item : *this->current_value.dict_value) {
-          if (item.first.type == ValueType::Indeterminate) {
-            extension_type = ValueType::Indeterminate;
-            break;
-          } else if (extension_type == ValueType::Indeterminate) {
-            extension_type = item.first.type;
-          } else if (extension_type != item.first.type) {
-            extension_type = ValueType::Indeterminate;
-            break;
-          }
+          items.emplace_back(&item.first);
         }
-        this->current_value = Variable(extension_type);
+        this->current_value = common_item_type(items);
         break;
       }
     }
@@ -869,15 +1060,30 @@ void AnalysisVisitor::visit(ForStatement* a) {
       // if we don't know the collection type, we can't know the value type;
       // just proceed without knowing
       case ValueType::Indeterminate:
+        this->current_value = Variable(ValueType::Indeterminate);
+        break;
 
-      // for these we can't know what the result type will be without also
-      // knowing the value
+      // for these, the extension types tell us the item type if they're all
+      // the same (for dicts, we iterate over the keys)
       case ValueType::List:
       case ValueType::Tuple:
       case ValueType::Set:
-      case ValueType::Dict:
-        this->current_value = Variable(ValueType::Indeterminate);
+      case ValueType::Dict: {
+        Variable item_type;
+        if (!this->current_value.extension_types.empty()) {
+          item_type = this->current_value.extension_types[0].type_only();
+          if (this->current_value.type == ValueType::Tuple) {
+            for (const auto& extension_type : this->current_value.extension_types) {
+              if (!item_type.types_equal(extension_type)) {
+                item_type = Variable(ValueType::Indeterminate);
+                break;
+              }
+            }
+          }
+        }
+        this->current_value = move(item_type);
         break;
+      }
 
       // silly programmer; you can't iterate these types
       case ValueType::None:
@@ -891,7 +1097,7 @@ void AnalysisVisitor::visit(ForStatement* a) {
         string target_type = this->current_value.str();
         throw compile_error(string_printf(
             "iteration target of type %s is not a collection", target_type.c_str()),
-            a->file_offset);
+            file_offset);
       }
 
       // even if we don't know the value, we know what type the result will be
@@ -901,8 +1107,58 @@ void AnalysisVisitor::visit(ForStatement* a) {
         break;
     }
   }
+}
 
-  a->variable->accept(this);
+void AnalysisVisitor::visit(ForStatement* a) {
+  // loops like `for i, x in enumerate(l)` and `for x, y in zip(l1, l2)` don't
+  // call the function at all; CompilationVisitor iterates over its arguments in
+  // lockstep and writes the items directly to the unpacked variables. so the
+  // variables get the types of the arguments' items
+  FunctionCall* call = dynamic_cast<FunctionCall*>(a->collection.get());
+  TupleLValueReference* targets = dynamic_cast<TupleLValueReference*>(
+      a->variable.get());
+  if (call && targets && call->kwargs.empty() && !call->varargs.get() &&
+      !call->varkwargs.get()) {
+    call->function->accept(this);
+    if ((this->current_value.type == ValueType::Function) &&
+        this->current_value.value_known) {
+      int64_t function_id = this->current_value.function_id;
+      if (((function_id == enumerate_function_id) &&
+           (targets->items.size() == 2) && !call->args.empty() &&
+           (call->args.size() <= 2)) ||
+          ((function_id == zip_function_id) && !call->args.empty() &&
+           (targets->items.size() == call->args.size()))) {
+        a->fused_iteration = true;
+        call->callee_function_id = function_id;
+        call->split_id = 0;
+      }
+    }
+  }
+
+  if (a->fused_iteration) {
+    vector<Variable> item_types;
+    if (call->callee_function_id == enumerate_function_id) {
+      item_types.emplace_back(ValueType::Int);
+      this->visit_iteration_source(call->args[0].get(), a->file_offset);
+      item_types.emplace_back(move(this->current_value));
+      if (call->args.size() == 2) {
+        call->args[1]->accept(this);
+      }
+    } else {
+      for (auto& arg : call->args) {
+        this->visit_iteration_source(arg.get(), a->file_offset);
+        item_types.emplace_back(move(this->current_value));
+      }
+    }
+    for (size_t x = 0; x < item_types.size(); x++) {
+      this->current_value = move(item_types[x]);
+      targets->items[x]->accept(this);
+    }
+
+  } else {
+    this->visit_iteration_source(a->collection.get(), a->file_offset);
+    a->variable->accept(this);
+  }
 
   this->visit_list(a->items);
   if (a->else_suite.get()) {
@@ -1107,11 +1363,22 @@ void AnalysisVisitor::record_assignment_generic(map<string, Variable>& vars,
     const string& name, const Variable& value, size_t file_offset) {
   auto& var = vars.at(name);
   if (var.type == ValueType::Indeterminate) {
-    var = value; // this is the first write
+    // this is the first write. lists, sets and dicts can be modified in place
+    // (e.g. by their methods), so we can't assume they keep their values
+    if ((value.type == ValueType::List) || (value.type == ValueType::Set) ||
+        (value.type == ValueType::Dict)) {
+      var = value.type_only();
+    } else {
+      var = value;
+    }
+  } else if (value.type == ValueType::Indeterminate) {
+    // we don't know what's being written (e.g. it depends on a function
+    // argument); CompilationVisitor checks the type when it's known
+    var.clear_value();
   } else {
     if (!var.types_equal(value)) {
-      string existing_type = var.str();
-      string new_type = value.str();
+      string existing_type = var.type_only().str();
+      string new_type = value.type_only().str();
       throw compile_error(string_printf("%s changes type (from %s to %s)",
           name.c_str(), existing_type.c_str(), new_type.c_str()), file_offset);
     }
@@ -91,6 +91,10 @@ private:
   FunctionContext* current_function();
   ClassContext* current_class();
 
+  // visits an iteration source (e.g. the collection in a for loop) and leaves
+  // the type of its items in current_value
+  void visit_iteration_source(Expression* collection, size_t file_offset);
+
   void record_assignment_generic(std::map<std::string, Variable>& vars,
       const std::string& name, const Variable& value, size_t file_offset);
   void record_assignment_global(const std::string& name, const Variable& value,
@@ -110,6 +110,46 @@ void AnnotationVisitor::visit(ExceptStatement* a) {
   this->RecursiveASTVisitor::visit(a);
 }
 
+void AnnotationVisitor::visit(ListComprehension* a) {
+  // the source is evaluated in the enclosing scope, but the loop variable
+  // belongs to the comprehension (as in python 3), so it can't clobber or
+  // change the type of a variable with the same name outside
+  a->source_data->accept(this);
+  this->rename_comprehension_variables(a->variable.get(),
+      {a->item_pattern.get(), a->predicate.get()}, a->file_offset);
+  a->variable->accept(this);
+  if (a->predicate.get()) {
+    a->predicate->accept(this);
+  }
+  a->item_pattern->accept(this);
+}
+
+void AnnotationVisitor::visit(SetComprehension* a) {
+  // same as for ListComprehension
+  a->source_data->accept(this);
+  this->rename_comprehension_variables(a->variable.get(),
+      {a->item_pattern.get(), a->predicate.get()}, a->file_offset);
+  a->variable->accept(this);
+  if (a->predicate.get()) {
+    a->predicate->accept(this);
+  }
+  a->item_pattern->accept(this);
+}
+
+void AnnotationVisitor::visit(DictComprehension* a) {
+  // same as for ListComprehension, but there are two patterns
+  a->source_data->accept(this);
+  this->rename_comprehension_variables(a->variable.get(),
+      {a->key_pattern.get(), a->value_pattern.get(), a->predicate.get()},
+      a->file_offset);
+  a->variable->accept(this);
+  if (a->predicate.get()) {
+    a->predicate->accept(this);
+  }
+  a->key_pattern->accept(this);
+  a->value_pattern->accept(this);
+}
+
 void AnnotationVisitor::visit(FunctionDefinition* a) {
   visit_list(a->decorators);
 
@@ -249,6 +289,90 @@ ClassContext* AnnotationVisitor::current_class() {
   return this->global->context_for_class(this->in_class_id, this->module);
 }
 
+// collects the names assigned by a comprehension's loop variable pattern
+class ComprehensionVariableCollector : public RecursiveASTVisitor {
+public:
+  unordered_set<string> names;
+
+  using RecursiveASTVisitor::visit;
+
+  virtual void visit(AttributeLValueReference* a) {
+    if (!a->base.get()) {
+      this->names.emplace(a->name);
+    }
+    this->RecursiveASTVisitor::visit(a);
+  }
+};
+
+// renames reads and writes of the given variables. lambda arguments shadow
+// the renamed names, so references to those aren't renamed within the lambda
+class ComprehensionVariableRenamer : public RecursiveASTVisitor {
+public:
+  unordered_map<string, string> renames;
+
+  using RecursiveASTVisitor::visit;
+
+  virtual void visit(AttributeLValueReference* a) {
+    if (!a->base.get()) {
+      this->rename(a->name);
+    }
+    this->RecursiveASTVisitor::visit(a);
+  }
+
+  virtual void visit(VariableLookup* a) {
+    this->rename(a->name);
+  }
+
+  virtual void visit(LambdaDefinition* a) {
+    auto prev_renames = this->renames;
+    for (const auto& arg : a->args.args) {
+      this->renames.erase(arg.name);
+    }
+    this->renames.erase(a->args.varargs_name);
+    this->renames.erase(a->args.varkwargs_name);
+    this->RecursiveASTVisitor::visit(a);
+    this->renames = move(prev_renames);
+  }
+
+private:
+  void rename(string& name) {
+    auto it = this->renames.find(name);
+    if (it != this->renames.end()) {
+      name = it->second;
+    }
+  }
+};
+
+void AnnotationVisitor::rename_comprehension_variables(Expression* variable,
+    const vector<Expression*>& scope, size_t file_offset) {
+  // comprehensions directly inside a class body would turn their variables
+  // into class attributes, which have no private equivalent, so they still
+  // bind in the class scope
+  if (!this->in_function_id && this->in_class_id) {
+    return;
+  }
+
+  // give each loop variable a name that can't collide with anything in the
+  // enclosing scope. if the comprehension is nested inside another one that
+  // binds the same name, the name was already renamed once; replace that
+  // suffix instead of stacking them
+  ComprehensionVariableCollector collector;
+  variable->accept(&collector);
+  ComprehensionVariableRenamer renamer;
+  for (const auto& name : collector.names) {
+    string base_name = name.substr(0, name.find('@'));
+    renamer.renames.emplace(name, string_printf("%s@Comprehension+%zu",
+        base_name.c_str(), file_offset));
+  }
+
+  variable->accept(&renamer);
+  for (auto* expr : scope) {
+    if (expr) {
+      expr->accept(&renamer);
+    }
+  }
+}
+
 void AnnotationVisitor::record_write(const string& name, size_t file_offset) {
   if (name.empty()) {
     throw compile_error("empty name in record_write", file_offset);
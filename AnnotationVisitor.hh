@@ -27,6 +27,9 @@ public:
   virtual void visit(GlobalStatement* a);
   virtual void visit(AttributeLValueReference* a);
   virtual void visit(ExceptStatement* a);
+  virtual void visit(ListComprehension* a);
+  virtual void visit(SetComprehension* a);
+  virtual void visit(DictComprehension* a);
   virtual void visit(FunctionDefinition* a);
   virtual void visit(LambdaDefinition* a);
   virtual void visit(ClassDefinition* a);
@@ -51,4 +54,6 @@ private:
   ClassContext* current_class();
 
   void record_write(const std::string& name, size_t file_offset);
+  void rename_comprehension_variables(Expression* variable,
+      const std::vector<Expression*>& scope, size_t file_offset);
 };
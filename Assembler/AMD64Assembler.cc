@@ -1,5 +1,6 @@
 #include "AMD64Assembler.hh"
 
+#include <cpuid.h>
 #include <inttypes.h>
 
 #include <phosg/Strings.hh>
@@ -8,6 +9,83 @@
 using namespace std;
 
 
+
+CPUFeatures::CPUFeatures() : sse41(false), popcnt(false), lzcnt(false), bmi1(false),
+    bmi2(false), avx(false), avx2(false), fma(false) { }
+
+static CPUFeatures detect_cpu_features() {
+  CPUFeatures ret;
+
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t max_leaf = __get_cpuid_max(0, NULL);
+  if (max_leaf < 1) {
+    return ret;
+  }
+  __cpuid(1, eax, ebx, ecx, edx);
+  ret.sse41 = ecx & (1 << 19);
+  ret.popcnt = ecx & (1 << 23);
+  bool has_fma = ecx & (1 << 12);
+  bool has_avx = ecx & (1 << 28);
+
+  // the OS has to save the xmm and ymm registers (XCR0 bits 1 and 2) for avx
+  // to be usable at all
+  if ((ecx & (1 << 27)) && has_avx) {
+    uint32_t xcr0_low, xcr0_high;
+    __asm__ ("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+    ret.avx = ((xcr0_low & 6) == 6);
+  }
+  ret.fma = ret.avx && has_fma;
+
+  if (max_leaf >= 7) {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    ret.bmi1 = ebx & (1 << 3);
+    ret.avx2 = ret.avx && (ebx & (1 << 5));
+    ret.bmi2 = ebx & (1 << 8);
+  }
+
+  if (__get_cpuid_max(0x80000000, NULL) >= 0x80000001) {
+    __cpuid(0x80000001, eax, ebx, ecx, edx);
+    ret.lzcnt = ecx & (1 << 5);
+  }
+
+  return ret;
+}
+
+const CPUFeatures& CPUFeatures::host() {
+  static const CPUFeatures features = detect_cpu_features();
+  return features;
+}
+
+string CPUFeatures::str() const {
+  string ret = "sse2";
+  if (this->sse41) {
+    ret += " sse4.1";
+  }
+  if (this->popcnt) {
+    ret += " popcnt";
+  }
+  if (this->lzcnt) {
+    ret += " lzcnt";
+  }
+  if (this->bmi1) {
+    ret += " bmi1";
+  }
+  if (this->bmi2) {
+    ret += " bmi2";
+  }
+  if (this->avx) {
+    ret += " avx";
+  }
+  if (this->avx2) {
+    ret += " avx2";
+  }
+  if (this->fma) {
+    ret += " fma";
+  }
+  return ret;
+}
+
+
 const char* name_for_register(Register r, OperandSize size) {
   switch (size) {
     case OperandSize::Automatic:
@@ -217,6 +295,44 @@ const char* name_for_register(Register r, OperandSize size) {
         default:
           return "UNKNOWNFLOAT";
       }
+
+    case OperandSize::YMMWord:
+      switch (r) {
+        case Register::XMM0:
+          return "ymm0";
+        case Register::XMM1:
+          return "ymm1";
+        case Register::XMM2:
+          return "ymm2";
+        case Register::XMM3:
+          return "ymm3";
+        case Register::XMM4:
+          return "ymm4";
+        case Register::XMM5:
+          return "ymm5";
+        case Register::XMM6:
+          return "ymm6";
+        case Register::XMM7:
+          return "ymm7";
+        case Register::XMM8:
+          return "ymm8";
+        case Register::XMM9:
+          return "ymm9";
+        case Register::XMM10:
+          return "ymm10";
+        case Register::XMM11:
+          return "ymm11";
+        case Register::XMM12:
+          return "ymm12";
+        case Register::XMM13:
+          return "ymm13";
+        case Register::XMM14:
+          return "ymm14";
+        case Register::XMM15:
+          return "ymm15";
+        default:
+          return "UNKNOWNVECTOR";
+      }
   }
   return "UNKNOWN";
 }
@@ -634,6 +750,38 @@ void AMD64Assembler::write_rm(Operation op, const MemoryReference& mem,
       skip_64bit_prefix));
 }
 
+string AMD64Assembler::generate_vex_rm(uint8_t opcode, uint8_t map_select,
+    uint8_t pp, bool w, bool l, const MemoryReference& mem, Register reg,
+    Register vreg) {
+  // the modrm/sib/displacement bytes are the same as for the legacy encoding;
+  // the REX bits move into the VEX prefix (inverted), so drop the REX byte
+  bool reg_ext = is_extension_register(reg);
+  bool mem_index_ext = is_extension_register(mem.index_register);
+  bool mem_base_ext = is_extension_register(mem.base_register);
+  string legacy = generate_rm(static_cast<Operation>(opcode), mem, reg,
+      OperandSize::DoublePrecision);
+  if (reg_ext || mem_index_ext || mem_base_ext) {
+    legacy = legacy.substr(1);
+  }
+
+  string ret;
+  ret += 0xC4;
+  ret += (reg_ext ? 0x00 : 0x80) | (mem_index_ext ? 0x00 : 0x40) |
+      (mem_base_ext ? 0x00 : 0x20) | (map_select & 0x1F);
+  // opcodes that don't use vreg must set the field to 1111 (as if it were 0)
+  uint8_t vreg_bits = (vreg == Register::None) ? 0 : vreg;
+  ret += (w ? 0x80 : 0x00) | ((~vreg_bits & 0x0F) << 3) | (l ? 0x04 : 0x00) |
+      (pp & 0x03);
+  ret += legacy;
+  return ret;
+}
+
+void AMD64Assembler::write_vex_rm(uint8_t opcode, uint8_t map_select,
+    uint8_t pp, bool w, bool l, const MemoryReference& mem, Register reg,
+    Register vreg) {
+  this->write(this->generate_vex_rm(opcode, map_select, pp, w, l, mem, reg,
+      vreg));
+}
 
 
 
@@ -1022,6 +1170,32 @@ void AMD64Assembler::write_movsd(const MemoryReference& to,
   }
 }
 
+void AMD64Assembler::write_sqrtsd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::SQRTSD, from, to, OperandSize::DoublePrecision, 0xF2);
+}
+
+// these are all VEX.LIG.66.0F38.W1 (map 2, pp 1); the 231 forms compute
+// to = (src1 * src2) +/- to
+void AMD64Assembler::write_vfmadd231sd(Register to, Register src1,
+    const MemoryReference& src2) {
+  this->write_vex_rm(0xB9, 2, 1, true, false, src2, to, src1);
+}
+
+void AMD64Assembler::write_vfmsub231sd(Register to, Register src1,
+    const MemoryReference& src2) {
+  this->write_vex_rm(0xBB, 2, 1, true, false, src2, to, src1);
+}
+
+void AMD64Assembler::write_vfnmadd231sd(Register to, Register src1,
+    const MemoryReference& src2) {
+  this->write_vex_rm(0xBD, 2, 1, true, false, src2, to, src1);
+}
+
+void AMD64Assembler::write_vfmadd231pd(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0xB8, 2, 1, true, wide, src2, to, src1);
+}
+
 void AMD64Assembler::write_addsd(Register to, const MemoryReference& from) {
   this->write_rm(Operation::ADDSD, from, to, OperandSize::DoublePrecision, 0xF2);
 }
@@ -1103,6 +1277,216 @@ void AMD64Assembler::write_cvtsd2si(Register to, Register from) {
       OperandSize::QuadWord, 0xF2);
 }
 
+void AMD64Assembler::write_movupd(const MemoryReference& to,
+    const MemoryReference& from) {
+  if (to.field_size && from.field_size) {
+    throw invalid_argument("load/store opcodes can have at most one memory reference");
+  }
+
+  if (!from.field_size) {
+    this->write_rm(Operation::MOVUPD_STORE, to, from.base_register,
+        OperandSize::DoublePrecision, 0x66);
+  } else {
+    this->write_rm(Operation::MOVUPD_LOAD, from, to.base_register,
+        OperandSize::DoublePrecision, 0x66);
+  }
+}
+
+void AMD64Assembler::write_unpcklpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::UNPCKLPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_movmskpd(Register to, Register from) {
+  this->write_rm(Operation::MOVMSKPD, MemoryReference(from), to,
+      OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_andpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::ANDPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+// sets zf, pf and cf like an unsigned comparison; all three are set if either
+// value is NaN
+void AMD64Assembler::write_ucomisd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::UCOMISD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_xorpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::XORPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_addpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::ADDPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_subpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::SUBPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_mulpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::MULPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_divpd(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::DIVPD, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_paddq(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::PADDQ, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_psubq(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::PSUBQ, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_pand(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::PAND, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_por(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::POR, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+void AMD64Assembler::write_pxor(Register to, const MemoryReference& from) {
+  this->write_rm(Operation::PXOR, from, to, OperandSize::DoublePrecision, 0x66);
+}
+
+// the AVX versions of the packed opcodes are VEX.66.0F (map 1, pp 1) with the
+// same opcode bytes as the SSE2 versions, except vbroadcastsd
+void AMD64Assembler::write_vmovupd(const MemoryReference& to,
+    const MemoryReference& from, bool wide) {
+  if (to.field_size && from.field_size) {
+    throw invalid_argument("load/store opcodes can have at most one memory reference");
+  }
+  if (!to.field_size) {
+    this->write_vex_rm(0x10, 1, 1, false, wide, from, to.base_register,
+        Register::None);
+  } else {
+    this->write_vex_rm(0x11, 1, 1, false, wide, to, from.base_register,
+        Register::None);
+  }
+}
+
+void AMD64Assembler::write_vbroadcastsd(Register to, const MemoryReference& from) {
+  this->write_vex_rm(0x19, 2, 1, false, true, from, to, Register::None);
+}
+
+void AMD64Assembler::write_vmovmskpd(Register to, Register from, bool wide) {
+  this->write_vex_rm(0x50, 1, 1, false, wide, MemoryReference(from), to,
+      Register::None);
+}
+
+void AMD64Assembler::write_vxorpd(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0x57, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vaddpd(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0x58, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vsubpd(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0x5C, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vmulpd(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0x59, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vdivpd(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0x5E, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vpaddq(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0xD4, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vpsubq(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0xFB, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vpand(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0xDB, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vpor(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0xEB, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vpxor(Register to, Register src1,
+    const MemoryReference& src2, bool wide) {
+  this->write_vex_rm(0xEF, 1, 1, false, wide, src2, to, src1);
+}
+
+void AMD64Assembler::write_vzeroupper() {
+  this->write("\xC5\xF8\x77");
+}
+
+void AMD64Assembler::write_popcnt(Register to, const MemoryReference& from,
+    OperandSize size) {
+  this->write_rm(Operation::POPCNT, from, to, size, 0xF3);
+}
+
+void AMD64Assembler::write_lzcnt(Register to, const MemoryReference& from,
+    OperandSize size) {
+  this->write_rm(Operation::LZCNT, from, to, size, 0xF3);
+}
+
+void AMD64Assembler::write_tzcnt(Register to, const MemoryReference& from,
+    OperandSize size) {
+  this->write_rm(Operation::TZCNT, from, to, size, 0xF3);
+}
+
+void AMD64Assembler::write_bswap(Register r, OperandSize size) {
+  string data;
+  if ((size == OperandSize::QuadWord) || is_extension_register(r)) {
+    data += 0x40 | ((size == OperandSize::QuadWord) ? 0x08 : 0) |
+        (is_extension_register(r) ? 0x01 : 0);
+  }
+  data += 0x0F;
+  data += 0xC8 | (r & 7);
+  this->write(data);
+}
+
+// the BMI2 opcodes are VEX.LZ.0F38 (map 2); pp selects the operation
+void AMD64Assembler::write_pdep(Register to, Register from,
+    const MemoryReference& mask, OperandSize size) {
+  this->write_vex_rm(0xF5, 2, 3, (size == OperandSize::QuadWord), false, mask,
+      to, from);
+}
+
+void AMD64Assembler::write_pext(Register to, Register from,
+    const MemoryReference& mask, OperandSize size) {
+  this->write_vex_rm(0xF5, 2, 2, (size == OperandSize::QuadWord), false, mask,
+      to, from);
+}
+
+void AMD64Assembler::write_shlx(Register to, const MemoryReference& from,
+    Register count, OperandSize size) {
+  this->write_vex_rm(0xF7, 2, 1, (size == OperandSize::QuadWord), false, from,
+      to, count);
+}
+
+void AMD64Assembler::write_shrx(Register to, const MemoryReference& from,
+    Register count, OperandSize size) {
+  this->write_vex_rm(0xF7, 2, 3, (size == OperandSize::QuadWord), false, from,
+      to, count);
+}
+
+void AMD64Assembler::write_sarx(Register to, const MemoryReference& from,
+    Register count, OperandSize size) {
+  this->write_vex_rm(0xF7, 2, 2, (size == OperandSize::QuadWord), false, from,
+      to, count);
+}
+
 
 
 void AMD64Assembler::write_nop() {
@@ -1966,6 +2350,93 @@ static inline Register make_reg(bool is_ext, uint8_t reg) {
 static const char* math_op_names[] = {
     "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
 
+// names for the packed SSE2 opcodes (and ucomisd, which also has a 0x66
+// prefix), indexed by the byte after 0x0F
+static const char* packed_opcode_name(uint8_t opcode) {
+  switch (opcode) {
+    case 0x10:
+    case 0x11:
+      return "movupd";
+    case 0x14:
+      return "unpcklpd";
+    case 0x2E:
+      return "ucomisd";
+    case 0x50:
+      return "movmskpd";
+    case 0x54:
+      return "andpd";
+    case 0x57:
+      return "xorpd";
+    case 0x58:
+      return "addpd";
+    case 0x59:
+      return "mulpd";
+    case 0x5C:
+      return "subpd";
+    case 0x5E:
+      return "divpd";
+    case 0xD4:
+      return "paddq";
+    case 0xDB:
+      return "pand";
+    case 0xEB:
+      return "por";
+    case 0xEF:
+      return "pxor";
+    case 0xFB:
+      return "psubq";
+    default:
+      return NULL;
+  }
+}
+
+// VEX-encoded opcodes, by how their operands are used. R is the modrm reg
+// field, V is the VEX vreg field, and M is the modrm r/m field
+enum class VEXOperands {
+  VectorRVM = 0,
+  ScalarRVM, // always xmm registers, regardless of L
+  VectorLoad,
+  VectorStore,
+  Broadcast, // vector register, but the source is a single double
+  MoveMask, // 32-bit register, vector r/m
+  IntRVM, // general-purpose registers
+  IntRMV, // general-purpose registers
+};
+
+struct VEXOpcode {
+  uint8_t map_select;
+  uint8_t pp;
+  uint8_t opcode;
+  const char* name;
+  VEXOperands operands;
+};
+
+static const VEXOpcode vex_opcodes[] = {
+  {1, 1, 0x10, "vmovupd", VEXOperands::VectorLoad},
+  {1, 1, 0x11, "vmovupd", VEXOperands::VectorStore},
+  {1, 1, 0x50, "vmovmskpd", VEXOperands::MoveMask},
+  {1, 1, 0x57, "vxorpd", VEXOperands::VectorRVM},
+  {1, 1, 0x58, "vaddpd", VEXOperands::VectorRVM},
+  {1, 1, 0x59, "vmulpd", VEXOperands::VectorRVM},
+  {1, 1, 0x5C, "vsubpd", VEXOperands::VectorRVM},
+  {1, 1, 0x5E, "vdivpd", VEXOperands::VectorRVM},
+  {1, 1, 0xD4, "vpaddq", VEXOperands::VectorRVM},
+  {1, 1, 0xDB, "vpand", VEXOperands::VectorRVM},
+  {1, 1, 0xEB, "vpor", VEXOperands::VectorRVM},
+  {1, 1, 0xEF, "vpxor", VEXOperands::VectorRVM},
+  {1, 1, 0xFB, "vpsubq", VEXOperands::VectorRVM},
+  {2, 1, 0x19, "vbroadcastsd", VEXOperands::Broadcast},
+  {2, 1, 0xB8, "vfmadd231pd", VEXOperands::VectorRVM},
+  {2, 1, 0xB9, "vfmadd231sd", VEXOperands::ScalarRVM},
+  {2, 1, 0xBB, "vfmsub231sd", VEXOperands::ScalarRVM},
+  {2, 1, 0xBD, "vfnmadd231sd", VEXOperands::ScalarRVM},
+  {2, 2, 0xF5, "pext", VEXOperands::IntRVM},
+  {2, 3, 0xF5, "pdep", VEXOperands::IntRVM},
+  {2, 1, 0xF7, "shlx", VEXOperands::IntRMV},
+  {2, 2, 0xF7, "sarx", VEXOperands::IntRMV},
+  {2, 3, 0xF7, "shrx", VEXOperands::IntRMV},
+};
+
 static const char* jmp_names[] = {
     "jo", "jno", "jb", "jae", "je", "jne", "jbe", "ja",
     "js", "jns", "jp", "jnp", "jl", "jge", "jle", "jg"};
@@ -1990,6 +2461,7 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
   bool index_ext = false;
   bool reg_ext = false;
   bool xmm_prefix = false;
+  bool rep_prefix = false;
   OperandSize operand_size = OperandSize::DoubleWord;
 
   size_t offset = 0;
@@ -2017,18 +2489,120 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
       xmm_prefix = true;
       continue;
     }
+    if (opcode == Operation::REP_PREFIX) {
+      rep_prefix = true;
+      continue;
+    }
 
     string opcode_text;
 
+    // check for VEX-encoded opcodes. the 2-byte form implies map 1 and W = 0,
+    // and can't extend the base or index registers
+    if ((opcode == 0xC4) || (opcode == 0xC5)) {
+      size_t vex_size = (opcode == 0xC4) ? 3 : 2;
+      if (offset + vex_size > size) {
+        opcode_text = "<<incomplete-vex>>";
+        offset = size;
+      } else {
+        uint8_t vex1 = data[offset];
+        uint8_t vex2 = (opcode == 0xC4) ? data[offset + 1] : vex1;
+        if (opcode == 0xC5) {
+          vex1 = (vex1 & 0x80) | 0x61;
+          vex2 &= 0x7F;
+        }
+        opcode = data[offset + vex_size - 1];
+        offset += vex_size;
+
+        uint8_t map_select = vex1 & 0x1F;
+        uint8_t pp = vex2 & 0x03;
+        bool w = vex2 & 0x80;
+        bool l = vex2 & 0x04;
+        bool vex_reg_ext = !(vex1 & 0x80);
+        bool vex_index_ext = !(vex1 & 0x40);
+        bool vex_base_ext = !(vex1 & 0x20);
+        Register vreg = static_cast<Register>((~vex2 >> 3) & 0x0F);
+
+        const VEXOpcode* vex_opcode = NULL;
+        for (const auto& it : vex_opcodes) {
+          if ((it.map_select == map_select) && (it.pp == pp) &&
+              (it.opcode == opcode)) {
+            vex_opcode = &it;
+            break;
+          }
+        }
+
+        if ((map_select == 1) && (pp == 0) && (opcode == 0x77) && !l) {
+          opcode_text = "vzeroupper";
+
+        } else if (!vex_opcode) {
+          opcode_text = string_printf("<<unknown-vex-%02hhX-%02hhX-%02hhX>>",
+              vex1, vex2, opcode);
+
+        } else {
+          OperandSize vector_size = l ? OperandSize::YMMWord :
+              OperandSize::DoublePrecision;
+          OperandSize int_size = w ? OperandSize::QuadWord :
+              OperandSize::DoubleWord;
+          OperandSize reg_size = vector_size;
+          OperandSize mem_size = vector_size;
+          OperandSize vreg_size = vector_size;
+          bool is_load = true;
+          switch (vex_opcode->operands) {
+            case VEXOperands::VectorRVM:
+              break;
+            case VEXOperands::ScalarRVM:
+              reg_size = mem_size = vreg_size = OperandSize::DoublePrecision;
+              break;
+            case VEXOperands::VectorLoad:
+              break;
+            case VEXOperands::VectorStore:
+              is_load = false;
+              break;
+            case VEXOperands::Broadcast:
+              mem_size = OperandSize::DoublePrecision;
+              break;
+            case VEXOperands::MoveMask:
+              reg_size = OperandSize::DoubleWord;
+              break;
+            case VEXOperands::IntRVM:
+            case VEXOperands::IntRMV:
+              reg_size = mem_size = vreg_size = int_size;
+              break;
+          }
+
+          opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+              vex_opcode->name, is_load, NULL, true, vex_reg_ext, vex_base_ext,
+              vex_index_ext, reg_size, mem_size);
+          string vreg_name = name_for_register(vreg, vreg_size);
+          if ((vex_opcode->operands == VEXOperands::VectorRVM) ||
+              (vex_opcode->operands == VEXOperands::ScalarRVM) ||
+              (vex_opcode->operands == VEXOperands::IntRVM)) {
+            size_t comma_offset = opcode_text.find(", ");
+            if (comma_offset != string::npos) {
+              opcode_text.insert(comma_offset + 2, vreg_name + ", ");
+            }
+          } else if (vex_opcode->operands == VEXOperands::IntRMV) {
+            opcode_text += ", " + vreg_name;
+          }
+        }
+      }
+
     // check for extended opcodes
-    if (opcode == 0x0F) {
+    } else if (opcode == 0x0F) {
       if (offset >= size) {
         opcode_text = "<<incomplete>>";
       } else {
         opcode = data[offset];
         offset++;
 
-        if ((opcode & 0xFE) == 0x10) {
+        if ((operand_size == OperandSize::Word) && !xmm_prefix &&
+            packed_opcode_name(opcode)) {
+          opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+              packed_opcode_name(opcode), (opcode != 0x11), NULL, ext, reg_ext,
+              base_ext, index_ext, (opcode == 0x50) ? OperandSize::DoubleWord :
+              OperandSize::DoublePrecision, OperandSize::DoublePrecision);
+
+        } else if ((opcode & 0xFE) == 0x10) {
           if (!xmm_prefix) {
             opcode_text = "<<unknown-0F-non-xmm>>";
           } else {
@@ -2078,6 +2652,15 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
             }
           }
 
+        } else if (opcode == 0x51) {
+          if (!xmm_prefix) {
+            opcode_text = "<<unknown-0F-51-non-xmm>>";
+          } else {
+            opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+                "sqrtsd", true, NULL, ext, reg_ext, base_ext, index_ext,
+                OperandSize::DoublePrecision);
+          }
+
         } else if ((opcode & 0xF8) == 0x58) {
           if (!xmm_prefix) {
             opcode_text = "<<unknown-0F-58-non-xmm>>";
@@ -2130,6 +2713,18 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
               names[opcode & 0x0F], false, fake_names, ext, reg_ext, base_ext,
               index_ext, OperandSize::Byte);
 
+        } else if (rep_prefix && ((opcode == 0xB8) || (opcode == 0xBC) ||
+                   (opcode == 0xBD))) {
+          static const char* names[3] = {"popcnt", "tzcnt", "lzcnt"};
+          opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
+              names[(opcode == 0xB8) ? 0 : (opcode - 0xBB)], true, NULL, ext,
+              reg_ext, base_ext, index_ext, operand_size);
+
+        } else if ((opcode & 0xF8) == 0xC8) {
+          Register reg = make_reg(base_ext, opcode & 7);
+          opcode_text = string_printf("bswap    %s",
+              name_for_register(reg, operand_size));
+
         } else if (opcode == 0xAF) {
           opcode_text = AMD64Assembler::disassemble_rm(data, size, offset,
               "imul", true, NULL, ext, reg_ext, base_ext, index_ext,
@@ -2395,6 +2990,7 @@ string AMD64Assembler::disassemble(const void* vdata, size_t size,
     index_ext = false;
     reg_ext = false;
     xmm_prefix = false;
+    rep_prefix = false;
     operand_size = OperandSize::DoubleWord;
     opcode_start_offset = offset;
   }
@@ -2515,7 +3111,7 @@ string AMD64Assembler::disassemble_rm(const uint8_t* data, size_t size,
   // if the operand size of the memory operand isn't obvious, prefix it
   if (mem_str[0] == '[' && ((mem_operand_size != reg_operand_size) || op_name_table)) {
     static const vector<const char*> size_names({
-        "byte", "word", "dword", "qword", "float", "double"});
+        "byte", "word", "dword", "qword", "float", "double", "qword", "ymmword"});
     mem_str = string(size_names.at(mem_operand_size)) + " ptr " + mem_str;
   }
 
@@ -117,6 +117,7 @@ enum Operation {
   JMP8       = 0xEB,
   LOCK       = 0xF0,
   XMM_PREFIX = 0xF2,
+  REP_PREFIX = 0xF3,
   TEST_IMM8  = 0xF6,
   NOT_NEG8   = 0xF7,
   TEST_IMM32 = 0xF7,
@@ -226,6 +227,7 @@ enum Operation {
   IMUL       = 0x0FAF,
   MOVSD_LOAD  = 0x0F10,
   MOVSD_STORE = 0x0F11,
+  SQRTSD     = 0x0F51,
   ADDSD      = 0x0F58,
   MULSD      = 0x0F59,
   SUBSD      = 0x0F5C,
@@ -235,6 +237,29 @@ enum Operation {
   MOVZX8     = 0x0FB6,
   MOVZX16    = 0x0FB7,
   CMPSD      = 0x0FC2,
+
+  // bit-counting opcodes; these all have a 0xF3 prefix
+  POPCNT     = 0x0FB8,
+  TZCNT      = 0x0FBC,
+  LZCNT      = 0x0FBD,
+
+  // packed SSE2 opcodes (and ucomisd); these all have a 0x66 prefix
+  MOVUPD_LOAD  = 0x0F10,
+  MOVUPD_STORE = 0x0F11,
+  UNPCKLPD   = 0x0F14,
+  UCOMISD    = 0x0F2E,
+  MOVMSKPD   = 0x0F50,
+  ANDPD      = 0x0F54,
+  XORPD      = 0x0F57,
+  ADDPD      = 0x0F58,
+  MULPD      = 0x0F59,
+  SUBPD      = 0x0F5C,
+  DIVPD      = 0x0F5E,
+  PADDQ      = 0x0FD4,
+  PAND       = 0x0FDB,
+  POR        = 0x0FEB,
+  PXOR       = 0x0FEF,
+  PSUBQ      = 0x0FFB,
 };
 
 
@@ -358,6 +383,7 @@ enum OperandSize {
   SinglePrecision = 4,
   DoublePrecision = 5,
   QuadWordXMM = 6,
+  YMMWord = 7,
 };
 
 const char* name_for_register(Register r,
@@ -391,6 +417,28 @@ extern MemoryReference ax, cx, dx, bx, sp, bp, si, di, r8w, r9w, r10w, r11w, r12
 extern MemoryReference al, cl, dl, bl, ah, ch, dh, bh, r8b, r9b, r10b, r11b, r12b, r13b, r14b, r15b, spl, bpl, sil, dil;
 extern MemoryReference xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7, xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15;
 
+// features of the cpu we're running on. the base AMD64 architecture includes
+// SSE2, so that's always available; the opcodes marked with a feature below
+// may only be used if the cpu has that feature
+struct CPUFeatures {
+  bool sse41; // roundsd
+  bool popcnt;
+  bool lzcnt;
+  bool bmi1; // tzcnt
+  bool bmi2; // pdep, pext, shlx, shrx, sarx
+  bool avx; // VEX-encoded packed floating-point opcodes, on xmm and ymm regs
+  bool avx2; // VEX-encoded packed integer opcodes on ymm regs, vbroadcastsd reg
+  bool fma;
+
+  CPUFeatures(); // all features disabled
+
+  // probes the cpu (once) with cpuid. avx and the features that depend on it
+  // are only enabled if the OS saves the ymm registers on context switches
+  static const CPUFeatures& host();
+
+  std::string str() const;
+};
+
 class AMD64Assembler {
 public:
   AMD64Assembler() = default;
@@ -512,6 +560,7 @@ public:
   void write_movq_to_xmm(Register reg, const MemoryReference& from);
   void write_movq_from_xmm(const MemoryReference& from, Register reg);
   void write_movsd(const MemoryReference& to, const MemoryReference& from);
+  void write_sqrtsd(Register to, const MemoryReference& from);
   void write_addsd(Register to, const MemoryReference& from);
   void write_subsd(Register to, const MemoryReference& from);
   void write_mulsd(Register to, const MemoryReference& from);
@@ -531,6 +580,85 @@ public:
   void write_cvtsi2sd(Register to, const MemoryReference& from);
   void write_cvtsd2si(Register to, Register from);
 
+  // packed floating-point and integer stuff. these operate on two doubles or
+  // two int64s at once. memory operands don't need to be aligned
+  void write_movupd(const MemoryReference& to, const MemoryReference& from);
+  void write_unpcklpd(Register to, const MemoryReference& from);
+  void write_movmskpd(Register to, Register from);
+  void write_andpd(Register to, const MemoryReference& from);
+  void write_ucomisd(Register to, const MemoryReference& from);
+  void write_xorpd(Register to, const MemoryReference& from);
+  void write_addpd(Register to, const MemoryReference& from);
+  void write_subpd(Register to, const MemoryReference& from);
+  void write_mulpd(Register to, const MemoryReference& from);
+  void write_divpd(Register to, const MemoryReference& from);
+  void write_paddq(Register to, const MemoryReference& from);
+  void write_psubq(Register to, const MemoryReference& from);
+  void write_pand(Register to, const MemoryReference& from);
+  void write_por(Register to, const MemoryReference& from);
+  void write_pxor(Register to, const MemoryReference& from);
+
+  // fused multiply-add opcodes. these are VEX-encoded and only exist on cpus
+  // that support FMA3; the caller is responsible for checking this
+  void write_vfmadd231sd(Register to, Register src1, const MemoryReference& src2);
+  void write_vfmsub231sd(Register to, Register src1, const MemoryReference& src2);
+  void write_vfnmadd231sd(Register to, Register src1, const MemoryReference& src2);
+  void write_vfmadd231pd(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+
+  // AVX/AVX2 packed opcodes. these have a separate destination register and
+  // operate on four values in ymm registers if wide is true, or on two values
+  // in the low halves of them (like the SSE2 opcodes above) if not. the float
+  // ones need avx; the wide integer ones and vbroadcastsd from a register need
+  // avx2. code that uses the wide ones should use vzeroupper before returning
+  // to code that uses SSE opcodes, since mixing them is slow on some cpus
+  void write_vmovupd(const MemoryReference& to, const MemoryReference& from,
+      bool wide = true);
+  void write_vbroadcastsd(Register to, const MemoryReference& from);
+  void write_vmovmskpd(Register to, Register from, bool wide = true);
+  void write_vxorpd(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vaddpd(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vsubpd(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vmulpd(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vdivpd(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vpaddq(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vpsubq(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vpand(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vpor(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vpxor(Register to, Register src1, const MemoryReference& src2,
+      bool wide = true);
+  void write_vzeroupper();
+
+  // bit manipulation opcodes. popcnt, lzcnt and tzcnt need the popcnt, lzcnt
+  // and bmi1 features; the rest need bmi2. for the shifts, only the low 6 bits
+  // of the count are used (5 bits for DoubleWord)
+  void write_popcnt(Register to, const MemoryReference& from,
+      OperandSize size = OperandSize::QuadWord);
+  void write_lzcnt(Register to, const MemoryReference& from,
+      OperandSize size = OperandSize::QuadWord);
+  void write_tzcnt(Register to, const MemoryReference& from,
+      OperandSize size = OperandSize::QuadWord);
+  void write_bswap(Register r, OperandSize size = OperandSize::QuadWord);
+  void write_pdep(Register to, Register from, const MemoryReference& mask,
+      OperandSize size = OperandSize::QuadWord);
+  void write_pext(Register to, Register from, const MemoryReference& mask,
+      OperandSize size = OperandSize::QuadWord);
+  void write_shlx(Register to, const MemoryReference& from, Register count,
+      OperandSize size = OperandSize::QuadWord);
+  void write_shrx(Register to, const MemoryReference& from, Register count,
+      OperandSize size = OperandSize::QuadWord);
+  void write_sarx(Register to, const MemoryReference& from, Register count,
+      OperandSize size = OperandSize::QuadWord);
+
   // control flow opcodes
   void write_nop();
   void write_jmp(const std::string& label_name);
@@ -707,6 +835,11 @@ private:
   void write_rm(Operation op, const MemoryReference& mem, uint8_t z,
       OperandSize size, uint32_t extra_prefixes = 0,
       bool skip_64bit_prefix = false);
+  static std::string generate_vex_rm(uint8_t opcode, uint8_t map_select,
+      uint8_t pp, bool w, bool l, const MemoryReference& mem, Register reg,
+      Register vreg);
+  void write_vex_rm(uint8_t opcode, uint8_t map_select, uint8_t pp, bool w,
+      bool l, const MemoryReference& mem, Register reg, Register vreg);
   static Operation load_store_oper_for_args(Operation op,
       const MemoryReference& to, const MemoryReference& from, OperandSize size);
   void write_load_store(Operation base_op, const MemoryReference& to,
@@ -1,8 +1,11 @@
 #include <assert.h>
 #include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 #include <sys/mman.h>
 
+#include <functional>
+
 #include <phosg/Hash.hh>
 #include <phosg/Strings.hh>
 
@@ -303,6 +306,369 @@ void test_float_neg() {
 }
 
 
+void test_float_sqrt() {
+  printf("-- floating square root\n");
+
+  AMD64Assembler as;
+  CodeBuffer code;
+
+  as.write_sqrtsd(xmm1, xmm0);
+  as.write_sqrtsd(xmm0, MemoryReference(rdi, 0));
+  as.write_addsd(xmm0, xmm1);
+  as.write_ret();
+
+  void* function = assemble(code, as);
+  double (*sqrt_sum)(double*, double) = reinterpret_cast<double (*)(double*, double)>(function);
+
+  double x = 16.0;
+  assert(sqrt_sum(&x, 2.25) == 5.5);
+}
+
+
+void test_float_round_abs() {
+  printf("-- floating rounding and absolute value\n");
+
+  // each of these takes a double in xmm0; round returns an int64 in rax and
+  // abs returns a double in xmm0
+  CodeBuffer code;
+  auto assemble_round = [&](uint8_t mode) -> int64_t (*)(double) {
+    AMD64Assembler as;
+    if (mode != 3) {
+      as.write_roundsd(Register::XMM0, xmm0, mode);
+    }
+    as.write_cvtsd2si(Register::RAX, Register::XMM0);
+    as.write_ret();
+    return reinterpret_cast<int64_t (*)(double)>(assemble(code, as));
+  };
+
+  AMD64Assembler as;
+  as.write_mov(rax, 0x7FFFFFFFFFFFFFFF);
+  as.write_movq_to_xmm(xmm1, rax);
+  as.write_andpd(Register::XMM0, xmm1);
+  as.write_ret();
+  double (*abs_fn)(double) = reinterpret_cast<double (*)(double)>(assemble(code, as));
+
+  assert(abs_fn(-2.5) == 2.5);
+  assert(abs_fn(0.25) == 0.25);
+  assert(signbit(abs_fn(-0.0)) == 0);
+
+  // compare returns 0 if xmm0 == xmm1, -1 if less, 1 if greater, 2 if unordered
+  AMD64Assembler cmp_as;
+  cmp_as.write_xor(rax, rax);
+  cmp_as.write_ucomisd(Register::XMM0, xmm1);
+  cmp_as.write_jp("unordered");
+  cmp_as.write_je("equal");
+  cmp_as.write_jb("less");
+  cmp_as.write_inc(rax);
+  cmp_as.write_ret();
+  cmp_as.write_label("less");
+  cmp_as.write_dec(rax);
+  cmp_as.write_label("equal");
+  cmp_as.write_ret();
+  cmp_as.write_label("unordered");
+  cmp_as.write_mov(rax, 2);
+  cmp_as.write_ret();
+  int64_t (*compare_fn)(double, double) = reinterpret_cast<int64_t (*)(double, double)>(
+      assemble(code, cmp_as));
+
+  assert(compare_fn(1.0, 1.0) == 0);
+  assert(compare_fn(-0.0, 0.0) == 0);
+  assert(compare_fn(-1.0, 0.5) == -1);
+  assert(compare_fn(INFINITY, 1e300) == 1);
+  assert(compare_fn(NAN, 0.0) == 2);
+  assert(compare_fn(0.0, NAN) == 2);
+
+  // cvtsd2si truncates, so trunc doesn't need roundsd
+  auto trunc_fn = assemble_round(3);
+  assert(trunc_fn(2.75) == 2);
+  assert(trunc_fn(-2.75) == -2);
+  if (!CPUFeatures::host().sse41) {
+    printf("---- skipped floor/ceil (cpu does not support sse4.1)\n");
+    return;
+  }
+  auto floor_fn = assemble_round(1);
+  auto ceil_fn = assemble_round(2);
+  assert(floor_fn(2.75) == 2);
+  assert(floor_fn(-2.25) == -3);
+  assert(ceil_fn(2.25) == 3);
+  assert(ceil_fn(-2.75) == -2);
+  assert(ceil_fn(4.0) == 4);
+}
+
+
+void test_float_fma() {
+  printf("-- fused multiply-add\n");
+  if (!CPUFeatures::host().fma) {
+    printf("---- skipped (cpu does not support fma)\n");
+    return;
+  }
+
+  AMD64Assembler as;
+  CodeBuffer code;
+
+  // (x0 * x1 + x2) - (x0 * [rdi]) - (x1 * x9) with an extension register
+  as.write_movsd(xmm9, xmm1);
+  as.write_vfmadd231sd(Register::XMM2, Register::XMM0, xmm1);
+  as.write_vfnmadd231sd(Register::XMM2, Register::XMM0, MemoryReference(rdi, 0));
+  as.write_vfmsub231sd(Register::XMM2, Register::XMM1, xmm9);
+  as.write_movsd(xmm0, xmm2);
+  as.write_ret();
+
+  void* function = assemble(code, as);
+  double (*fma_fn)(double*, double, double, double) =
+      reinterpret_cast<double (*)(double*, double, double, double)>(function);
+
+  // ((3 * 5 + 7) - 3 * 2) -> 16; then 5 * 5 - 16 -> 9
+  double x = 2.0;
+  assert(fma_fn(&x, 3.0, 5.0, 7.0) == 9.0);
+}
+
+
+void test_packed() {
+  printf("-- packed floating-point and integer\n");
+
+  AMD64Assembler as;
+  CodeBuffer code;
+
+  // out_floats = [((a + b) * a - b) / b for each pair, then a[0] broadcast]
+  as.write_movupd(xmm0, MemoryReference(rdi, 0));
+  as.write_movupd(xmm9, MemoryReference(rsi, 0));
+  as.write_movupd(xmm8, xmm0);
+  as.write_addpd(Register::XMM8, xmm9);
+  as.write_mulpd(Register::XMM8, xmm0);
+  as.write_subpd(Register::XMM8, xmm9);
+  as.write_divpd(Register::XMM8, MemoryReference(rsi, 0));
+  as.write_movupd(MemoryReference(r8, 0), xmm8);
+  as.write_unpcklpd(Register::XMM0, xmm0);
+  as.write_movupd(MemoryReference(r8, 16), xmm0);
+
+  // out_ints = [((c + d) - c) & d | c ^ d for each pair]
+  as.write_movupd(xmm2, MemoryReference(rdx, 0));
+  as.write_movupd(xmm3, xmm2);
+  as.write_paddq(Register::XMM3, MemoryReference(rcx, 0));
+  as.write_psubq(Register::XMM3, xmm2);
+  as.write_pand(Register::XMM3, MemoryReference(rcx, 0));
+  as.write_movupd(xmm4, xmm2);
+  as.write_pxor(Register::XMM4, MemoryReference(rcx, 0));
+  as.write_por(Register::XMM3, xmm4);
+  as.write_movupd(MemoryReference(r9, 0), xmm3);
+
+  // return the sign bits of c, after clearing the low one with xorpd
+  as.write_xorpd(Register::XMM4, xmm4);
+  as.write_unpcklpd(Register::XMM4, xmm2);
+  as.write_movmskpd(Register::RAX, Register::XMM4);
+  as.write_ret();
+
+  void* function = assemble(code, as);
+  int64_t (*fn)(const double*, const double*, const int64_t*, const int64_t*,
+      double*, int64_t*) = reinterpret_cast<int64_t (*)(const double*,
+        const double*, const int64_t*, const int64_t*, double*, int64_t*)>(
+          function);
+
+  double a[2] = {3.0, -1.5};
+  double b[2] = {2.0, 0.5};
+  int64_t c[2] = {-12, 0x0F0F};
+  int64_t d[2] = {10, 0x00FF};
+  double out_floats[4];
+  int64_t out_ints[2];
+  assert(fn(a, b, c, d, out_floats, out_ints) == 2);
+  assert(out_floats[0] == 6.5);
+  assert(out_floats[1] == 2.0);
+  assert(out_floats[2] == 3.0);
+  assert(out_floats[3] == 3.0);
+  assert(out_ints[0] == ((10 & 10) | (-12 ^ 10)));
+  assert(out_ints[1] == ((0x00FF & 0x00FF) | (0x0F0F ^ 0x00FF)));
+}
+
+
+void test_vex_encodings() {
+  printf("-- VEX and bit manipulation encodings\n");
+
+  // this only checks the generated bytes, so it works on any cpu
+  AMD64Assembler as;
+  as.write_vmovupd(xmm9, MemoryReference(r10, 0, rbx, 8));
+  as.write_vmovupd(MemoryReference(rdx, 0x20, r11, 8), xmm12);
+  as.write_vmovupd(xmm1, xmm14, false);
+  as.write_vbroadcastsd(Register::XMM3, MemoryReference(rbp, -8));
+  as.write_vbroadcastsd(Register::XMM10, xmm2);
+  as.write_vmovmskpd(Register::R9, Register::XMM13);
+  as.write_vaddpd(Register::XMM8, Register::XMM9, MemoryReference(rcx, 0, rbx, 8));
+  as.write_vsubpd(Register::XMM1, Register::XMM12, xmm15, false);
+  as.write_vpaddq(Register::XMM10, Register::XMM11, xmm12);
+  as.write_vpxor(Register::XMM15, Register::XMM15, xmm15);
+  as.write_vfmadd231pd(Register::XMM1, Register::XMM2, xmm11);
+  as.write_vzeroupper();
+  as.write_popcnt(Register::RAX, rcx);
+  as.write_popcnt(Register::R9, MemoryReference(rdi, 0x10), OperandSize::DoubleWord);
+  as.write_lzcnt(Register::RDX, r11);
+  as.write_tzcnt(Register::R12, MemoryReference(rsp, 0));
+  as.write_pdep(Register::RAX, Register::RBX, rcx);
+  as.write_pext(Register::R8, Register::R9, MemoryReference(r10, 4));
+  as.write_shlx(Register::RAX, rbx, Register::RCX);
+  as.write_shrx(Register::R13, MemoryReference(r14, 0), Register::R15);
+  as.write_sarx(Register::RDX, rsi, Register::R8, OperandSize::DoubleWord);
+  as.write_bswap(Register::R10);
+  as.write_bswap(Register::RDX, OperandSize::DoubleWord);
+
+  unordered_set<size_t> patch_offsets;
+  string data = as.assemble(patch_offsets);
+  string expected = parse_data_string(
+      "C4417D100CDA C4217D1164DA20 C4C17910CE C4E27D195DF8 C4627D19D2 "
+      "C4417D50CD C461355804D9 C4C1195CCF C44125D4D4 C44105EFFF C4C2EDB8CB "
+      "C5F877 F3480FB8C1 F3440FB84F10 F3490FBDD3 F34C0FBC2424 C4E2E3F5C1 "
+      "C442B2F54204 C4E2F1F7C3 C44283F72E C4E23AF7D6 490FCA 0FCA");
+  assert(data == expected);
+
+  string disassembly = AMD64Assembler::disassemble(data.data(), data.size());
+  for (const char* name : {"vmovupd  ymm9, [r10 + rbx * 8]",
+      "vbroadcastsd ymm10, xmm2", "vmovmskpd r9d, ymm13",
+      "vaddpd   ymm8, ymm9, [rcx + rbx * 8]", "vsubpd   xmm1, xmm12, xmm15",
+      "vfmadd231pd ymm1, ymm2, ymm11", "vzeroupper", "popcnt   r9d, [rdi + 0x10]",
+      "tzcnt    r12, [rsp]", "pdep     rax, rbx, rcx",
+      "shrx     r13, [r14], r15", "sarx     edx, esi, r8d", "bswap    r10",
+      "bswap    edx"}) {
+    assert(disassembly.find(name) != string::npos);
+  }
+}
+
+
+void test_avx2_packed() {
+  printf("-- AVX2 packed floating-point and integer\n");
+  if (!CPUFeatures::host().avx2) {
+    printf("---- skipped (cpu does not support avx2)\n");
+    return;
+  }
+
+  AMD64Assembler as;
+  CodeBuffer code;
+
+  // out_floats = a * k + b - a / k, four at a time; k is broadcast from xmm0
+  as.write_vbroadcastsd(Register::XMM0, xmm0);
+  as.write_vmovupd(xmm8, MemoryReference(rdi, 0));
+  as.write_vmulpd(Register::XMM9, Register::XMM8, xmm0);
+  as.write_vaddpd(Register::XMM9, Register::XMM9, MemoryReference(rsi, 0));
+  as.write_vdivpd(Register::XMM10, Register::XMM8, xmm0);
+  as.write_vsubpd(Register::XMM9, Register::XMM9, xmm10);
+  as.write_vmovupd(MemoryReference(r8, 0), xmm9);
+
+  // out_ints = ((c + d) - c) & d | c ^ d, four at a time
+  as.write_vmovupd(xmm2, MemoryReference(rdx, 0));
+  as.write_vpaddq(Register::XMM3, Register::XMM2, MemoryReference(rcx, 0));
+  as.write_vpsubq(Register::XMM3, Register::XMM3, xmm2);
+  as.write_vpand(Register::XMM3, Register::XMM3, MemoryReference(rcx, 0));
+  as.write_vpxor(Register::XMM4, Register::XMM2, MemoryReference(rcx, 0));
+  as.write_vpor(Register::XMM3, Register::XMM3, xmm4);
+  as.write_vmovupd(MemoryReference(r9, 0), xmm3);
+
+  // return the sign bits of c
+  as.write_vmovmskpd(Register::RAX, Register::XMM2);
+  as.write_vzeroupper();
+  as.write_ret();
+
+  void* function = assemble(code, as);
+  int64_t (*fn)(const double*, const double*, const int64_t*, const int64_t*,
+      double*, int64_t*, double) = reinterpret_cast<int64_t (*)(const double*,
+        const double*, const int64_t*, const int64_t*, double*, int64_t*,
+        double)>(function);
+
+  double a[4] = {3.0, -1.5, 8.0, 0.0};
+  double b[4] = {2.0, 0.5, -4.0, 1.0};
+  int64_t c[4] = {-12, 0x0F0F, 7, -1};
+  int64_t d[4] = {10, 0x00FF, 9, 3};
+  double out_floats[4];
+  int64_t out_ints[4];
+  assert(fn(a, b, c, d, out_floats, out_ints, 2.0) == 9);
+  for (size_t x = 0; x < 4; x++) {
+    assert(out_floats[x] == a[x] * 2.0 + b[x] - a[x] / 2.0);
+    assert(out_ints[x] == ((d[x] & d[x]) | (c[x] ^ d[x])));
+  }
+}
+
+
+void test_bit_manipulation() {
+  printf("-- bit manipulation\n");
+  const CPUFeatures& features = CPUFeatures::host();
+  printf("---- cpu features: %s\n", features.str().c_str());
+
+  // each of these takes (x, y) in (rdi, rsi) and returns the result in rax
+  CodeBuffer code;
+  auto assemble_function = [&](function<void(AMD64Assembler&)> write) ->
+      int64_t (*)(int64_t, int64_t) {
+    AMD64Assembler as;
+    write(as);
+    as.write_ret();
+    return reinterpret_cast<int64_t (*)(int64_t, int64_t)>(assemble(code, as));
+  };
+
+  // bswap and rotates are available on every cpu
+  auto bswap_fn = assemble_function([](AMD64Assembler& as) {
+    as.write_mov(rax, rdi);
+    as.write_bswap(Register::RAX);
+  });
+  auto rol_fn = assemble_function([](AMD64Assembler& as) {
+    as.write_mov(rax, rdi);
+    as.write_mov(rcx, rsi);
+    as.write_rol_cl(rax);
+  });
+  assert(bswap_fn(0x0102030405060708, 0) == 0x0807060504030201);
+  assert(rol_fn(0x8000000000000001, 4) == 0x18);
+  assert(rol_fn(3, 64 + 1) == 6);
+
+  if (features.popcnt) {
+    auto fn = assemble_function([](AMD64Assembler& as) {
+      as.write_popcnt(Register::RAX, rdi);
+    });
+    assert(fn(0, 0) == 0);
+    assert(fn(0xF0F0, 0) == 8);
+    assert(fn(-1, 0) == 64);
+  } else {
+    printf("---- skipped popcnt (cpu does not support it)\n");
+  }
+
+  if (features.lzcnt && features.bmi1) {
+    auto lzcnt_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_lzcnt(Register::RAX, rdi);
+    });
+    auto tzcnt_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_tzcnt(Register::RAX, rdi);
+    });
+    assert(lzcnt_fn(1, 0) == 63);
+    assert(lzcnt_fn(0, 0) == 64);
+    assert(lzcnt_fn(-1, 0) == 0);
+    assert(tzcnt_fn(8, 0) == 3);
+    assert(tzcnt_fn(0, 0) == 64);
+  } else {
+    printf("---- skipped lzcnt/tzcnt (cpu does not support them)\n");
+  }
+
+  if (features.bmi2) {
+    auto pdep_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_pdep(Register::RAX, Register::RDI, rsi);
+    });
+    auto pext_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_pext(Register::RAX, Register::RDI, rsi);
+    });
+    auto shlx_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_shlx(Register::RAX, rdi, Register::RSI);
+    });
+    auto shrx_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_shrx(Register::RAX, rdi, Register::RSI);
+    });
+    auto sarx_fn = assemble_function([](AMD64Assembler& as) {
+      as.write_sarx(Register::RAX, rdi, Register::RSI);
+    });
+    assert(pdep_fn(0x5, 0xF0F0) == 0x0050);
+    assert(pext_fn(0x1234, 0xFF00) == 0x12);
+    assert(shlx_fn(3, 4) == 48);
+    assert(shlx_fn(1, 64 + 3) == 8);
+    assert(shrx_fn(-16, 2) == 0x3FFFFFFFFFFFFFFC);
+    assert(sarx_fn(-16, 2) == -4);
+  } else {
+    printf("---- skipped bmi2 (cpu does not support it)\n");
+  }
+}
+
+
 void test_absolute_patches() {
   printf("-- absolute patches\n");
 
@@ -329,6 +695,13 @@ int main(int argc, char** argv) {
   test_quicksort();
   test_float_move_load_multiply();
   test_float_neg();
+  test_float_sqrt();
+  test_float_round_abs();
+  test_float_fma();
+  test_packed();
+  test_vex_encodings();
+  test_avx2_packed();
+  test_bit_manipulation();
   test_absolute_patches();
 
   printf("-- all tests passed\n");
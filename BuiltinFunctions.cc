@@ -1,12 +1,14 @@
 #include "BuiltinFunctions.hh"
 
 #include <inttypes.h>
+#include <math.h>
 
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <memory>
 #include <phosg/Strings.hh>
 #include <string>
@@ -15,10 +17,16 @@
 #include <vector>
 
 #include "Analysis.hh"
+#include "StandardStreams.hh"
 #include "Types/Strings.hh"
 #include "Types/Dictionary.hh"
 #include "Types/List.hh"
+#include "Types/Set.hh"
+#include "Types/Slice.hh"
+#include "Types/Tuple.hh"
 #include "Types/Instance.hh"
+#include "Types/Int.hh"
+#include "Types/Parse.hh"
 #include "Parser/PythonLexer.hh" // for escape()
 
 // builtin module implementations
@@ -28,6 +36,7 @@
 #include "Modules/posix.hh"
 #include "Modules/sys.hh"
 #include "Modules/time.hh"
+#include "Modules/vmath.hh"
 
 using namespace std;
 using FragDef = BuiltinFragmentDefinition;
@@ -40,11 +49,19 @@ unordered_map<string, Variable> builtin_names;
 
 InstanceObject MemoryError_instance;
 int64_t AssertionError_class_id = 0;
+int64_t EOFError_class_id = 0;
 int64_t IndexError_class_id = 0;
 int64_t KeyError_class_id = 0;
 int64_t OSError_class_id = 0;
+int64_t OverflowError_class_id = 0;
 int64_t TypeError_class_id = 0;
 int64_t ValueError_class_id = 0;
+int64_t ZeroDivisionError_class_id = 0;
+
+int64_t print_function_id = 0;
+int64_t range_function_id = 0;
+int64_t enumerate_function_id = 0;
+int64_t zip_function_id = 0;
 
 int64_t BytesObject_class_id = 0;
 int64_t UnicodeObject_class_id = 0;
@@ -52,16 +69,21 @@ int64_t DictObject_class_id = 0;
 int64_t ListObject_class_id = 0;
 int64_t TupleObject_class_id = 0;
 int64_t SetObject_class_id = 0;
+int64_t Int_class_id = 0;
+
+static unordered_map<int64_t, Intrinsic> function_id_to_intrinsic;
+static unordered_set<int64_t> promoted_int_function_ids;
 
 
 
-static UnicodeObject* empty_unicode = unicode_new(NULL, 0);
 static const Variable None(ValueType::None);
 static const Variable Bool(ValueType::Bool);
 static const Variable Bool_True(ValueType::Bool, true);
 static const Variable Bool_False(ValueType::Bool, false);
 static const Variable Int(ValueType::Int);
 static const Variable Int_Zero(ValueType::Int, static_cast<int64_t>(0));
+static const Variable Int_One(ValueType::Int, static_cast<int64_t>(1));
+static const Variable Int_Ten(ValueType::Int, static_cast<int64_t>(10));
 static const Variable Int_NegOne(ValueType::Int, static_cast<int64_t>(-1));
 static const Variable Float(ValueType::Float);
 static const Variable Float_Zero(ValueType::Float, 0.0);
@@ -72,14 +94,321 @@ static const Variable Extension0(ValueType::ExtensionTypeReference, static_cast<
 static const Variable Extension1(ValueType::ExtensionTypeReference, static_cast<int64_t>(1));
 static const Variable Self(ValueType::Instance, 0LL, nullptr);
 static const Variable List_Any(ValueType::List, vector<Variable>({Variable()}));
+static const Variable List_Bool(ValueType::List, vector<Variable>({Bool}));
+static const Variable List_Int(ValueType::List, vector<Variable>({Int}));
+static const Variable List_Float(ValueType::List, vector<Variable>({Float}));
+static const Variable List_Bytes(ValueType::List, vector<Variable>({Bytes}));
+static const Variable List_Unicode(ValueType::List, vector<Variable>({Unicode}));
 static const Variable List_Same(ValueType::List, vector<Variable>({Extension0}));
+static const Variable List_Same1(ValueType::List, vector<Variable>({Extension1}));
+static const Variable List_Enumerated(ValueType::List, vector<Variable>({
+    Variable(ValueType::Tuple, vector<Variable>({Int, Extension0}))}));
+static const Variable List_Zipped(ValueType::List, vector<Variable>({
+    Variable(ValueType::Tuple, vector<Variable>({Extension0, Extension1}))}));
 static const Variable Set_Any(ValueType::Set, vector<Variable>({Variable()}));
+static const Variable Set_Int(ValueType::Set, vector<Variable>({Int}));
+static const Variable Set_Bytes(ValueType::Set, vector<Variable>({Bytes}));
+static const Variable Set_Unicode(ValueType::Set, vector<Variable>({Unicode}));
 static const Variable Set_Same(ValueType::Set, vector<Variable>({Extension0}));
 static const Variable Dict_Any(ValueType::Dict, vector<Variable>({Variable(), Variable()}));
 static const Variable Dict_Same(ValueType::Dict, vector<Variable>({Extension0, Extension1}));
 
 
 
+// helpers for the set methods, which (like all built-in functions) must
+// release their arguments' references
+
+static void set_release_key(SetObject* s, void* k) {
+  if (s->key_type != SetKeyType::Int) {
+    delete_reference(k);
+  } else {
+    int_delete_reference(reinterpret_cast<int64_t>(k));
+  }
+}
+
+template <SetObject* (*Fn)(const SetObject*, const SetObject*, ExceptionBlock*)>
+static SetObject* set_method(SetObject* s, SetObject* other,
+    ExceptionBlock* exc_block) {
+  SetObject* ret = Fn(s, other, exc_block);
+  delete_reference(other);
+  delete_reference(s);
+  return ret;
+}
+
+template <void (*Fn)(SetObject*, const SetObject*, ExceptionBlock*)>
+static void set_update_method(SetObject* s, SetObject* other,
+    ExceptionBlock* exc_block) {
+  Fn(s, other, exc_block);
+  delete_reference(other);
+  delete_reference(s);
+}
+
+template <bool (*Fn)(const SetObject*, const SetObject*), bool Reverse>
+static bool set_predicate_method(SetObject* s, SetObject* other) {
+  bool ret = Reverse ? Fn(other, s) : Fn(s, other);
+  delete_reference(other);
+  delete_reference(s);
+  return ret;
+}
+
+
+// helpers for sorted() and list.sort(). the Sort functions are the typed
+// kernels in Types/List.hh
+
+// with reverse=True, equal items stay in their original order (as in python),
+// so the list is reversed both before and after sorting it in ascending order
+template <void (*Sort)(ListObject*, ExceptionBlock*)>
+static void list_sort_in_direction(ListObject* l, bool reverse,
+    ExceptionBlock* exc_block) {
+  if (reverse) {
+    std::reverse(l->items, l->items + l->count);
+  }
+  Sort(l, exc_block);
+  if (reverse) {
+    std::reverse(l->items, l->items + l->count);
+  }
+}
+
+template <void (*Sort)(ListObject*, ExceptionBlock*)>
+static ListObject* list_sorted(ListObject* l, bool reverse,
+    ExceptionBlock* exc_block) {
+  ListObject* ret = list_slice(l, SLICE_INDEX_OMITTED, SLICE_INDEX_OMITTED, 1,
+      exc_block);
+  delete_reference(l);
+  list_sort_in_direction<Sort>(ret, reverse, exc_block);
+  return ret;
+}
+
+template <void (*Sort)(ListObject*, ExceptionBlock*)>
+static ListObject* set_sorted(SetObject* s, bool reverse,
+    ExceptionBlock* exc_block) {
+  ListObject* ret = list_new(set_size(s), s->key_type != SetKeyType::Int,
+      exc_block);
+  ret->items_are_ints = (s->key_type == SetKeyType::Int);
+  uint64_t count = 0;
+  for (SetIteration it = set_next_item(s, 0); it.position;
+       it = set_next_item(s, it.position)) {
+    ret->items[count++] = it.key;
+    if (list_item_has_refcount(ret, it.key)) {
+      add_reference(it.key);
+    }
+  }
+  delete_reference(s);
+  list_sort_in_direction<Sort>(ret, reverse, exc_block);
+  return ret;
+}
+
+template <void (*Sort)(ListObject*, ExceptionBlock*)>
+static void list_sort_method(ListObject* l, bool reverse,
+    ExceptionBlock* exc_block) {
+  list_sort_in_direction<Sort>(l, reverse, exc_block);
+  delete_reference(l);
+}
+
+// the list functions add their own references to the items, so the methods
+// release the caller's references to the list and the value afterward
+static void list_append_method(ListObject* l, void* value,
+    ExceptionBlock* exc_block) {
+  list_append(l, value, exc_block);
+  if (list_item_has_refcount(l, value)) {
+    delete_reference(value);
+  }
+  delete_reference(l);
+}
+
+static void list_insert_method(ListObject* l, int64_t position, void* value,
+    ExceptionBlock* exc_block) {
+  list_insert(l, position, value, exc_block);
+  if (list_item_has_refcount(l, value)) {
+    delete_reference(value);
+  }
+  delete_reference(l);
+}
+
+static void* list_pop_method(ListObject* l, int64_t position,
+    ExceptionBlock* exc_block) {
+  void* ret = list_pop(l, position, exc_block);
+  delete_reference(l);
+  return ret;
+}
+
+static void list_clear_method(ListObject* l) {
+  list_clear(l);
+  delete_reference(l);
+}
+
+
+// helpers for sum, min, max, any and all. the numeric list versions call the
+// SIMD kernels in Types/List.hh; the others are plain loops
+
+template <typename ReturnT, ReturnT (*Fn)(const ListObject*)>
+static ReturnT list_reduce(ListObject* l) {
+  ReturnT ret = Fn(l);
+  delete_reference(l);
+  return ret;
+}
+
+template <typename ReturnT, ReturnT (*Fn)(const ListObject*)>
+static ReturnT list_reduce_nonempty(ListObject* l, void*,
+    ExceptionBlock* exc_block) {
+  if (l->count == 0) {
+    delete_reference(l);
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+  }
+  return list_reduce<ReturnT, Fn>(l);
+}
+
+// Compare returns a negative number if its first argument is less than its
+// second. like Python, this returns the first of several equal items
+template <typename ObjectType, int64_t (*Compare)(const ObjectType*, const ObjectType*), bool Max>
+static ObjectType* list_extreme_object(ListObject* l, void*,
+    ExceptionBlock* exc_block) {
+  if (l->count == 0) {
+    delete_reference(l);
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+  }
+  ObjectType** items = reinterpret_cast<ObjectType**>(l->items);
+  ObjectType* ret = items[0];
+  for (uint64_t x = 1; x < l->count; x++) {
+    int64_t c = Compare(items[x], ret);
+    if (Max ? (c > 0) : (c < 0)) {
+      ret = items[x];
+    }
+  }
+  add_reference(ret);
+  delete_reference(l);
+  return ret;
+}
+
+// the truth value of a Bytes or Unicode object depends only on its length
+template <typename ObjectType, bool All>
+static bool list_truth_objects(ListObject* l) {
+  ObjectType** items = reinterpret_cast<ObjectType**>(l->items);
+  uint64_t x;
+  for (x = 0; x < l->count; x++) {
+    if (All == (items[x]->count == 0)) {
+      break;
+    }
+  }
+  bool ret = All ? (x == l->count) : (x != l->count);
+  delete_reference(l);
+  return ret;
+}
+
+static int64_t list_sum_ints_released(ListObject* l, int64_t start,
+    ExceptionBlock*) {
+  int64_t ret = list_sum_ints(l, start);
+  delete_reference(l);
+  int_delete_reference(start);
+  return ret;
+}
+
+static int64_t set_sum_ints(SetObject* s, int64_t start, ExceptionBlock*) {
+  vector<int64_t> items;
+  for (SetIteration it = set_next_item(s, 0); it.position;
+       it = set_next_item(s, it.position)) {
+    items.emplace_back(reinterpret_cast<int64_t>(it.key));
+  }
+  int64_t ret = int_sum(items.data(), items.size(), start);
+  delete_reference(s);
+  int_delete_reference(start);
+  return ret;
+}
+
+template <bool Max>
+static int64_t set_extreme_int(SetObject* s, void*, ExceptionBlock* exc_block) {
+  SetIteration it = set_next_item(s, 0);
+  if (!it.position) {
+    delete_reference(s);
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+  }
+  int64_t ret = reinterpret_cast<int64_t>(it.key);
+  for (it = set_next_item(s, it.position); it.position;
+       it = set_next_item(s, it.position)) {
+    int64_t item = reinterpret_cast<int64_t>(it.key);
+    if ((int_compare(item, ret) > 0) == Max) {
+      ret = item;
+    }
+  }
+  int_add_reference(ret);
+  delete_reference(s);
+  return ret;
+}
+
+// int() and float() release their string arguments before calling this, since
+// it doesn't return if it raises
+static void raise_for_parse_result(NumberParseResult result,
+    ExceptionBlock* exc_block) {
+  if (result == NumberParseResult::Invalid) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+  }
+}
+
+
+
+int64_t range_length(int64_t start, int64_t stop, int64_t step,
+    ExceptionBlock* exc_block) {
+  if (step > 0) {
+    return (start < stop) ? ((stop - start - 1) / step + 1) : 0;
+  } else if (step < 0) {
+    return (start > stop) ? ((start - stop - 1) / -step + 1) : 0;
+  }
+  raise_python_exception(exc_block, create_instance(ValueError_class_id));
+  throw logic_error("range step cannot be zero");
+}
+
+// enumerate() and zip() are only called when their results are used as values;
+// for loops that unpack their items are compiled without calling them (see
+// CompilationVisitor::visit(ForStatement*)), so these don't need to be fast
+
+static ListObject* enumerate_new(ListObject* l, int64_t start,
+    ExceptionBlock* exc_block) {
+  ListObject* ret = list_new(l->count, true, exc_block);
+  for (uint64_t x = 0; x < l->count; x++) {
+    TupleObject* t = tuple_new(2, exc_block);
+    int64_t index = int_from_int64(start + x);
+    tuple_set_item(t, 0, reinterpret_cast<void*>(index), int_is_promoted(index),
+        exc_block);
+    int_delete_reference(index);
+    tuple_set_item(t, 1, l->items[x], list_item_has_refcount(l, l->items[x]),
+        exc_block);
+    ret->items[x] = t;
+  }
+  delete_reference(l);
+  return ret;
+}
+
+static ListObject* zip_new(ListObject* a, ListObject* b,
+    ExceptionBlock* exc_block) {
+  uint64_t count = min<uint64_t>(a->count, b->count);
+  ListObject* ret = list_new(count, true, exc_block);
+  for (uint64_t x = 0; x < count; x++) {
+    TupleObject* t = tuple_new(2, exc_block);
+    tuple_set_item(t, 0, a->items[x], list_item_has_refcount(a, a->items[x]),
+        exc_block);
+    tuple_set_item(t, 1, b->items[x], list_item_has_refcount(b, b->items[x]),
+        exc_block);
+    ret->items[x] = t;
+  }
+  delete_reference(a);
+  delete_reference(b);
+  return ret;
+}
+
+static ListObject* range_new(int64_t start, int64_t stop, int64_t step,
+    ExceptionBlock* exc_block) {
+  int64_t count = range_length(start, stop, step, exc_block);
+  ListObject* l = list_new(count, false, exc_block);
+  l->items_are_ints = true;
+  int64_t* items = list_int_items(l);
+  for (int64_t x = 0; x < count; x++) {
+    items[x] = start + x * step;
+  }
+  return l;
+}
+
+
+
 static int64_t generate_function_id() {
   // all builtin functions and classes have negative IDs
   static int64_t next_function_id = -1;
@@ -91,7 +420,7 @@ int64_t create_builtin_function(BuiltinFunctionDefinition& def) {
 
   builtin_function_definitions.emplace(piecewise_construct,
       forward_as_tuple(function_id), forward_as_tuple(nullptr, function_id,
-        def.name, def.fragments, def.pass_exception_block));
+        def.name, def.fragments, def.pass_exception_block, def.arg_names));
   if (def.register_globally) {
     create_builtin_name(def.name, Variable(ValueType::Function, function_id));
   }
@@ -121,7 +450,8 @@ int64_t create_builtin_class(BuiltinClassDefinition& def) {
   static const unordered_map<string, unordered_set<Variable>> name_to_self_types({
     {"bytes", {Bytes}},
     {"unicode", {Unicode}},
-    {"list", {List_Any, List_Same}},
+    {"int", {Int}},
+    {"list", {List_Any, List_Same, List_Int, List_Float, List_Bytes, List_Unicode}},
     //{"tuple", ???}, // TODO: extension type refs won't work here
     {"set", {Set_Any, Set_Same}},
     {"dict", {Dict_Any, Dict_Same}},
@@ -189,7 +519,7 @@ int64_t create_builtin_class(BuiltinClassDefinition& def) {
     // register the function
     FunctionContext& fn = builtin_function_definitions.emplace(piecewise_construct,
         forward_as_tuple(function_id),
-        forward_as_tuple(nullptr, function_id, method_def.name, method_def.fragments, method_def.pass_exception_block)).first->second;
+        forward_as_tuple(nullptr, function_id, method_def.name, method_def.fragments, method_def.pass_exception_block, method_def.arg_names)).first->second;
     fn.class_id = class_id;
 
     // link the function as a class attribute
@@ -212,6 +542,49 @@ void create_builtin_name(const char* name, const Variable& value) {
   builtin_names.emplace(name, value);
 }
 
+void register_intrinsic(int64_t function_id, Intrinsic intrinsic) {
+  function_id_to_intrinsic[function_id] = intrinsic;
+}
+
+Intrinsic intrinsic_for_function(int64_t function_id) {
+  try {
+    return function_id_to_intrinsic.at(function_id);
+  } catch (const out_of_range&) {
+    return Intrinsic::None;
+  }
+}
+
+void register_promoted_int_function(int64_t function_id) {
+  promoted_int_function_ids.emplace(function_id);
+}
+
+bool function_accepts_promoted_ints(int64_t function_id) {
+  return promoted_int_function_ids.count(function_id);
+}
+
+// formats promoted Ints for repr, bin, oct and hex, and releases them
+static UnicodeObject* int_format_unicode(int64_t v, uint8_t base,
+    const wchar_t* prefix) {
+  static string digits;
+  bool negative = int_format_digits(digits, v, base);
+  int_delete_reference(v);
+  size_t prefix_length = wcslen(prefix);
+  size_t count = negative + prefix_length + digits.size();
+  UnicodeObject* ret = unicode_new(NULL, count);
+  size_t x = 0;
+  if (negative) {
+    ret->data[x++] = L'-';
+  }
+  for (size_t y = 0; y < prefix_length; y++) {
+    ret->data[x++] = prefix[y];
+  }
+  for (char ch : digits) {
+    ret->data[x++] = ch;
+  }
+  ret->data[x] = 0;
+  return ret;
+}
+
 
 
 static void create_default_builtin_functions() {
@@ -224,28 +597,34 @@ static void create_default_builtin_functions() {
     // None print(Float)
     // None print(Bytes)
     // None print(Unicode)
+    // note: direct calls to print() are compiled inline (see
+    // CompilationVisitor::write_print_call) and can take any number of
+    // arguments; these fragments are only used by other call paths
     {"print", {FragDef({None}, None, void_fn_ptr([](void*) {
-      fwrite("None\n", 5, 1, stdout);
+      stdout_write_none();
+      stdout_write_char('\n');
 
     })), FragDef({Bool}, None, void_fn_ptr([](bool v) {
-      if (v) {
-        fwrite("True\n", 5, 1, stdout);
-      } else {
-        fwrite("False\n", 6, 1, stdout);
-      }
+      stdout_write_bool(v);
+      stdout_write_char('\n');
 
     })), FragDef({Int}, None, void_fn_ptr([](int64_t v) {
-      fprintf(stdout, "%" PRId64 "\n", v);
+      stdout_write_int(v);
+      stdout_write_char('\n');
+      int_delete_reference(v);
 
     })), FragDef({Float}, None, void_fn_ptr([](double v) {
-      fprintf(stdout, "%lg\n", v);
+      stdout_write_float(v);
+      stdout_write_char('\n');
 
     })), FragDef({Bytes}, None, void_fn_ptr([](BytesObject* str) {
-      fprintf(stdout, "%.*s\n", static_cast<int>(str->count), str->data);
+      stdout_write_bytes(str);
+      stdout_write_char('\n');
       delete_reference(str);
 
     })), FragDef({Unicode}, None, void_fn_ptr([](UnicodeObject* str) {
-      fprintf(stdout, "%.*ls\n", static_cast<int>(str->count), str->data);
+      stdout_write_unicode(str);
+      stdout_write_char('\n');
       delete_reference(str);
     }))}, false, true},
 
@@ -253,6 +632,7 @@ static void create_default_builtin_functions() {
       return b;
 
     })), FragDef({Int}, Bool, void_fn_ptr([](int64_t i) -> bool {
+      int_delete_reference(i);
       return static_cast<bool>(i);
 
     })), FragDef({Float}, Bool, void_fn_ptr([](double f) -> bool {
@@ -272,52 +652,37 @@ static void create_default_builtin_functions() {
       bool ret = l->count != 0;
       delete_reference(l);
       return ret;
+
+    })), FragDef({Set_Any}, Bool, void_fn_ptr([](SetObject* s) -> bool {
+      bool ret = s->count != 0;
+      delete_reference(s);
+      return ret;
     }))}, false, true},
 
     // Unicode input(Unicode='')
-    {"input", {Unicode_Blank}, Unicode, void_fn_ptr([](UnicodeObject* prompt) -> UnicodeObject* {
-      if (prompt->count) {
-        fprintf(stdout, "%.*ls", static_cast<int>(prompt->count), prompt->data);
-        fflush(stdout);
-      }
+    // raises EOFError at the end of the input, like python
+    {"input", {Unicode_Blank}, Unicode, void_fn_ptr([](UnicodeObject* prompt, ExceptionBlock* exc_block) -> UnicodeObject* {
+      stdout_write_unicode(prompt);
+      stdout_flush();
       delete_reference(prompt);
 
-      vector<wstring> blocks;
-      while (blocks.empty() || blocks.back().back() != '\n') {
-        blocks.emplace_back(0x400, 0);
-        if (!fgetws(const_cast<wchar_t*>(blocks.back().data()), blocks.back().size(), stdin)) {
-          blocks.pop_back();
-          break;
-        }
-        blocks.back().resize(wcslen(blocks.back().c_str()));
-      }
-
-      if (blocks.empty()) {
-        add_reference(empty_unicode);
-        return empty_unicode;
-      }
-
-      // concatenate the blocks
-      wstring data;
-      if (blocks.size() == 1) {
-        data = move(blocks[0]);
-      } else {
-        for (const auto& block : blocks) {
-          data += block;
-        }
-      }
-
-      // trim off the trailing newline
-      if (!data.empty() && (data.back() == '\n')) {
-        data.resize(data.size() - 1);
+      UnicodeObject* line = stdin_read_line();
+      if (!line) {
+        raise_python_exception(exc_block, create_instance(EOFError_class_id));
+        throw runtime_error("end of input");
       }
+      return line;
+    }), true, true},
 
-      if (data.empty()) {
-        add_reference(empty_unicode);
-        return empty_unicode;
-      }
-      return unicode_new(data.data(), data.size());
-    }), false, true},
+    // List[Int] range(Int, None=None, Int=1)
+    // List[Int] range(Int, Int, Int=1)
+    // ranges are materialized as lists; comprehensions over a range don't call
+    // this at all (see CompilationVisitor::write_comprehension)
+    {"range", {FragDef({Int, None, Int_One}, List_Int, void_fn_ptr([](int64_t stop, void*, int64_t step, ExceptionBlock* exc_block) -> ListObject* {
+      return range_new(0, stop, step, exc_block);
+    })), FragDef({Int, Int, Int_One}, List_Int, void_fn_ptr([](int64_t start, int64_t stop, int64_t step, ExceptionBlock* exc_block) -> ListObject* {
+      return range_new(start, stop, step, exc_block);
+    }))}, true, true},
 
     // Bool bool(Bool=False)
     // Bool bool(Int)
@@ -326,13 +691,14 @@ static void create_default_builtin_functions() {
     // Bool bool(Unicode)
     // Bool bool(List[Any])
     // Bool bool(Tuple[...]) // unimplemented
-    // Bool bool(Set[Any]) // unimplemented
+    // Bool bool(Set[Any])
     // Bool bool(Dict[Any, Any]) // unimplemented
     // probably more that I'm forgetting right now
     {"bool", {FragDef({Bool_False}, Bool, void_fn_ptr([](bool b) -> bool {
       return b;
 
     })), FragDef({Int}, Bool, void_fn_ptr([](int64_t i) -> bool {
+      int_delete_reference(i);
       return static_cast<bool>(i);
 
     })), FragDef({Float}, Bool, void_fn_ptr([](double f) -> bool {
@@ -352,42 +718,43 @@ static void create_default_builtin_functions() {
       bool ret = l->count != 0;
       delete_reference(l);
       return ret;
+
+    })), FragDef({Set_Any}, Bool, void_fn_ptr([](SetObject* s) -> bool {
+      bool ret = s->count != 0;
+      delete_reference(s);
+      return ret;
     }))}, false, true},
 
-    // Int int(Int=0, Int=0)
-    // Int int(Bytes, Int=0)
-    // Int int(Unicode, Int=0)
-    // Int int(Float, Int=0)
-    {"int", {FragDef({Int_Zero, Int_Zero}, Int, void_fn_ptr([](
+    // Int int(Int=0, Int=10)
+    // Int int(Bytes, Int=10)
+    // Int int(Unicode, Int=10)
+    // Int int(Float, Int=10)
+    // (the base only matters for strings, but all fragments must have the same
+    // default values)
+    {"int", {FragDef({Int_Zero, Int_Ten}, Int, void_fn_ptr([](
         int64_t i, int64_t, ExceptionBlock*) -> int64_t {
       return i;
 
-    })), FragDef({Bytes, Int_Zero}, Int, void_fn_ptr([](
+    })), FragDef({Bytes, Int_Ten}, Int, void_fn_ptr([](
         BytesObject* s, int64_t base, ExceptionBlock* exc_block) -> int64_t {
-      char* endptr;
-      int64_t ret = strtoll(reinterpret_cast<const char*>(s->data), &endptr, base);
+      int64_t ret = 0;
+      NumberParseResult result = bytes_parse_int(s, base, &ret);
       delete_reference(s);
-
-      if (endptr != s->data + s->count) {
-        raise_python_exception(exc_block, create_instance(ValueError_class_id));
-      }
+      raise_for_parse_result(result, exc_block);
       return ret;
 
-    })), FragDef({Unicode, Int_Zero}, Int, void_fn_ptr([](
+    })), FragDef({Unicode, Int_Ten}, Int, void_fn_ptr([](
         UnicodeObject* s, int64_t base, ExceptionBlock* exc_block) -> int64_t {
-      wchar_t* endptr;
-      int64_t ret = wcstoll(s->data, &endptr, base);
+      int64_t ret = 0;
+      NumberParseResult result = unicode_parse_int(s, base, &ret);
       delete_reference(s);
-
-      if (endptr != s->data + s->count) {
-        raise_python_exception(exc_block, create_instance(ValueError_class_id));
-      }
+      raise_for_parse_result(result, exc_block);
       return ret;
 
-    })), FragDef({Float, Int_Zero}, Int, void_fn_ptr([](
-        double x, int64_t, ExceptionBlock*) -> int64_t {
-      return static_cast<int64_t>(x);
-    }))}, true, true},
+    })), FragDef({Float, Int_Ten}, Int, void_fn_ptr([](
+        double x, int64_t, ExceptionBlock* exc_block) -> int64_t {
+      return int_from_double(x, exc_block);
+    }))}, true, true, {"", "base"}},
 
     // Float float(Float=0.0)
     // Float float(Int)
@@ -398,29 +765,25 @@ static void create_default_builtin_functions() {
       return f;
 
     })), FragDef({Int}, Float, void_fn_ptr([](
-        int64_t i, ExceptionBlock*) -> double {
-      return static_cast<double>(i);
+        int64_t i, ExceptionBlock* exc_block) -> double {
+      double ret = int_to_double(i, exc_block);
+      int_delete_reference(i);
+      return ret;
 
     })), FragDef({Bytes}, Float, void_fn_ptr([](
         BytesObject* s, ExceptionBlock* exc_block) -> double {
-      char* endptr;
-      double ret = strtod(s->data, &endptr);
+      double ret = 0;
+      NumberParseResult result = bytes_parse_float(s, &ret);
       delete_reference(s);
-
-      if (endptr != s->data + s->count) {
-        raise_python_exception(exc_block, create_instance(ValueError_class_id));
-      }
+      raise_for_parse_result(result, exc_block);
       return ret;
 
     })), FragDef({Unicode}, Float, void_fn_ptr([](
         UnicodeObject* s, ExceptionBlock* exc_block) -> double {
-      wchar_t* endptr;
-      double ret = wcstod(s->data, &endptr);
+      double ret = 0;
+      NumberParseResult result = unicode_parse_float(s, &ret);
       delete_reference(s);
-
-      if (endptr != s->data + s->count) {
-        raise_python_exception(exc_block, create_instance(ValueError_class_id));
-      }
+      raise_for_parse_result(result, exc_block);
       return ret;
     }))}, true, true},
 
@@ -443,21 +806,26 @@ static void create_default_builtin_functions() {
       return ret;
 
     })), FragDef({Int}, Unicode, void_fn_ptr([](int64_t v) -> UnicodeObject* {
+      if (!int_is_direct(v)) {
+        return int_format_unicode(v, 10, L"");
+      }
       wchar_t buf[24];
       return unicode_new(buf, swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"%" PRId64, v));
 
     })), FragDef({Float}, Unicode, void_fn_ptr([](double v) -> UnicodeObject* {
       wchar_t buf[60]; // TODO: figure out how long this actually needs to be
-      size_t count = swprintf(buf, sizeof(buf) / sizeof(buf[0]) - 2, L"%lg", v);
+      size_t count = swprintf(buf, sizeof(buf) / sizeof(buf[0]) - 2, L"%lg",
+          isnan(v) ? fabs(v) : v);
 
-      // if there isn't a . in the output, add .0 at the end
+      // if there isn't a . in the output, add .0 at the end (but not to inf
+      // or nan)
       size_t x;
       for (x = 0; x < count; x++) {
         if (buf[x] == L'.') {
           break;
         }
       }
-      if (x == count) {
+      if ((x == count) && isfinite(v)) {
         buf[count] = L'.';
         buf[count + 1] = L'0';
         buf[count + 2] = 0;
@@ -495,8 +863,8 @@ static void create_default_builtin_functions() {
     // Int len(Unicode)
     // Int len(List[Any])
     // Int len(Tuple[...]) // unimplemented
-    // Int len(Set[Any]) // unimplemented
-    // Int len(Dict[Any, Any]) // unimplemented
+    // Int len(Set[Any])
+    // Int len(Dict[Any, Any])
     {"len", {FragDef({Bytes}, Int, void_fn_ptr([](BytesObject* s) -> int64_t {
       int64_t ret = s->count;
       delete_reference(s);
@@ -509,16 +877,132 @@ static void create_default_builtin_functions() {
       int64_t ret = l->count;
       delete_reference(l);
       return ret;
+    })), FragDef({Set_Any}, Int, void_fn_ptr([](SetObject* s) -> int64_t {
+      int64_t ret = set_size(s);
+      delete_reference(s);
+      return ret;
+    })), FragDef({Dict_Any}, Int, void_fn_ptr([](DictionaryObject* d) -> int64_t {
+      int64_t ret = dictionary_size(d);
+      delete_reference(d);
+      return ret;
     }))}, false, true},
 
+    // List[Int] sorted(List[Int], reverse=False)
+    // List[Float] sorted(List[Float], reverse=False)
+    // List[Bytes] sorted(List[Bytes], reverse=False)
+    // List[Unicode] sorted(List[Unicode], reverse=False)
+    // List[Int] sorted(Set[Int], reverse=False)
+    // List[Bytes] sorted(Set[Bytes], reverse=False)
+    // List[Unicode] sorted(Set[Unicode], reverse=False)
+    // key is not implemented, since functions can't be passed as values
+    {"sorted", {
+      FragDef({List_Int, Bool_False}, List_Int, void_fn_ptr((&list_sorted<list_sort_ints>))),
+      FragDef({List_Float, Bool_False}, List_Float, void_fn_ptr((&list_sorted<list_sort_floats>))),
+      FragDef({List_Bytes, Bool_False}, List_Bytes, void_fn_ptr((&list_sorted<list_sort_bytes>))),
+      FragDef({List_Unicode, Bool_False}, List_Unicode, void_fn_ptr((&list_sorted<list_sort_unicodes>))),
+      FragDef({Set_Int, Bool_False}, List_Int, void_fn_ptr((&set_sorted<list_sort_ints>))),
+      FragDef({Set_Bytes, Bool_False}, List_Bytes, void_fn_ptr((&set_sorted<list_sort_bytes>))),
+      FragDef({Set_Unicode, Bool_False}, List_Unicode, void_fn_ptr((&set_sorted<list_sort_unicodes>))),
+    }, true, true, {"", "reverse"}},
+
+    // List[Tuple[Int, T]] enumerate(List[T], Int=0)
+    {"enumerate", {List_Same, Int_Zero}, List_Enumerated, void_fn_ptr(&enumerate_new), true, true, {"", "start"}},
+
+    // List[Tuple[T, U]] zip(List[T], List[U])
+    // the generic form only takes two lists; for loops over zip() can take any
+    // number of lists or tuples
+    {"zip", {List_Same, List_Same1}, List_Zipped, void_fn_ptr(&zip_new), true, true},
+
+    // Int sum(List[Int], Int=0)
+    // Int sum(List[Bool], Int=0)
+    // Float sum(List[Float], Int=0)
+    // Float sum(List[Float], Float)
+    // Int sum(Set[Int], Int=0)
+    // Float sums aren't added in order, so they may round differently than
+    // they would in Python
+    {"sum", {
+      FragDef({List_Int, Int_Zero}, Int, void_fn_ptr(&list_sum_ints_released)),
+      FragDef({List_Bool, Int_Zero}, Int, void_fn_ptr(&list_sum_ints_released)),
+      FragDef({List_Float, Int_Zero}, Float, void_fn_ptr([](ListObject* l, int64_t start, ExceptionBlock*) -> double {
+        return start + (list_reduce<double, list_sum_floats>)(l);
+      })),
+      FragDef({List_Float, Float}, Float, void_fn_ptr([](ListObject* l, double start, ExceptionBlock*) -> double {
+        return start + (list_reduce<double, list_sum_floats>)(l);
+      })),
+      FragDef({Set_Int, Int_Zero}, Int, void_fn_ptr(&set_sum_ints)),
+    }, true, true, {"", "start"}},
+
+    // Int min(List[Int], None=None)
+    // Float min(List[Float], None=None)
+    // Bytes min(List[Bytes], None=None)
+    // Unicode min(List[Unicode], None=None)
+    // Int min(Set[Int], None=None)
+    // Int min(Int, Int)
+    // Float min(Float, Float)
+    // (and the same for max.) the one-argument forms raise ValueError if the
+    // collection is empty. key and default are not implemented
+    {"min", {
+      FragDef({List_Int, None}, Int, void_fn_ptr((&list_reduce_nonempty<int64_t, list_min_ints>))),
+      FragDef({List_Float, None}, Float, void_fn_ptr((&list_reduce_nonempty<double, list_min_floats>))),
+      FragDef({List_Bytes, None}, Bytes, void_fn_ptr((&list_extreme_object<BytesObject, bytes_compare, false>))),
+      FragDef({List_Unicode, None}, Unicode, void_fn_ptr((&list_extreme_object<UnicodeObject, unicode_compare, false>))),
+      FragDef({Set_Int, None}, Int, void_fn_ptr(&set_extreme_int<false>)),
+      FragDef({Int, Int}, Int, void_fn_ptr([](int64_t a, int64_t b, ExceptionBlock*) -> int64_t {
+        bool use_b = (int_compare(b, a) < 0);
+        int_delete_reference(use_b ? a : b);
+        return use_b ? b : a;
+      })),
+      FragDef({Float, Float}, Float, void_fn_ptr([](double a, double b, ExceptionBlock*) -> double {
+        return (b < a) ? b : a;
+      })),
+    }, true, true},
+    {"max", {
+      FragDef({List_Int, None}, Int, void_fn_ptr((&list_reduce_nonempty<int64_t, list_max_ints>))),
+      FragDef({List_Float, None}, Float, void_fn_ptr((&list_reduce_nonempty<double, list_max_floats>))),
+      FragDef({List_Bytes, None}, Bytes, void_fn_ptr((&list_extreme_object<BytesObject, bytes_compare, true>))),
+      FragDef({List_Unicode, None}, Unicode, void_fn_ptr((&list_extreme_object<UnicodeObject, unicode_compare, true>))),
+      FragDef({Set_Int, None}, Int, void_fn_ptr(&set_extreme_int<true>)),
+      FragDef({Int, Int}, Int, void_fn_ptr([](int64_t a, int64_t b, ExceptionBlock*) -> int64_t {
+        bool use_b = (int_compare(b, a) > 0);
+        int_delete_reference(use_b ? a : b);
+        return use_b ? b : a;
+      })),
+      FragDef({Float, Float}, Float, void_fn_ptr([](double a, double b, ExceptionBlock*) -> double {
+        return (b > a) ? b : a;
+      })),
+    }, true, true},
+
+    // Bool any(List[Int])
+    // Bool any(List[Bool])
+    // Bool any(List[Float])
+    // Bool any(List[Bytes])
+    // Bool any(List[Unicode])
+    // (and the same for all)
+    {"any", {
+      FragDef({List_Int}, Bool, void_fn_ptr((&list_reduce<bool, list_any_ints>))),
+      FragDef({List_Bool}, Bool, void_fn_ptr((&list_reduce<bool, list_any_ints>))),
+      FragDef({List_Float}, Bool, void_fn_ptr((&list_reduce<bool, list_any_floats>))),
+      FragDef({List_Bytes}, Bool, void_fn_ptr((&list_truth_objects<BytesObject, false>))),
+      FragDef({List_Unicode}, Bool, void_fn_ptr((&list_truth_objects<UnicodeObject, false>))),
+    }, false, true},
+    {"all", {
+      FragDef({List_Int}, Bool, void_fn_ptr((&list_reduce<bool, list_all_ints>))),
+      FragDef({List_Bool}, Bool, void_fn_ptr((&list_reduce<bool, list_all_ints>))),
+      FragDef({List_Float}, Bool, void_fn_ptr((&list_reduce<bool, list_all_floats>))),
+      FragDef({List_Bytes}, Bool, void_fn_ptr((&list_truth_objects<BytesObject, true>))),
+      FragDef({List_Unicode}, Bool, void_fn_ptr((&list_truth_objects<UnicodeObject, true>))),
+    }, false, true},
+
     // Int abs(Int)
     // Float abs(Float)
     // Float abs(Complex) // unimplemented
-    {"abs", {FragDef({Int}, Int, void_fn_ptr([](int64_t i) -> int64_t {
-      return (i < 0) ? -i : i;
-    })), FragDef({Float}, Float, void_fn_ptr([](double d) -> double {
+    {"abs", {FragDef({Int}, Int, void_fn_ptr([](int64_t i, ExceptionBlock*) -> int64_t {
+      int64_t ret = int_absolute(i);
+      int_delete_reference(i);
+      return ret;
+    })), FragDef({Float}, Float, void_fn_ptr([](double d, ExceptionBlock*) -> double {
       return (d < 0) ? -d : d;
-    }))}, false, true},
+    }))}, true, true},
 
     // Unicode chr(Int)
     {"chr", {Int}, Unicode, void_fn_ptr([](int64_t i, ExceptionBlock* exc_block) -> UnicodeObject* {
@@ -555,6 +1039,9 @@ static void create_default_builtin_functions() {
 
     // Unicode bin(Int)
     {"bin", {Int}, Unicode, void_fn_ptr([](int64_t i) -> UnicodeObject* {
+      if (!int_is_direct(i)) {
+        return int_format_unicode(i, 2, L"0b");
+      }
       if (!i) {
         return unicode_new(L"0b0", 3);
       }
@@ -586,6 +1073,9 @@ static void create_default_builtin_functions() {
 
     // Unicode oct(Int)
     {"oct", {Int}, Unicode, void_fn_ptr([](int64_t i) -> UnicodeObject* {
+      if (!int_is_direct(i)) {
+        return int_format_unicode(i, 8, L"0o");
+      }
       if (!i) {
         return unicode_new(L"0o0", 3);
       }
@@ -624,8 +1114,11 @@ static void create_default_builtin_functions() {
 
     // Unicode hex(Int)
     {"hex", {Int}, Unicode, void_fn_ptr([](int64_t i) -> UnicodeObject* {
+      if (!int_is_direct(i)) {
+        return int_format_unicode(i, 16, L"0x");
+      }
       UnicodeObject* s = unicode_new(NULL, 19);
-      s->count = swprintf(s->data, 19, L"%s0x%x", (i < 0) ? "-" : "", (i < 0) ? -i : i);
+      s->count = swprintf(s->data, 20, L"%s0x%" PRIx64, (i < 0) ? "-" : "", (i < 0) ? -i : i);
       return s;
     }), false, true},
   });
@@ -634,6 +1127,18 @@ static void create_default_builtin_functions() {
   for (auto& def : function_defs) {
     create_builtin_function(def);
   }
+
+  // populate global static symbols with function ids that the compiler treats
+  // specially
+  print_function_id = builtin_names.at("print").function_id;
+  range_function_id = builtin_names.at("range").function_id;
+  enumerate_function_id = builtin_names.at("enumerate").function_id;
+  zip_function_id = builtin_names.at("zip").function_id;
+
+  for (const char* name : {"print", "bool", "int", "float", "repr", "sum", "min",
+      "max", "abs", "bin", "oct", "hex"}) {
+    register_promoted_int_function(builtin_names.at(name).function_id);
+  }
 }
 
 void create_default_builtin_classes() {
@@ -810,10 +1315,16 @@ void create_default_builtin_classes() {
     }, void_fn_ptr(&list_delete), true},
 
     {"list", {}, {
-      {"clear", {List_Any}, None, void_fn_ptr(&list_clear), false, false},
-      {"append", {List_Same, Extension0}, None, void_fn_ptr(&list_append), true, false},
-      {"insert", {List_Same, Int, Extension0}, None, void_fn_ptr(&list_insert), true, false},
-      {"pop", {List_Same, Int_NegOne}, Extension0, void_fn_ptr(&list_pop), true, false},
+      {"clear", {List_Any}, None, void_fn_ptr(&list_clear_method), false, false},
+      {"append", {List_Same, Extension0}, None, void_fn_ptr(&list_append_method), true, false},
+      {"insert", {List_Same, Int, Extension0}, None, void_fn_ptr(&list_insert_method), true, false},
+      {"pop", {List_Same, Int_NegOne}, Extension0, void_fn_ptr(&list_pop_method), true, false},
+      {"sort", {
+        FragDef({List_Int, Bool_False}, None, void_fn_ptr(&list_sort_method<list_sort_ints>)),
+        FragDef({List_Float, Bool_False}, None, void_fn_ptr(&list_sort_method<list_sort_floats>)),
+        FragDef({List_Bytes, Bool_False}, None, void_fn_ptr(&list_sort_method<list_sort_bytes>)),
+        FragDef({List_Unicode, Bool_False}, None, void_fn_ptr(&list_sort_method<list_sort_unicodes>)),
+      }, true, false, {"", "reverse"}},
 
       /* TODO: implement these
       {"copy", {Self}, List_Same, void_fn_ptr(), true, false},
@@ -822,7 +1333,6 @@ void create_default_builtin_classes() {
       {"index", {Self, Extension0}, Int, void_fn_ptr(), true, false},
       {"remove", {Self, Extension0}, None, void_fn_ptr(), true, false},
       {"reverse", {Self}, None, void_fn_ptr(), true, false},
-      {"sort", {Self, key=TODO, Bool_False}, None, void_fn_ptr(), true, false},
       */
     }, void_fn_ptr(&list_delete), true},
 
@@ -834,30 +1344,61 @@ void create_default_builtin_classes() {
     }, NULL, true},
 
     {"set", {}, {
-      /* TODO: implement these
-      {"add", {Self, Extension0}, None, void_fn_ptr(), true, false},
-      {"clear", {Self}, None, void_fn_ptr(), true, false},
-      {"copy", {Self}, Set_Same, void_fn_ptr(), true, false},
+      // these take ownership of their arguments, so unlike the functions in
+      // Types/Set.hh, they release the references afterward
+      {"add", {Set_Same, Extension0}, None, void_fn_ptr([](SetObject* s, void* k, ExceptionBlock* exc_block) {
+        set_add(s, k, exc_block);
+        set_release_key(s, k);
+        delete_reference(s);
+      }), true, false},
+      {"clear", {Set_Any}, None, void_fn_ptr([](SetObject* s) {
+        set_clear(s);
+        delete_reference(s);
+      }), false, false},
+      {"copy", {Set_Same}, Set_Same, void_fn_ptr([](SetObject* s, ExceptionBlock* exc_block) -> SetObject* {
+        SetObject* ret = set_copy(s, exc_block);
+        delete_reference(s);
+        return ret;
+      }), true, false},
 
       // TODO: these should support variadic arguments
-      {"difference", {Self, Set_Same}, Set_Same, void_fn_ptr(), true, false},
-      {"difference_update", {Self, Set_Same}, None, void_fn_ptr(), true, false},
-      {"intersection", {Self, Set_Same}, Set_Same, void_fn_ptr(), true, false},
-      {"intersection_update", {Self, Set_Same}, None, void_fn_ptr(), true, false},
-      {"symmetric_difference", {Self, Set_Same}, Set_Same, void_fn_ptr(), true, false},
-      {"symmetric_difference_update", {Self, Set_Same}, None, void_fn_ptr(), true, false},
-      {"union", {Self, Set_Same}, Set_Same, void_fn_ptr(), true, false},
-      {"update", {Self, Set_Same}, None, void_fn_ptr(), true, false},
-
-      {"discard", {Self, Extension0}, None, void_fn_ptr(), true, false},
-      {"remove", {Self, Extension0}, None, void_fn_ptr(), true, false},
-
-      {"isdisjoint", {Self, Set_Same}, Bool, void_fn_ptr(), true, false},
-      {"issubset", {Self, Set_Same}, Bool, void_fn_ptr(), true, false},
-      {"issuperset", {Self, Set_Same}, Bool, void_fn_ptr(), true, false},
-      {"pop", {Self}, Extension0, void_fn_ptr(), true, false},
-      */
-    }, NULL, true},
+      {"difference", {Set_Same, Set_Same}, Set_Same, void_fn_ptr(&set_method<set_difference>), true, false},
+      {"difference_update", {Set_Same, Set_Same}, None, void_fn_ptr([](SetObject* s, SetObject* other, ExceptionBlock* exc_block) {
+        set_difference_update(s, other);
+        delete_reference(other);
+        delete_reference(s);
+      }), true, false},
+      {"intersection", {Set_Same, Set_Same}, Set_Same, void_fn_ptr(&set_method<set_intersection>), true, false},
+      {"intersection_update", {Set_Same, Set_Same}, None, void_fn_ptr(&set_update_method<set_intersection_update>), true, false},
+      {"symmetric_difference", {Set_Same, Set_Same}, Set_Same, void_fn_ptr(&set_method<set_symmetric_difference>), true, false},
+      {"symmetric_difference_update", {Set_Same, Set_Same}, None, void_fn_ptr(&set_update_method<set_symmetric_difference_update>), true, false},
+      {"union", {Set_Same, Set_Same}, Set_Same, void_fn_ptr(&set_method<set_union>), true, false},
+      {"update", {Set_Same, Set_Same}, None, void_fn_ptr(&set_update_method<set_update>), true, false},
+
+      {"discard", {Set_Same, Extension0}, None, void_fn_ptr([](SetObject* s, void* k) {
+        set_discard(s, k);
+        set_release_key(s, k);
+        delete_reference(s);
+      }), false, false},
+      {"remove", {Set_Same, Extension0}, None, void_fn_ptr([](SetObject* s, void* k, ExceptionBlock* exc_block) {
+        bool removed = set_discard(s, k);
+        set_release_key(s, k);
+        delete_reference(s);
+        if (!removed) {
+          raise_python_exception(exc_block, create_instance(KeyError_class_id));
+          throw out_of_range("key not in set");
+        }
+      }), true, false},
+      {"pop", {Set_Same}, Extension0, void_fn_ptr([](SetObject* s, ExceptionBlock* exc_block) -> void* {
+        void* ret = set_pop(s, exc_block);
+        delete_reference(s);
+        return ret;
+      }), true, false},
+
+      {"isdisjoint", {Set_Same, Set_Same}, Bool, void_fn_ptr((&set_predicate_method<set_is_disjoint, false>)), false, false},
+      {"issubset", {Set_Same, Set_Same}, Bool, void_fn_ptr((&set_predicate_method<set_is_subset, false>)), false, false},
+      {"issuperset", {Set_Same, Set_Same}, Bool, void_fn_ptr((&set_predicate_method<set_is_subset, true>)), false, false},
+    }, void_fn_ptr(&set_delete), true},
 
     {"dict", {}, {
       /* TODO: implement these
@@ -894,8 +1435,11 @@ void create_default_builtin_classes() {
   KeyError_class_id = builtin_names.at("KeyError").class_id;
   TypeError_class_id = builtin_names.at("TypeError").class_id;
   ValueError_class_id = builtin_names.at("ValueError").class_id;
+  ZeroDivisionError_class_id = builtin_names.at("ZeroDivisionError").class_id;
   AssertionError_class_id = builtin_names.at("AssertionError").class_id;
+  EOFError_class_id = builtin_names.at("EOFError").class_id;
   OSError_class_id = builtin_names.at("OSError").class_id;
+  OverflowError_class_id = builtin_names.at("OverflowError").class_id;
 
   BytesObject_class_id = builtin_names.at("bytes").class_id;
   UnicodeObject_class_id = builtin_names.at("unicode").class_id;
@@ -904,6 +1448,28 @@ void create_default_builtin_classes() {
   DictObject_class_id = builtin_names.at("dict").class_id;
   SetObject_class_id = builtin_names.at("set").class_id;
 
+  // int's methods are in a class that isn't registered globally, since int()
+  // is a function. both methods are intrinsics; these implementations are only
+  // called for promoted values or when the cpu doesn't have popcnt/lzcnt
+  static BuiltinClassDefinition int_def("int", {}, {
+    {"bit_count", {Int}, Int, void_fn_ptr([](int64_t v) -> int64_t {
+      int64_t ret = int_bit_count(v);
+      int_delete_reference(v);
+      return ret;
+    }), false, false},
+    {"bit_length", {Int}, Int, void_fn_ptr([](int64_t v) -> int64_t {
+      int64_t ret = int_bit_length(v);
+      int_delete_reference(v);
+      return ret;
+    }), false, false},
+  }, NULL, false);
+  Int_class_id = create_builtin_class(int_def);
+  const auto& int_attributes = builtin_class_definitions.at(Int_class_id).attributes;
+  register_intrinsic(int_attributes.at("bit_count").function_id, Intrinsic::BitCount);
+  register_intrinsic(int_attributes.at("bit_length").function_id, Intrinsic::BitLength);
+  register_promoted_int_function(int_attributes.at("bit_count").function_id);
+  register_promoted_int_function(int_attributes.at("bit_length").function_id);
+
   // create some common exception singletons. note that the MemoryError instance
   // probably can't be allocated when it's really needed, so instead it's a
   // global preallocated singleton
@@ -925,8 +1491,6 @@ void create_default_builtin_names() {
   create_builtin_name("__spec__",        Variable(ValueType::None));
   create_builtin_name("Ellipsis",        Variable());
   create_builtin_name("NotImplemented",  Variable());
-  create_builtin_name("all",             Variable(ValueType::Function));
-  create_builtin_name("any",             Variable(ValueType::Function));
   create_builtin_name("ascii",           Variable(ValueType::Function));
   create_builtin_name("bool",            Variable(ValueType::Function));
   create_builtin_name("bytearray",       Variable(ValueType::Function));
@@ -940,7 +1504,6 @@ void create_default_builtin_names() {
   create_builtin_name("delattr",         Variable(ValueType::Function));
   create_builtin_name("dir",             Variable(ValueType::Function));
   create_builtin_name("divmod",          Variable(ValueType::Function));
-  create_builtin_name("enumerate",       Variable(ValueType::Function));
   create_builtin_name("eval",            Variable(ValueType::Function));
   create_builtin_name("exec",            Variable(ValueType::Function));
   create_builtin_name("exit",            Variable(ValueType::Function));
@@ -959,9 +1522,7 @@ void create_default_builtin_names() {
   create_builtin_name("license",         Variable(ValueType::Function));
   create_builtin_name("locals",          Variable(ValueType::Function));
   create_builtin_name("map",             Variable(ValueType::Function));
-  create_builtin_name("max",             Variable(ValueType::Function));
   create_builtin_name("memoryview",      Variable(ValueType::Function));
-  create_builtin_name("min",             Variable(ValueType::Function));
   create_builtin_name("next",            Variable(ValueType::Function));
   create_builtin_name("object",          Variable(ValueType::Function));
   create_builtin_name("open",            Variable(ValueType::Function));
@@ -969,19 +1530,15 @@ void create_default_builtin_names() {
   create_builtin_name("pow",             Variable(ValueType::Function));
   create_builtin_name("property",        Variable(ValueType::Function));
   create_builtin_name("quit",            Variable(ValueType::Function));
-  create_builtin_name("range",           Variable(ValueType::Function));
   create_builtin_name("reversed",        Variable(ValueType::Function));
   create_builtin_name("round",           Variable(ValueType::Function));
   create_builtin_name("setattr",         Variable(ValueType::Function));
   create_builtin_name("slice",           Variable(ValueType::Function));
-  create_builtin_name("sorted",          Variable(ValueType::Function));
   create_builtin_name("staticmethod",    Variable(ValueType::Function));
   create_builtin_name("str",             Variable(ValueType::Function));
-  create_builtin_name("sum",             Variable(ValueType::Function));
   create_builtin_name("super",           Variable(ValueType::Function));
   create_builtin_name("type",            Variable(ValueType::Function));
   create_builtin_name("vars",            Variable(ValueType::Function));
-  create_builtin_name("zip",             Variable(ValueType::Function));
 
   create_default_builtin_functions();
   create_default_builtin_classes();
@@ -1010,6 +1567,7 @@ static unordered_map<string, BuiltinModule> builtin_modules({
   DECLARE_MODULE(posix),
   DECLARE_MODULE(sys),
   DECLARE_MODULE(time),
+  DECLARE_MODULE(vmath),
 });
 #undef DECLARE_MODULE
 
@@ -17,11 +17,19 @@ extern std::unordered_map<int64_t, ClassContext> builtin_class_definitions;
 
 extern InstanceObject MemoryError_instance;
 extern int64_t AssertionError_class_id;
+extern int64_t EOFError_class_id;
 extern int64_t IndexError_class_id;
 extern int64_t KeyError_class_id;
 extern int64_t OSError_class_id;
+extern int64_t OverflowError_class_id;
 extern int64_t TypeError_class_id;
 extern int64_t ValueError_class_id;
+extern int64_t ZeroDivisionError_class_id;
+
+extern int64_t print_function_id;
+extern int64_t range_function_id;
+extern int64_t enumerate_function_id;
+extern int64_t zip_function_id;
 
 extern int64_t BytesObject_class_id;
 extern int64_t UnicodeObject_class_id;
@@ -29,6 +37,34 @@ extern int64_t DictObject_class_id;
 extern int64_t ListObject_class_id;
 extern int64_t TupleObject_class_id;
 extern int64_t SetObject_class_id;
+extern int64_t Int_class_id;
+
+// builtin functions that CompilationVisitor can write inline as one or a few
+// instructions. the builtin's own implementation is still called when the
+// target cpu doesn't have the necessary instructions
+enum class Intrinsic {
+  None = 0,
+  BitCount,
+  BitLength,
+  CountTrailingZeroes,
+  CountLeadingZeroes,
+  RotateLeft,
+  ByteSwap,
+  SquareRoot,
+  FloatAbs,
+  Floor,
+  Ceil,
+  Truncate,
+};
+
+void register_intrinsic(int64_t function_id, Intrinsic intrinsic);
+Intrinsic intrinsic_for_function(int64_t function_id);
+
+// calls to built-in functions check that their Int arguments aren't promoted
+// (see Types/Int.hh) and raise OverflowError if they are, unless the function
+// is registered here as handling promoted values itself
+void register_promoted_int_function(int64_t function_id);
+bool function_accepts_promoted_ints(int64_t function_id);
 
 // functions for creating new builtin functions and classes
 int64_t create_builtin_function(BuiltinFunctionDefinition& def);
@@ -36,6 +72,11 @@ int64_t create_builtin_class(BuiltinClassDefinition& def);
 
 void create_builtin_name(const char* name, const Variable& value);
 
+// returns the number of items in range(start, stop, step), or raises ValueError
+// if step is zero
+int64_t range_length(int64_t start, int64_t stop, int64_t step,
+    ExceptionBlock* exc_block = NULL);
+
 void create_default_builtin_names();
 
 // functions for retrieving builtin names
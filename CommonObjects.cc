@@ -9,12 +9,15 @@
 
 #include "BuiltinFunctions.hh"
 #include "Exception.hh"
+#include "StandardStreams.hh"
 #include "Types/Reference.hh"
 #include "Types/Strings.hh"
 #include "Types/Format.hh"
+#include "Types/Int.hh"
 #include "Types/List.hh"
 #include "Types/Tuple.hh"
 #include "Types/Dictionary.hh"
+#include "Types/Set.hh"
 
 using namespace std;
 
@@ -34,28 +37,108 @@ static const vector<const void*> objects({
 
   void_fn_ptr(&_unwind_exception_internal),
 
+  void_fn_ptr(&range_length),
+
+  void_fn_ptr(&int_from_int64),
+  void_fn_ptr(&int_from_double),
+  void_fn_ptr(&int_to_int64),
+  void_fn_ptr(&int_to_double),
+  void_fn_ptr(&int_add),
+  void_fn_ptr(&int_subtract),
+  void_fn_ptr(&int_multiply),
+  void_fn_ptr(&int_floor_divide),
+  void_fn_ptr(&int_modulus),
+  void_fn_ptr(&int_power),
+  void_fn_ptr(&int_negate),
+  void_fn_ptr(&int_invert),
+  void_fn_ptr(&int_and),
+  void_fn_ptr(&int_or),
+  void_fn_ptr(&int_xor),
+  void_fn_ptr(&int_left_shift),
+  void_fn_ptr(&int_right_shift),
+  void_fn_ptr(&int_compare),
+  void_fn_ptr(&int_bit_length),
+  void_fn_ptr(&int_bit_count),
+  void_fn_ptr(&int_add_reference),
+  void_fn_ptr(&int_delete_reference),
+
+  releasing_int_fn_ptr(int_to_int64),
+  releasing_int_fn_ptr(int_to_double),
+  releasing_int_fn_ptr(int_add),
+  releasing_int_fn_ptr(int_subtract),
+  releasing_int_fn_ptr(int_multiply),
+  releasing_int_fn_ptr(int_floor_divide),
+  releasing_int_fn_ptr(int_modulus),
+  releasing_int_fn_ptr(int_power),
+  releasing_int_fn_ptr(int_negate),
+  releasing_int_fn_ptr(int_invert),
+  releasing_int_fn_ptr(int_and),
+  releasing_int_fn_ptr(int_or),
+  releasing_int_fn_ptr(int_xor),
+  releasing_int_fn_ptr(int_left_shift),
+  releasing_int_fn_ptr(int_right_shift),
+  releasing_int_fn_ptr(int_compare),
+  releasing_int_fn_ptr(int_bit_length),
+  releasing_int_fn_ptr(int_bit_count),
+
   void_fn_ptr(&bytes_equal),
   void_fn_ptr(&bytes_compare),
   void_fn_ptr(&bytes_contains),
   void_fn_ptr(&bytes_concat),
+  void_fn_ptr(&bytes_get_item),
+  void_fn_ptr(&bytes_slice),
   void_fn_ptr(&bytes_format),
   void_fn_ptr(&bytes_format_one),
+  void_fn_ptr(&bytes_format_compiled),
+  void_fn_ptr(&bytes_format_compiled_one),
 
   void_fn_ptr(&unicode_equal),
   void_fn_ptr(&unicode_compare),
   void_fn_ptr(&unicode_contains),
   void_fn_ptr(&unicode_concat),
+  void_fn_ptr(&unicode_get_item),
+  void_fn_ptr(&unicode_slice),
   void_fn_ptr(&unicode_format),
   void_fn_ptr(&unicode_format_one),
+  void_fn_ptr(&unicode_format_compiled),
+  void_fn_ptr(&unicode_format_compiled_one),
+
+  void_fn_ptr(&stdout_write_char),
+  void_fn_ptr(&stdout_write_none),
+  void_fn_ptr(&stdout_write_bool),
+  void_fn_ptr(&stdout_write_int),
+  void_fn_ptr(&stdout_write_float),
+  void_fn_ptr(&stdout_write_bytes),
+  void_fn_ptr(static_cast<void(*)(const UnicodeObject*)>(&stdout_write_unicode)),
+  void_fn_ptr(&stdin_read_lines),
 
   void_fn_ptr(&list_new),
   void_fn_ptr(&list_get_item),
   void_fn_ptr(&list_set_item),
+  void_fn_ptr(&list_append),
+  void_fn_ptr(&list_slice),
+  void_fn_ptr(&list_set_slice),
 
   void_fn_ptr(&tuple_new),
   void_fn_ptr(&tuple_get_item),
 
+  void_fn_ptr(&dictionary_new),
+  void_fn_ptr(&dictionary_insert),
+  void_fn_ptr(&dictionary_at),
+  void_fn_ptr(&dictionary_at_cached),
   void_fn_ptr(&dictionary_next_item),
+
+  void_fn_ptr(&set_new),
+  void_fn_ptr(&set_add),
+  void_fn_ptr(&set_contains),
+  void_fn_ptr(&set_union),
+  void_fn_ptr(&set_intersection),
+  void_fn_ptr(&set_difference),
+  void_fn_ptr(&set_symmetric_difference),
+  void_fn_ptr(&set_equal),
+  void_fn_ptr(&set_is_subset),
+  void_fn_ptr(&set_is_proper_subset),
+  void_fn_ptr(&set_next_item),
 });
 
 static unique_ptr<const unordered_map<const void*, size_t>> pointer_to_index;
@@ -1,7 +1,36 @@
 #pragma once
 
 #include "Assembler/AMD64Assembler.hh" // for MemoryReference
+#include "Exception.hh"
+#include "Types/Int.hh"
 
 const void* common_object_base();
 size_t common_object_count();
 MemoryReference common_object_reference(const void* which);
+
+// the int_* functions borrow their arguments (see Types/Int.hh), but generated
+// code owns a reference to each Int it computes, so the slow paths of Int
+// operations call these wrappers, which release the Int arguments afterward.
+// only functions whose int64_t arguments are all Int values can be wrapped.
+// like the functions they wrap, the wrappers are common objects
+inline void release_int_argument(int64_t v) {
+  int_delete_reference(v);
+}
+
+inline void release_int_argument(ExceptionBlock*) { }
+
+template <typename FnT, FnT Fn>
+struct ReleasingIntFunction;
+
+template <typename ReturnT, typename... ArgTs, ReturnT (*Fn)(ArgTs...)>
+struct ReleasingIntFunction<ReturnT (*)(ArgTs...), Fn> {
+  static ReturnT call(ArgTs... args) {
+    ReturnT ret = Fn(args...);
+    int unused[] = {0, (release_int_argument(args), 0)...};
+    (void)unused;
+    return ret;
+  }
+};
+
+#define releasing_int_fn_ptr(fn) \
+  reinterpret_cast<const void*>(&ReleasingIntFunction<decltype(&fn), &fn>::call)
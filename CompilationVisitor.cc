@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include <functional>
+#include <map>
 #include <phosg/Filesystem.hh>
 #include <phosg/Strings.hh>
 
@@ -17,11 +19,16 @@
 #include "Parser/PythonASTNodes.hh"
 #include "Parser/PythonASTVisitor.hh"
 #include "Environment.hh"
+#include "Modules/__nemesys__.hh"
+#include "StandardStreams.hh"
 #include "Assembler/AMD64Assembler.hh"
 #include "Types/Reference.hh"
+#include "Types/Slice.hh"
 #include "Types/Strings.hh"
 #include "Types/Format.hh"
+#include "Types/Int.hh"
 #include "Types/List.hh"
+#include "Types/Set.hh"
 #include "Types/Tuple.hh"
 #include "Types/Dictionary.hh"
 
@@ -39,6 +46,92 @@ static const int64_t default_available_int_registers =
     (1 << r8) | (1 << r9) | (1 << r10) | (1 << r11);
 static const int64_t default_available_float_registers = 0xFFFF; // all of them
 
+static bool is_float_arithmetic_operator(BinaryOperator oper) {
+  return (oper == BinaryOperator::Addition) ||
+         (oper == BinaryOperator::Subtraction) ||
+         (oper == BinaryOperator::Multiplication) ||
+         (oper == BinaryOperator::Division);
+}
+
+// the features of the host cpu that generated code may use
+static const CPUFeatures& target_cpu_features() {
+  static const CPUFeatures baseline_features;
+  return (debug_flags & DebugFlag::BaselineISA) ? baseline_features :
+      CPUFeatures::host();
+}
+
+// fused multiply-add rounds once instead of twice, so results can differ from
+// cpython's; it's only used if the user asks for it
+static bool use_fused_multiply_add() {
+  return (debug_flags & DebugFlag::FusedMultiplyAdd) &&
+      target_cpu_features().fma;
+}
+
+// range() calls with positional args only are compiled inline by for loops and
+// comprehensions, without materializing the list
+static bool is_simple_range_call(FunctionCall* call) {
+  return call && (call->callee_function_id == range_function_id) &&
+      !call->args.empty() && (call->args.size() <= 3) &&
+      call->kwargs.empty() && !call->varargs.get() && !call->varkwargs.get();
+}
+
+static bool is_unbounded_stdin_lines_call(FunctionCall* call) {
+  return call && stdin_lines_function_id &&
+      (call->callee_function_id == stdin_lines_function_id) &&
+      call->args.empty() && call->kwargs.empty() && !call->varargs.get() &&
+      !call->varkwargs.get();
+}
+
+// sets of Ints and Bools are stored unboxed; sets of strings cache the hashes
+// of their items. other item types aren't supported
+static SetKeyType set_key_type_for_item_type(const Variable& item_type,
+    ssize_t file_offset) {
+  switch (item_type.type) {
+    case ValueType::Bool:
+    case ValueType::Int:
+      return SetKeyType::Int;
+    case ValueType::Bytes:
+      return SetKeyType::Bytes;
+    case ValueType::Unicode:
+      return SetKeyType::Unicode;
+    default:
+      throw compile_error("sets can only contain Bool, Int, Bytes, or Unicode items; here it\'s " +
+          item_type.str(), file_offset);
+  }
+}
+
+// returns the key functions and flags for dictionary_new. Int keys use the
+// default key functions, which are selected by passing NULL
+struct DictionaryLayout {
+  const void* key_length;
+  const void* key_char;
+  uint64_t flags;
+};
+
+static DictionaryLayout dictionary_layout_for_types(const Variable& key_type,
+    const Variable& value_type, ssize_t file_offset) {
+  if ((key_type.type == ValueType::Float) || (value_type.type == ValueType::Float)) {
+    throw compile_error("dicts cannot contain Float keys or values",
+        file_offset);
+  }
+
+  DictionaryLayout ret;
+  ret.key_length = NULL;
+  ret.key_char = NULL;
+  if (key_type.type == ValueType::Bytes) {
+    ret.key_length = void_fn_ptr(&bytes_length);
+    ret.key_char = void_fn_ptr(&bytes_at);
+  } else if (key_type.type == ValueType::Unicode) {
+    ret.key_length = void_fn_ptr(&unicode_length);
+    ret.key_char = void_fn_ptr(&unicode_at);
+  }
+  ret.flags = ((key_type.type == ValueType::Int) ? DictionaryFlag::KeysAreInts :
+        type_has_refcount(key_type.type) ? DictionaryFlag::KeysAreObjects : 0) |
+      ((value_type.type == ValueType::Int) ? DictionaryFlag::ValuesAreInts :
+        type_has_refcount(value_type.type) ? DictionaryFlag::ValuesAreObjects : 0);
+  return ret;
+}
+
 
 
 CompilationVisitor::CompilationVisitor(GlobalAnalysis* global,
@@ -276,11 +369,16 @@ void CompilationVisitor::visit(UnaryOperation* a) {
         this->as.write_xor(target_mem, 1);
 
       } else if (this->current_type.type == ValueType::Int) {
-        // check if the value is zero
+        // check if the value is zero, then release it if it's promoted
+        Register reg = this->available_register_except({this->target_register});
+        MemoryReference mem(reg);
+        this->reserve_register(reg);
+        this->as.write_mov(reg, 0);
         this->as.write_test(target_mem, target_mem);
-        this->as.write_mov(this->target_register, 0);
-        this->as.write_setz(MemoryReference(byte_register_for_register(
-            this->target_register)));
+        this->as.write_setz(MemoryReference(byte_register_for_register(reg)));
+        this->write_delete_held_reference(target_mem);
+        this->as.write_mov(target_mem, mem);
+        this->release_register(reg);
 
       } else if (this->current_type.type == ValueType::Float) {
         // 0.0 and -0.0 are falsey, everything else is truthy
@@ -322,8 +420,17 @@ void CompilationVisitor::visit(UnaryOperation* a) {
       break;
 
     case UnaryOperator::Not:
-      if ((this->current_type.type == ValueType::Int) ||
-          (this->current_type.type == ValueType::Bool)) {
+      if (this->current_type.type == ValueType::Int) {
+        // ~x is direct whenever x is
+        string resume_label = string_printf("__UnaryOperation_%p_resume", a);
+        this->write_jump_if_promoted(
+            this->available_register_except({this->target_register}),
+            target_mem, this->int_slow_path_label(resume_label,
+              releasing_int_fn_ptr(int_invert), {target_mem}, {},
+              this->target_register));
+        this->as.write_not(target_mem);
+        this->as.write_label(resume_label);
+      } else if (this->current_type.type == ValueType::Bool) {
         this->as.write_not(target_mem);
       } else {
         throw compile_error("bitwise not can only be applied to ints and bools", this->file_offset);
@@ -342,8 +449,23 @@ void CompilationVisitor::visit(UnaryOperation* a) {
       break;
 
     case UnaryOperator::Negative:
-      if ((this->current_type.type == ValueType::Bool) ||
-          (this->current_type.type == ValueType::Int)) {
+      if (this->current_type.type == ValueType::Int) {
+        // negate the doubled value, so the result overflows if it isn't direct
+        string resume_label = string_printf("__UnaryOperation_%p_resume", a);
+        string slow_label = this->int_slow_path_label(resume_label,
+            releasing_int_fn_ptr(int_negate), {target_mem}, {},
+            this->target_register);
+        MemoryReference temp_mem(this->available_register_except(
+            {this->target_register}));
+        this->write_jump_if_promoted(temp_mem.base_register, target_mem,
+            slow_label);
+        this->as.write_neg(temp_mem);
+        this->as.write_jo(slow_label);
+        this->as.write_sar(temp_mem, 1);
+        this->as.write_mov(target_mem, temp_mem);
+        this->as.write_label(resume_label);
+
+      } else if (this->current_type.type == ValueType::Bool) {
         this->as.write_neg(target_mem);
         this->current_type = Variable(ValueType::Int);
 
@@ -365,6 +487,9 @@ void CompilationVisitor::visit(UnaryOperation* a) {
     case UnaryOperator::Yield:
       throw compile_error("yield operator not yet supported", this->file_offset);
   }
+
+  // the result is a new Int (owned, if it's promoted), or a Bool or Float
+  this->holding_reference = type_has_refcount(this->current_type.type);
 }
 
 bool CompilationVisitor::is_always_truthy(const Variable& type) {
@@ -430,6 +555,17 @@ void CompilationVisitor::write_current_truth_value_test() {
   }
 }
 
+// multiplier and shift for dividing nonnegative 63-bit values by a positive
+// constant d that isn't a power of 2: n / d == mulhi(n, m) >> shift. with
+// l = ceil(log2(d)) and m = ceil(2^(63 + l) / d), the error term is less than
+// 2^-l <= 1/d, so it never carries into the integer part, and m fits in 64 bits
+static void unsigned_division_magic(int64_t d, uint64_t* m, uint8_t* shift) {
+  uint8_t l = 64 - __builtin_clzll(static_cast<uint64_t>(d - 1));
+  unsigned __int128 n = static_cast<unsigned __int128>(1) << (63 + l);
+  *m = static_cast<uint64_t>((n + d - 1) / d);
+  *shift = l - 1;
+}
+
 void CompilationVisitor::visit(BinaryOperation* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
@@ -491,6 +627,15 @@ void CompilationVisitor::visit(BinaryOperation* a) {
     return;
   }
 
+  // arithmetic on floats is done entirely in xmm registers, so the operands
+  // don't have to go through the stack
+  if (is_float_arithmetic_operator(a->oper) &&
+      (this->is_float_expression(a->left.get()) ||
+       this->is_float_expression(a->right.get()))) {
+    this->write_float_arithmetic(a);
+    return;
+  }
+
   // all of the remaining operators use both operands, so evaluate both of them
   // into different registers
   // TODO: it's kind of stupid that we push the result onto the stack; figure
@@ -510,7 +655,7 @@ void CompilationVisitor::visit(BinaryOperation* a) {
 
   this->as.write_label(string_printf("__BinaryOperation_%p_evaluate_right", a));
   a->right->accept(this);
-  Variable& right_type = this->current_type;
+  Variable right_type = this->current_type;
   if (right_type.type == ValueType::Float) {
     this->as.write_movq_from_xmm(target_mem, this->float_target_register);
   }
@@ -540,6 +685,40 @@ void CompilationVisitor::visit(BinaryOperation* a) {
   bool left_unicode = (left_type.type == ValueType::Unicode);
   bool right_unicode = (right_type.type == ValueType::Unicode);
   bool right_tuple = (right_type.type == ValueType::Tuple);
+  bool left_set = (left_type.type == ValueType::Set);
+  bool right_set = (right_type.type == ValueType::Set);
+
+  // Int operations check that their operands are direct (Bools always are)
+  // and call fn(left, right[, exc_block]) if not; the inline code ends with
+  // resume_label. fn releases the operands (see ReleasingIntFunction), and
+  // direct operands don't need to be released, so the cleanup code below
+  // skips Int operands when int_operands_released is set
+  string resume_label = string_printf("__BinaryOperation_%p_resume", a);
+  bool int_operands_released = false;
+  auto write_int_operand_checks = [&](const void* fn,
+      bool pass_exception_block) -> string {
+    int_operands_released = true;
+    vector<MemoryReference> args({left_mem, right_mem});
+    if (pass_exception_block) {
+      args.emplace_back(r14);
+    }
+    string slow_label = this->int_slow_path_label(resume_label, fn, args, {},
+        this->target_register);
+    if (left_int_only) {
+      this->write_jump_if_promoted(temp_mem.base_register, left_mem, slow_label);
+    }
+    if (right_int_only) {
+      this->write_jump_if_promoted(temp_mem.base_register, right_mem, slow_label);
+    }
+    return slow_label;
+  };
+
+  // set operations require both sets to have the same item type
+  if (left_set && right_set &&
+      !left_type.extension_types.at(0).types_equal(right_type.extension_types.at(0))) {
+    throw compile_error("cannot combine " + left_type.str() + " and " +
+        right_type.str(), this->file_offset);
+  }
 
   this->as.write_label(string_printf("__BinaryOperation_%p_combine", a));
   switch (a->oper) {
@@ -562,10 +741,32 @@ void CompilationVisitor::visit(BinaryOperation* a) {
         MemoryReference xmm_mem(xmm);
         this->as.write_xor(target_mem, target_mem);
 
-        // Int vs Int
+        // Int vs Int. there's only one live object for each promoted value,
+        // so == and != can compare them directly, but ordered comparisons have
+        // to call int_compare. the target register is reserved so the slow
+        // path preserves its zero
         if (left_int && right_int) {
+          bool ordered = (a->oper != BinaryOperator::Equality) &&
+              (a->oper != BinaryOperator::NotEqual);
+          if (ordered && (left_int_only || right_int_only)) {
+            int_operands_released = true;
+            this->reserve_register(this->target_register);
+            string slow_label = this->int_slow_path_label(resume_label,
+                releasing_int_fn_ptr(int_compare), {left_mem, right_mem}, {},
+                temp_mem.base_register, false, true);
+            this->release_register(this->target_register);
+            if (left_int_only) {
+              this->write_jump_if_promoted(temp_mem.base_register, left_mem,
+                  slow_label);
+            }
+            if (right_int_only) {
+              this->write_jump_if_promoted(temp_mem.base_register, right_mem,
+                  slow_label);
+            }
+          }
           this->as.write_mov(temp_mem, left_mem);
           this->as.write_cmp(temp_mem, right_mem);
+          this->as.write_label(resume_label);
           target_mem.base_register = byte_register_for_register(target_mem.base_register);
           if (a->oper == BinaryOperator::LessThan) {
             this->as.write_setl(target_mem);
@@ -583,7 +784,7 @@ void CompilationVisitor::visit(BinaryOperation* a) {
 
         // Float vs Int
         } else if (left_float && right_int) {
-          this->as.write_cvtsi2sd(xmm, right_mem);
+          this->write_int_to_float(xmm, right_mem);
 
           // we're comparing in the opposite direction, so we negate the results
           // of ordered comparisons
@@ -605,7 +806,7 @@ void CompilationVisitor::visit(BinaryOperation* a) {
         // Int vs Float and Float vs Float
         } else if (right_float) {
           if (left_int) {
-            this->as.write_cvtsi2sd(xmm, left_mem);
+            this->write_int_to_float(xmm, left_mem);
           } else {
             this->as.write_movsd(xmm_mem, left_mem);
           }
@@ -637,6 +838,8 @@ void CompilationVisitor::visit(BinaryOperation* a) {
               left_bytes ? void_fn_ptr(&bytes_equal) : void_fn_ptr(&unicode_equal));
           this->write_function_call(target_function, {target_mem, left_mem},
               {}, -1, this->target_register);
+          // C functions returning bool only set the low byte
+          this->as.write_and(target_mem, 0xFF);
           if (a->oper == BinaryOperator::NotEqual) {
             this->as.write_xor(target_mem, 1);
           }
@@ -660,6 +863,29 @@ void CompilationVisitor::visit(BinaryOperation* a) {
           }
         }
 
+      } else if (left_set && right_set) {
+        // ordered comparisons are subset tests. the operands are swapped for
+        // > and >=
+        const void* fn;
+        bool swap = (a->oper == BinaryOperator::GreaterThan) ||
+            (a->oper == BinaryOperator::GreaterOrEqual);
+        if ((a->oper == BinaryOperator::Equality) ||
+            (a->oper == BinaryOperator::NotEqual)) {
+          fn = void_fn_ptr(&set_equal);
+        } else if ((a->oper == BinaryOperator::LessThan) ||
+                   (a->oper == BinaryOperator::GreaterThan)) {
+          fn = void_fn_ptr(&set_is_proper_subset);
+        } else {
+          fn = void_fn_ptr(&set_is_subset);
+        }
+        this->write_function_call(common_object_reference(fn),
+            {swap ? right_mem : left_mem, swap ? left_mem : right_mem}, {}, -1,
+            this->target_register);
+        this->as.write_and(target_mem, 0xFF);
+        if (a->oper == BinaryOperator::NotEqual) {
+          this->as.write_xor(target_mem, 1);
+        }
+
       } else {
         throw compile_error("unimplemented non-numeric ordered comparison: " +
             left_type.str() + " vs " + right_type.str(), this->file_offset);
@@ -676,6 +902,19 @@ void CompilationVisitor::visit(BinaryOperation* a) {
             left_bytes ? void_fn_ptr(&bytes_contains) : void_fn_ptr(&unicode_contains));
         this->write_function_call(target_function, {target_mem, left_mem}, {},
             -1, this->target_register);
+        this->as.write_and(target_mem, 0xFF);
+
+      } else if (right_set && left_int &&
+          (set_key_type_for_item_type(right_type.extension_types.at(0),
+            this->file_offset) == SetKeyType::Int)) {
+        this->write_set_int_contains(a, left_mem);
+
+      } else if (right_set &&
+          left_type.types_equal(right_type.extension_types.at(0))) {
+        this->write_function_call(
+            common_object_reference(void_fn_ptr(&set_contains)),
+            {target_mem, left_mem}, {}, -1, this->target_register);
+        this->as.write_and(target_mem, 0xFF);
 
       } else {
         // TODO
@@ -732,21 +971,62 @@ void CompilationVisitor::visit(BinaryOperation* a) {
 
     case BinaryOperator::Or:
       if (left_int && right_int) {
+        if (left_int_only || right_int_only) {
+          write_int_operand_checks(releasing_int_fn_ptr(int_or), false);
+        }
         this->as.write_or(target_mem, left_mem);
+        this->as.write_label(resume_label);
+        // the result is a Bool only if both operands are; here and in the
+        // arithmetic operators below, an Int result owns its value
+        if (left_int_only || right_int_only) {
+          this->current_type = Variable(ValueType::Int);
+        }
+        break;
+      }
+      if (left_set && right_set) {
+        this->write_function_call(common_object_reference(void_fn_ptr(&set_union)),
+            {left_mem, right_mem, r14}, {}, -1, this->target_register);
+        this->holding_reference = true;
         break;
       }
       throw compile_error("Or not valid for " + left_type.str() + " and " + right_type.str(), this->file_offset);
 
     case BinaryOperator::And:
       if (left_int && right_int) {
+        if (left_int_only || right_int_only) {
+          write_int_operand_checks(releasing_int_fn_ptr(int_and), false);
+        }
         this->as.write_and(target_mem, left_mem);
+        this->as.write_label(resume_label);
+        if (left_int_only || right_int_only) {
+          this->current_type = Variable(ValueType::Int);
+        }
+        break;
+      }
+      if (left_set && right_set) {
+        this->write_function_call(common_object_reference(void_fn_ptr(&set_intersection)),
+            {left_mem, right_mem, r14}, {}, -1, this->target_register);
+        this->holding_reference = true;
         break;
       }
       throw compile_error("And not valid for " + left_type.str() + " and " + right_type.str(), this->file_offset);
 
     case BinaryOperator::Xor:
       if (left_int && right_int) {
+        if (left_int_only || right_int_only) {
+          write_int_operand_checks(releasing_int_fn_ptr(int_xor), false);
+        }
         this->as.write_xor(target_mem, left_mem);
+        this->as.write_label(resume_label);
+        if (left_int_only || right_int_only) {
+          this->current_type = Variable(ValueType::Int);
+        }
+        break;
+      }
+      if (left_set && right_set) {
+        this->write_function_call(common_object_reference(void_fn_ptr(&set_symmetric_difference)),
+            {left_mem, right_mem, r14}, {}, -1, this->target_register);
+        this->holding_reference = true;
         break;
       }
       throw compile_error("Xor not valid for " + left_type.str() + " and " + right_type.str(), this->file_offset);
@@ -754,17 +1034,49 @@ void CompilationVisitor::visit(BinaryOperation* a) {
     case BinaryOperator::LeftShift:
     case BinaryOperator::RightShift:
       if (left_int && right_int) {
-        // we can only use cl apparently
+        // we can only use cl apparently, so if the target register is rcx, the
+        // shift is done in another register
         if (this->available_register(rcx) != rcx) {
           throw compile_error("RCX not available for shift operation", this->file_offset);
         }
-        this->as.write_mov(rcx, target_mem);
-        this->as.write_mov(target_mem, left_mem);
-        if (a->oper == BinaryOperator::LeftShift) {
-          this->as.write_shl_cl(target_mem);
+        bool is_left_shift = (a->oper == BinaryOperator::LeftShift);
+        int_operands_released = true;
+        string slow_label = this->int_slow_path_label(resume_label,
+            is_left_shift ? releasing_int_fn_ptr(int_left_shift) :
+              releasing_int_fn_ptr(int_right_shift),
+            {left_mem, right_mem, r14}, {}, this->target_register);
+        MemoryReference shift_mem((this->target_register == rcx) ?
+            temp_mem : target_mem);
+
+        // counts that are negative, promoted or over 63 are all above 63 when
+        // compared as unsigned values; the slow path handles them
+        this->as.write_mov(rcx, right_mem);
+        this->as.write_cmp(MemoryReference(rcx), 63);
+        this->as.write_ja(slow_label);
+
+        // the shift is done on the doubled value, so a promoted left operand
+        // or a result that isn't direct goes to the slow path too. shl doesn't
+        // set the overflow flag for multi-bit shifts, so shift back and make
+        // sure nothing was lost
+        this->write_jump_if_promoted(shift_mem.base_register, left_mem, slow_label);
+        if (is_left_shift) {
+          MemoryReference check_mem(this->available_register_except(
+              {shift_mem.base_register, this->target_register, rcx}));
+          this->as.write_shl_cl(shift_mem);
+          this->as.write_mov(check_mem, shift_mem);
+          this->as.write_sar_cl(check_mem);
+          this->as.write_sar(check_mem, 1);
+          this->as.write_cmp(check_mem, left_mem);
+          this->as.write_jne(slow_label);
         } else {
-          this->as.write_sar_cl(target_mem);
+          this->as.write_sar_cl(shift_mem);
         }
+        this->as.write_sar(shift_mem, 1);
+        if (shift_mem != target_mem) {
+          this->as.write_mov(target_mem, shift_mem);
+        }
+        this->as.write_label(resume_label);
+        this->current_type = Variable(ValueType::Int);
         break;
       }
       throw compile_error("bit shift not valid for " + left_type.str() + " and " + right_type.str(), this->file_offset);
@@ -780,15 +1092,26 @@ void CompilationVisitor::visit(BinaryOperation* a) {
             {left_mem, target_mem, r14}, {}, -1, this->target_register);
 
       } else if (left_int && right_int) {
-        this->as.write_add(target_mem, left_mem);
+        // the sum of the doubled operands overflows if the result isn't direct
+        int_operands_released = true;
+        string slow_label = this->int_slow_path_label(resume_label,
+            releasing_int_fn_ptr(int_add), {left_mem, right_mem}, {},
+            this->target_register);
+        this->write_jump_if_promoted(temp_mem.base_register, left_mem, slow_label);
+        this->write_jump_if_promoted(this->target_register, target_mem, slow_label);
+        this->as.write_add(target_mem, temp_mem);
+        this->as.write_jo(slow_label);
+        this->as.write_sar(target_mem, 1);
+        this->as.write_label(resume_label);
+        this->current_type = Variable(ValueType::Int);
 
       } else if (left_int && right_float) {
-        this->as.write_cvtsi2sd(this->float_target_register, left_mem);
+        this->write_int_to_float(this->float_target_register, left_mem);
         this->as.write_addsd(this->float_target_register, right_mem);
 
       } else if (left_float && right_int) {
         // the int value is still in the target register; skip the memory access
-        this->as.write_cvtsi2sd(this->float_target_register, target_mem);
+        this->write_int_to_float(this->float_target_register, target_mem);
         this->as.write_addsd(this->float_target_register, left_mem);
 
         // watch it: in this case the type is different from right_type
@@ -804,17 +1127,29 @@ void CompilationVisitor::visit(BinaryOperation* a) {
 
     case BinaryOperator::Subtraction:
       if (left_int && right_int) {
-        this->as.write_neg(target_mem);
-        this->as.write_add(target_mem, left_mem);
+        int_operands_released = true;
+        string slow_label = this->int_slow_path_label(resume_label,
+            releasing_int_fn_ptr(int_subtract), {left_mem, right_mem}, {},
+            this->target_register);
+        this->write_jump_if_promoted(temp_mem.base_register, left_mem, slow_label);
+        this->write_jump_if_promoted(this->target_register, target_mem, slow_label);
+        this->as.write_sub(temp_mem, target_mem);
+        this->as.write_jo(slow_label);
+        this->as.write_sar(temp_mem, 1);
+        this->as.write_mov(target_mem, temp_mem);
+        this->as.write_label(resume_label);
+        this->current_type = Variable(ValueType::Int);
 
       } else if (left_int && right_float) {
-        this->as.write_cvtsi2sd(this->float_target_register, left_mem);
+        this->write_int_to_float(this->float_target_register, left_mem);
         this->as.write_subsd(this->float_target_register, right_mem);
 
       } else if (left_float && right_int) {
-        this->as.write_neg(target_mem);
-        this->as.write_cvtsi2sd(this->float_target_register, target_mem);
-        this->as.write_addsd(this->float_target_register, left_mem);
+        Register tmp_xmm = this->available_register_except(
+            {this->float_target_register}, true);
+        this->write_int_to_float(tmp_xmm, target_mem);
+        this->as.write_movsd(float_target_mem, left_mem);
+        this->as.write_subsd(this->float_target_register, MemoryReference(tmp_xmm));
 
         // watch it: in this case the type is different from right_type
         this->current_type = Variable(ValueType::Float);
@@ -823,6 +1158,11 @@ void CompilationVisitor::visit(BinaryOperation* a) {
         this->as.write_movq_to_xmm(this->float_target_register, left_mem);
         this->as.write_subsd(this->float_target_register, right_mem);
 
+      } else if (left_set && right_set) {
+        this->write_function_call(common_object_reference(void_fn_ptr(&set_difference)),
+            {left_mem, right_mem, r14}, {}, -1, this->target_register);
+        this->holding_reference = true;
+
       } else {
         throw compile_error("Subtraction not implemented for " + left_type.str() + " and " + right_type.str(), this->file_offset);
       }
@@ -830,14 +1170,26 @@ void CompilationVisitor::visit(BinaryOperation* a) {
 
     case BinaryOperator::Multiplication:
       if (left_int && right_int) {
-        this->as.write_imul(target_mem.base_register, left_mem);
+        // one operand is doubled, so the product overflows if the result
+        // isn't direct
+        int_operands_released = true;
+        string slow_label = this->int_slow_path_label(resume_label,
+            releasing_int_fn_ptr(int_multiply), {left_mem, right_mem}, {},
+            this->target_register);
+        this->write_jump_if_promoted(temp_mem.base_register, target_mem, slow_label);
+        this->write_jump_if_promoted(temp_mem.base_register, left_mem, slow_label);
+        this->as.write_imul(target_mem.base_register, temp_mem);
+        this->as.write_jo(slow_label);
+        this->as.write_sar(target_mem, 1);
+        this->as.write_label(resume_label);
+        this->current_type = Variable(ValueType::Int);
 
       } else if (left_int && right_float) {
-        this->as.write_cvtsi2sd(this->float_target_register, left_mem);
+        this->write_int_to_float(this->float_target_register, left_mem);
         this->as.write_mulsd(this->float_target_register, right_mem);
 
       } else if (left_float && right_int) {
-        this->as.write_cvtsi2sd(this->float_target_register, right_mem);
+        this->write_int_to_float(this->float_target_register, right_mem);
         this->as.write_mulsd(this->float_target_register, left_mem);
 
         // watch it: in this case the type is different from right_type
@@ -860,17 +1212,20 @@ void CompilationVisitor::visit(BinaryOperation* a) {
       // TODO: check if right is zero and raise ZeroDivisionError if so
 
       if (left_int && right_int) {
-        this->as.write_cvtsi2sd(this->float_target_register, left_mem);
-        this->as.write_cvtsi2sd(tmp_xmm, right_mem);
+        // the second conversion's slow path would clobber the first's result
+        this->write_int_to_float(this->float_target_register, left_mem);
+        this->reserve_register(this->float_target_register, true);
+        this->write_int_to_float(tmp_xmm, right_mem);
+        this->release_register(this->float_target_register, true);
         this->as.write_divsd(this->float_target_register, tmp_xmm_mem);
 
       } else if (left_int && right_float) {
-        this->as.write_cvtsi2sd(this->float_target_register, left_mem);
+        this->write_int_to_float(this->float_target_register, left_mem);
         this->as.write_divsd(this->float_target_register, right_mem);
 
       } else if (left_float && right_int) {
+        this->write_int_to_float(tmp_xmm, right_mem);
         this->as.write_movsd(float_target_mem, left_mem);
-        this->as.write_cvtsi2sd(tmp_xmm, right_mem);
         this->as.write_divsd(this->float_target_register, tmp_xmm_mem);
 
       } else if (left_float && right_float) {
@@ -888,8 +1243,28 @@ void CompilationVisitor::visit(BinaryOperation* a) {
     case BinaryOperator::Modulus:
       if (left_bytes || left_unicode) {
         // AnalysisVisitor should have already done the typechecking - all we
-        // have to do is call the right format function
-        if (right_tuple) {
+        // have to do is call the right format function. if the format string
+        // is known, compile it now so the callee doesn't have to parse it
+        if (a->format_known) {
+          const void* program = left_bytes ?
+              reinterpret_cast<const void*>(this->global->get_or_create_format_program(a->bytes_format)) :
+              reinterpret_cast<const void*>(this->global->get_or_create_format_program(a->unicode_format));
+          Register r = available_register(rdi);
+          MemoryReference r_mem(r);
+          this->as.write_mov(r, reinterpret_cast<int64_t>(program));
+
+          const void* fn;
+          if (right_tuple) {
+            fn = left_bytes ? void_fn_ptr(&bytes_format_compiled) :
+                void_fn_ptr(&unicode_format_compiled);
+          } else {
+            fn = left_bytes ? void_fn_ptr(&bytes_format_compiled_one) :
+                void_fn_ptr(&unicode_format_compiled_one);
+          }
+          this->write_function_call(common_object_reference(fn),
+              {r_mem, right_mem, r14}, {}, -1, this->target_register);
+
+        } else if (right_tuple) {
           const void* fn = left_bytes ?
               void_fn_ptr(&bytes_format) : void_fn_ptr(&unicode_format);
           this->write_function_call(common_object_reference(fn),
@@ -900,7 +1275,7 @@ void CompilationVisitor::visit(BinaryOperation* a) {
           // have to tell the callee whether it is or not
           Register r = available_register(rdx);
           MemoryReference r_mem(r);
-          if (!right_holding_reference) {
+          if (!right_holding_reference || right_int_only) {
             this->as.write_xor(r_mem, r_mem);
           } else {
             this->as.write_mov(r_mem, 1);
@@ -943,20 +1318,140 @@ void CompilationVisitor::visit(BinaryOperation* a) {
           this->write_push(rdx);
         }
 
-        // TODO: check if right is zero and raise ZeroDivisionError if so
+        // the pushes above moved the operands further from rsp
+        int64_t pushed_bytes = (push_rax + push_rdx) * 8;
+        MemoryReference div_left_mem(rsp, 8 + pushed_bytes);
+        MemoryReference div_right_mem(rsp, pushed_bytes);
+        MemoryReference rax_mem(rax);
+        MemoryReference rdx_mem(rdx);
+
+        // promoted operands go to the slow path, which is written after the
+        // pushes so it can use the same stack offsets
+        Register check = this->available_register_except(
+            {rax, rdx, this->target_register});
+        int_operands_released = true;
+        string slow_label = this->int_slow_path_label(resume_label,
+            is_mod ? releasing_int_fn_ptr(int_modulus) :
+              releasing_int_fn_ptr(int_floor_divide),
+            {div_left_mem, div_right_mem, r14}, {}, this->target_register);
+        if (left_int_only) {
+          this->write_jump_if_promoted(check, div_left_mem, slow_label);
+        }
 
-        this->as.write_mov(rax, left_mem);
-        this->as.write_xor(rdx, rdx);
-        this->as.write_idiv(right_mem);
-        if (is_mod) {
+        // if the divisor is a positive constant, we can avoid idiv entirely
+        IntegerConstant* right_constant = dynamic_cast<IntegerConstant*>(a->right.get());
+        int64_t divisor = (right_constant && int_is_direct(right_constant->value)) ?
+            right_constant->value : 0;
+
+        if ((divisor > 0) && !(divisor & (divisor - 1))) {
+          // powers of 2: floor division is an arithmetic shift and the modulus
+          // is the low bits, regardless of the dividend's sign
+          uint8_t bits = __builtin_ctzll(divisor);
+          this->as.write_mov(target_mem, div_left_mem);
+          if (!is_mod) {
+            if (bits) {
+              this->as.write_sar(target_mem, bits);
+            }
+          } else if (!bits) {
+            this->as.write_xor(target_mem, target_mem);
+          } else if (bits < 32) {
+            this->as.write_and(target_mem, divisor - 1);
+          } else {
+            this->as.write_shl(target_mem, 64 - bits);
+            this->as.write_shr(target_mem, 64 - bits);
+          }
+
+        } else if (divisor > 0) {
+          // other positive constants: for negative x, floor(x / d) is
+          // ~(~x / d), and ~x is nonnegative. so we flip x with its sign mask,
+          // divide unsigned by multiplying by the magic number, then flip the
+          // quotient back with the same mask
+          uint64_t m;
+          uint8_t shift;
+          unsigned_division_magic(divisor, &m, &shift);
+
+          Register sign = this->available_register_except(
+              {rax, rdx, this->target_register});
+          MemoryReference sign_mem(sign);
+          this->as.write_mov(sign_mem, div_left_mem);
+          this->as.write_mov(rax_mem, sign_mem);
+          this->as.write_sar(sign_mem, 63);
+          this->as.write_xor(rax_mem, sign_mem);
+          this->as.write_mov(rdx, static_cast<int64_t>(m));
+          this->as.write_mul(rdx_mem);
+          this->as.write_shr(rdx_mem, shift);
+          this->as.write_xor(rdx_mem, sign_mem);
+
+          if (is_mod) {
+            // x - q * d is in [0, d) even if q * d wraps around
+            this->as.write_mov(rax, divisor);
+            this->as.write_imul(rax, rdx_mem);
+            this->as.write_mov(rdx_mem, div_left_mem);
+            this->as.write_sub(rdx_mem, rax_mem);
+          }
           if (this->target_register != rdx) {
-            this->as.write_mov(target_mem, rdx);
+            this->as.write_mov(target_mem, rdx_mem);
           }
+
         } else {
-          if (this->target_register != rax) {
-            this->as.write_mov(target_mem, rax);
+          string nonzero_label = string_printf("__BinaryOperation_%p_div_nonzero", a);
+          string floor_label = string_printf("__BinaryOperation_%p_div_floor", a);
+          this->as.write_cmp(div_right_mem, 0);
+          this->as.write_jne(nonzero_label);
+          this->write_raise_exception(ZeroDivisionError_class_id);
+          this->as.write_label(nonzero_label);
+          if (right_int_only) {
+            this->write_jump_if_promoted(check, div_right_mem, slow_label);
+          }
+
+          // x % -1 is always 0, and x // -1 is -x, which isn't direct if x is
+          // -2**62. any other quotient is direct
+          string not_negative_one_label = string_printf(
+              "__BinaryOperation_%p_div_not_negative_one", a);
+          this->as.write_cmp(div_right_mem, -1);
+          this->as.write_jne(not_negative_one_label);
+          if (is_mod) {
+            this->as.write_xor(rdx_mem, rdx_mem);
+          } else {
+            this->as.write_mov(rax_mem, div_left_mem);
+            this->as.write_neg(rax_mem);
+            this->write_jump_if_promoted(check, rax_mem, slow_label);
+          }
+          this->as.write_jmp(floor_label);
+          this->as.write_label(not_negative_one_label);
+
+          this->as.write_mov(rax_mem, div_left_mem);
+          this->as.write_mov(rdx_mem, rax_mem);
+          this->as.write_sar(rdx_mem, 63);
+          this->as.write_idiv(div_right_mem);
+
+          // idiv truncates toward zero; python floors. if the remainder is
+          // nonzero and its sign differs from the divisor's, move the quotient
+          // down by 1 and the remainder up by the divisor
+          MemoryReference tmp_mem(check);
+          this->as.write_test(rdx_mem, rdx_mem);
+          this->as.write_jz(floor_label);
+          this->as.write_mov(tmp_mem, rdx_mem);
+          this->as.write_xor(tmp_mem, div_right_mem);
+          this->as.write_jns(floor_label);
+          if (is_mod) {
+            this->as.write_add(rdx_mem, div_right_mem);
+          } else {
+            this->as.write_dec(rax_mem);
+          }
+          this->as.write_label(floor_label);
+
+          if (is_mod) {
+            if (this->target_register != rdx) {
+              this->as.write_mov(target_mem, rdx_mem);
+            }
+          } else {
+            if (this->target_register != rax) {
+              this->as.write_mov(target_mem, rax_mem);
+            }
           }
         }
+        this->as.write_label(resume_label);
 
         if (push_rdx) {
           this->write_pop(rdx);
@@ -977,12 +1472,14 @@ void CompilationVisitor::visit(BinaryOperation* a) {
         if (left_float) {
           this->as.write_movsd(left_xmm_mem, left_mem);
         } else {
-          this->as.write_cvtsi2sd(left_xmm, left_mem);
+          this->write_int_to_float(left_xmm, left_mem);
         }
         if (right_float) {
           this->as.write_movsd(right_xmm_mem, right_mem);
         } else {
-          this->as.write_cvtsi2sd(right_xmm, right_mem);
+          this->reserve_register(left_xmm, true);
+          this->write_int_to_float(right_xmm, right_mem);
+          this->release_register(left_xmm, true);
         }
 
         // TODO: check if right is zero and raise ZeroDivisionError if so
@@ -1008,8 +1505,64 @@ void CompilationVisitor::visit(BinaryOperation* a) {
       break;
     }
 
-    case BinaryOperator::Exponentiation:
-      if (left_int && right_int) {
+    case BinaryOperator::Exponentiation: {
+      // small constant exponents are expanded into multiplication chains at
+      // compile time. integral Float exponents count too (the result is a
+      // Float either way), and x ** 0.5 becomes a square root. chains for
+      // Float results round at each step and so could differ from pow() in
+      // the last few bits; they're only used when there's at most one
+      // rounding step (x ** 2 and x ** -1), where the result is exact
+      static const int64_t min_float_chain_exponent = -1;
+      static const int64_t max_float_chain_exponent = 2;
+      IntegerConstant* int_exponent = dynamic_cast<IntegerConstant*>(a->right.get());
+      FloatConstant* float_exponent = dynamic_cast<FloatConstant*>(a->right.get());
+      bool exponent_known = false;
+      int64_t exponent = 0;
+      if (int_exponent && (int_exponent->value >= -64) && (int_exponent->value <= 64)) {
+        exponent_known = true;
+        exponent = int_exponent->value;
+      } else if (float_exponent && (float_exponent->value >= -64.0) &&
+          (float_exponent->value <= 64.0) &&
+          (float_exponent->value == trunc(float_exponent->value))) {
+        exponent_known = true;
+        exponent = static_cast<int64_t>(float_exponent->value);
+      }
+      bool sqrt_exponent = float_exponent && (float_exponent->value == 0.5);
+
+      if (left_int && right_int && exponent_known && (exponent >= 0)) {
+        this->as.write_label(string_printf("__BinaryOperation_%p_pow_unrolled", a));
+        if (exponent == 0) {
+          this->as.write_mov(target_mem.base_register, 1);
+        } else {
+          // square for each bit after the highest one, and multiply by the
+          // base for each set bit. the intermediate values only have to fit
+          // in 64 bits; the result is checked at the end
+          int_operands_released = true;
+          string slow_label = this->int_slow_path_label(resume_label,
+              releasing_int_fn_ptr(int_power), {left_mem, right_mem, r14}, {},
+              this->target_register);
+          if (left_int_only) {
+            this->write_jump_if_promoted(temp_mem.base_register, left_mem,
+                slow_label);
+          }
+          this->as.write_mov(temp_mem, left_mem);
+          this->as.write_mov(target_mem, temp_mem);
+          for (int8_t bit = 62 - __builtin_clzll(exponent); bit >= 0; bit--) {
+            this->as.write_imul(target_mem.base_register, target_mem);
+            this->as.write_jo(slow_label);
+            if (exponent & (1LL << bit)) {
+              this->as.write_imul(target_mem.base_register, temp_mem);
+              this->as.write_jo(slow_label);
+            }
+          }
+          this->write_jump_if_promoted(temp_mem.base_register, target_mem,
+              slow_label);
+          this->as.write_label(resume_label);
+        }
+        this->current_type = Variable(ValueType::Int);
+        break;
+
+      } else if (left_int && right_int) {
         // if the exponent is negative, throw ValueError. unfortunately we can't
         // fix this in a consistent way since the return type of the expression
         // depends on the value, not on any part of the code that we can
@@ -1018,6 +1571,11 @@ void CompilationVisitor::visit(BinaryOperation* a) {
         // change the source to do `1/(a**b)` instead), so we'll make the user
         // do that instead
 
+        // promoted operands go to the slow path, which raises ValueError for
+        // promoted negative exponents too
+        string slow_label = write_int_operand_checks(
+            releasing_int_fn_ptr(int_power), true);
+
         string positive_label = string_printf("__BinaryOperation_%p_pow_not_neg", a);
         this->as.write_label(string_printf("__BinaryOperation_%p_pow_check_neg", a));
         this->as.write_cmp(right_mem, 0);
@@ -1026,50 +1584,120 @@ void CompilationVisitor::visit(BinaryOperation* a) {
         this->as.write_label(positive_label);
 
         // implementation mirrors notes/pow.s except that we load the base value
-        // into a temp register
+        // into a temp register, and we don't square the base after the last
+        // bit (it may overflow even if the result doesn't). the exponent is
+        // shifted in a register, since the slow path needs the original value.
+        // like the unrolled form, only the result has to be direct
         string again_label = string_printf("__BinaryOperation_%p_pow_again", a);
         string skip_base_label = string_printf("__BinaryOperation_%p_pow_skip_base", a);
+        string done_label = string_printf("__BinaryOperation_%p_pow_done", a);
+        MemoryReference exponent_mem(this->available_register_except(
+            {this->target_register, temp_mem.base_register}));
         this->as.write_mov(target_mem, 1);
         this->as.write_mov(temp_mem, left_mem);
+        this->as.write_mov(exponent_mem, right_mem);
         this->as.write_label(again_label);
-        this->as.write_test(right_mem, 1);
+        this->as.write_test(exponent_mem, 1);
         this->as.write_jz(skip_base_label);
         this->as.write_imul(target_mem.base_register, temp_mem);
+        this->as.write_jo(slow_label);
         this->as.write_label(skip_base_label);
+        this->as.write_shr(exponent_mem, 1);
+        this->as.write_jz(done_label);
         this->as.write_imul(temp_mem.base_register, temp_mem);
-        this->as.write_shr(right_mem, 1);
-        this->as.write_jnz(again_label);
+        this->as.write_jo(slow_label);
+        this->as.write_jmp(again_label);
+        this->as.write_label(done_label);
+        this->write_jump_if_promoted(temp_mem.base_register, target_mem,
+            slow_label);
+        this->as.write_label(resume_label);
+        this->current_type = Variable(ValueType::Int);
         break;
 
       } else if (left_float || right_float) {
-        Register left_xmm = this->available_register(Register::None, true);
-        Register right_xmm = this->available_register_except({left_xmm}, true);
-        MemoryReference left_xmm_mem(left_xmm);
-        MemoryReference right_xmm_mem(right_xmm);
+        Register result_xmm = this->float_target_register;
+        Register base_xmm = this->available_register_except({result_xmm}, true);
+        MemoryReference result_xmm_mem(result_xmm);
+        MemoryReference base_xmm_mem(base_xmm);
 
         if (!left_float) { // left is Int, right is Float
-          this->as.write_cvtsi2sd(left_xmm, left_mem);
+          this->write_int_to_float(base_xmm, left_mem);
         } else {
-          this->as.write_movsd(left_xmm_mem, left_mem);
+          this->as.write_movsd(base_xmm_mem, left_mem);
         }
+        this->current_type = Variable(ValueType::Float);
 
-        if (!right_float) { // left is Float, right is Int
-          this->as.write_cvtsi2sd(right_xmm, right_mem);
-          // watch it: in this case the type is different from right_type
-          this->current_type = Variable(ValueType::Float);
+        if (sqrt_exponent) {
+          // adding 0.0 turns sqrt(-0.0) == -0.0 into 0.0, as pow does
+          this->as.write_label(string_printf("__BinaryOperation_%p_pow_sqrt", a));
+          this->as.write_sqrtsd(result_xmm, base_xmm_mem);
+          this->write_load_double(base_xmm, 0.0);
+          this->as.write_addsd(result_xmm, base_xmm_mem);
+
+        } else if (exponent_known && (exponent >= min_float_chain_exponent) &&
+            (exponent <= max_float_chain_exponent)) {
+          this->as.write_label(string_printf("__BinaryOperation_%p_pow_unrolled", a));
+          uint64_t abs_exponent = (exponent < 0) ? -exponent : exponent;
+          if (abs_exponent == 0) {
+            this->write_load_double(result_xmm, 1.0);
+          } else {
+            this->as.write_movsd(result_xmm_mem, base_xmm_mem);
+            for (int8_t bit = 62 - __builtin_clzll(abs_exponent); bit >= 0; bit--) {
+              this->as.write_mulsd(result_xmm, result_xmm_mem);
+              if (abs_exponent & (1ULL << bit)) {
+                this->as.write_mulsd(result_xmm, base_xmm_mem);
+              }
+            }
+            if (exponent < 0) {
+              this->write_load_double(base_xmm, 1.0);
+              this->as.write_divsd(base_xmm, result_xmm_mem);
+              this->as.write_movsd(result_xmm_mem, base_xmm_mem);
+            }
+          }
 
         } else {
-          this->as.write_movsd(right_xmm_mem, right_mem);
-        }
+          string call_label = string_printf("__BinaryOperation_%p_pow_call", a);
+          string done_label = string_printf("__BinaryOperation_%p_pow_done", a);
+
+          if (!right_float) {
+            // Float ** Int: squares are common and exact as a single multiply;
+            // any other exponent calls pow() so the result matches python's
+            this->as.write_cmp(right_mem, 2);
+            this->as.write_jne(call_label);
+            this->as.write_movsd(result_xmm_mem, base_xmm_mem);
+            this->as.write_mulsd(result_xmm, base_xmm_mem);
+            this->as.write_jmp(done_label);
+          }
+
+          // write_function_call doesn't reorder float argument moves, so put
+          // the arguments in the lowest available registers
+          this->as.write_label(call_label);
+          Register pow_base_xmm = this->available_register(Register::None, true);
+          Register exponent_xmm = this->available_register_except({pow_base_xmm}, true);
+          MemoryReference pow_base_xmm_mem(pow_base_xmm);
+          MemoryReference exponent_xmm_mem(exponent_xmm);
+          if (pow_base_xmm != base_xmm) {
+            this->as.write_movsd(pow_base_xmm_mem, base_xmm_mem);
+          }
+          if (right_float) {
+            this->as.write_movsd(exponent_xmm_mem, right_mem);
+          } else {
+            this->reserve_register(pow_base_xmm, true);
+            this->write_int_to_float(exponent_xmm, right_mem);
+            this->release_register(pow_base_xmm, true);
+          }
 
-        static const void* pow_fn = void_fn_ptr(static_cast<double(*)(double, double)>(&pow));
-        this->write_function_call(common_object_reference(pow_fn), {},
-            {left_xmm_mem, right_xmm_mem}, -1, this->float_target_register, true);
+          static const void* pow_fn = void_fn_ptr(static_cast<double(*)(double, double)>(&pow));
+          this->write_function_call(common_object_reference(pow_fn), {},
+              {pow_base_xmm_mem, exponent_xmm_mem}, -1, this->float_target_register, true);
+          this->as.write_label(done_label);
+        }
         break;
       }
 
       // TODO
       throw compile_error("Exponentiation not implemented for " + left_type.str() + " and " + right_type.str(), this->file_offset);
+    }
 
     default:
       throw compile_error("unhandled binary operator", this->file_offset);
@@ -1077,19 +1705,36 @@ void CompilationVisitor::visit(BinaryOperation* a) {
 
   this->as.write_label(string_printf("__BinaryOperation_%p_cleanup", a));
 
-  // if either value requires destruction, do so now
+  // all the results are new values; Ints are owned if they're promoted
+  this->holding_reference = type_has_refcount(this->current_type.type);
+
+  // if either value requires destruction, do so now. Int operands don't if the
+  // slow path released them, or if they're direct constants
+  auto is_direct_constant = [](Expression* e) -> bool {
+    IntegerConstant* constant = dynamic_cast<IntegerConstant*>(e);
+    return constant && int_is_direct(constant->value);
+  };
+  if (left_int_only && (int_operands_released ||
+      is_direct_constant(a->left.get()))) {
+    left_holding_reference = false;
+  }
+  if (right_int_only && (int_operands_released ||
+      is_direct_constant(a->right.get()))) {
+    right_holding_reference = false;
+  }
   if (left_holding_reference || right_holding_reference) {
-    // save the return value before destroying the temp values
+    // save the return value before destroying the temp values. after this, the
+    // right value is at [rsp+8] and the left value is at [rsp+16]
     this->write_push(this->target_register);
 
     // destroy the temp values
-    if (type_has_refcount(left_type.type)) {
+    if (left_holding_reference) {
       this->as.write_label(string_printf("__BinaryOperation_%p_destroy_left", a));
-      this->write_delete_reference(MemoryReference(rsp, 8), left_type.type);
+      this->write_delete_reference(MemoryReference(rsp, 16), left_type.type);
     }
-    if (type_has_refcount(right_type.type)) {
+    if (right_holding_reference) {
       this->as.write_label(string_printf("__BinaryOperation_%p_destroy_right", a));
-      this->write_delete_reference(MemoryReference(rsp, 16), right_type.type);
+      this->write_delete_reference(MemoryReference(rsp, 8), right_type.type);
     }
 
     // load the result again and clean up the stack
@@ -1105,6 +1750,266 @@ void CompilationVisitor::visit(BinaryOperation* a) {
   this->as.write_label(string_printf("__BinaryOperation_%p_complete", a));
 }
 
+void CompilationVisitor::write_set_int_contains(BinaryOperation* a,
+    const MemoryReference& key_mem) {
+  // the set is in the target register; the result goes there too. this is the
+  // same probe sequence as table_contains<IntSlots> in Types/Set.cc, with
+  // set_int_hash inlined
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  vector<Register> temp_registers;
+  for (size_t x = 0; x < 4; x++) {
+    temp_registers.emplace_back(this->available_register_except({target_register}));
+    this->reserve_register(temp_registers.back());
+  }
+  MemoryReference index_mem(temp_registers[0]);
+  MemoryReference slots_mem(temp_registers[1]);
+  MemoryReference empty_mem(temp_registers[2]);
+  MemoryReference item_mem(temp_registers[3]);
+
+  string probe_label = string_printf("__BinaryOperation_%p_set_probe", a);
+  string found_label = string_printf("__BinaryOperation_%p_set_found", a);
+  string not_found_label = string_printf("__BinaryOperation_%p_set_not_found", a);
+  string empty_key_label = string_printf("__BinaryOperation_%p_set_empty_key", a);
+  string end_label = string_printf("__BinaryOperation_%p_set_probe_end", a);
+
+  // the empty slot value can't be stored in a slot, so there's a flag for it
+  this->as.write_mov(empty_mem.base_register, SET_EMPTY_INT_SLOT);
+  this->as.write_cmp(empty_mem, key_mem);
+  this->as.write_je(empty_key_label);
+
+  this->as.write_mov(index_mem.base_register,
+      static_cast<int64_t>(0x9E3779B97F4A7C15));
+  this->as.write_imul(index_mem.base_register, key_mem);
+  this->as.write_mov(slots_mem, index_mem);
+  this->as.write_shr(slots_mem, 32);
+  this->as.write_xor(index_mem, slots_mem);
+  this->as.write_mov(slots_mem, MemoryReference(target_register, 0x28));
+
+  // the table is never full, so this always terminates
+  this->as.write_label(probe_label);
+  this->as.write_and(index_mem, MemoryReference(target_register, 0x18));
+  this->as.write_mov(item_mem, MemoryReference(slots_mem.base_register, 0,
+      index_mem.base_register, 8));
+  this->as.write_cmp(item_mem, key_mem);
+  this->as.write_je(found_label);
+  this->as.write_cmp(item_mem, empty_mem);
+  this->as.write_je(not_found_label);
+  this->as.write_inc(index_mem);
+  this->as.write_jmp(probe_label);
+
+  this->as.write_label(empty_key_label);
+  this->as.write_movzx8(target_register, MemoryReference(target_register, 0x21));
+  this->as.write_jmp(end_label);
+  this->as.write_label(found_label);
+  this->as.write_mov(target_register, 1);
+  this->as.write_jmp(end_label);
+  this->as.write_label(not_found_label);
+  this->as.write_xor(target_mem, target_mem);
+  this->as.write_label(end_label);
+
+  for (Register r : temp_registers) {
+    this->release_register(r);
+  }
+}
+
+bool CompilationVisitor::is_float_expression(Expression* a) {
+  // this is conservative: it returns true only if a will definitely produce a
+  // Float (or fail to compile), without generating any code
+  if (dynamic_cast<FloatConstant*>(a)) {
+    return true;
+  }
+
+  VariableLookup* lookup = dynamic_cast<VariableLookup*>(a);
+  if (lookup) {
+    return this->location_for_variable(lookup->name).type.type == ValueType::Float;
+  }
+
+  UnaryOperation* unary = dynamic_cast<UnaryOperation*>(a);
+  if (unary) {
+    return ((unary->oper == UnaryOperator::Negative) ||
+            (unary->oper == UnaryOperator::Positive)) &&
+        this->is_float_expression(unary->expr.get());
+  }
+
+  BinaryOperation* binary = dynamic_cast<BinaryOperation*>(a);
+  if (binary) {
+    // true division always returns a Float
+    if (binary->oper == BinaryOperator::Division) {
+      return true;
+    }
+    return is_float_arithmetic_operator(binary->oper) &&
+        (this->is_float_expression(binary->left.get()) ||
+         this->is_float_expression(binary->right.get()));
+  }
+
+  return false;
+}
+
+Register CompilationVisitor::available_float_temp_register(Register prevented) {
+  // xmm8-15 aren't used for function arguments, so temporaries there don't
+  // get in the way of calls made while evaluating the other operand
+  for (Register which = Register::XMM8; which <= Register::XMM15;
+       which = static_cast<Register>(static_cast<int64_t>(which) + 1)) {
+    if ((which != this->float_target_register) && (which != prevented) &&
+        this->register_is_available(which, true)) {
+      return which;
+    }
+  }
+  return Register::None;
+}
+
+void CompilationVisitor::write_float_operand(Expression* a, Register xmm) {
+  Register original_float_target_register = this->float_target_register;
+  this->float_target_register = xmm;
+  a->accept(this);
+  this->float_target_register = original_float_target_register;
+
+  // the Int isn't needed after it's converted, so it's released
+  if (this->current_type.type == ValueType::Int) {
+    this->write_int_to_float(xmm, MemoryReference(this->target_register), true);
+    this->holding_reference = false;
+  } else if (this->current_type.type == ValueType::Bool) {
+    this->as.write_cvtsi2sd(xmm, MemoryReference(this->target_register));
+  } else if (this->current_type.type != ValueType::Float) {
+    throw compile_error("cannot use " + this->current_type.str() +
+        " in floating-point arithmetic", this->file_offset);
+  }
+}
+
+void CompilationVisitor::write_float_arithmetic(BinaryOperation* a) {
+  // the result goes in the float target register. the left operand is kept in
+  // a temporary xmm register (or on the stack, if they're all in use) while the
+  // right operand is evaluated. like the target registers, temporaries are only
+  // reserved after their values are computed
+  Register result_xmm = this->float_target_register;
+  MemoryReference result_mem(result_xmm);
+
+  this->as.write_label(string_printf("__BinaryOperation_%p_float", a));
+
+  // (x * y) + z, (x * y) - z, z + (x * y) and z - (x * y) can be done with a
+  // single fused multiply-add. the operands are still evaluated in order
+  if (use_fused_multiply_add() &&
+      ((a->oper == BinaryOperator::Addition) ||
+       (a->oper == BinaryOperator::Subtraction))) {
+    BinaryOperation* left_product = dynamic_cast<BinaryOperation*>(a->left.get());
+    if (left_product && ((left_product->oper != BinaryOperator::Multiplication) ||
+        !this->is_float_expression(left_product))) {
+      left_product = NULL;
+    }
+    BinaryOperation* right_product = dynamic_cast<BinaryOperation*>(a->right.get());
+    if (right_product && ((right_product->oper != BinaryOperator::Multiplication) ||
+        !this->is_float_expression(right_product))) {
+      right_product = NULL;
+    }
+
+    Register temp1_xmm = Register::None, temp2_xmm = Register::None;
+    if (left_product || right_product) {
+      temp1_xmm = this->available_float_temp_register();
+      temp2_xmm = this->available_float_temp_register(temp1_xmm);
+    }
+
+    if ((temp1_xmm != Register::None) && (temp2_xmm != Register::None)) {
+      MemoryReference temp2_mem(temp2_xmm);
+      if (left_product) {
+        this->write_float_operand(left_product->left.get(), temp1_xmm);
+        this->reserve_register(temp1_xmm, true);
+        this->write_float_operand(left_product->right.get(), temp2_xmm);
+        this->reserve_register(temp2_xmm, true);
+        this->write_float_operand(a->right.get(), result_xmm);
+        if (a->oper == BinaryOperator::Addition) {
+          this->as.write_vfmadd231sd(result_xmm, temp1_xmm, temp2_mem);
+        } else {
+          this->as.write_vfmsub231sd(result_xmm, temp1_xmm, temp2_mem);
+        }
+      } else {
+        this->write_float_operand(a->left.get(), temp1_xmm);
+        this->reserve_register(temp1_xmm, true);
+        this->write_float_operand(right_product->left.get(), temp2_xmm);
+        this->reserve_register(temp2_xmm, true);
+        this->write_float_operand(right_product->right.get(), result_xmm);
+        if (a->oper == BinaryOperator::Addition) {
+          this->as.write_vfmadd231sd(temp1_xmm, temp2_xmm, result_mem);
+        } else {
+          this->as.write_vfnmadd231sd(temp1_xmm, temp2_xmm, result_mem);
+        }
+        this->as.write_movsd(result_mem, MemoryReference(temp1_xmm));
+      }
+
+      this->release_register(temp1_xmm, true);
+      this->release_register(temp2_xmm, true);
+      this->current_type = Variable(ValueType::Float);
+      this->holding_reference = false;
+      return;
+    }
+  }
+
+  // if the right operand is a Float variable, use it directly from memory
+  VariableLookup* right_lookup = dynamic_cast<VariableLookup*>(a->right.get());
+  if (right_lookup) {
+    VariableLocation loc = this->location_for_variable(right_lookup->name);
+    if ((loc.type.type == ValueType::Float) && loc.mem.field_size) {
+      this->write_float_operand(a->left.get(), result_xmm);
+      this->file_offset = a->file_offset;
+      if (a->oper == BinaryOperator::Addition) {
+        this->as.write_addsd(result_xmm, loc.mem);
+      } else if (a->oper == BinaryOperator::Subtraction) {
+        this->as.write_subsd(result_xmm, loc.mem);
+      } else if (a->oper == BinaryOperator::Multiplication) {
+        this->as.write_mulsd(result_xmm, loc.mem);
+      } else {
+        this->as.write_divsd(result_xmm, loc.mem);
+      }
+      this->current_type = Variable(ValueType::Float);
+      this->holding_reference = false;
+      return;
+    }
+  }
+
+  Register left_xmm = this->available_float_temp_register();
+  MemoryReference left_mem(left_xmm);
+  if (left_xmm != Register::None) {
+    this->write_float_operand(a->left.get(), left_xmm);
+    this->reserve_register(left_xmm, true);
+  } else {
+    this->write_float_operand(a->left.get(), result_xmm);
+    this->adjust_stack(-8);
+    this->as.write_movsd(MemoryReference(rsp, 0), result_mem);
+    left_mem = MemoryReference(rsp, 0);
+  }
+  this->write_float_operand(a->right.get(), result_xmm);
+  this->file_offset = a->file_offset;
+
+  // addition and multiplication commute, so the result can stay where it is.
+  // for the others, the left operand has to be in a register
+  if (a->oper == BinaryOperator::Addition) {
+    this->as.write_addsd(result_xmm, left_mem);
+  } else if (a->oper == BinaryOperator::Multiplication) {
+    this->as.write_mulsd(result_xmm, left_mem);
+  } else {
+    Register temp_xmm = (left_xmm != Register::None) ? left_xmm :
+        this->available_register_except({result_xmm}, true);
+    MemoryReference temp_mem(temp_xmm);
+    if (left_xmm == Register::None) {
+      this->as.write_movsd(temp_mem, left_mem);
+    }
+    if (a->oper == BinaryOperator::Subtraction) {
+      this->as.write_subsd(temp_xmm, result_mem);
+    } else {
+      this->as.write_divsd(temp_xmm, result_mem);
+    }
+    this->as.write_movsd(result_mem, temp_mem);
+  }
+
+  if (left_xmm != Register::None) {
+    this->release_register(left_xmm, true);
+  } else {
+    this->adjust_stack(8);
+  }
+  this->current_type = Variable(ValueType::Float);
+  this->holding_reference = false;
+}
+
 void CompilationVisitor::visit(TernaryOperation* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
@@ -1137,14 +2042,22 @@ void CompilationVisitor::visit(TernaryOperation* a) {
   this->write_current_truth_value_test();
   this->as.write_jz(false_label); // skip left
 
+  // both branches release the condition value, so save its state for the
+  // second one
+  Variable condition_type = this->current_type;
+  bool condition_held = this->holding_reference;
+
   // generate code for the left (True) value
   this->write_delete_held_reference(MemoryReference(this->target_register));
   a->left->accept(this);
   this->as.write_jmp(end_label);
   Variable left_type = move(this->current_type);
+  bool left_held = this->holding_reference;
 
   // generate code for the right (False) value
   this->as.write_label(false_label);
+  this->current_type = move(condition_type);
+  this->holding_reference = condition_held;
   this->write_delete_held_reference(MemoryReference(this->target_register));
   a->right->accept(this);
   this->as.write_label(end_label);
@@ -1153,6 +2066,10 @@ void CompilationVisitor::visit(TernaryOperation* a) {
   if (left_type != this->current_type) {
     throw compile_error("sides have different types", this->file_offset);
   }
+  if (left_held != this->holding_reference) {
+    throw compile_error("sides have different reference ownership",
+        this->file_offset);
+  }
 }
 
 void CompilationVisitor::visit(ListConstructor* a) {
@@ -1209,8 +2126,12 @@ void CompilationVisitor::visit(ListConstructor* a) {
   this->as.write_label(string_printf("__ListConstructor_%p_finalize", a));
   this->write_pop(this->target_register);
 
-  // if the extension type is an object of some sort, set the destructor flag
-  if (type_has_refcount(extension_type.type)) {
+  // if the extension type is an object of some sort, set the destructor flag.
+  // Int lists own references to their promoted items instead
+  if (extension_type.type == ValueType::Int) {
+    this->as.write_mov(MemoryReference(this->target_register, 0x21), 1,
+        OperandSize::Byte);
+  } else if (type_has_refcount(extension_type.type)) {
     this->as.write_mov(MemoryReference(this->target_register, 0x20), 1);
   }
 
@@ -1228,32 +2149,171 @@ void CompilationVisitor::visit(SetConstructor* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO: generate malloc call, item constructor and insert code
-  throw compile_error("SetConstructor not yet implemented", this->file_offset);
-}
+  this->as.write_label(string_printf("__SetConstructor_%p_setup", a));
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  int64_t previously_reserved_registers = this->write_push_reserved_registers();
 
-void CompilationVisitor::visit(DictConstructor* a) {
-  this->file_offset = a->file_offset;
-  this->assert_not_evaluating_instance_pointer();
+  // we don't know the set's layout until we've generated code for the first
+  // item, so it's allocated after that. the stack looks like this:
+  // [rsp+0x00] the current item
+  // [rsp+0x08] the set object
+  this->write_push(0);
 
-  // TODO: generate malloc call, item constructor and insert code
-  throw compile_error("DictConstructor not yet implemented", this->file_offset);
-}
+  Variable extension_type;
+  size_t item_index = 0;
+  for (const auto& item : a->items) {
+    this->as.write_label(string_printf("__SetConstructor_%p_item_%zu", a, item_index));
+    this->target_register = target_register;
+    item->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error("set item is not a held reference", this->file_offset);
+    }
+    this->write_push(target_register);
 
-void CompilationVisitor::visit(TupleConstructor* a) {
-  // TODO: deduplicate this with ListConstructor
+    if (extension_type.type == ValueType::Indeterminate) {
+      extension_type = this->current_type.type_only();
+      SetKeyType key_type = set_key_type_for_item_type(extension_type,
+          this->file_offset);
 
-  this->file_offset = a->file_offset;
-  this->assert_not_evaluating_instance_pointer();
+      this->as.write_label(string_printf("__SetConstructor_%p_allocate", a));
+      this->as.write_mov(rdi, static_cast<int64_t>(key_type));
+      this->as.write_mov(rsi, a->items.size());
+      this->write_function_call(common_object_reference(void_fn_ptr(&set_new)),
+          {rdi, rsi, r14}, {}, -1, target_register);
+      this->as.write_mov(MemoryReference(rsp, 8), target_mem);
 
-  this->as.write_label(string_printf("__TupleConstructor_%p_setup", a));
+    } else if (!extension_type.types_equal(this->current_type)) {
+      throw compile_error("set contains different object types: " +
+          extension_type.str() + " and " + this->current_type.type_only().str(),
+          this->file_offset);
+    }
 
-  // we'll use rbx to store the tuple ptr while constructing items and I'm lazy
-  if (this->target_register == rbx) {
-    throw compile_error("cannot use rbx as target register for tuple construction");
+    // set_add adds its own reference to the item, so release ours afterward
+    this->write_function_call(common_object_reference(void_fn_ptr(&set_add)),
+        {MemoryReference(rsp, 8), MemoryReference(rsp, 0), r14}, {});
+    if (type_has_refcount(extension_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 0), extension_type.type);
+    }
+    this->adjust_stack(8);
+    item_index++;
   }
-  this->write_push(rbx);
-  int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+  this->as.write_label(string_printf("__SetConstructor_%p_finalize", a));
+  this->write_pop(target_register);
+  this->write_pop_reserved_registers(previously_reserved_registers);
+  this->target_register = target_register;
+
+  // the result type is a new reference to a Set[extension_type]
+  this->current_type = Variable(ValueType::Set,
+      vector<Variable>({extension_type}));
+  this->holding_reference = true;
+}
+
+void CompilationVisitor::visit(DictConstructor* a) {
+  this->file_offset = a->file_offset;
+  this->assert_not_evaluating_instance_pointer();
+
+  // we need to know the key and value types to allocate the dict
+  if (a->items.empty()) {
+    throw compile_error("empty dict displays are not supported", this->file_offset);
+  }
+
+  this->as.write_label(string_printf("__DictConstructor_%p_setup", a));
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+  // like for sets, the dict is allocated after the first item is generated.
+  // the stack looks like this:
+  // [rsp+0x00] the current value
+  // [rsp+0x08] the current key
+  // [rsp+0x10] the dict object
+  this->write_push(0);
+
+  Variable key_type;
+  Variable value_type;
+  size_t item_index = 0;
+  for (const auto& item : a->items) {
+    this->as.write_label(string_printf("__DictConstructor_%p_item_%zu", a, item_index));
+    this->target_register = target_register;
+    item.first->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error("dict key is not a held reference", this->file_offset);
+    }
+    this->write_push(target_register);
+    Variable item_key_type = this->current_type.type_only();
+
+    this->target_register = target_register;
+    item.second->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error("dict value is not a held reference", this->file_offset);
+    }
+    this->write_push(target_register);
+    Variable item_value_type = this->current_type.type_only();
+
+    if (key_type.type == ValueType::Indeterminate) {
+      key_type = move(item_key_type);
+      value_type = move(item_value_type);
+      DictionaryLayout layout = dictionary_layout_for_types(key_type,
+          value_type, this->file_offset);
+
+      this->as.write_label(string_printf("__DictConstructor_%p_allocate", a));
+      this->as.write_mov(rdi, reinterpret_cast<int64_t>(layout.key_length));
+      this->as.write_mov(rsi, reinterpret_cast<int64_t>(layout.key_char));
+      this->as.write_mov(rdx, layout.flags);
+      this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_new)),
+          {rdi, rsi, rdx, r14}, {}, -1, target_register);
+      this->as.write_mov(MemoryReference(rsp, 0x10), target_mem);
+
+    } else if (!key_type.types_equal(item_key_type) ||
+               !value_type.types_equal(item_value_type)) {
+      throw compile_error("dict contains different item types: " +
+          key_type.str() + ": " + value_type.str() + " and " +
+          item_key_type.str() + ": " + item_value_type.str(),
+          this->file_offset);
+    }
+
+    // dictionary_insert adds its own references to the key and value, so
+    // release ours afterward
+    this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_insert)),
+        {MemoryReference(rsp, 0x10), MemoryReference(rsp, 8),
+          MemoryReference(rsp, 0), r14}, {});
+    if (type_has_refcount(key_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 8), key_type.type);
+    }
+    if (type_has_refcount(value_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 0), value_type.type);
+    }
+    this->adjust_stack(0x10);
+    item_index++;
+  }
+
+  this->as.write_label(string_printf("__DictConstructor_%p_finalize", a));
+  this->write_pop(target_register);
+  this->write_pop_reserved_registers(previously_reserved_registers);
+  this->target_register = target_register;
+
+  // the result type is a new reference to a Dict[key_type, value_type]
+  this->current_type = Variable(ValueType::Dict,
+      vector<Variable>({key_type, value_type}));
+  this->holding_reference = true;
+}
+
+void CompilationVisitor::visit(TupleConstructor* a) {
+  // TODO: deduplicate this with ListConstructor
+
+  this->file_offset = a->file_offset;
+  this->assert_not_evaluating_instance_pointer();
+
+  this->as.write_label(string_printf("__TupleConstructor_%p_setup", a));
+
+  // we'll use rbx to store the tuple ptr while constructing items and I'm lazy
+  if (this->target_register == rbx) {
+    throw compile_error("cannot use rbx as target register for tuple construction");
+  }
+  this->write_push(rbx);
+  int64_t previously_reserved_registers = this->write_push_reserved_registers();
 
   // allocate the tuple object
   this->as.write_label(string_printf("__TupleConstructor_%p_allocate", a));
@@ -1288,7 +2348,8 @@ void CompilationVisitor::visit(TupleConstructor* a) {
   while (types_handled < extension_types.size()) {
     uint8_t value = 0;
     for (size_t x = 0; (x < 8) && ((types_handled + x) < extension_types.size()); x++) {
-      if (type_has_refcount(extension_types[types_handled + x].type)) {
+      ValueType type = extension_types[types_handled + x].type;
+      if (type_has_refcount(type) && (type != ValueType::Int)) {
         value |= (0x80 >> x);
       }
     }
@@ -1297,6 +2358,22 @@ void CompilationVisitor::visit(TupleConstructor* a) {
     types_handled += 8;
   }
 
+  // Int items only have refcounts if they're promoted, so their bits are set
+  // at runtime
+  Register int_temp = this->available_register_except({rbx});
+  for (size_t x = 0; x < extension_types.size(); x++) {
+    if (extension_types[x].type != ValueType::Int) {
+      continue;
+    }
+    string skip_label = string_printf("__TupleConstructor_%p_item_%zu_direct",
+        a, x);
+    this->write_get_promoted_int_object(int_temp, MemoryReference(rbx, x * 8),
+        skip_label);
+    this->as.write_or(MemoryReference(rbx, extension_types.size() * 8 + (x / 8)),
+        0x80 >> (x & 7), OperandSize::Byte);
+    this->as.write_label(skip_label);
+  }
+
   // get the tuple pointer back
   this->as.write_label(string_printf("__TupleConstructor_%p_finalize", a));
   this->write_pop(this->target_register);
@@ -1314,24 +2391,371 @@ void CompilationVisitor::visit(ListComprehension* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("ListComprehension not yet implemented", this->file_offset);
+  this->write_comprehension(a, a->item_pattern.get(), NULL, a->variable.get(),
+      a->source_data.get(), a->predicate.get());
 }
 
 void CompilationVisitor::visit(SetComprehension* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("SetComprehension not yet implemented", this->file_offset);
+  this->write_comprehension(a, a->item_pattern.get(), NULL, a->variable.get(),
+      a->source_data.get(), a->predicate.get());
 }
 
 void CompilationVisitor::visit(DictComprehension* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("DictComprehension not yet implemented", this->file_offset);
+  this->write_comprehension(a, a->key_pattern.get(), a->value_pattern.get(),
+      a->variable.get(), a->source_data.get(), a->predicate.get());
+}
+
+void CompilationVisitor::write_push_range(FunctionCall* range_call) {
+  // push start, stop and step, in that order
+  Register target_register = this->target_register;
+  for (size_t x = 0; x < 3; x++) {
+    Expression* arg = NULL;
+    if (range_call->args.size() == 1) {
+      arg = (x == 1) ? range_call->args[0].get() : NULL;
+    } else if (x < range_call->args.size()) {
+      arg = range_call->args[x].get();
+    }
+    if (arg) {
+      this->target_register = target_register;
+      arg->accept(this);
+      if (this->current_type.type != ValueType::Int) {
+        throw compile_error("range arguments must be Int; here one is " +
+            this->current_type.str(), this->file_offset);
+      }
+      // the loop's values are all direct (see Types/Int.hh) if the arguments
+      // are; promoted arguments raise OverflowError
+      this->write_jump_if_promoted(
+          this->available_register_except({target_register}),
+          MemoryReference(target_register), this->overflow_stub_label());
+      this->write_push(target_register);
+    } else {
+      this->write_push((x == 2) ? 1 : 0);
+    }
+  }
+
+  // move step to where stop was, then compute the item count and put it
+  // where step was. afterward, the stack looks like this:
+  // [rsp+0x00] item count
+  // [rsp+0x08] step
+  // [rsp+0x10] start
+  this->as.write_mov(rdi, MemoryReference(rsp, 16));
+  this->as.write_mov(rsi, MemoryReference(rsp, 8));
+  this->as.write_mov(rdx, MemoryReference(rsp, 0));
+  this->as.write_mov(MemoryReference(rsp, 8), rdx);
+  this->write_function_call(common_object_reference(void_fn_ptr(&range_length)),
+      {rdi, rsi, rdx, r14}, {}, -1, target_register);
+  this->as.write_mov(MemoryReference(rsp, 0), MemoryReference(target_register));
+  this->target_register = target_register;
+}
+
+void CompilationVisitor::write_comprehension(Expression* a,
+    Expression* item_pattern, Expression* value_pattern, Expression* variable,
+    Expression* source_data, Expression* predicate) {
+  // comprehensions are compiled inline, like a for loop whose body appends to
+  // the result. if value_pattern is given, this is a dict comprehension and
+  // item_pattern is the key pattern
+  bool is_dict = (value_pattern != NULL);
+  bool is_set = (dynamic_cast<SetComprehension*>(a) != NULL);
+  string label_prefix = string_printf(is_dict ? "__DictComprehension_%p" :
+      (is_set ? "__SetComprehension_%p" : "__ListComprehension_%p"), a);
+
+  // we'll use rbx for the item index, as in ForStatement
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  if (target_register == rbx) {
+    throw compile_error("cannot use rbx as target register for comprehensions");
+  }
+  int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+  // get the source. ranges aren't materialized; we just save start, step and
+  // the item count on the stack. lists and tuples are saved on the stack along
+  // with their item count (see the stack layout below)
+  this->as.write_label(label_prefix + "_get_source");
+  FunctionCall* range_call = dynamic_cast<FunctionCall*>(source_data);
+  bool is_range = is_simple_range_call(range_call);
+
+  Variable source_type;
+  Variable item_type;
+  if (is_range) {
+    this->target_register = target_register;
+    this->write_push_range(range_call);
+
+    item_type = Variable(ValueType::Int);
+
+  } else {
+    this->target_register = target_register;
+    source_data->accept(this);
+    source_type = move(this->current_type);
+    if ((source_type.type != ValueType::List) &&
+        (source_type.type != ValueType::Tuple)) {
+      throw compile_error("comprehension not implemented for " +
+          source_type.str(), this->file_offset);
+    }
+    if (source_type.extension_types.empty()) {
+      throw compile_error("comprehension source has unknown item type",
+          this->file_offset);
+    }
+    for (const Variable& extension_type : source_type.extension_types) {
+      if (source_type.extension_types[0] != extension_type) {
+        string uniform_str = source_type.extension_types[0].str();
+        string other_str = extension_type.str();
+        throw compile_error(string_printf(
+            "can\'t iterate over Tuple with disparate types (contains %s and %s)",
+            uniform_str.c_str(), other_str.c_str()), this->file_offset);
+      }
+    }
+    item_type = source_type.extension_types[0];
+
+    this->write_push(target_register);
+    this->as.write_mov(target_mem, MemoryReference(target_register, 0x10));
+    this->write_push(target_register);
+  }
+
+  // from here on, the stack looks like this:
+  // [rsp+0x00] result object (NULL for dicts until the first insert)
+  // [rsp+0x08] saved rbx
+  // [rsp+0x10] item count
+  // [rsp+0x18] source object, or range step
+  // [rsp+0x20] range start (only for ranges)
+  static const int64_t result_offset = 0x00;
+  static const int64_t count_offset = 0x10;
+  static const int64_t source_offset = 0x18;
+  static const int64_t step_offset = 0x18;
+  static const int64_t start_offset = 0x20;
+  this->write_push(rbx);
+
+  // if there's no filter, the result will have exactly as many items as the
+  // source, so we can allocate all of them now and store them directly.
+  // otherwise, start empty and append. dicts and sets are allocated at the
+  // first insert because we don't know the key type until we've compiled the
+  // key pattern
+  this->as.write_label(label_prefix + "_allocate");
+  bool preallocate = !is_dict && !is_set && !predicate;
+  if (is_dict || is_set) {
+    this->write_push(0);
+  } else {
+    if (preallocate) {
+      this->as.write_mov(rdi, MemoryReference(rsp, count_offset - 8));
+    } else {
+      this->as.write_xor(rdi, rdi);
+    }
+    // we'll set items_are_objects at the end, after we know the item type
+    this->as.write_xor(rsi, rsi);
+    this->write_function_call(common_object_reference(void_fn_ptr(&list_new)),
+        {rdi, rsi, r14}, {}, -1, target_register);
+    this->write_push(target_register);
+  }
+  this->as.write_xor(rbx, rbx);
+
+  string next_label = label_prefix + "_next";
+  string end_label = label_prefix + "_complete";
+  this->as.write_label(next_label);
+  this->as.write_cmp(rbx, MemoryReference(rsp, count_offset));
+  this->as.write_jge(end_label);
+
+  // get the next item. lists can be modified by the patterns, so check the
+  // list's count too
+  if (is_range) {
+    this->as.write_mov(target_mem, rbx);
+    this->as.write_imul(target_register, MemoryReference(rsp, step_offset));
+    this->as.write_add(target_mem, MemoryReference(rsp, start_offset));
+  } else {
+    this->as.write_mov(target_mem, MemoryReference(rsp, source_offset));
+    int64_t items_offset = 0x18;
+    if (source_type.type == ValueType::List) {
+      this->as.write_cmp(rbx, MemoryReference(target_register, 0x10));
+      this->as.write_jge(end_label);
+      this->as.write_mov(target_mem, MemoryReference(target_register, 0x28));
+      items_offset = 0;
+    }
+    if (item_type.type == ValueType::Float) {
+      this->as.write_movq_to_xmm(this->float_target_register,
+          MemoryReference(target_register, items_offset, rbx, 8));
+    } else {
+      this->as.write_mov(target_mem,
+          MemoryReference(target_register, items_offset, rbx, 8));
+    }
+  }
+  this->as.write_inc(rbx);
+  if (type_has_refcount(item_type.type)) {
+    this->write_add_reference(target_register, item_type.type);
+  }
+
+  // assign the loop variable
+  this->as.write_label(label_prefix + "_write_value");
+  this->target_register = target_register;
+  this->current_type = item_type;
+  this->holding_reference = type_has_refcount(item_type.type);
+  variable->accept(this);
+
+  // if there's a filter, skip the item if it's falsey
+  if (predicate) {
+    string keep_label = label_prefix + "_keep";
+    this->as.write_label(label_prefix + "_predicate");
+    this->target_register = target_register;
+    predicate->accept(this);
+    this->write_current_truth_value_test();
+    this->as.write_jnz(keep_label);
+    bool predicate_held = this->holding_reference;
+    this->write_delete_held_reference(target_mem);
+    this->as.write_jmp(next_label);
+    this->as.write_label(keep_label);
+    this->holding_reference = predicate_held;
+    this->write_delete_held_reference(target_mem);
+  }
+
+  // compute the item (or key), and move it to an int register if needed
+  auto compute_item = [&](Expression* pattern, const char* name) -> Variable {
+    this->as.write_label(label_prefix + "_" + name);
+    this->target_register = target_register;
+    pattern->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error("comprehension item is not a held reference",
+          this->file_offset);
+    }
+    if (this->current_type.type == ValueType::Float) {
+      this->as.write_movq_from_xmm(target_mem, this->float_target_register);
+    }
+    return this->current_type.type_only();
+  };
+
+  Variable result_type;
+  if (is_set) {
+    Variable item_type = compute_item(item_pattern, "item");
+    this->write_push(target_register);
+    SetKeyType key_type = set_key_type_for_item_type(item_type,
+        this->file_offset);
+
+    // allocate the set if needed. as for dicts, the same code is used after
+    // the loop in case the source was empty. the source's item count isn't
+    // used as a size hint, since sets are often built to remove duplicates
+    auto write_allocate_set = [&](int64_t offset, const string& skip_label) {
+      this->as.write_cmp(MemoryReference(rsp, offset), 0);
+      this->as.write_jne(skip_label);
+      this->as.write_mov(rdi, static_cast<int64_t>(key_type));
+      this->as.write_xor(rsi, rsi);
+      this->write_function_call(common_object_reference(void_fn_ptr(&set_new)),
+          {rdi, rsi, r14}, {}, -1, target_register);
+      this->as.write_mov(MemoryReference(rsp, offset), target_mem);
+      this->as.write_label(skip_label);
+    };
+    write_allocate_set(result_offset + 0x08, label_prefix + "_insert");
+
+    // set_add adds its own reference to the item, so release ours afterward
+    this->as.write_mov(rdi, MemoryReference(rsp, result_offset + 0x08));
+    this->as.write_mov(rsi, MemoryReference(rsp, 0));
+    this->write_function_call(common_object_reference(void_fn_ptr(&set_add)),
+        {rdi, rsi, r14}, {});
+    if (type_has_refcount(item_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 0), item_type.type);
+    }
+    this->adjust_stack(0x08);
+    this->as.write_jmp(next_label);
+    this->as.write_label(end_label);
+
+    write_allocate_set(result_offset, label_prefix + "_allocated");
+    result_type = Variable(ValueType::Set, vector<Variable>({item_type}));
+
+  } else if (!is_dict) {
+    Variable result_item_type = compute_item(item_pattern, "item");
+
+    // the list doesn't add references to the items yet, so it takes ownership
+    // of the reference we're holding
+    this->as.write_label(label_prefix + "_store");
+    if (preallocate) {
+      Register items_register = (target_register == rax) ? rcx : rax;
+      MemoryReference items_mem(items_register);
+      this->as.write_mov(items_mem, MemoryReference(rsp, result_offset));
+      this->as.write_mov(items_mem, MemoryReference(items_register, 0x28));
+      this->as.write_mov(MemoryReference(items_register, -8, rbx, 8), target_mem);
+    } else {
+      this->as.write_mov(rsi, target_mem);
+      this->as.write_mov(rdi, MemoryReference(rsp, result_offset));
+      this->write_function_call(common_object_reference(void_fn_ptr(&list_append)),
+          {rdi, rsi, r14}, {});
+    }
+    this->as.write_jmp(next_label);
+    this->as.write_label(end_label);
+
+    // now we know the item type; if it's an object (or an Int, which may be
+    // promoted), the list should own references to its items
+    if (type_has_refcount(result_item_type.type)) {
+      this->as.write_mov(target_mem, MemoryReference(rsp, result_offset));
+      this->as.write_mov(MemoryReference(target_register,
+          (result_item_type.type == ValueType::Int) ? 0x21 : 0x20), 1,
+          OperandSize::Byte);
+    }
+    result_type = Variable(ValueType::List, vector<Variable>({result_item_type}));
+
+  } else {
+    Variable key_type = compute_item(item_pattern, "key");
+    this->write_push(target_register);
+    Variable value_type = compute_item(value_pattern, "value");
+    this->write_push(target_register);
+    DictionaryLayout layout = dictionary_layout_for_types(key_type, value_type,
+        this->file_offset);
+
+    // allocate the dict if needed. the same code is used after the loop in
+    // case the source was empty
+    auto write_allocate_dict = [&](int64_t offset, const string& skip_label) {
+      this->as.write_cmp(MemoryReference(rsp, offset), 0);
+      this->as.write_jne(skip_label);
+      this->as.write_mov(rdi, reinterpret_cast<int64_t>(layout.key_length));
+      this->as.write_mov(rsi, reinterpret_cast<int64_t>(layout.key_char));
+      this->as.write_mov(rdx, layout.flags);
+      this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_new)),
+          {rdi, rsi, rdx, r14}, {}, -1, target_register);
+      this->as.write_mov(MemoryReference(rsp, offset), target_mem);
+      this->as.write_label(skip_label);
+    };
+    write_allocate_dict(result_offset + 0x10, label_prefix + "_insert");
+
+    // insert the item. dictionary_insert adds references to the key and value,
+    // so release ours afterward
+    this->as.write_mov(rdi, MemoryReference(rsp, result_offset + 0x10));
+    this->as.write_mov(rsi, MemoryReference(rsp, 8));
+    this->as.write_mov(rdx, MemoryReference(rsp, 0));
+    this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_insert)),
+        {rdi, rsi, rdx, r14}, {});
+    if (type_has_refcount(key_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 8), key_type.type);
+    }
+    if (type_has_refcount(value_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 0), value_type.type);
+    }
+    this->adjust_stack(0x10);
+    this->as.write_jmp(next_label);
+    this->as.write_label(end_label);
+
+    write_allocate_dict(result_offset, label_prefix + "_allocated");
+    result_type = Variable(ValueType::Dict, vector<Variable>({key_type, value_type}));
+  }
+
+  // get the result, restore rbx, and release the source
+  this->as.write_label(label_prefix + "_finalize");
+  this->write_pop(target_register);
+  this->write_pop(rbx);
+  if (is_range) {
+    this->adjust_stack(0x18);
+  } else {
+    this->write_push(target_register);
+    this->write_delete_reference(MemoryReference(rsp, 0x10), source_type.type);
+    this->write_pop(target_register);
+    this->adjust_stack(0x10);
+  }
+
+  this->write_pop_reserved_registers(previously_reserved_registers);
+  this->target_register = target_register;
+
+  // the result is a new reference
+  this->current_type = move(result_type);
+  this->holding_reference = true;
 }
 
 void CompilationVisitor::visit(LambdaDefinition* a) {
@@ -1398,9 +2822,34 @@ void CompilationVisitor::visit(FunctionCall* a) {
         this->file_offset);
   }
 
+  // print() is compiled inline so it can take any number of arguments
+  if (a->callee_function_id == print_function_id) {
+    this->write_print_call(a);
+    return;
+  }
+
+  // some builtin functions are single instructions, so they're written inline
+  // instead of being called
+  Intrinsic intrinsic = intrinsic_for_function(a->callee_function_id);
+  if ((intrinsic != Intrinsic::None) && this->write_intrinsic_call(a, intrinsic)) {
+    return;
+  }
+
   // get the function context
   auto* fn = this->global->context_for_function(a->callee_function_id);
-  if (a->callee_function_id == 0) {
+  if (!fn) {
+    // built-in classes with no __init__ (like most exception classes) have no
+    // function context; calling one just allocates an instance
+    auto* cls = this->global->context_for_class(a->callee_function_id);
+    if (cls && a->args.empty() && a->kwargs.empty() &&
+        (cls->instance_size() == sizeof(InstanceObject))) {
+      this->as.write_label(string_printf("__FunctionCall_%p_alloc_instance", a));
+      int64_t previously_reserved_registers = this->write_push_reserved_registers();
+      this->write_alloc_class_instance(cls->id, false);
+      this->write_pop_reserved_registers(previously_reserved_registers);
+      this->current_type = Variable(ValueType::Instance, cls->id, NULL);
+      return;
+    }
     throw compile_error(string_printf("function %" PRId64 " has no context object", a->callee_function_id),
         this->file_offset);
   }
@@ -1488,6 +2937,19 @@ void CompilationVisitor::visit(FunctionCall* a) {
     }
   }
 
+  // keyword arguments that don't name any of the function's arguments would
+  // otherwise be ignored
+  for (const auto& it : keyword_call_args) {
+    bool found = false;
+    for (const auto& callee_arg : fn->args) {
+      found |= (callee_arg.name == it.first);
+    }
+    if (!found) {
+      throw compile_error(string_printf("%s() does not support keyword argument %s",
+          fn->name.c_str(), it.first.c_str()), this->file_offset);
+    }
+  }
+
   // at this point we should have the same number of args overall as the
   // function wants
   if (arg_values.size() != fn->args.size()) {
@@ -1513,6 +2975,7 @@ void CompilationVisitor::visit(FunctionCall* a) {
   Register original_target_register = this->target_register;
   Register original_float_target_register = this->float_target_register;
   size_t int_registers_used = 0, float_registers_used = 0, stack_offset = 0;
+  vector<MemoryReference> arg_locations;
   for (size_t arg_index = 0; arg_index < arg_values.size(); arg_index++) {
     auto& arg = arg_values[arg_index];
 
@@ -1548,7 +3011,8 @@ void CompilationVisitor::visit(FunctionCall* a) {
         if (this->evaluating_instance_pointer) {
           throw compile_error("instance pointer evaluation failed", this->file_offset);
         }
-        if (!type_has_refcount(this->current_type.type)) {
+        if (!type_has_refcount(this->current_type.type) &&
+            (this->current_type.type != ValueType::Int)) {
           throw compile_error("instance pointer evaluation resulted in " + this->current_type.str(),
               this->file_offset);
         }
@@ -1611,18 +3075,22 @@ void CompilationVisitor::visit(FunctionCall* a) {
     if (arg.type.type == ValueType::Float) {
       if (float_registers_used != float_argument_register_order.size()) {
         this->reserve_register(this->float_target_register, true);
+        arg_locations.emplace_back(this->float_target_register);
         float_registers_used++;
       } else {
-        this->as.write_movsd(MemoryReference(rsp, stack_offset),
+        arg_locations.emplace_back(rsp, stack_offset);
+        this->as.write_movsd(arg_locations.back(),
             MemoryReference(this->float_target_register));
         stack_offset += sizeof(double);
       }
     } else {
       if (int_registers_used != int_argument_register_order.size()) {
         this->reserve_register(this->target_register);
+        arg_locations.emplace_back(this->target_register);
         int_registers_used++;
       } else {
-        this->as.write_mov(MemoryReference(rsp, stack_offset),
+        arg_locations.emplace_back(rsp, stack_offset);
+        this->as.write_mov(arg_locations.back(),
             MemoryReference(this->target_register));
         stack_offset += sizeof(int64_t);
       }
@@ -1658,13 +3126,39 @@ void CompilationVisitor::visit(FunctionCall* a) {
   }
 
   // get the fragment id
-  int64_t fragment_id;
+  int64_t fragment_id = -1;
+  vector<Variable> extension_type_bindings;
   try {
     fragment_id = fn->arg_signature_to_fragment_id.at(arg_signature);
+  } catch (const std::out_of_range& e) { }
+
+  // built-in functions can be generic over extension types (e.g. list.append),
+  // so their signatures won't match exactly. look for a fragment whose argument
+  // types match after binding the extension type references
+  if ((fragment_id < 0) && !fn->module) {
+    for (const auto& it : fn->fragments) {
+      const auto& fragment_arg_types = it.second.arg_types;
+      if (fragment_arg_types.size() != arg_types.size()) {
+        continue;
+      }
+      extension_type_bindings.clear();
+      size_t x;
+      for (x = 0; x < arg_types.size(); x++) {
+        if (!match_extension_type_references(fragment_arg_types[x],
+            arg_types[x], extension_type_bindings)) {
+          break;
+        }
+      }
+      if (x == arg_types.size()) {
+        fragment_id = it.first;
+        break;
+      }
+    }
+  }
 
-  // if there's no existing fragment with the right types, check if there's a
-  // fragment with Indeterminate extension types.
-  } catch (const std::out_of_range& e) {
+  // if there's no existing built-in fragment with the right types, check if
+  // there's a fragment with Indeterminate extension types.
+  if ((fragment_id < 0) && !fn->module) {
     // TODO: for now, just clear all the extension types and see if there's a
     // match. this is an ugly hack that works for e.g. len() but won't work for
     // more complex generic functions
@@ -1681,19 +3175,20 @@ void CompilationVisitor::visit(FunctionCall* a) {
     try {
       fragment_id = fn->arg_signature_to_fragment_id.at(arg_signature);
     } catch (const std::out_of_range& e) {
-
       // still no match. built-in functions can't be recompiled, so fail
-      if (!fn->module) {
-        throw compile_error(string_printf("built-in fragment %" PRId64 "+%s does not exist",
-            a->callee_function_id, arg_signature.c_str()), this->file_offset);
-      }
-
-      // this isn't a built-in function, so create a new fragment and compile it
-      fragment_id = fn->arg_signature_to_fragment_id.emplace(
-          arg_signature, fn->fragments.size()).first->second;
+      throw compile_error(string_printf("built-in fragment %" PRId64 "+%s does not exist",
+          a->callee_function_id, arg_signature.c_str()), this->file_offset);
     }
   }
 
+  // this isn't a built-in function, so create a new fragment and compile it.
+  // the signature includes the extension types, so e.g. a List[Int] argument
+  // and a List[Float] argument get different fragments
+  if (fragment_id < 0) {
+    fragment_id = fn->arg_signature_to_fragment_id.emplace(
+        arg_signature, fn->fragments.size()).first->second;
+  }
+
   // get or generate the Fragment object
   const FunctionContext::Fragment* fragment;
   try {
@@ -1704,6 +3199,20 @@ void CompilationVisitor::visit(FunctionCall* a) {
     fragment = &fn->fragments.emplace(fragment_id, move(new_fragment)).first->second;
   }
 
+  // built-in functions that take Int arguments expect them to be direct (see
+  // Types/Int.hh), unless they're registered as handling promoted values.
+  // promoted arguments to the others raise OverflowError. the exception block
+  // argument is always last, so the indexes match the fragment's arg types
+  if (!fragment->arg_types.empty() &&
+      !function_accepts_promoted_ints(a->callee_function_id)) {
+    for (size_t x = 0; x < fragment->arg_types.size(); x++) {
+      if (fragment->arg_types[x].type == ValueType::Int) {
+        this->write_jump_if_promoted(rax, arg_locations[x],
+            this->overflow_stub_label());
+      }
+    }
+  }
+
   this->as.write_label(string_printf("__FunctionCall_%p_call_fragment_%" PRId64 "_%" PRId64 "_%s",
       a, a->callee_function_id, fragment_id, arg_signature.c_str()));
 
@@ -1719,9 +3228,21 @@ void CompilationVisitor::visit(FunctionCall* a) {
   this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
   this->as.write_label(no_exc_label);
 
+  // resolve the return type if the fragment is generic
+  Variable return_type = fragment->return_type;
+  if (has_extension_type_references(return_type)) {
+    try {
+      return_type = resolve_extension_type_references(return_type,
+          extension_type_bindings);
+    } catch (const invalid_argument& e) {
+      throw compile_error(string_printf("can\'t resolve return type of generic function: %s",
+          e.what()), this->file_offset);
+    }
+  }
+
   // put the return value into the target register
-  if (fragment->return_type.type == ValueType::Float) {
-    if (this->target_register != rax) {
+  if (return_type.type == ValueType::Float) {
+    if (this->float_target_register != xmm0) {
       this->as.write_label(string_printf("__FunctionCall_%p_save_return_value", a));
       this->as.write_movsd(MemoryReference(this->float_target_register), xmm0);
     }
@@ -1730,10 +3251,14 @@ void CompilationVisitor::visit(FunctionCall* a) {
       this->as.write_label(string_printf("__FunctionCall_%p_save_return_value", a));
       this->as.write_mov(MemoryReference(this->target_register), rax);
     }
+    // built-in functions returning bool only set the low byte
+    if (return_type.type == ValueType::Bool) {
+      this->as.write_and(MemoryReference(this->target_register), 0xFF);
+    }
   }
 
   // functions always return new references, unless they return trivial types
-  this->current_type = fragment->return_type;
+  this->current_type = move(return_type);
   this->holding_reference = type_has_refcount(this->current_type.type);
 
   // note: we don't have to destroy the function arguments; we passed the
@@ -1754,9 +3279,9 @@ void CompilationVisitor::visit(ArrayIndex* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO: this leakes a reference! need to delete the reference to the
-  // collection (and key if it's a dict). maybe can fix this by using reference-
-  // absorbing functions instead?
+  // TODO: the Tuple case leaks a reference! need to delete the reference to
+  // the collection. maybe can fix this by using reference-absorbing functions
+  // instead?
 
   // get the collection
   a->array->accept(this);
@@ -1774,19 +3299,44 @@ void CompilationVisitor::visit(ArrayIndex* a) {
 
   if (collection_type.type == ValueType::Dict) {
 
-    // arg 1 is the dict object
-    if (this->target_register != rdi) {
-      this->as.write_mov(rdi, MemoryReference(this->target_register));
+    // save the collection so we can release it after getting the item
+    this->write_push(this->target_register);
+    const Variable& key_type = collection_type.extension_types[0];
+    const Variable& value_type = collection_type.extension_types[1];
+    string release_label = string_printf("__ArrayIndex_%p_release", a);
+
+    // if the key is a constant, this site gets an inline cache. if the dict's
+    // version matches the cached version, the value is still in the cached
+    // slot, so we don't need to compute the key or traverse the dict at all
+    bool key_is_constant = dynamic_cast<const IntegerConstant*>(a->index.get()) ||
+        dynamic_cast<const BytesConstant*>(a->index.get()) ||
+        dynamic_cast<const UnicodeConstant*>(a->index.get());
+    DictionaryLookupCache* cache = NULL;
+    if (key_is_constant) {
+      string cache_miss_label = string_printf("__ArrayIndex_%p_cache_miss", a);
+      cache = this->global->get_or_create_dictionary_lookup_cache(a);
+      this->as.write_mov(rdi, MemoryReference(rsp, 0));
+      this->as.write_mov(rsi, reinterpret_cast<int64_t>(cache));
+      this->as.write_mov(rax, MemoryReference(rsi, 0)); // cache->version
+      this->as.write_cmp(rax, MemoryReference(rdi, 0x38)); // d->version
+      this->as.write_jne(cache_miss_label);
+      this->as.write_mov(rax, MemoryReference(rsi, 8)); // cache->value_slot
+      this->as.write_mov(MemoryReference(original_target_register),
+          MemoryReference(rax, 0));
+      if (type_has_refcount(value_type.type)) {
+        this->write_add_reference(original_target_register, value_type.type);
+      }
+      this->as.write_jmp(release_label);
+      this->as.write_label(cache_miss_label);
     }
 
     // compute the key
     this->target_register = rsi;
-    this->reserve_register(rdi);
     a->index->accept(this);
-    if (!this->current_type.types_equal(collection_type.extension_types[0])) {
+    if (!this->current_type.types_equal(key_type)) {
       string expr_key_type = this->current_type.str();
-      string dict_key_type = collection_type.extension_types[0].str();
-      string dict_value_type = collection_type.extension_types[1].str();
+      string dict_key_type = key_type.str();
+      string dict_value_type = value_type.str();
       throw compile_error(string_printf("lookup for key of type %s on Dict[%s, %s]",
           expr_key_type.c_str(), dict_key_type.c_str(), dict_value_type.c_str()),
           this->file_offset);
@@ -1794,65 +3344,151 @@ void CompilationVisitor::visit(ArrayIndex* a) {
     if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
       throw compile_error("not holding reference to key", this->file_offset);
     }
-    this->release_register(rdi);
+    this->write_push(rsi);
+
+    // get the dict item, filling in the cache if there is one. these functions
+    // borrow the key and return a borrowed reference to the value
+    this->as.write_mov(rdi, MemoryReference(rsp, 8));
+    if (cache) {
+      this->as.write_mov(rdx, reinterpret_cast<int64_t>(cache));
+      this->write_function_call(
+          common_object_reference(void_fn_ptr(&dictionary_at_cached)),
+          {rdi, rsi, rdx, r14}, {}, -1, original_target_register);
+    } else {
+      this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_at)),
+          {rdi, rsi, r14}, {}, -1, original_target_register);
+    }
+    if (type_has_refcount(value_type.type)) {
+      this->write_add_reference(original_target_register, value_type.type);
+    }
 
-    // get the dict item
-    this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_at)),
-        {rdi, rsi, r14}, {}, -1, original_target_register);
+    // release the key, preserving the result
+    if (type_has_refcount(key_type.type)) {
+      this->write_push(original_target_register);
+      this->write_delete_reference(MemoryReference(rsp, 8), key_type.type);
+      this->write_pop(original_target_register);
+    }
+    this->adjust_stack(8);
+
+    // release the collection, preserving the result
+    this->as.write_label(release_label);
+    this->write_push(original_target_register);
+    this->write_delete_reference(MemoryReference(rsp, 8), collection_type.type);
+    this->write_pop(original_target_register);
+    this->adjust_stack(8);
 
     // the return type is the value extension type
-    this->current_type = collection_type.extension_types[1];
+    this->current_type = value_type;
+
+  } else if (collection_type.type == ValueType::List) {
+
+    // save the collection so we can release it after getting the item
+    this->write_push(this->target_register);
+
+    // compute the index
+    this->target_register = rsi;
+    a->index->accept(this);
+    if (this->current_type.type != ValueType::Int) {
+      throw compile_error("list index must be Int; here it\'s " + this->current_type.str(),
+          this->file_offset);
+    }
+
+    // items are stored unboxed, so we can load them directly. out-of-range
+    // indexes go through list_get_item, which raises IndexError
+    string positive_label = string_printf("__ArrayIndex_%p_positive_index", a);
+    string out_of_range_label = string_printf("__ArrayIndex_%p_out_of_range", a);
+    string end_label = string_printf("__ArrayIndex_%p_end", a);
+    this->as.write_mov(rdi, MemoryReference(rsp, 0));
+    this->as.write_mov(rdx, rsi);
+    this->as.write_test(rdx, rdx);
+    this->as.write_jns(positive_label);
+    this->as.write_add(rdx, MemoryReference(rdi, 0x10));
+    this->as.write_label(positive_label);
+    this->as.write_cmp(rdx, MemoryReference(rdi, 0x10));
+    this->as.write_jae(out_of_range_label);
+    this->as.write_mov(rdi, MemoryReference(rdi, 0x28));
+    this->as.write_mov(MemoryReference(original_target_register),
+        MemoryReference(rdi, 0, rdx, 8));
+    this->current_type = collection_type.extension_types[0];
+    if (type_has_refcount(this->current_type.type)) {
+      this->write_add_reference(original_target_register,
+          this->current_type.type);
+    }
+    this->as.write_jmp(end_label);
+
+    this->as.write_label(out_of_range_label);
+    this->write_function_call(common_object_reference(void_fn_ptr(&list_get_item)),
+        {rdi, rsi, r14}, {}, -1, original_target_register);
+    this->as.write_label(end_label);
+
+    // release the collection, preserving the result
+    this->write_push(original_target_register);
+    this->write_delete_reference(MemoryReference(rsp, 8), collection_type.type);
+    this->write_pop(original_target_register);
+    this->adjust_stack(8);
 
-  } else if ((collection_type.type == ValueType::List) ||
-             (collection_type.type == ValueType::Tuple)) {
+  } else if (collection_type.type == ValueType::Tuple) {
 
-    // arg 1 is the list/tuple object
+    // arg 1 is the tuple object
     if (this->target_register != rdi) {
       this->as.write_mov(rdi, MemoryReference(this->target_register));
     }
 
-    // for lists, the index can be dynamic; compute it now
+    // the index must be static since the result type depends on it. for this
+    // reason, it also needs to be in range of the extension types
+    if (!a->index_constant) {
+      throw compile_error("tuple indexes must be constants", this->file_offset);
+    }
     int64_t tuple_index = a->index_value;
-    if (collection_type.type == ValueType::List) {
-      this->target_register = rsi;
-      this->reserve_register(rdi);
-      a->index->accept(this);
-      if (this->current_type.type != ValueType::Int) {
-        throw compile_error("list index must be Int; here it\'s " + this->current_type.str(),
-            this->file_offset);
-      }
-      this->release_register(rdi);
+    if (tuple_index < 0) {
+      tuple_index += collection_type.extension_types.size();
+    }
+    if ((tuple_index < 0) || (tuple_index >= static_cast<ssize_t>(
+        collection_type.extension_types.size()))) {
+      throw compile_error("tuple index out of range", this->file_offset);
+    }
+    this->as.write_mov(rsi, tuple_index);
 
-    // for tuples, the index must be static since the result type depends on it.
-    // for this reason, it also needs to be in range of the extension types
-    } else {
-      if (!a->index_constant) {
-        throw compile_error("tuple indexes must be constants", this->file_offset);
-      }
-      if (tuple_index < 0) {
-        tuple_index += collection_type.extension_types.size();
-      }
-      if ((tuple_index < 0) || (tuple_index >= static_cast<ssize_t>(
-          collection_type.extension_types.size()))) {
-        throw compile_error("tuple index out of range", this->file_offset);
-      }
-      this->as.write_mov(rsi, tuple_index);
+    // now call the function. the return type is one of the extension types,
+    // determined by the static index value
+    this->write_function_call(common_object_reference(void_fn_ptr(&tuple_get_item)),
+        {rdi, rsi, r14}, {}, -1, original_target_register);
+    this->current_type = collection_type.extension_types[tuple_index];
+
+  } else if ((collection_type.type == ValueType::Bytes) ||
+             (collection_type.type == ValueType::Unicode)) {
+
+    // save the collection so we can release it after getting the item
+    this->write_push(this->target_register);
+
+    // arg 1 is the bytes/unicode object
+    if (this->target_register != rdi) {
+      this->as.write_mov(rdi, MemoryReference(this->target_register));
+    }
+
+    // arg 2 is the index
+    this->target_register = rsi;
+    this->reserve_register(rdi);
+    a->index->accept(this);
+    if (this->current_type.type != ValueType::Int) {
+      throw compile_error("string index must be Int; here it\'s " + this->current_type.str(),
+          this->file_offset);
     }
+    this->release_register(rdi);
 
-    // now call the function
-    const void* fn = (collection_type.type == ValueType::List) ?
-        void_fn_ptr(&list_get_item) : void_fn_ptr(&tuple_get_item);
+    // bytes items are Ints; unicode items are new Unicode objects
+    const void* fn = (collection_type.type == ValueType::Bytes) ?
+        void_fn_ptr(&bytes_get_item) : void_fn_ptr(&unicode_get_item);
     this->write_function_call(common_object_reference(fn), {rdi, rsi, r14}, {},
         -1, original_target_register);
+    this->current_type = Variable((collection_type.type == ValueType::Bytes) ?
+        ValueType::Int : ValueType::Unicode);
 
-    // for lists, the return type is the extension type
-    if (collection_type.type == ValueType::List) {
-      this->current_type = collection_type.extension_types[0];
-    // for tuples, the return type is one of the extension types, determined by
-    // the static index value
-    } else {
-      this->current_type = collection_type.extension_types[tuple_index];
-    }
+    // release the collection, preserving the result
+    this->write_push(original_target_register);
+    this->write_delete_reference(MemoryReference(rsp, 8), collection_type.type);
+    this->write_pop(original_target_register);
+    this->adjust_stack(8);
 
   } else {
     // TODO
@@ -1868,7 +3504,7 @@ void CompilationVisitor::visit(ArrayIndex* a) {
   // to an xmm reg if needed
   if (this->current_type.type == ValueType::Float) {
     this->as.write_movq_to_xmm(this->float_target_register,
-        MemoryReference(this->target_register));
+        MemoryReference(original_target_register));
   }
 
   // restore state
@@ -1880,17 +3516,69 @@ void CompilationVisitor::visit(ArraySlice* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("ArraySlice not yet implemented", this->file_offset);
-}
+  // get the collection
+  a->array->accept(this);
+  Variable collection_type = move(this->current_type);
+  if (!this->holding_reference) {
+    throw compile_error("not holding reference to collection", this->file_offset);
+  }
+
+  // bytes and unicode slices are usually views of the original object, so they
+  // don't copy any data; list slices are copies (see Types/Strings.hh and
+  // Types/List.hh)
+  const void* fn;
+  if (collection_type.type == ValueType::Bytes) {
+    fn = void_fn_ptr(&bytes_slice);
+  } else if (collection_type.type == ValueType::Unicode) {
+    fn = void_fn_ptr(&unicode_slice);
+  } else if (collection_type.type == ValueType::List) {
+    fn = void_fn_ptr(&list_slice);
+  } else {
+    throw compile_error("ArraySlice not yet implemented for collections of type " +
+        collection_type.str(), this->file_offset);
+  }
+
+  Register original_target_register = this->target_register;
+  int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+  // save the collection so we can release it after slicing, then compute the
+  // indexes
+  this->write_push(this->target_register);
+  this->write_push_slice_indexes(a->start_index.get(), a->end_index.get(),
+      a->step_size.get());
+
+  this->as.write_mov(rdi, MemoryReference(rsp, 0x18));
+  this->as.write_mov(rsi, MemoryReference(rsp, 0x10));
+  this->as.write_mov(rdx, MemoryReference(rsp, 0x08));
+  this->as.write_mov(rcx, MemoryReference(rsp, 0));
+  this->adjust_stack(0x18);
+  this->write_function_call(common_object_reference(fn),
+      {rdi, rsi, rdx, rcx, r14}, {}, -1, original_target_register);
+
+  // release the collection, preserving the result
+  this->write_push(original_target_register);
+  this->write_delete_reference(MemoryReference(rsp, 8), collection_type.type);
+  this->write_pop(original_target_register);
+  this->adjust_stack(8);
+
+  this->current_type = move(collection_type);
+  this->holding_reference = true;
+
+  // restore state
+  this->write_pop_reserved_registers(previously_reserved_registers);
+  this->target_register = original_target_register;
+}
 
 void CompilationVisitor::visit(IntegerConstant* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
   this->as.write_mov(this->target_register, a->value);
+  if (int_is_promoted(a->value)) {
+    this->write_add_reference(this->target_register, ValueType::Int);
+  }
   this->current_type = Variable(ValueType::Int);
-  this->holding_reference = false;
+  this->holding_reference = true;
 }
 
 void CompilationVisitor::visit(FloatConstant* a) {
@@ -1908,7 +3596,7 @@ void CompilationVisitor::visit(BytesConstant* a) {
 
   const BytesObject* o = this->global->get_or_create_constant(a->value);
   this->as.write_mov(this->target_register, reinterpret_cast<int64_t>(o));
-  this->write_add_reference(this->target_register);
+  this->write_add_reference(this->target_register, ValueType::Bytes);
 
   this->current_type = Variable(ValueType::Bytes);
   this->holding_reference = true;
@@ -1920,7 +3608,7 @@ void CompilationVisitor::visit(UnicodeConstant* a) {
 
   const UnicodeObject* o = this->global->get_or_create_constant(a->value);
   this->as.write_mov(this->target_register, reinterpret_cast<int64_t>(o));
-  this->write_add_reference(this->target_register);
+  this->write_add_reference(this->target_register, ValueType::Unicode);
 
   this->current_type = Variable(ValueType::Unicode);
   this->holding_reference = true;
@@ -1968,7 +3656,7 @@ void CompilationVisitor::visit(VariableLookup* a) {
   } else {
     this->as.write_mov(MemoryReference(this->target_register), loc.mem);
     if (has_refcount) {
-      this->write_add_reference(this->target_register);
+      this->write_add_reference(this->target_register, loc.type.type);
     }
   }
 
@@ -2001,7 +3689,7 @@ void CompilationVisitor::visit(AttributeLookup* a) {
     } else {
       this->as.write_mov(MemoryReference(this->target_register), loc.mem);
       if (has_refcount) {
-        this->write_add_reference(this->target_register);
+        this->write_add_reference(this->target_register, loc.type.type);
       }
     }
 
@@ -2024,7 +3712,7 @@ void CompilationVisitor::visit(AttributeLookup* a) {
 
     this->as.write_label(string_printf("__AttributeLookup_%p_evaluate_instance", a));
     a->base->accept(this);
-    if (!this->holding_reference) {
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
       throw compile_error("instance pointer evaluation resulted in non-held reference",
           this->file_offset);
     }
@@ -2049,7 +3737,7 @@ void CompilationVisitor::visit(AttributeLookup* a) {
     bool attr_has_refcount = type_has_refcount(loc.type.type);
     if (attr_has_refcount) {
       this->reserve_register(base_register);
-      this->write_add_reference(attr_register);
+      this->write_add_reference(attr_register, loc.type.type);
       this->release_register(base_register);
     }
 
@@ -2075,24 +3763,258 @@ void CompilationVisitor::visit(TupleLValueReference* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("TupleLValueReference not yet implemented", this->file_offset);
+  // the value is a Tuple or List object in target_register. tuples that are
+  // constructed and immediately unpacked don't get here (see
+  // write_unpacked_tuple_assignment)
+  Variable value_type = move(this->current_type);
+  bool value_held = this->holding_reference;
+  if ((value_type.type != ValueType::Tuple) &&
+      (value_type.type != ValueType::List)) {
+    throw compile_error("cannot unpack " + value_type.str(), this->file_offset);
+  }
+  if (value_type.type == ValueType::Tuple) {
+    if (value_type.extension_types.size() != a->items.size()) {
+      throw compile_error("unpacking format length doesn\'t match Tuple count",
+          this->file_offset);
+    }
+  } else if (value_type.extension_types.size() != 1) {
+    throw compile_error("cannot unpack List with unknown item type",
+        this->file_offset);
+  }
+
+  Register value_register = this->target_register;
+  this->write_push(value_register);
+  int64_t value_stack_bytes_used = this->stack_bytes_used;
+
+  // lists can be any length, so check it here
+  if (value_type.type == ValueType::List) {
+    string length_ok_label = string_printf("__TupleLValueReference_%p_length_ok", a);
+    this->as.write_cmp(MemoryReference(value_register, 0x10), a->items.size());
+    this->as.write_je(length_ok_label);
+    this->write_pop(value_register);
+    if (value_held) {
+      this->write_delete_reference(MemoryReference(value_register), value_type.type);
+    }
+    this->write_raise_exception(ValueError_class_id);
+    this->as.write_label(length_ok_label);
+    this->stack_bytes_used = value_stack_bytes_used;
+  }
+
+  for (size_t x = 0; x < a->items.size(); x++) {
+    this->as.write_label(string_printf("__TupleLValueReference_%p_item_%zu", a, x));
+    const Variable& item_type = value_type.extension_types[
+        (value_type.type == ValueType::Tuple) ? x : 0];
+
+    this->target_register = this->available_register();
+    MemoryReference target_mem(this->target_register);
+    this->as.write_mov(target_mem, MemoryReference(rsp,
+        this->stack_bytes_used - value_stack_bytes_used));
+    int64_t item_offset = 0x18 + x * sizeof(int64_t);
+    if (value_type.type == ValueType::List) {
+      this->as.write_mov(target_mem, MemoryReference(this->target_register, 0x28));
+      item_offset = x * sizeof(int64_t);
+    }
+    if (item_type.type == ValueType::Float) {
+      this->as.write_movq_to_xmm(this->float_target_register,
+          MemoryReference(this->target_register, item_offset));
+    } else {
+      this->as.write_mov(target_mem,
+          MemoryReference(this->target_register, item_offset));
+    }
+    if (type_has_refcount(item_type.type)) {
+      this->write_add_reference(this->target_register, item_type.type);
+    }
+
+    this->current_type = item_type;
+    this->holding_reference = type_has_refcount(item_type.type);
+    a->items[x]->accept(this);
+  }
+
+  this->target_register = value_register;
+  this->write_pop(value_register);
+  if (value_held) {
+    this->write_delete_reference(MemoryReference(value_register), value_type.type);
+  }
+  this->holding_reference = false;
 }
 
 void CompilationVisitor::visit(ArrayIndexLValueReference* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("ArrayIndexLValueReference not yet implemented", this->file_offset);
+  // we had better be holding a reference to the value
+  if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+    throw compile_error("assignment of non-held reference to list item",
+        this->file_offset);
+  }
+  Variable value_type = move(this->current_type);
+  Register original_target_register = this->target_register;
+
+  // save the value (for floats, the raw bits) while we evaluate the collection
+  // and index
+  if (value_type.type == ValueType::Float) {
+    this->as.write_movq_from_xmm(MemoryReference(this->target_register),
+        this->float_target_register);
+  }
+  this->write_push(this->target_register);
+
+  // get the collection
+  a->array->accept(this);
+  if ((this->current_type.type != ValueType::List) &&
+      (this->current_type.type != ValueType::Dict)) {
+    throw compile_error("ArrayIndexLValueReference not yet implemented for collections of type " +
+        this->current_type.str(), this->file_offset);
+  }
+  if (!this->holding_reference) {
+    throw compile_error("not holding reference to collection", this->file_offset);
+  }
+  Variable collection_type = move(this->current_type);
+
+  if (collection_type.type == ValueType::Dict) {
+    if (!collection_type.extension_types[1].types_equal(value_type)) {
+      string item_type_str = collection_type.extension_types[1].str();
+      string value_type_str = value_type.str();
+      throw compile_error(string_printf("cannot store %s in dict of %s",
+          value_type_str.c_str(), item_type_str.c_str()), this->file_offset);
+    }
+    this->write_push(this->target_register);
+
+    // compute the key
+    this->target_register = rsi;
+    a->index->accept(this);
+    if (!this->current_type.types_equal(collection_type.extension_types[0])) {
+      string expr_key_type = this->current_type.str();
+      string dict_key_type = collection_type.extension_types[0].str();
+      throw compile_error(string_printf("cannot store key of type %s in dict with keys of type %s",
+          expr_key_type.c_str(), dict_key_type.c_str()), this->file_offset);
+    }
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error("not holding reference to key", this->file_offset);
+    }
+    this->write_push(rsi);
+
+    // dictionary_insert adds its own references to the key and value, so
+    // release ours (and the dict) afterward. the stack looks like this:
+    // [rsp+0x00] the key
+    // [rsp+0x08] the dict object
+    // [rsp+0x10] the value
+    this->write_function_call(common_object_reference(void_fn_ptr(&dictionary_insert)),
+        {MemoryReference(rsp, 8), MemoryReference(rsp, 0),
+          MemoryReference(rsp, 0x10), r14}, {});
+    if (type_has_refcount(collection_type.extension_types[0].type)) {
+      this->write_delete_reference(MemoryReference(rsp, 0),
+          collection_type.extension_types[0].type);
+    }
+    this->write_delete_reference(MemoryReference(rsp, 8), collection_type.type);
+    if (type_has_refcount(value_type.type)) {
+      this->write_delete_reference(MemoryReference(rsp, 0x10), value_type.type);
+    }
+    this->adjust_stack(0x18);
+    this->target_register = original_target_register;
+    return;
+  }
+
+  if (!collection_type.extension_types[0].types_equal(value_type)) {
+    string item_type_str = collection_type.extension_types[0].str();
+    string value_type_str = value_type.str();
+    throw compile_error(string_printf("cannot store %s in list of %s",
+        value_type_str.c_str(), item_type_str.c_str()), this->file_offset);
+  }
+  this->write_push(this->target_register);
+
+  // compute the index
+  this->target_register = rsi;
+  a->index->accept(this);
+  if (this->current_type.type != ValueType::Int) {
+    throw compile_error("list index must be Int; here it\'s " + this->current_type.str(),
+        this->file_offset);
+  }
+
+  // store the item directly. the list takes over our reference to the value,
+  // and if the items are objects, the reference to the old value is released.
+  // out-of-range indexes go through list_set_item, which raises IndexError
+  string positive_label = string_printf("__ArrayIndexLValueReference_%p_positive_index", a);
+  string out_of_range_label = string_printf("__ArrayIndexLValueReference_%p_out_of_range", a);
+  string end_label = string_printf("__ArrayIndexLValueReference_%p_end", a);
+  this->as.write_mov(rdi, MemoryReference(rsp, 0));
+  this->as.write_mov(rdx, MemoryReference(rsp, 8));
+  this->as.write_mov(rcx, rsi);
+  this->as.write_test(rcx, rcx);
+  this->as.write_jns(positive_label);
+  this->as.write_add(rcx, MemoryReference(rdi, 0x10));
+  this->as.write_label(positive_label);
+  this->as.write_cmp(rcx, MemoryReference(rdi, 0x10));
+  this->as.write_jae(out_of_range_label);
+  this->as.write_mov(rdi, MemoryReference(rdi, 0x28));
+  if (type_has_refcount(value_type.type)) {
+    this->as.write_mov(rax, MemoryReference(rdi, 0, rcx, 8));
+    this->as.write_mov(MemoryReference(rdi, 0, rcx, 8), rdx);
+    this->write_delete_reference(MemoryReference(rax), value_type.type);
+  } else {
+    this->as.write_mov(MemoryReference(rdi, 0, rcx, 8), rdx);
+  }
+  this->as.write_jmp(end_label);
+
+  this->as.write_label(out_of_range_label);
+  this->write_function_call(common_object_reference(void_fn_ptr(&list_set_item)),
+      {rdi, rsi, rdx, r14}, {});
+  this->as.write_label(end_label);
+
+  // release the collection and clean up the stack
+  this->write_delete_reference(MemoryReference(rsp, 0), collection_type.type);
+  this->adjust_stack(16);
+  this->target_register = original_target_register;
 }
 
 void CompilationVisitor::visit(ArraySliceLValueReference* a) {
   this->file_offset = a->file_offset;
   this->assert_not_evaluating_instance_pointer();
 
-  // TODO
-  throw compile_error("ArraySliceLValueReference not yet implemented", this->file_offset);
+  // only lists can be modified, and the value must be a list of the same type
+  if (!this->holding_reference) {
+    throw compile_error("assignment of non-held reference to list slice",
+        this->file_offset);
+  }
+  Variable value_type = move(this->current_type);
+  Register original_target_register = this->target_register;
+  this->write_push(this->target_register);
+
+  // get the collection
+  a->array->accept(this);
+  if (this->current_type.type != ValueType::List) {
+    throw compile_error("ArraySliceLValueReference not yet implemented for collections of type " +
+        this->current_type.str(), this->file_offset);
+  }
+  if (!this->holding_reference) {
+    throw compile_error("not holding reference to collection", this->file_offset);
+  }
+  Variable collection_type = move(this->current_type);
+  if ((value_type.type != ValueType::List) ||
+      !collection_type.extension_types[0].types_equal(value_type.extension_types[0])) {
+    string collection_type_str = collection_type.str();
+    string value_type_str = value_type.str();
+    throw compile_error(string_printf("cannot assign %s to slice of %s",
+        value_type_str.c_str(), collection_type_str.c_str()), this->file_offset);
+  }
+  this->write_push(this->target_register);
+
+  // compute the indexes and replace the items. list_set_slice borrows the
+  // value, so we release both lists afterward
+  this->write_push_slice_indexes(a->start_index.get(), a->end_index.get(),
+      a->step_size.get());
+  this->as.write_mov(rdi, MemoryReference(rsp, 0x18));
+  this->as.write_mov(rsi, MemoryReference(rsp, 0x10));
+  this->as.write_mov(rdx, MemoryReference(rsp, 0x08));
+  this->as.write_mov(rcx, MemoryReference(rsp, 0));
+  this->as.write_mov(r8, MemoryReference(rsp, 0x20));
+  this->adjust_stack(0x18);
+  this->write_function_call(common_object_reference(void_fn_ptr(&list_set_slice)),
+      {rdi, rsi, rdx, rcx, r8, r14}, {});
+
+  this->write_delete_reference(MemoryReference(rsp, 0), collection_type.type);
+  this->write_delete_reference(MemoryReference(rsp, 8), value_type.type);
+  this->adjust_stack(16);
+  this->target_register = original_target_register;
 }
 
 void CompilationVisitor::visit(AttributeLValueReference* a) {
@@ -2132,8 +4054,8 @@ void CompilationVisitor::visit(AttributeLValueReference* a) {
         this->target_register);
     const auto& attr = cls->attributes.at(a->name);
     if (!attr.types_equal(loc.type)) {
-      string attr_type = attr.str();
-      string new_type = value_type.str();
+      string attr_type = attr.type_only().str();
+      string new_type = value_type.type_only().str();
       throw compile_error(string_printf("attribute %s changes type from %s to %s",
           a->name.c_str(), attr_type.c_str(), new_type.c_str()),
           this->file_offset);
@@ -2182,9 +4104,9 @@ void CompilationVisitor::visit(AttributeLValueReference* a) {
     }
     if (target_variable->type == ValueType::Indeterminate) {
       *target_variable = current_type;
-    } else if (!target_variable->types_equal(loc.type)) {
-      string target_type_str = target_variable->str();
-      string value_type_str = current_type.str();
+    } else if (!target_variable->types_equal(this->current_type)) {
+      string target_type_str = target_variable->type_only().str();
+      string value_type_str = current_type.type_only().str();
       throw compile_error(string_printf("variable %s changes type from %s to %s\n",
           loc.name.c_str(), target_type_str.c_str(),
           value_type_str.c_str()), this->file_offset);
@@ -2262,6 +4184,7 @@ void CompilationVisitor::visit(ModuleStatement* a) {
   }
 
   this->as.write_ret();
+  this->write_exception_stubs();
 }
 
 void CompilationVisitor::visit(ExpressionStatement* a) {
@@ -2281,8 +4204,17 @@ void CompilationVisitor::visit(AssignmentStatement* a) {
   // unlike in AnalysisVisitor, we look at the lvalue references first, so we
   // can know where to put the resulting values when generating their code
 
-  // TODO: currently we don't support unpacking at all; we only support simple
-  // assignments
+  // if a tuple is unpacked as soon as it's constructed (e.g. `a, b = b, a`),
+  // don't construct it at all
+  TupleLValueReference* tuple_target = dynamic_cast<TupleLValueReference*>(
+      a->target.get());
+  TupleConstructor* tuple_value = dynamic_cast<TupleConstructor*>(
+      a->value.get());
+  if (tuple_target && tuple_value &&
+      (tuple_target->items.size() == tuple_value->items.size())) {
+    this->write_unpacked_tuple_assignment(tuple_target, tuple_value);
+    return;
+  }
 
   // generate code to load the value into any available register
   this->target_register = available_register();
@@ -2301,6 +4233,52 @@ void CompilationVisitor::visit(AssignmentStatement* a) {
   this->holding_reference = false;
 }
 
+void CompilationVisitor::write_unpacked_tuple_assignment(
+    TupleLValueReference* target, TupleConstructor* value) {
+  // all the values are evaluated before any of the targets are written (so
+  // e.g. `a, b = b, a` works), so they're saved on the stack in between
+  vector<Variable> item_types;
+  for (const auto& item : value->items) {
+    this->as.write_label(string_printf("__AssignmentStatement_%p_item_%zu",
+        target, item_types.size()));
+    this->target_register = this->available_register();
+    item->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error("can\'t assign borrowed reference to " + this->current_type.str(),
+          this->file_offset);
+    }
+    if (this->current_type.type == ValueType::Float) {
+      this->adjust_stack(-8);
+      this->as.write_movsd(MemoryReference(rsp, 0),
+          MemoryReference(this->float_target_register));
+    } else {
+      this->write_push(this->target_register);
+    }
+    item_types.emplace_back(move(this->current_type));
+  }
+  int64_t items_stack_bytes_used = this->stack_bytes_used;
+
+  // write the values to the targets in order. the item lvalues may use the
+  // stack themselves, so the offsets are computed for each one
+  for (size_t x = 0; x < item_types.size(); x++) {
+    this->as.write_label(string_printf("__AssignmentStatement_%p_write_item_%zu",
+        target, x));
+    MemoryReference item_mem(rsp, this->stack_bytes_used - items_stack_bytes_used +
+        (item_types.size() - 1 - x) * sizeof(int64_t));
+    this->target_register = this->available_register();
+    if (item_types[x].type == ValueType::Float) {
+      this->as.write_movsd(MemoryReference(this->float_target_register), item_mem);
+    } else {
+      this->as.write_mov(MemoryReference(this->target_register), item_mem);
+    }
+    this->current_type = item_types[x];
+    this->holding_reference = type_has_refcount(item_types[x].type);
+    target->items[x]->accept(this);
+  }
+  this->adjust_stack(item_types.size() * sizeof(int64_t));
+  this->holding_reference = false;
+}
+
 void CompilationVisitor::visit(AugmentStatement* a) {
   this->file_offset = a->file_offset;
 
@@ -2347,7 +4325,8 @@ void CompilationVisitor::visit(ImportStatement* a) {
 
     // if it's an object, add a reference to it
     if (type_has_refcount(module->globals.at(it.first).type)) {
-      this->write_add_reference(this->target_register);
+      this->write_add_reference(this->target_register,
+          module->globals.at(it.first).type);
     }
 
     // store the value in this module
@@ -2398,7 +4377,7 @@ void CompilationVisitor::visit(AssertStatement* a) {
     // if no message is given, use a blank message
     const UnicodeObject* message = this->global->get_or_create_constant(L"");
     this->as.write_mov(this->target_register, reinterpret_cast<int64_t>(message));
-    this->write_add_reference(this->target_register);
+    this->write_add_reference(this->target_register, ValueType::Unicode);
   }
   this->write_push(this->target_register);
 
@@ -2474,8 +4453,9 @@ void CompilationVisitor::visit(ReturnStatement* a) {
         this->file_offset);
   }
 
-  // record this return type
-  this->function_return_types.emplace(this->current_type);
+  // record this return type. the value doesn't matter here (and mutable
+  // collections with known values can't be hashed)
+  this->function_return_types.emplace(this->current_type.type_only());
 
   // if we're inside a finally block, there may be an active exception. but a
   // return statement inside a finally block should cause the exception to be
@@ -2490,7 +4470,31 @@ void CompilationVisitor::visit(ReturnStatement* a) {
   // TODO: this is wrong; it doesn't cause enclosing finally blocks to execute.
   // we should unwind the exception blocks until the end of the function
   this->as.write_label(string_printf("__ReturnStatement_%p_return", a));
-  this->as.write_jmp(this->return_label);
+  if (!this->for_loop_stack.empty()) {
+    // we're inside one or more for loops, so restore rbx and release each
+    // collection (preserving the return value in rax) before leaving
+    int64_t prev_stack_bytes_used = this->stack_bytes_used;
+    for (auto it = this->for_loop_stack.crbegin();
+         it != this->for_loop_stack.crend(); it++) {
+      int64_t offset = this->stack_bytes_used - it->stack_bytes_used;
+      this->as.write_mov(rbx, MemoryReference(rsp, offset));
+      for (size_t x = 0; x < it->slot_types.size(); x++) {
+        if (type_has_refcount(it->slot_types[x])) {
+          int64_t slot_offset = offset + (x + 1) * sizeof(int64_t);
+          this->as.write_xchg(rax, MemoryReference(rsp, slot_offset));
+          this->write_delete_reference(rax, it->slot_types[x]);
+          this->as.write_mov(rax, MemoryReference(rsp, slot_offset));
+        }
+      }
+    }
+    const auto& outer_loop = this->for_loop_stack.front();
+    this->adjust_stack_to(outer_loop.stack_bytes_used -
+        (outer_loop.slot_types.size() + 1) * sizeof(int64_t));
+    this->as.write_jmp(this->return_label);
+    this->stack_bytes_used = prev_stack_bytes_used;
+  } else {
+    this->as.write_jmp(this->return_label);
+  }
 }
 
 void CompilationVisitor::visit(RaiseStatement* a) {
@@ -2633,6 +4637,20 @@ void CompilationVisitor::visit(ElifStatement* a) {
 void CompilationVisitor::visit(ForStatement* a) {
   this->file_offset = a->file_offset;
 
+  if (a->fused_iteration) {
+    this->write_fused_for_statement(a);
+    return;
+  }
+  if (is_simple_range_call(dynamic_cast<FunctionCall*>(a->collection.get()))) {
+    this->write_range_for_statement(a);
+    return;
+  }
+  if (is_unbounded_stdin_lines_call(
+      dynamic_cast<FunctionCall*>(a->collection.get()))) {
+    this->write_stdin_lines_for_statement(a);
+    return;
+  }
+
   // get the collection object and save it on the stack
   this->as.write_label(string_printf("__ForStatement_%p_get_collection", a));
   a->collection->accept(this);
@@ -2645,6 +4663,8 @@ void CompilationVisitor::visit(ForStatement* a) {
   }
   this->write_push(rbx);
   this->as.write_xor(rbx, rbx);
+  this->for_loop_stack.emplace_back(ForLoopState({this->stack_bytes_used,
+      vector<ValueType>({collection_type.type})}));
 
   string next_label = string_printf("__ForStatement_%p_next", a);
   string end_label = string_printf("__ForStatement_%p_complete", a);
@@ -2705,12 +4725,13 @@ void CompilationVisitor::visit(ForStatement* a) {
 
     // if the extension type has a refcount, add a reference
     if (type_has_refcount(item_type)) {
-      this->write_add_reference(this->target_register);
+      this->write_add_reference(this->target_register, item_type);
     }
 
     // load the value into the correct local variable slot
     this->as.write_label(string_printf("__ForStatement_%p_write_value", a));
     this->current_type = collection_type.extension_types[0];
+    this->holding_reference = type_has_refcount(this->current_type.type);
     a->variable->accept(this);
 
     // do the loop body
@@ -2723,85 +4744,1036 @@ void CompilationVisitor::visit(ForStatement* a) {
     this->as.write_jmp(next_label);
     this->as.write_label(end_label);
 
-  } else if (collection_type.type == ValueType::Dict) {
+  } else if (collection_type.type == ValueType::Dict) {
+
+    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+
+    // create a SlotContents structure
+    // TODO: figure out how this structure interacts with refcounting and
+    // exceptions (or if it does at all)
+    this->adjust_stack(-sizeof(DictionaryObject::SlotContents));
+    this->as.write_mov(MemoryReference(rsp, 0), 0);
+    this->as.write_mov(MemoryReference(rsp, 8), 0);
+    this->as.write_mov(MemoryReference(rsp, 16), 0);
+
+    // get the dict object and SlotContents pointer
+    this->as.write_label(next_label);
+    this->as.write_mov(rdi, MemoryReference(rsp,
+        sizeof(DictionaryObject::SlotContents)));
+    this->as.write_mov(rsi, rsp);
+
+    // call dictionary_next_item
+    this->write_add_reference(rdi, ValueType::Dict);
+    this->write_function_call(
+        common_object_reference(void_fn_ptr(&dictionary_next_item)), {rdi, rsi}, {});
+
+    // if dictionary_next_item returned 0, then we're done
+    this->as.write_test(rax, rax);
+    this->as.write_je(end_label);
+
+    // get the key pointer
+    this->as.write_mov(MemoryReference(this->target_register),
+        MemoryReference(rsp, 0));
+
+    // if the extension type has a refcount, add a reference
+    if (type_has_refcount(collection_type.extension_types[0].type)) {
+      this->write_add_reference(this->target_register,
+          collection_type.extension_types[0].type);
+    }
+
+    // load the value into the correct local variable slot
+    this->as.write_label(string_printf("__ForStatement_%p_write_key_value", a));
+    this->current_type = collection_type.extension_types[0];
+    this->holding_reference = type_has_refcount(this->current_type.type);
+    a->variable->accept(this);
+
+    // do the loop body
+    this->as.write_label(string_printf("__ForStatement_%p_body", a));
+    this->break_label_stack.emplace_back(break_label);
+    this->continue_label_stack.emplace_back(next_label);
+    this->visit_list(a->items);
+    this->continue_label_stack.pop_back();
+    this->break_label_stack.pop_back();
+    this->as.write_jmp(next_label);
+    this->as.write_label(end_label);
+
+    // clean up the stack
+    this->adjust_stack(sizeof(DictionaryObject::SlotContents));
+    this->write_pop_reserved_registers(previously_reserved_registers);
+
+  } else if (collection_type.type == ValueType::Set) {
+
+    // set_next_item returns the next position in rax and the item in rdx, so
+    // the position can live in rbx like the list index does
+    this->as.write_label(next_label);
+    this->as.write_mov(rdi, MemoryReference(rsp, 8));
+    this->as.write_mov(rsi, rbx);
+    this->write_function_call(
+        common_object_reference(void_fn_ptr(&set_next_item)), {rdi, rsi}, {});
+    this->as.write_mov(rbx, rax);
+    this->as.write_test(rbx, rbx);
+    this->as.write_jz(end_label);
+    this->as.write_mov(MemoryReference(this->target_register), rdx);
+
+    // if the extension type has a refcount, add a reference
+    ValueType item_type = collection_type.extension_types[0].type;
+    if (type_has_refcount(item_type)) {
+      this->write_add_reference(this->target_register, item_type);
+    }
+
+    // load the value into the correct local variable slot
+    this->as.write_label(string_printf("__ForStatement_%p_write_value", a));
+    this->current_type = collection_type.extension_types[0];
+    this->holding_reference = type_has_refcount(this->current_type.type);
+    a->variable->accept(this);
+
+    // do the loop body
+    this->as.write_label(string_printf("__ForStatement_%p_body", a));
+    this->break_label_stack.emplace_back(break_label);
+    this->continue_label_stack.emplace_back(next_label);
+    this->visit_list(a->items);
+    this->continue_label_stack.pop_back();
+    this->break_label_stack.pop_back();
+    this->as.write_jmp(next_label);
+    this->as.write_label(end_label);
+
+  } else {
+    throw compile_error("iteration not implemented for " + collection_type.str(),
+        this->file_offset);
+  }
+
+  // if there's an else statement, generate the body here
+  if (a->else_suite.get()) {
+    a->else_suite->accept(this);
+  }
+
+  // any break statement will jump over the loop body and the else statement
+  this->as.write_label(break_label);
+  this->for_loop_stack.pop_back();
+
+  // restore rbx
+  this->write_pop(rbx);
+
+  // we still own a reference to the collection; destroy it now
+  // note: all collection types have refcounts; dunno why I bothered checking
+  if (type_has_refcount(collection_type.type)) {
+    this->write_pop(this->target_register);
+    this->write_delete_reference(MemoryReference(this->target_register),
+        collection_type.type);
+  } else {
+    this->as.write_add(rsp, 8);
+  }
+}
+
+void CompilationVisitor::write_range_for_statement(ForStatement* a) {
+  // this is a loop like `for i in range(...)`. the range isn't materialized;
+  // as in comprehensions, we compute each value from the item index (in rbx).
+  // while the loop runs, the stack looks like this:
+  // [rsp+0x00] saved rbx
+  // [rsp+0x08] item count
+  // [rsp+0x10] step
+  // [rsp+0x18] start
+  FunctionCall* range_call = static_cast<FunctionCall*>(a->collection.get());
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  if (target_register == rbx) {
+    throw compile_error("cannot use rbx as target register for list iteration");
+  }
+
+  this->as.write_label(string_printf("__ForStatement_%p_get_range", a));
+  this->write_push_range(range_call);
+  this->write_push(rbx);
+  this->as.write_xor(rbx, rbx);
+  // the slots hold raw values (the count may not be a valid Int), so they're
+  // typed as None to keep break and return from releasing them
+  this->for_loop_stack.emplace_back(ForLoopState({this->stack_bytes_used,
+      vector<ValueType>({ValueType::None, ValueType::None, ValueType::None})}));
+
+  string next_label = string_printf("__ForStatement_%p_next", a);
+  string end_label = string_printf("__ForStatement_%p_complete", a);
+  string break_label = string_printf("__ForStatement_%p_broken", a);
+
+  // simple loops over ranges starting at zero may be able to do most of their
+  // work before the scalar loop runs; if so, rbx is advanced past those items
+  if (range_call->args.size() == 1) {
+    this->write_vectorized_range_loop(a);
+  }
+
+  this->as.write_label(next_label);
+  this->as.write_cmp(rbx, MemoryReference(rsp, 0x08));
+  this->as.write_jge(end_label);
+  this->as.write_mov(target_mem, rbx);
+  this->as.write_imul(target_register, MemoryReference(rsp, 0x10));
+  this->as.write_add(target_mem, MemoryReference(rsp, 0x18));
+  this->as.write_inc(rbx);
+
+  // the values are direct, so there's no reference to add
+  this->as.write_label(string_printf("__ForStatement_%p_write_value", a));
+  this->target_register = target_register;
+  this->current_type = Variable(ValueType::Int);
+  this->holding_reference = true;
+  a->variable->accept(this);
+
+  this->as.write_label(string_printf("__ForStatement_%p_body", a));
+  this->break_label_stack.emplace_back(break_label);
+  this->continue_label_stack.emplace_back(next_label);
+  this->visit_list(a->items);
+  this->continue_label_stack.pop_back();
+  this->break_label_stack.pop_back();
+  this->as.write_jmp(next_label);
+  this->as.write_label(end_label);
+
+  if (a->else_suite.get()) {
+    a->else_suite->accept(this);
+  }
+
+  this->as.write_label(break_label);
+  this->for_loop_stack.pop_back();
+  this->write_pop(rbx);
+  this->adjust_stack(0x18);
+  this->target_register = target_register;
+}
+
+void CompilationVisitor::write_stdin_lines_for_statement(ForStatement* a) {
+  // this is a loop like `for line in __nemesys__.stdin_lines()`. instead of
+  // reading all of stdin into one list first, we read it in chunks of up to
+  // stdin_lines_chunk_size lines and read the next chunk when the current one
+  // is used up. a chunk with fewer lines than that is the last one. while the
+  // loop runs, the stack looks like it does in a loop over a list:
+  // [rsp+0x00] saved rbx (the index in the current chunk)
+  // [rsp+0x08] the current chunk (List[Unicode])
+  static const int64_t stdin_lines_chunk_size = 0x1000;
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  if (target_register == rbx) {
+    throw compile_error("cannot use rbx as target register for list iteration");
+  }
+
+  this->as.write_label(string_printf("__ForStatement_%p_get_chunk", a));
+  this->as.write_mov(rdi, stdin_lines_chunk_size);
+  this->write_function_call(common_object_reference(void_fn_ptr(&stdin_read_lines)),
+      {rdi, r14}, {}, -1, target_register);
+  this->write_push(target_register);
+  this->write_push(rbx);
+  this->as.write_xor(rbx, rbx);
+  this->for_loop_stack.emplace_back(ForLoopState({this->stack_bytes_used,
+      vector<ValueType>({ValueType::List})}));
+
+  string next_label = string_printf("__ForStatement_%p_next", a);
+  string item_label = string_printf("__ForStatement_%p_get_item", a);
+  string end_label = string_printf("__ForStatement_%p_complete", a);
+  string break_label = string_printf("__ForStatement_%p_broken", a);
+
+  this->as.write_label(next_label);
+  this->as.write_mov(target_mem, MemoryReference(rsp, 8));
+  this->as.write_cmp(rbx, MemoryReference(target_register, 0x10));
+  this->as.write_jl(item_label);
+  this->as.write_cmp(MemoryReference(target_register, 0x10),
+      stdin_lines_chunk_size);
+  this->as.write_jl(end_label);
+  this->write_delete_reference(target_mem, ValueType::List);
+  this->as.write_mov(rdi, stdin_lines_chunk_size);
+  this->write_function_call(common_object_reference(void_fn_ptr(&stdin_read_lines)),
+      {rdi, r14}, {}, -1, target_register);
+  this->as.write_mov(MemoryReference(rsp, 8), target_mem);
+  this->as.write_xor(rbx, rbx);
+  this->as.write_jmp(next_label);
+
+  this->as.write_label(item_label);
+  this->as.write_mov(target_mem, MemoryReference(target_register, 0x28));
+  this->as.write_mov(target_mem, MemoryReference(target_register, 0, rbx, 8));
+  this->as.write_inc(rbx);
+  this->write_add_reference(target_register, ValueType::Unicode);
+
+  this->as.write_label(string_printf("__ForStatement_%p_write_value", a));
+  this->target_register = target_register;
+  this->current_type = Variable(ValueType::Unicode);
+  this->holding_reference = true;
+  a->variable->accept(this);
+
+  this->as.write_label(string_printf("__ForStatement_%p_body", a));
+  this->break_label_stack.emplace_back(break_label);
+  this->continue_label_stack.emplace_back(next_label);
+  this->visit_list(a->items);
+  this->continue_label_stack.pop_back();
+  this->break_label_stack.pop_back();
+  this->as.write_jmp(next_label);
+  this->as.write_label(end_label);
+
+  if (a->else_suite.get()) {
+    a->else_suite->accept(this);
+  }
+
+  this->as.write_label(break_label);
+  this->for_loop_stack.pop_back();
+  this->write_pop(rbx);
+  this->target_register = target_register;
+  this->write_pop(target_register);
+  this->write_delete_reference(target_mem, ValueType::List);
+}
+
+void CompilationVisitor::write_vectorized_range_loop(ForStatement* a) {
+  // this handles loops like `for i in range(n): out[i] = a[i] * k + b[i]`, in
+  // which every statement stores a value into item i of a list of Ints or
+  // Floats, computed only from item i of other lists of the same type and from
+  // values that don't change during the loop. these are computed several items
+  // at a time in xmm (or, with avx2, ymm) registers before the scalar loop
+  // starts. when the vector loop can't continue (there aren't enough items
+  // left for another group, a list is too short, an Int operation overflowed
+  // or involved a promoted value, or a list written by one statement is read
+  // by a later statement under another name), it stops and leaves the rest of the items to the scalar
+  // loop, which raises any exceptions normally. this is called with rbx = 0
+  // and the stack laid out as in write_range_for_statement. nothing else in
+  // the loop can refer to a list's item storage, so accesses through two lists
+  // can only overlap if they're the same list (aliasing)
+  if (debug_flags & DebugFlag::NoVectorization) {
+    return;
+  }
+
+  AttributeLValueReference* index_variable =
+      dynamic_cast<AttributeLValueReference*>(a->variable.get());
+  if (!index_variable || index_variable->base.get() || a->items.empty()) {
+    return;
+  }
+  const string& index_name = index_variable->name;
+  VariableLocation index_loc = this->location_for_variable(index_name);
+  if (index_loc.type.type != ValueType::Int) {
+    return;
+  }
+
+  // find the lists written by the loop body, which must all have the same
+  // item type
+  struct VectorStatement {
+    string list_name;
+    Expression* value;
+    unordered_set<string> read_list_names;
+  };
+  vector<VectorStatement> statements;
+  map<string, VariableLocation> lists;
+  ValueType lane_type = ValueType::Indeterminate;
+  auto add_list = [&](const string& name) -> bool {
+    if (name == index_name) {
+      return false;
+    }
+    VariableLocation loc = this->location_for_variable(name);
+    if ((loc.type.type != ValueType::List) || loc.type.extension_types.empty()) {
+      return false;
+    }
+    ValueType item_type = loc.type.extension_types[0].type;
+    if ((item_type != ValueType::Int) && (item_type != ValueType::Float)) {
+      return false;
+    }
+    if (lane_type == ValueType::Indeterminate) {
+      lane_type = item_type;
+    } else if (item_type != lane_type) {
+      return false;
+    }
+    lists.emplace(name, loc);
+    return true;
+  };
+  for (const auto& item : a->items) {
+    AssignmentStatement* assignment = dynamic_cast<AssignmentStatement*>(item.get());
+    if (!assignment) {
+      return;
+    }
+    ArrayIndexLValueReference* target = dynamic_cast<ArrayIndexLValueReference*>(
+        assignment->target.get());
+    if (!target) {
+      return;
+    }
+    VariableLookup* list_lookup = dynamic_cast<VariableLookup*>(target->array.get());
+    VariableLookup* index_lookup = dynamic_cast<VariableLookup*>(target->index.get());
+    if (!list_lookup || !index_lookup || (index_lookup->name != index_name) ||
+        !add_list(list_lookup->name)) {
+      return;
+    }
+    for (const auto& statement : statements) {
+      if (statement.list_name == list_lookup->name) {
+        return;
+      }
+    }
+    statements.emplace_back(VectorStatement({list_lookup->name,
+        assignment->value.get(), {}}));
+  }
+
+  // check the values and estimate how many xmm registers they need. each
+  // loop-invariant value is loaded into both lanes of its own register before
+  // the loop starts; Int values in Float loops are converted there too, so
+  // Float operations must have at least one Float operand (as in cpython,
+  // where an operation on two Ints is done before converting to Float)
+  struct ExpressionInfo {
+    ValueType type;
+    size_t registers;
+  };
+  static const ExpressionInfo invalid_info({ValueType::Indeterminate, 0});
+  map<string, VariableLocation> invariant_variables;
+  vector<Expression*> invariant_constants;
+  bool uses_sign_mask = false;
+  bool uses_overflow_mask = false;
+  VectorStatement* current_statement = NULL;
+  function<ExpressionInfo(Expression*)> check_expression = [&](
+      Expression* e) -> ExpressionInfo {
+    ArrayIndex* array_index = dynamic_cast<ArrayIndex*>(e);
+    if (array_index) {
+      VariableLookup* list_lookup = dynamic_cast<VariableLookup*>(
+          array_index->array.get());
+      VariableLookup* index_lookup = dynamic_cast<VariableLookup*>(
+          array_index->index.get());
+      if (!list_lookup || !index_lookup || (index_lookup->name != index_name) ||
+          !add_list(list_lookup->name)) {
+        return invalid_info;
+      }
+      current_statement->read_list_names.emplace(list_lookup->name);
+      // Int items need another register for the direct check (see below)
+      return ExpressionInfo({lane_type,
+          static_cast<size_t>((lane_type == ValueType::Int) ? 2 : 1)});
+    }
+
+    VariableLookup* lookup = dynamic_cast<VariableLookup*>(e);
+    if (lookup) {
+      if (lookup->name == index_name) {
+        return invalid_info;
+      }
+      VariableLocation loc = this->location_for_variable(lookup->name);
+      if ((loc.type.type != ValueType::Int) && (loc.type.type != ValueType::Float)) {
+        return invalid_info;
+      }
+      if ((loc.type.type == ValueType::Float) && (lane_type != ValueType::Float)) {
+        return invalid_info;
+      }
+      invariant_variables.emplace(lookup->name, loc);
+      return ExpressionInfo({loc.type.type, 1});
+    }
+
+    IntegerConstant* int_constant = dynamic_cast<IntegerConstant*>(e);
+    if (int_constant) {
+      if (!int_is_direct(int_constant->value)) {
+        return invalid_info;
+      }
+      invariant_constants.emplace_back(e);
+      return ExpressionInfo({ValueType::Int, 1});
+    }
+    if (dynamic_cast<FloatConstant*>(e)) {
+      if (lane_type != ValueType::Float) {
+        return invalid_info;
+      }
+      invariant_constants.emplace_back(e);
+      return ExpressionInfo({ValueType::Float, 1});
+    }
+
+    // operations in Float loops can't have an Int result (see above)
+    UnaryOperation* unary = dynamic_cast<UnaryOperation*>(e);
+    if (unary) {
+      if ((unary->oper != UnaryOperator::Negative) &&
+          (unary->oper != UnaryOperator::Positive)) {
+        return invalid_info;
+      }
+      ExpressionInfo info = check_expression(unary->expr.get());
+      if (info.type != lane_type) {
+        return invalid_info;
+      }
+      if (unary->oper == UnaryOperator::Negative) {
+        if (lane_type == ValueType::Float) {
+          uses_sign_mask = true;
+        } else {
+          uses_overflow_mask = true;
+        }
+      }
+      return ExpressionInfo({lane_type, info.registers + 1});
+    }
+
+    // Int operations need up to two registers beyond their operands for the
+    // overflow check
+    BinaryOperation* binary = dynamic_cast<BinaryOperation*>(e);
+    if (binary) {
+      ExpressionInfo left_info = check_expression(binary->left.get());
+      ExpressionInfo right_info = check_expression(binary->right.get());
+      if ((left_info.type == ValueType::Indeterminate) ||
+          (right_info.type == ValueType::Indeterminate)) {
+        return invalid_info;
+      }
+      if (lane_type == ValueType::Float) {
+        if (!is_float_arithmetic_operator(binary->oper) ||
+            ((left_info.type != ValueType::Float) &&
+             (right_info.type != ValueType::Float))) {
+          return invalid_info;
+        }
+      } else {
+        if ((binary->oper == BinaryOperator::Addition) ||
+            (binary->oper == BinaryOperator::Subtraction)) {
+          uses_overflow_mask = true;
+        } else if ((binary->oper != BinaryOperator::And) &&
+                   (binary->oper != BinaryOperator::Or) &&
+                   (binary->oper != BinaryOperator::Xor)) {
+          return invalid_info;
+        }
+      }
+      return ExpressionInfo({lane_type, max<size_t>(left_info.registers,
+          right_info.registers + 1) + 2});
+    }
+
+    return invalid_info;
+  };
+
+  // Int values written to the lists are checked like the items read from
+  // them, which also uses the overflow mask and another register
+  bool int_lanes = (lane_type == ValueType::Int);
+  size_t statement_registers = 0;
+  for (size_t x = 0; x < statements.size(); x++) {
+    current_statement = &statements[x];
+    ExpressionInfo info = check_expression(statements[x].value);
+    if (info.type != lane_type) {
+      return;
+    }
+    statement_registers = max<size_t>(statement_registers,
+        x + info.registers + int_lanes);
+  }
+  uses_overflow_mask |= int_lanes;
+  size_t float_registers_needed = invariant_variables.size() +
+      invariant_constants.size() + uses_sign_mask + uses_overflow_mask +
+      statement_registers;
+  if (float_registers_needed > 16) {
+    return;
+  }
+
+  // if a list written by one statement is read by a later one, the vector
+  // loop would read the old values; this can only be done by the scalar loop.
+  // if the names differ, the lists might still be the same object, which we
+  // have to check at runtime
+  vector<pair<string, string>> alias_checks;
+  for (size_t x = 0; x < statements.size(); x++) {
+    for (size_t y = x + 1; y < statements.size(); y++) {
+      for (const string& read_list_name : statements[y].read_list_names) {
+        if (read_list_name == statements[x].list_name) {
+          return;
+        }
+        alias_checks.emplace_back(statements[x].list_name, read_list_name);
+      }
+    }
+  }
+
+  // we need a register for each list's items pointer, plus a temporary
+  size_t available_int_registers = 0;
+  for (Register r = rax; r <= r15; r = static_cast<Register>(r + 1)) {
+    available_int_registers += this->register_is_available(r, false);
+  }
+  if (lists.size() + 1 > available_int_registers) {
+    return;
+  }
+
+  // with avx2, use ymm registers (four items at a time) instead of xmm
+  bool wide = target_cpu_features().avx2;
+  int64_t lane_count = wide ? 4 : 2;
+
+  string label_prefix = string_printf("__ForStatement_%p_vector", a);
+  string next_label = label_prefix + "_next";
+  string done_label = label_prefix + "_done";
+  MemoryReference count_mem(rsp, 0x08);
+  Register tmp = this->reserve_register(this->available_register());
+  MemoryReference tmp_mem(tmp);
+
+  // all the lists must have enough items for the entire range
+  this->as.write_label(label_prefix + "_check");
+  for (const auto& it : lists) {
+    this->as.write_mov(tmp_mem, it.second.mem);
+    this->as.write_mov(tmp_mem, MemoryReference(tmp, 0x10));
+    this->as.write_cmp(tmp_mem, count_mem);
+    this->as.write_jl(done_label);
+  }
+  for (const auto& check : alias_checks) {
+    this->as.write_mov(tmp_mem, lists.at(check.first).mem);
+    this->as.write_cmp(tmp_mem, lists.at(check.second).mem);
+    this->as.write_je(done_label);
+  }
+
+  // get the lists' item pointers and the invariant values
+  this->as.write_label(label_prefix + "_setup");
+  unordered_map<string, Register> items_registers;
+  for (const auto& it : lists) {
+    Register r = this->reserve_register(this->available_register());
+    items_registers.emplace(it.first, r);
+    this->as.write_mov(MemoryReference(r), it.second.mem);
+    this->as.write_mov(MemoryReference(r), MemoryReference(r, 0x28));
+  }
+
+  vector<Register> float_registers_to_release;
+  auto new_float_register = [&]() -> Register {
+    return this->reserve_register(this->available_register(Register::None, true),
+        true);
+  };
+
+  // writes to = src1 op src2. the SSE2 opcodes overwrite their first operand,
+  // so src1 is copied to to first if they differ (to must not be src2 then)
+  typedef void (AMD64Assembler::*SSEOpcodeWriter)(Register,
+      const MemoryReference&);
+  typedef void (AMD64Assembler::*AVXOpcodeWriter)(Register, Register,
+      const MemoryReference&, bool);
+  auto write_packed = [&](SSEOpcodeWriter sse_writer, AVXOpcodeWriter avx_writer,
+      Register to, Register src1, Register src2) {
+    if (wide) {
+      (this->as.*avx_writer)(to, src1, MemoryReference(src2), true);
+    } else {
+      if (to != src1) {
+        this->as.write_movupd(MemoryReference(to), MemoryReference(src1));
+      }
+      (this->as.*sse_writer)(to, MemoryReference(src2));
+    }
+  };
+  auto write_packed_move = [&](const MemoryReference& to,
+      const MemoryReference& from) {
+    if (wide) {
+      this->as.write_vmovupd(to, from);
+    } else {
+      this->as.write_movupd(to, from);
+    }
+  };
+  auto write_broadcast = [&](Register r) {
+    if (wide) {
+      this->as.write_vbroadcastsd(r, MemoryReference(r));
+    } else {
+      this->as.write_unpcklpd(r, MemoryReference(r));
+    }
+  };
+
+  // promoted Int variables (see Types/Int.hh) are left to the scalar loop
+  unordered_map<string, Register> invariant_variable_registers;
+  for (const auto& it : invariant_variables) {
+    if (it.second.type.type == ValueType::Int) {
+      this->write_jump_if_promoted(tmp, it.second.mem, done_label);
+    }
+    Register r = new_float_register();
+    float_registers_to_release.emplace_back(r);
+    invariant_variable_registers.emplace(it.first, r);
+    if ((it.second.type.type == ValueType::Int) &&
+        (lane_type == ValueType::Float)) {
+      this->as.write_cvtsi2sd(r, it.second.mem);
+    } else {
+      this->as.write_movq_to_xmm(r, it.second.mem);
+    }
+    write_broadcast(r);
+  }
+
+  unordered_map<Expression*, Register> invariant_constant_registers;
+  for (Expression* e : invariant_constants) {
+    Register r = new_float_register();
+    float_registers_to_release.emplace_back(r);
+    invariant_constant_registers.emplace(e, r);
+    IntegerConstant* int_constant = dynamic_cast<IntegerConstant*>(e);
+    if (int_constant && (lane_type == ValueType::Int)) {
+      this->as.write_mov(tmp, int_constant->value);
+      this->as.write_movq_to_xmm(r, tmp_mem);
+    } else if (int_constant) {
+      this->write_load_double(r, int_constant->value);
+    } else {
+      this->write_load_double(r, static_cast<FloatConstant*>(e)->value);
+    }
+    write_broadcast(r);
+  }
+
+  Register sign_mask = Register::None;
+  if (uses_sign_mask) {
+    sign_mask = new_float_register();
+    float_registers_to_release.emplace_back(sign_mask);
+    this->write_load_double(sign_mask, -0.0);
+    write_broadcast(sign_mask);
+  }
+
+  // Int overflows are detected for all lanes at once: the sign bit of each
+  // lane of the overflow mask is set if any operation in that lane overflowed
+  Register overflow_mask = Register::None;
+  if (uses_overflow_mask) {
+    overflow_mask = new_float_register();
+    float_registers_to_release.emplace_back(overflow_mask);
+  }
+
+  // the items read and the values written must also be direct. bits 63 and
+  // 62 of a direct value are the same, so the sign bit of v ^ (v + v) is set
+  // if v isn't direct. if all the items are direct and no operation
+  // overflowed, the 64-bit results are exact, so intermediate values don't
+  // have to be checked
+  auto write_direct_check = [&](Register value) {
+    Register check = new_float_register();
+    write_packed(&AMD64Assembler::write_paddq, &AMD64Assembler::write_vpaddq,
+        check, value, value);
+    write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+        check, check, value);
+    write_packed(&AMD64Assembler::write_por, &AMD64Assembler::write_vpor,
+        overflow_mask, overflow_mask, check);
+    this->release_register(check, true);
+  };
+
+  // computes a value into a register. the returned register is owned (and can
+  // be overwritten) if the bool is true; otherwise it's an invariant value
+  function<pair<Register, bool>(Expression*)> write_vector_expression = [&](
+      Expression* e) -> pair<Register, bool> {
+    ArrayIndex* array_index = dynamic_cast<ArrayIndex*>(e);
+    if (array_index) {
+      Register items_register = items_registers.at(
+          static_cast<VariableLookup*>(array_index->array.get())->name);
+      Register r = new_float_register();
+      write_packed_move(MemoryReference(r),
+          MemoryReference(items_register, 0, rbx, 8));
+      if (int_lanes) {
+        write_direct_check(r);
+      }
+      return make_pair(r, true);
+    }
+
+    VariableLookup* lookup = dynamic_cast<VariableLookup*>(e);
+    if (lookup) {
+      return make_pair(invariant_variable_registers.at(lookup->name), false);
+    }
+    if (dynamic_cast<IntegerConstant*>(e) || dynamic_cast<FloatConstant*>(e)) {
+      return make_pair(invariant_constant_registers.at(e), false);
+    }
+
+    // returns a register that can hold the result of an operation on the
+    // given value (its own register, if it's owned)
+    auto result_register_for = [&](const pair<Register, bool>& value) -> Register {
+      return value.second ? value.first : new_float_register();
+    };
+    auto release = [&](Register r) {
+      this->release_register(r, true);
+    };
+
+    UnaryOperation* unary = dynamic_cast<UnaryOperation*>(e);
+    if (unary) {
+      auto value = write_vector_expression(unary->expr.get());
+      if (unary->oper == UnaryOperator::Positive) {
+        return value;
+      }
+      if (lane_type == ValueType::Float) {
+        Register r = result_register_for(value);
+        write_packed(&AMD64Assembler::write_xorpd, &AMD64Assembler::write_vxorpd,
+            r, value.first, sign_mask);
+        return make_pair(r, true);
+      }
+
+      // -x overflows only if x and -x are both negative
+      Register r = new_float_register();
+      write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+          r, r, r);
+      write_packed(&AMD64Assembler::write_psubq, &AMD64Assembler::write_vpsubq,
+          r, r, value.first);
+      Register check = result_register_for(value);
+      write_packed(&AMD64Assembler::write_pand, &AMD64Assembler::write_vpand,
+          check, value.first, r);
+      write_packed(&AMD64Assembler::write_por, &AMD64Assembler::write_vpor,
+          overflow_mask, overflow_mask, check);
+      release(check);
+      return make_pair(r, true);
+    }
+
+    BinaryOperation* binary = static_cast<BinaryOperation*>(e);
+    auto left = write_vector_expression(binary->left.get());
+    auto right = write_vector_expression(binary->right.get());
+
+    if ((lane_type == ValueType::Int) &&
+        ((binary->oper == BinaryOperator::Addition) ||
+         (binary->oper == BinaryOperator::Subtraction))) {
+      // l + r overflows if the result's sign differs from both operands' signs;
+      // l - r overflows if the operands' signs differ and the result's sign
+      // differs from l's sign
+      Register r = new_float_register();
+      if (binary->oper == BinaryOperator::Addition) {
+        write_packed(&AMD64Assembler::write_paddq, &AMD64Assembler::write_vpaddq,
+            r, left.first, right.first);
+      } else {
+        write_packed(&AMD64Assembler::write_psubq, &AMD64Assembler::write_vpsubq,
+            r, left.first, right.first);
+      }
+      Register left_check = result_register_for(left);
+      Register right_check = result_register_for(right);
+      if (binary->oper == BinaryOperator::Addition) {
+        write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+            left_check, left.first, r);
+        write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+            right_check, right.first, r);
+      } else {
+        write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+            right_check, right.first, left.first);
+        write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+            left_check, left.first, r);
+      }
+      write_packed(&AMD64Assembler::write_pand, &AMD64Assembler::write_vpand,
+          left_check, left_check, right_check);
+      write_packed(&AMD64Assembler::write_por, &AMD64Assembler::write_vpor,
+          overflow_mask, overflow_mask, left_check);
+      release(left_check);
+      release(right_check);
+      return make_pair(r, true);
+    }
+
+    SSEOpcodeWriter sse_writer;
+    AVXOpcodeWriter avx_writer;
+    switch (binary->oper) {
+      case BinaryOperator::Addition:
+        sse_writer = &AMD64Assembler::write_addpd;
+        avx_writer = &AMD64Assembler::write_vaddpd;
+        break;
+      case BinaryOperator::Subtraction:
+        sse_writer = &AMD64Assembler::write_subpd;
+        avx_writer = &AMD64Assembler::write_vsubpd;
+        break;
+      case BinaryOperator::Multiplication:
+        sse_writer = &AMD64Assembler::write_mulpd;
+        avx_writer = &AMD64Assembler::write_vmulpd;
+        break;
+      case BinaryOperator::Division:
+        sse_writer = &AMD64Assembler::write_divpd;
+        avx_writer = &AMD64Assembler::write_vdivpd;
+        break;
+      case BinaryOperator::And:
+        sse_writer = &AMD64Assembler::write_pand;
+        avx_writer = &AMD64Assembler::write_vpand;
+        break;
+      case BinaryOperator::Or:
+        sse_writer = &AMD64Assembler::write_por;
+        avx_writer = &AMD64Assembler::write_vpor;
+        break;
+      case BinaryOperator::Xor:
+        sse_writer = &AMD64Assembler::write_pxor;
+        avx_writer = &AMD64Assembler::write_vpxor;
+        break;
+      default:
+        throw compile_error("unsupported vector operation", this->file_offset);
+    }
+    Register r = result_register_for(left);
+    write_packed(sse_writer, avx_writer, r, left.first, right.first);
+    if (right.second) {
+      release(right.first);
+    }
+    return make_pair(r, true);
+  };
+
+  // compute all the values for a group of items, then store them all
+  this->as.write_label(next_label);
+  this->as.write_lea(tmp, MemoryReference(rbx, lane_count));
+  this->as.write_cmp(tmp_mem, count_mem);
+  this->as.write_jg(done_label);
+  if (uses_overflow_mask) {
+    write_packed(&AMD64Assembler::write_pxor, &AMD64Assembler::write_vpxor,
+        overflow_mask, overflow_mask, overflow_mask);
+  }
+  // the items being overwritten are checked too, since promoted ones have to
+  // be released; the scalar loop does that
+  if (int_lanes) {
+    for (const auto& statement : statements) {
+      Register r = new_float_register();
+      write_packed_move(MemoryReference(r), MemoryReference(items_registers.at(
+          statement.list_name), 0, rbx, 8));
+      write_direct_check(r);
+      this->release_register(r, true);
+    }
+  }
+  vector<pair<Register, bool>> values;
+  for (const auto& statement : statements) {
+    values.emplace_back(write_vector_expression(statement.value));
+    if (int_lanes) {
+      write_direct_check(values.back().first);
+    }
+  }
+  if (uses_overflow_mask) {
+    if (wide) {
+      this->as.write_vmovmskpd(tmp, overflow_mask);
+    } else {
+      this->as.write_movmskpd(tmp, overflow_mask);
+    }
+    this->as.write_test(tmp_mem, tmp_mem);
+    this->as.write_jnz(done_label);
+  }
+  for (size_t x = 0; x < statements.size(); x++) {
+    write_packed_move(MemoryReference(items_registers.at(
+        statements[x].list_name), 0, rbx, 8), MemoryReference(values[x].first));
+    if (values[x].second) {
+      this->release_register(values[x].first, true);
+    }
+  }
+  this->as.write_add(rbx, lane_count);
+  this->as.write_jmp(next_label);
+
+  // the loop variable has the value from the last item done (if any); the
+  // scalar loop continues from rbx
+  this->as.write_label(done_label);
+  if (wide) {
+    this->as.write_vzeroupper();
+  }
+  this->as.write_test(rbx, rbx);
+  this->as.write_jz(label_prefix + "_complete");
+  this->as.write_lea(tmp, MemoryReference(rbx, -1));
+  this->as.write_mov(index_loc.mem, tmp_mem);
+  this->as.write_label(label_prefix + "_complete");
+
+  for (Register r : float_registers_to_release) {
+    this->release_register(r, true);
+  }
+  for (const auto& it : items_registers) {
+    this->release_register(it.second);
+  }
+  this->release_register(tmp);
+}
+
+void CompilationVisitor::write_fused_for_statement(ForStatement* a) {
+  // this is a loop like `for i, x in enumerate(l)` or `for x, y in zip(l1, l2)`
+  // (see AnalysisVisitor::visit(ForStatement*)). instead of calling the
+  // function and unpacking a tuple for each item, we iterate over the sources
+  // in lockstep, using rbx as the index for all of them, and write each item
+  // directly to its variable. while the loop runs, the stack looks like this:
+  // [rsp+0x00] saved rbx
+  // [rsp+0x08] enumerate() start value, or the last zip() source
+  // ...        the other zip() sources, in reverse order
+  // for enumerate(), the only source is right after the start value
+  FunctionCall* call = static_cast<FunctionCall*>(a->collection.get());
+  TupleLValueReference* targets = static_cast<TupleLValueReference*>(
+      a->variable.get());
+  bool is_enumerate = (call->callee_function_id == enumerate_function_id);
+  size_t num_sources = is_enumerate ? 1 : call->args.size();
+
+  Register target_register = this->target_register;
+  MemoryReference target_mem(target_register);
+  if (target_register == rbx) {
+    throw compile_error("cannot use rbx as target register for list iteration");
+  }
 
-    int64_t previously_reserved_registers = this->write_push_reserved_registers();
+  // get the sources and save them on the stack
+  vector<Variable> item_types;
+  vector<ValueType> slot_types;
+  for (size_t x = 0; x < num_sources; x++) {
+    this->as.write_label(string_printf("__ForStatement_%p_get_source_%zu", a, x));
+    this->target_register = target_register;
+    call->args[x]->accept(this);
+    const Variable& source_type = this->current_type;
+    if ((source_type.type != ValueType::List) &&
+        (source_type.type != ValueType::Tuple)) {
+      throw compile_error("unpacked iteration not implemented for " +
+          source_type.str(), this->file_offset);
+    }
+    if (source_type.extension_types.empty()) {
+      throw compile_error("iteration source has unknown item type",
+          this->file_offset);
+    }
+    for (const Variable& extension_type : source_type.extension_types) {
+      if (source_type.extension_types[0] != extension_type) {
+        string uniform_str = source_type.extension_types[0].str();
+        string other_str = extension_type.str();
+        throw compile_error(string_printf(
+            "can\'t iterate over Tuple with disparate types (contains %s and %s)",
+            uniform_str.c_str(), other_str.c_str()), this->file_offset);
+      }
+    }
+    item_types.emplace_back(source_type.extension_types[0]);
+    slot_types.emplace(slot_types.begin(), source_type.type);
+    this->write_push(target_register);
+  }
 
-    // create a SlotContents structure
-    // TODO: figure out how this structure interacts with refcounting and
-    // exceptions (or if it does at all)
-    this->adjust_stack(-sizeof(DictionaryObject::SlotContents));
-    this->as.write_mov(MemoryReference(rsp, 0), 0);
-    this->as.write_mov(MemoryReference(rsp, 8), 0);
-    this->as.write_mov(MemoryReference(rsp, 16), 0);
+  if (is_enumerate) {
+    this->as.write_label(string_printf("__ForStatement_%p_get_start", a));
+    if (call->args.size() == 2) {
+      this->target_register = target_register;
+      call->args[1]->accept(this);
+      if (this->current_type.type != ValueType::Int) {
+        throw compile_error("enumerate start must be Int; here it\'s " +
+            this->current_type.str(), this->file_offset);
+      }
+      // as with range(), the indexes are direct; a promoted start raises
+      // OverflowError
+      this->write_jump_if_promoted(
+          this->available_register_except({target_register}),
+          MemoryReference(target_register), this->overflow_stub_label());
+      this->write_push(target_register);
+    } else {
+      this->write_push(0);
+    }
+    item_types.emplace(item_types.begin(), ValueType::Int);
+    slot_types.emplace(slot_types.begin(), ValueType::None);
+  }
 
-    // get the dict object and SlotContents pointer
-    this->as.write_label(next_label);
-    this->as.write_mov(rdi, MemoryReference(rsp,
-        sizeof(DictionaryObject::SlotContents)));
-    this->as.write_mov(rsi, rsp);
+  this->write_push(rbx);
+  this->as.write_xor(rbx, rbx);
+  this->for_loop_stack.emplace_back(ForLoopState({this->stack_bytes_used,
+      slot_types}));
+  this->target_register = target_register;
 
-    // call dictionary_next_item
-    this->write_add_reference(rdi);
-    this->write_function_call(
-        common_object_reference(void_fn_ptr(&dictionary_next_item)), {rdi, rsi}, {});
+  string next_label = string_printf("__ForStatement_%p_next", a);
+  string end_label = string_printf("__ForStatement_%p_complete", a);
+  string break_label = string_printf("__ForStatement_%p_broken", a);
 
-    // if dictionary_next_item returned 0, then we're done
-    this->as.write_test(rax, rax);
-    this->as.write_je(end_label);
+  // stop when any source runs out of items
+  this->as.write_label(next_label);
+  for (size_t x = 0; x < num_sources; x++) {
+    this->as.write_mov(target_mem,
+        MemoryReference(rsp, (slot_types.size() - x) * sizeof(int64_t)));
+    this->as.write_cmp(rbx, MemoryReference(target_register, 0x10));
+    this->as.write_jge(end_label);
+  }
 
-    // get the key pointer
-    this->as.write_mov(MemoryReference(this->target_register),
-        MemoryReference(rsp, 0));
+  // write the items to their variables
+  for (size_t x = 0; x < item_types.size(); x++) {
+    this->as.write_label(string_printf("__ForStatement_%p_write_value_%zu", a, x));
+    if (is_enumerate && (x == 0)) {
+      this->as.write_mov(target_mem, MemoryReference(rsp, 8));
+      this->as.write_add(target_mem, MemoryReference(rbx));
+      this->write_jump_if_promoted(
+          this->available_register_except({target_register}), target_mem,
+          this->overflow_stub_label());
 
-    // if the extension type has a refcount, add a reference
-    if (type_has_refcount(collection_type.extension_types[0].type)) {
-      this->write_add_reference(this->target_register);
+    } else {
+      size_t source_index = is_enumerate ? 0 : x;
+      ValueType source_type = slot_types[slot_types.size() - 1 - source_index];
+      ValueType item_type = item_types[x].type;
+      this->as.write_mov(target_mem, MemoryReference(rsp,
+          (slot_types.size() - source_index) * sizeof(int64_t)));
+      int64_t items_offset = 0x18;
+      if (source_type == ValueType::List) {
+        this->as.write_mov(target_mem, MemoryReference(target_register, 0x28));
+        items_offset = 0;
+      }
+      if (item_type == ValueType::Float) {
+        this->as.write_movq_to_xmm(this->float_target_register,
+            MemoryReference(target_register, items_offset, rbx, 8));
+      } else {
+        this->as.write_mov(target_mem,
+            MemoryReference(target_register, items_offset, rbx, 8));
+      }
+      if (type_has_refcount(item_type)) {
+        this->write_add_reference(target_register, item_type);
+      }
     }
 
-    // load the value into the correct local variable slot
-    this->as.write_label(string_printf("__ForStatement_%p_write_key_value", a));
-    this->current_type = collection_type.extension_types[0];
-    a->variable->accept(this);
-
-    // do the loop body
-    this->as.write_label(string_printf("__ForStatement_%p_body", a));
-    this->break_label_stack.emplace_back(break_label);
-    this->continue_label_stack.emplace_back(next_label);
-    this->visit_list(a->items);
-    this->continue_label_stack.pop_back();
-    this->break_label_stack.pop_back();
-    this->as.write_jmp(next_label);
-    this->as.write_label(end_label);
-
-    // clean up the stack
-    this->adjust_stack(sizeof(DictionaryObject::SlotContents));
-    this->write_pop_reserved_registers(previously_reserved_registers);
-
-  } else {
-    throw compile_error("iteration not implemented for " + collection_type.str(),
-        this->file_offset);
+    this->current_type = item_types[x];
+    this->holding_reference = type_has_refcount(item_types[x].type);
+    targets->items[x]->accept(this);
+    this->target_register = target_register;
   }
+  this->as.write_inc(rbx);
+
+  // do the loop body
+  this->as.write_label(string_printf("__ForStatement_%p_body", a));
+  this->break_label_stack.emplace_back(break_label);
+  this->continue_label_stack.emplace_back(next_label);
+  this->visit_list(a->items);
+  this->continue_label_stack.pop_back();
+  this->break_label_stack.pop_back();
+  this->as.write_jmp(next_label);
+  this->as.write_label(end_label);
 
-  // if there's an else statement, generate the body here
   if (a->else_suite.get()) {
     a->else_suite->accept(this);
   }
 
-  // any break statement will jump over the loop body and the else statement
   this->as.write_label(break_label);
-
-  // restore rbx
+  this->for_loop_stack.pop_back();
   this->write_pop(rbx);
 
-  // we still own a reference to the collection; destroy it now
-  // note: all collection types have refcounts; dunno why I bothered checking
-  if (type_has_refcount(collection_type.type)) {
-    this->write_pop(this->target_register);
-    this->write_delete_reference(MemoryReference(this->target_register),
-        collection_type.type);
-  } else {
-    this->as.write_add(rsp, 8);
+  // release the sources
+  this->target_register = target_register;
+  for (ValueType slot_type : slot_types) {
+    if (type_has_refcount(slot_type)) {
+      this->write_pop(target_register);
+      this->write_delete_reference(target_mem, slot_type);
+    } else {
+      this->adjust_stack(8);
+    }
   }
 }
 
@@ -3094,7 +6066,7 @@ void CompilationVisitor::visit(FunctionDefinition* a) {
     if (!type_has_refcount(loc.type.type)) {
       throw compile_error("self is not an object", this->file_offset);
     }
-    this->write_add_reference(this->target_register);
+    this->write_add_reference(this->target_register, loc.type.type);
   }
 
   this->write_function_cleanup(base_label);
@@ -3218,10 +6190,12 @@ void CompilationVisitor::visit(ClassDefinition* a) {
               attr_name.c_str()));
 
           // if inline refcounting is disabled, call delete_reference manually
+          bool is_int = (attr.type == ValueType::Int);
           if (debug_flags & DebugFlag::NoInlineRefcounting) {
             dtor_as.write_mov(rdi, MemoryReference(rbx, offset));
             dtor_as.write_mov(rsi, r14);
-            dtor_as.write_call(common_object_reference(void_fn_ptr(&delete_reference)));
+            dtor_as.write_call(common_object_reference(is_int ?
+                void_fn_ptr(&int_delete_reference) : void_fn_ptr(&delete_reference)));
 
           } else {
             string skip_label = string_printf(
@@ -3230,9 +6204,18 @@ void CompilationVisitor::visit(ClassDefinition* a) {
             // get the object pointer
             dtor_as.write_mov(rdi, MemoryReference(rbx, offset));
 
-            // if the pointer is NULL, do nothing
-            dtor_as.write_test(rdi, rdi);
-            dtor_as.write_je(skip_label);
+            // if the pointer is NULL (or the Int isn't promoted), do nothing.
+            // this is the same as write_get_promoted_int_object
+            if (is_int) {
+              dtor_as.write_add(rdi, rdi);
+              dtor_as.write_jno(skip_label);
+              dtor_as.write_jns(skip_label);
+              dtor_as.write_shl(rdi, 1);
+              dtor_as.write_shr(rdi, 2);
+            } else {
+              dtor_as.write_test(rdi, rdi);
+              dtor_as.write_je(skip_label);
+            }
 
             // decrement the refcount; if it's not zero, skip the destructor call
             dtor_as.write_lock();
@@ -3298,15 +6281,25 @@ void CompilationVisitor::write_code_for_value(const Variable& value) {
     case ValueType::None:
       this->as.write_xor(MemoryReference(this->target_register),
           MemoryReference(this->target_register));
+      this->holding_reference = false;
       break;
 
     case ValueType::Bool:
+      this->as.write_mov(this->target_register, value.int_value);
+      this->holding_reference = false;
+      break;
+
     case ValueType::Int:
       this->as.write_mov(this->target_register, value.int_value);
+      if (int_is_promoted(value.int_value)) {
+        this->write_add_reference(this->target_register, value.type);
+      }
+      this->holding_reference = true;
       break;
 
     case ValueType::Float:
       this->write_load_double(this->float_target_register, value.float_value);
+      this->holding_reference = false;
       break;
 
     case ValueType::Bytes:
@@ -3315,7 +6308,7 @@ void CompilationVisitor::write_code_for_value(const Variable& value) {
           void_fn_ptr(this->global->get_or_create_constant(*value.bytes_value)) :
           void_fn_ptr(this->global->get_or_create_constant(*value.unicode_value));
       this->as.write_mov(this->target_register, reinterpret_cast<int64_t>(o));
-      this->write_add_reference(this->target_register);
+      this->write_add_reference(this->target_register, value.type);
       this->holding_reference = true;
       break;
     }
@@ -3372,14 +6365,14 @@ void CompilationVisitor::write_function_call(
         this->file_offset);
   }
 
+  // if any of the references are memory references based on RSP, we'll have
+  // to adjust them for the saved registers and the argument stack space
+  ssize_t stack_bytes_before_call = this->stack_bytes_used;
   int64_t previously_reserved_registers = this->write_push_reserved_registers();
-
-  size_t rsp_adjustment = 0;
+  size_t rsp_adjustment = this->stack_bytes_used - stack_bytes_before_call;
   if (arg_stack_bytes < 0) {
     arg_stack_bytes = this->write_function_call_stack_prep(int_args.size());
-    // if any of the references are memory references based on RSP, we'll have
-    // to adjust them
-    rsp_adjustment = arg_stack_bytes;
+    rsp_adjustment += arg_stack_bytes;
   }
 
   // generate the list of move destinations
@@ -3497,6 +6490,383 @@ void CompilationVisitor::write_function_call(
   this->write_pop_reserved_registers(previously_reserved_registers);
 }
 
+void CompilationVisitor::write_print_call(FunctionCall* a) {
+  if (a->varargs.get() || a->varkwargs.get()) {
+    throw compile_error("variadic function calls not supported", this->file_offset);
+  }
+
+  // like python, evaluate all the arguments before writing anything. each
+  // value is pushed onto the stack; the sep and end arguments go after the
+  // positional arguments
+  vector<shared_ptr<Expression>> arg_exprs = a->args;
+  shared_ptr<Expression> sep_expr, end_expr;
+  for (const auto& it : a->kwargs) {
+    if (it.first == "sep") {
+      sep_expr = it.second;
+    } else if (it.first == "end") {
+      end_expr = it.second;
+    } else {
+      throw compile_error("print() does not support keyword argument " + it.first,
+          this->file_offset);
+    }
+  }
+  size_t positional_count = arg_exprs.size();
+  arg_exprs.emplace_back(sep_expr);
+  arg_exprs.emplace_back(end_expr);
+
+  vector<Variable> arg_types;
+  for (size_t x = 0; x < arg_exprs.size(); x++) {
+    if (!arg_exprs[x].get()) {
+      arg_types.emplace_back(ValueType::None);
+      this->write_push(0);
+      continue;
+    }
+
+    this->as.write_label(string_printf("__FunctionCall_%p_print_evaluate_arg_%zu",
+        a, x));
+    arg_exprs[x]->accept(this);
+    if (type_has_refcount(this->current_type.type) && !this->holding_reference) {
+      throw compile_error(string_printf(
+          "function call argument %zu is a non-held reference", x),
+          this->file_offset);
+    }
+    if ((x >= positional_count) && (this->current_type.type != ValueType::None) &&
+        (this->current_type.type != ValueType::Unicode)) {
+      throw compile_error("print() sep and end must be Unicode or None",
+          this->file_offset);
+    }
+    if (this->current_type.type == ValueType::Float) {
+      this->as.write_movq_from_xmm(MemoryReference(this->target_register),
+          this->float_target_register);
+    }
+    this->write_push(this->target_register);
+    arg_types.emplace_back(move(this->current_type));
+  }
+
+  auto arg_mem = [&](size_t index) -> MemoryReference {
+    return MemoryReference(rsp, (arg_types.size() - index - 1) * sizeof(int64_t));
+  };
+  auto write_separator = [&](size_t index, char default_char) {
+    if (arg_types[index].type == ValueType::None) {
+      this->as.write_mov(rdi, default_char);
+      this->write_function_call(common_object_reference(
+          void_fn_ptr(&stdout_write_char)), {rdi}, {});
+    } else {
+      this->write_function_call(common_object_reference(void_fn_ptr(
+          static_cast<void(*)(const UnicodeObject*)>(&stdout_write_unicode))),
+          {arg_mem(index)}, {});
+    }
+  };
+
+  // write all the values
+  for (size_t x = 0; x < positional_count; x++) {
+    this->as.write_label(string_printf("__FunctionCall_%p_print_write_arg_%zu",
+        a, x));
+    if (x != 0) {
+      write_separator(positional_count, ' ');
+    }
+
+    switch (arg_types[x].type) {
+      case ValueType::None:
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&stdout_write_none)), {}, {});
+        break;
+      case ValueType::Bool:
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&stdout_write_bool)), {arg_mem(x)}, {});
+        break;
+      case ValueType::Int:
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&stdout_write_int)), {arg_mem(x)}, {});
+        break;
+      case ValueType::Float:
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&stdout_write_float)), {}, {arg_mem(x)});
+        break;
+      case ValueType::Bytes:
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&stdout_write_bytes)), {arg_mem(x)}, {});
+        break;
+      case ValueType::Unicode:
+        this->write_function_call(common_object_reference(void_fn_ptr(
+            static_cast<void(*)(const UnicodeObject*)>(&stdout_write_unicode))),
+            {arg_mem(x)}, {});
+        break;
+      default:
+        throw compile_error("cannot print value of type " + arg_types[x].str(),
+            this->file_offset);
+    }
+  }
+  this->as.write_label(string_printf("__FunctionCall_%p_print_write_end", a));
+  write_separator(positional_count + 1, '\n');
+
+  // destroy the argument values and clean up the stack
+  for (size_t x = 0; x < arg_types.size(); x++) {
+    if (type_has_refcount(arg_types[x].type)) {
+      this->as.write_label(string_printf("__FunctionCall_%p_print_destroy_arg_%zu",
+          a, x));
+      this->write_delete_reference(arg_mem(x), arg_types[x].type);
+    }
+  }
+  this->adjust_stack(arg_types.size() * sizeof(int64_t));
+
+  this->as.write_xor(MemoryReference(this->target_register),
+      MemoryReference(this->target_register));
+  this->current_type = Variable(ValueType::None);
+  this->holding_reference = false;
+}
+
+bool CompilationVisitor::write_intrinsic_call(FunctionCall* a,
+    Intrinsic intrinsic) {
+  // if the cpu doesn't have the instruction, call the builtin function instead
+  const CPUFeatures& features = target_cpu_features();
+  if (((intrinsic == Intrinsic::BitCount) && !features.popcnt) ||
+      (((intrinsic == Intrinsic::BitLength) ||
+        (intrinsic == Intrinsic::CountLeadingZeroes)) && !features.lzcnt) ||
+      ((intrinsic == Intrinsic::CountTrailingZeroes) && !features.bmi1) ||
+      (((intrinsic == Intrinsic::Floor) || (intrinsic == Intrinsic::Ceil)) &&
+        !features.sse41)) {
+    return false;
+  }
+
+  // int methods take the int from the attribute lookup; the others take it as
+  // the first argument. if the arguments don't look right, the normal call path
+  // will produce the appropriate error
+  vector<shared_ptr<Expression>> arg_exprs;
+  if ((intrinsic == Intrinsic::BitCount) || (intrinsic == Intrinsic::BitLength)) {
+    AttributeLookup* lookup = dynamic_cast<AttributeLookup*>(a->function.get());
+    if (!lookup || !lookup->base.get() || !lookup->base_module_name.empty()) {
+      return false;
+    }
+    arg_exprs.emplace_back(lookup->base);
+  }
+  arg_exprs.insert(arg_exprs.end(), a->args.begin(), a->args.end());
+  size_t expected_arg_count = (intrinsic == Intrinsic::RotateLeft) ? 2 : 1;
+  if (!a->kwargs.empty() || a->varargs.get() || a->varkwargs.get() ||
+      (arg_exprs.size() != expected_arg_count)) {
+    return false;
+  }
+
+  // rotates by a variable count have to use cl; if it's in use (e.g. by an
+  // earlier argument of an enclosing call), call the builtin function instead
+  Register result_register = this->target_register;
+  IntegerConstant* count_constant = NULL;
+  if (intrinsic == Intrinsic::RotateLeft) {
+    count_constant = dynamic_cast<IntegerConstant*>(arg_exprs[1].get());
+    if (count_constant && !int_is_direct(count_constant->value)) {
+      count_constant = NULL;
+    }
+    if (!count_constant && (result_register != rcx) &&
+        (this->available_register(rcx) != rcx)) {
+      return false;
+    }
+  }
+  Register value_register = ((intrinsic == Intrinsic::RotateLeft) &&
+      !count_constant && (result_register == rcx)) ?
+      this->available_register_except({rcx}) : result_register;
+  MemoryReference value_mem(value_register);
+
+  this->as.write_label(string_printf("__FunctionCall_%p_intrinsic_evaluate_value", a));
+  this->target_register = value_register;
+  arg_exprs[0]->accept(this);
+  ValueType arg_type = this->current_type.type;
+  bool is_math = (intrinsic == Intrinsic::SquareRoot) ||
+      (intrinsic == Intrinsic::FloatAbs) || (intrinsic == Intrinsic::Floor) ||
+      (intrinsic == Intrinsic::Ceil) || (intrinsic == Intrinsic::Truncate);
+  if (!is_math && (arg_type != ValueType::Int)) {
+    throw compile_error("bit operation not valid for " + this->current_type.str(),
+        this->file_offset);
+  }
+  if (is_math && (arg_type != ValueType::Float) &&
+      ((intrinsic != Intrinsic::SquareRoot) || (arg_type != ValueType::Int))) {
+    throw compile_error("math function not valid for " + this->current_type.str(),
+        this->file_offset);
+  }
+  MemoryReference float_mem(this->float_target_register);
+
+  // promoted arguments (see Types/Int.hh) go to slow paths, which release
+  // them. the bit intrinsics convert them to 64-bit values and resume at the
+  // instruction, then convert their results back to Ints if they aren't direct
+  Register check_register = this->available_register_except(
+      {value_register, result_register, rcx});
+  string check_label = string_printf("__FunctionCall_%p_intrinsic_checked", a);
+  string resume_label = string_printf("__FunctionCall_%p_intrinsic_resume", a);
+  auto write_value_to_int64 = [&]() {
+    this->write_jump_if_promoted(check_register, value_mem,
+        this->int_slow_path_label(check_label,
+          releasing_int_fn_ptr(int_to_int64), {value_mem, r14}, {},
+          value_register));
+    this->as.write_label(check_label);
+  };
+  auto write_value_from_int64 = [&]() {
+    this->write_jump_if_promoted(check_register, value_mem,
+        this->int_slow_path_label(resume_label, void_fn_ptr(&int_from_int64),
+          {value_mem}, {}, value_register));
+    this->as.write_label(resume_label);
+  };
+
+  this->as.write_label(string_printf("__FunctionCall_%p_intrinsic", a));
+  switch (intrinsic) {
+    // bit_count and bit_length use the absolute value. neg sets the sign flag
+    // if the value was positive, in which case the original value is used
+    case Intrinsic::BitCount:
+    case Intrinsic::BitLength: {
+      this->write_jump_if_promoted(check_register, value_mem,
+          this->int_slow_path_label(resume_label,
+            (intrinsic == Intrinsic::BitCount) ?
+              releasing_int_fn_ptr(int_bit_count) :
+              releasing_int_fn_ptr(int_bit_length),
+            {value_mem}, {}, value_register));
+      MemoryReference abs_mem(this->available_register_except({value_register}));
+      this->as.write_mov(abs_mem, value_mem);
+      this->as.write_neg(abs_mem);
+      this->as.write_cmovs(abs_mem.base_register, value_mem);
+      if (intrinsic == Intrinsic::BitCount) {
+        this->as.write_popcnt(value_register, abs_mem);
+      } else {
+        this->as.write_lzcnt(value_register, abs_mem);
+        this->as.write_neg(value_mem);
+        this->as.write_add(value_mem, 64);
+      }
+      this->as.write_label(resume_label);
+      break;
+    }
+
+    case Intrinsic::CountTrailingZeroes:
+      write_value_to_int64();
+      this->as.write_tzcnt(value_register, value_mem);
+      break;
+
+    case Intrinsic::CountLeadingZeroes:
+      write_value_to_int64();
+      this->as.write_lzcnt(value_register, value_mem);
+      break;
+
+    case Intrinsic::ByteSwap:
+      write_value_to_int64();
+      this->as.write_bswap(value_register);
+      write_value_from_int64();
+      break;
+
+    case Intrinsic::RotateLeft: {
+      write_value_to_int64();
+      if (count_constant) {
+        this->as.write_rol(value_mem, count_constant->value & 63);
+        write_value_from_int64();
+        break;
+      }
+
+      // the count is evaluated directly into rcx; the value is kept in a
+      // reserved register in case evaluating the count involves a call (or
+      // the count's slow path)
+      this->reserve_register(value_register);
+      this->as.write_label(string_printf("__FunctionCall_%p_intrinsic_evaluate_count", a));
+      this->target_register = rcx;
+      arg_exprs[1]->accept(this);
+      if (this->current_type.type != ValueType::Int) {
+        throw compile_error("rotate count must be Int, not " + this->current_type.str(),
+            this->file_offset);
+      }
+      string rotate_label = string_printf("__FunctionCall_%p_intrinsic_rotate", a);
+      this->write_jump_if_promoted(check_register, MemoryReference(rcx),
+          this->int_slow_path_label(rotate_label,
+            releasing_int_fn_ptr(int_to_int64), {rcx, r14}, {}, rcx));
+      this->release_register(value_register);
+      this->as.write_label(rotate_label);
+      this->as.write_rol_cl(value_mem);
+      write_value_from_int64();
+      if (value_register != result_register) {
+        this->as.write_mov(MemoryReference(result_register), value_mem);
+      }
+      break;
+    }
+
+    // python raises ValueError for negative arguments instead of returning
+    // NaN. NaN arguments also compare as below zero; the stub lets them through
+    case Intrinsic::SquareRoot: {
+      if (arg_type == ValueType::Int) {
+        this->write_int_to_float(this->float_target_register, value_mem, true);
+      }
+      Register zero_xmm = this->available_register_except(
+          {this->float_target_register}, true);
+      this->as.write_xorpd(zero_xmm, MemoryReference(zero_xmm));
+      this->as.write_ucomisd(this->float_target_register, MemoryReference(zero_xmm));
+      this->as.write_jb(this->float_check_stub_label(resume_label,
+          this->float_target_register));
+      this->as.write_label(resume_label);
+      this->as.write_sqrtsd(this->float_target_register, float_mem);
+      break;
+    }
+
+    // the sign bit is cleared with a mask, which has to come from a gpr. the
+    // target register isn't used for Float results, so it's free to use here
+    case Intrinsic::FloatAbs: {
+      Register mask_xmm = this->available_register_except(
+          {this->float_target_register}, true);
+      this->as.write_mov(value_mem, 0x7FFFFFFFFFFFFFFF);
+      this->as.write_movq_to_xmm(mask_xmm, value_mem);
+      this->as.write_andpd(this->float_target_register, MemoryReference(mask_xmm));
+      break;
+    }
+
+    // cvtsd2si truncates toward zero, so trunc doesn't need to round first.
+    // NaN and values out of 64-bit range all convert to -2**63, which isn't
+    // direct, so they go to the slow path along with the other results that
+    // need to be promoted. int_from_double raises ValueError for NaN and
+    // OverflowError for infinities
+    case Intrinsic::Floor:
+    case Intrinsic::Ceil:
+    case Intrinsic::Truncate: {
+      if (intrinsic != Intrinsic::Truncate) {
+        this->as.write_roundsd(this->float_target_register, float_mem,
+            (intrinsic == Intrinsic::Floor) ? 1 : 2);
+      }
+      this->as.write_cvtsd2si(value_register, this->float_target_register);
+      this->write_jump_if_promoted(check_register, value_mem,
+          this->int_slow_path_label(resume_label, void_fn_ptr(&int_from_double),
+            {r14}, {MemoryReference(this->float_target_register)},
+            value_register));
+      this->as.write_label(resume_label);
+      break;
+    }
+
+    default:
+      throw compile_error("unknown intrinsic", this->file_offset);
+  }
+
+  this->target_register = result_register;
+  bool returns_float = (intrinsic == Intrinsic::SquareRoot) ||
+      (intrinsic == Intrinsic::FloatAbs);
+  this->current_type = Variable(returns_float ? ValueType::Float : ValueType::Int);
+  this->holding_reference = !returns_float;
+  return true;
+}
+
+void CompilationVisitor::write_push_slice_indexes(Expression* start_index,
+    Expression* end_index, Expression* step_size) {
+  // pushes start, stop and step, in that order. omitted indexes are pushed as
+  // SLICE_INDEX_OMITTED, and an omitted step as 1
+  Register target_register = this->target_register;
+  Expression* indexes[3] = {start_index, end_index, step_size};
+  for (size_t x = 0; x < 3; x++) {
+    if (indexes[x]) {
+      this->target_register = target_register;
+      indexes[x]->accept(this);
+      if (this->current_type.type != ValueType::Int) {
+        throw compile_error("slice indexes must be Int; here one is " +
+            this->current_type.str(), this->file_offset);
+      }
+      this->write_push(target_register);
+    } else if (x == 2) {
+      this->write_push(1);
+    } else {
+      this->as.write_mov(target_register, SLICE_INDEX_OMITTED);
+      this->write_push(target_register);
+    }
+  }
+  this->target_register = target_register;
+}
+
 void CompilationVisitor::write_function_setup(const string& base_label) {
   // get ready to rumble
   this->as.write_label("__" + base_label);
@@ -3619,14 +6989,27 @@ void CompilationVisitor::write_function_cleanup(const string& base_label) {
   }
 
   this->as.write_ret();
+  this->write_exception_stubs();
 }
 
-void CompilationVisitor::write_add_reference(Register addr_reg) {
+void CompilationVisitor::write_add_reference(Register addr_reg,
+    ValueType type) {
+  // only promoted Ints have references (see Types/Int.hh)
   if (debug_flags & DebugFlag::NoInlineRefcounting) {
     this->reserve_register(addr_reg);
-    this->write_function_call(common_object_reference(void_fn_ptr(&add_reference)),
+    this->write_function_call(common_object_reference((type == ValueType::Int) ?
+          void_fn_ptr(&int_add_reference) : void_fn_ptr(&add_reference)),
         {MemoryReference(addr_reg)}, {});
     this->release_register(addr_reg);
+  } else if (type == ValueType::Int) {
+    static uint64_t skip_label_id = 0;
+    string skip_label = string_printf("__add_reference_skip_%" PRIu64,
+        skip_label_id++);
+    Register r = this->available_register_except({addr_reg});
+    this->write_get_promoted_int_object(r, MemoryReference(addr_reg), skip_label);
+    this->as.write_lock();
+    this->as.write_inc(MemoryReference(r, 0));
+    this->as.write_label(skip_label);
   } else {
     this->as.write_lock();
     this->as.write_inc(MemoryReference(addr_reg, 0));
@@ -3653,8 +7036,13 @@ void CompilationVisitor::write_delete_reference(const MemoryReference& mem,
 
   if (type_has_refcount(type)) {
     if (debug_flags & DebugFlag::NoInlineRefcounting) {
-      this->write_function_call(common_object_reference(void_fn_ptr(&delete_reference)),
-          {mem, r14}, {});
+      if (type == ValueType::Int) {
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&int_delete_reference)), {mem}, {});
+      } else {
+        this->write_function_call(common_object_reference(
+            void_fn_ptr(&delete_reference)), {mem, r14}, {});
+      }
 
     } else {
       static uint64_t skip_label_id = 0;
@@ -3663,15 +7051,18 @@ void CompilationVisitor::write_delete_reference(const MemoryReference& mem,
       Register r = this->available_register();
       MemoryReference r_mem(r);
 
-      // get the object pointer
-      if (mem.field_size || (r != mem.base_register)) {
-        this->as.write_mov(r_mem, mem);
+      // get the object pointer. if it's NULL (or the value is an Int that
+      // isn't promoted), do nothing
+      if (type == ValueType::Int) {
+        this->write_get_promoted_int_object(r, mem, skip_label);
+      } else {
+        if (mem.field_size || (r != mem.base_register)) {
+          this->as.write_mov(r_mem, mem);
+        }
+        this->as.write_test(r_mem, r_mem);
+        this->as.write_je(skip_label);
       }
 
-      // if the pointer is NULL, do nothing
-      this->as.write_test(r_mem, r_mem);
-      this->as.write_je(skip_label);
-
       // decrement the refcount; if it's not zero, skip the destructor call
       this->as.write_lock();
       this->as.write_dec(MemoryReference(r, 0));
@@ -3708,7 +7099,7 @@ void CompilationVisitor::write_alloc_class_instance(int64_t class_id,
   this->as.write_test(rax, rax);
   this->as.write_jnz(skip_label);
   this->as.write_mov(rax, common_object_reference(&MemoryError_instance));
-  this->write_add_reference(rax);
+  this->write_add_reference(rax, ValueType::Instance);
   this->as.write_mov(r15, rax);
   this->as.write_jmp(
       common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
@@ -3757,6 +7148,129 @@ void CompilationVisitor::write_raise_exception(int64_t class_id) {
   this->as.write_jmp(common_object_reference(void_fn_ptr(&_unwind_exception_internal)));
 }
 
+string CompilationVisitor::overflow_stub_label() {
+  string label = string_printf("__overflow_%zu", this->overflow_stubs.size());
+  this->overflow_stubs.emplace_back(OverflowStub({label, this->stack_bytes_used}));
+  return label;
+}
+
+string CompilationVisitor::float_check_stub_label(const string& resume_label,
+    Register float_register) {
+  string label = string_printf("__float_check_%zu", this->float_check_stubs.size());
+  this->float_check_stubs.emplace_back(FloatCheckStub({label, resume_label,
+      this->stack_bytes_used, float_register}));
+  return label;
+}
+
+string CompilationVisitor::int_slow_path_label(const string& resume_label,
+    const void* function, const vector<MemoryReference>& int_args,
+    const vector<MemoryReference>& float_args, Register result_register,
+    bool result_float, bool compare_result) {
+  string label = string_printf("__int_slow_path_%zu",
+      this->int_slow_path_stubs.size());
+
+  // the stub writes the result register after restoring the saved registers,
+  // so it must not be one of them
+  int64_t available_registers = this->available_registers;
+  if (result_float) {
+    this->available_float_registers |= (1 << result_register);
+  } else {
+    this->available_int_registers |= (1 << result_register);
+  }
+  this->int_slow_path_stubs.emplace_back(IntSlowPathStub({label, resume_label,
+      this->stack_bytes_used, this->available_registers, function, int_args,
+      float_args, result_register, result_float, compare_result}));
+  this->available_registers = available_registers;
+  return label;
+}
+
+void CompilationVisitor::write_jump_if_promoted(Register temp,
+    const MemoryReference& int_mem, const string& label) {
+  // doubling a direct value never overflows, and doubling a promoted value
+  // always does
+  MemoryReference temp_mem(temp);
+  if (temp_mem != int_mem) {
+    this->as.write_mov(temp_mem, int_mem);
+  }
+  this->as.write_add(temp_mem, temp_mem);
+  this->as.write_jo(label);
+}
+
+void CompilationVisitor::write_get_promoted_int_object(Register temp,
+    const MemoryReference& int_mem, const string& skip_label) {
+  // a value is promoted if doubling it overflows to a negative value (the
+  // values that overflow to nonnegative values are raw 64-bit values outside
+  // the direct range; see Types/Int.hh). shifting the doubled value left and
+  // then right by 2 clears the top two bits, leaving the object's address
+  MemoryReference temp_mem(temp);
+  if (temp_mem != int_mem) {
+    this->as.write_mov(temp_mem, int_mem);
+  }
+  this->as.write_add(temp_mem, temp_mem);
+  this->as.write_jno(skip_label);
+  this->as.write_jns(skip_label);
+  this->as.write_shl(temp_mem, 1);
+  this->as.write_shr(temp_mem, 2);
+}
+
+void CompilationVisitor::write_int_to_float(Register xmm,
+    const MemoryReference& int_mem, bool release) {
+  // promoted values are converted by calling int_to_double, which raises
+  // OverflowError if the value is too large for a Float. if release is true,
+  // the slow path also releases the value
+  string resume_label = string_printf("__int_slow_path_%zu_resume",
+      this->int_slow_path_stubs.size());
+  Register temp = this->available_register_except({int_mem.base_register,
+      int_mem.index_register, this->target_register});
+  this->write_jump_if_promoted(temp, int_mem, this->int_slow_path_label(
+      resume_label, release ? releasing_int_fn_ptr(int_to_double) :
+        void_fn_ptr(&int_to_double), {int_mem, r14}, {}, xmm, true));
+  this->as.write_cvtsi2sd(xmm, int_mem);
+  this->as.write_label(resume_label);
+}
+
+void CompilationVisitor::write_exception_stubs() {
+  // these are reached by jumping from the middle of the function, so the stack
+  // is as it was at the jump site, not as it is here
+  int64_t stack_bytes_used = this->stack_bytes_used;
+  for (const auto& stub : this->overflow_stubs) {
+    this->as.write_label(stub.label);
+    this->stack_bytes_used = stub.stack_bytes_used;
+    this->write_raise_exception(OverflowError_class_id);
+  }
+  this->overflow_stubs.clear();
+
+  for (const auto& stub : this->float_check_stubs) {
+    MemoryReference float_mem(stub.float_register);
+    this->as.write_label(stub.label);
+    this->stack_bytes_used = stub.stack_bytes_used;
+
+    // sqrt's argument was below zero or NaN; sqrt(NaN) is just NaN
+    this->as.write_ucomisd(stub.float_register, float_mem);
+    this->as.write_jp(stub.resume_label);
+    this->write_raise_exception(ValueError_class_id);
+  }
+  this->float_check_stubs.clear();
+
+  int64_t available_registers = this->available_registers;
+  for (const auto& stub : this->int_slow_path_stubs) {
+    this->as.write_label(stub.label);
+    this->stack_bytes_used = stub.stack_bytes_used;
+    this->available_registers = stub.available_registers;
+    this->write_function_call(common_object_reference(stub.function),
+        stub.int_args, stub.float_args, -1, stub.result_register,
+        stub.result_float);
+    if (stub.compare_result) {
+      this->as.write_cmp(MemoryReference(stub.result_register), 0);
+    }
+    this->as.write_jmp(stub.resume_label);
+  }
+  this->int_slow_path_stubs.clear();
+  this->available_registers = available_registers;
+
+  this->stack_bytes_used = stack_bytes_used;
+}
+
 void CompilationVisitor::write_create_exception_block(
     const vector<pair<string, unordered_set<int64_t>>>& label_to_class_ids,
     const string& exception_return_label) {
@@ -3790,6 +7304,7 @@ void CompilationVisitor::write_create_exception_block(
     this->write_push(tmp);
   }
 
+  this->write_push(rbx);
   this->write_push(r13);
   this->write_push(r12);
 
@@ -3843,7 +7358,7 @@ void CompilationVisitor::write_load_double(Register reg, double value) {
   Register tmp = this->available_register();
   const int64_t* int_value = reinterpret_cast<const int64_t*>(&value);
   this->as.write_mov(tmp, *int_value);
-  this->as.write_movq_to_xmm(this->float_target_register, MemoryReference(tmp));
+  this->as.write_movq_to_xmm(reg, MemoryReference(tmp));
 }
 
 CompilationVisitor::VariableLocation CompilationVisitor::location_for_global(
@@ -14,6 +14,7 @@
 #include "Environment.hh"
 #include "Analysis.hh"
 #include "Assembler/AMD64Assembler.hh"
+#include "BuiltinFunctions.hh"
 
 
 
@@ -122,6 +123,54 @@ private:
   std::vector<std::string> break_label_stack;
   std::vector<std::string> continue_label_stack;
 
+  // for loops being compiled, innermost last. each one has the caller's rbx on
+  // the stack, with its collections (and any other state) above it; a return
+  // statement has to clean these up
+  struct ForLoopState {
+    int64_t stack_bytes_used; // after rbx was pushed
+    std::vector<ValueType> slot_types; // slots above rbx, nearest first
+  };
+  std::vector<ForLoopState> for_loop_stack;
+
+  // integer overflow checks jump to stubs that raise OverflowError. the stubs
+  // are written after the end of the function, so the checks are never-taken
+  // forward branches
+  struct OverflowStub {
+    std::string label;
+    int64_t stack_bytes_used; // at the jump site
+  };
+  std::vector<OverflowStub> overflow_stubs;
+
+  // some Float checks can't tell valid values from invalid ones: NaN compares
+  // as less than zero. their stubs check again, then raise or jump back to
+  // resume_label
+  struct FloatCheckStub {
+    std::string label;
+    std::string resume_label;
+    int64_t stack_bytes_used; // at the jump site
+    Register float_register;
+  };
+  std::vector<FloatCheckStub> float_check_stubs;
+
+  // Ints outside the direct range (see Types/Int.hh) are handled by calling
+  // one of the int_* functions. the inline code checks its operands and jumps
+  // to one of these stubs if any are promoted; the stub saves the registers
+  // that were reserved at the jump site, makes the call, puts the result in
+  // result_register, and jumps back to resume_label
+  struct IntSlowPathStub {
+    std::string label;
+    std::string resume_label;
+    int64_t stack_bytes_used; // at the jump site
+    int64_t available_registers; // at the jump site
+    const void* function;
+    std::vector<MemoryReference> int_args;
+    std::vector<MemoryReference> float_args;
+    Register result_register;
+    bool result_float;
+    bool compare_result; // compare the result to zero before resuming
+  };
+  std::vector<IntSlowPathStub> int_slow_path_stubs;
+
   struct VariableLocation {
     std::string name;
     bool is_global;
@@ -167,16 +216,49 @@ private:
       const std::vector<MemoryReference>& float_args,
       ssize_t arg_stack_bytes = -1, Register return_register = Register::None,
       bool return_float = false);
+  void write_print_call(FunctionCall* a);
+  bool write_intrinsic_call(FunctionCall* a, Intrinsic intrinsic);
+  void write_fused_for_statement(ForStatement* a);
+  void write_push_range(FunctionCall* range_call);
+  void write_range_for_statement(ForStatement* a);
+  void write_stdin_lines_for_statement(ForStatement* a);
+  void write_vectorized_range_loop(ForStatement* a);
+  void write_unpacked_tuple_assignment(TupleLValueReference* target,
+      TupleConstructor* value);
+  void write_comprehension(Expression* a, Expression* item_pattern,
+      Expression* value_pattern, Expression* variable, Expression* source_data,
+      Expression* predicate);
+  void write_push_slice_indexes(Expression* start_index, Expression* end_index,
+      Expression* step_size);
+  void write_set_int_contains(BinaryOperation* a, const MemoryReference& key_mem);
+  bool is_float_expression(Expression* a);
+  Register available_float_temp_register(Register prevented = Register::None);
+  void write_float_operand(Expression* a, Register xmm);
+  void write_float_arithmetic(BinaryOperation* a);
   void write_function_setup(const std::string& base_label);
   void write_function_cleanup(const std::string& base_label);
 
-  void write_add_reference(Register addr_reg);
+  void write_add_reference(Register addr_reg, ValueType type);
   void write_delete_held_reference(const MemoryReference& mem);
   void write_delete_reference(const MemoryReference& mem, ValueType type);
 
   void write_alloc_class_instance(int64_t class_id, bool initialize_attributes = true);
 
   void write_raise_exception(int64_t class_id);
+  std::string overflow_stub_label();
+  std::string float_check_stub_label(const std::string& resume_label,
+      Register float_register);
+  std::string int_slow_path_label(const std::string& resume_label,
+      const void* function, const std::vector<MemoryReference>& int_args,
+      const std::vector<MemoryReference>& float_args, Register result_register,
+      bool result_float = false, bool compare_result = false);
+  void write_jump_if_promoted(Register temp, const MemoryReference& int_mem,
+      const std::string& label);
+  void write_get_promoted_int_object(Register temp,
+      const MemoryReference& int_mem, const std::string& skip_label);
+  void write_int_to_float(Register xmm, const MemoryReference& int_mem,
+      bool release = false);
+  void write_exception_stubs();
   void write_create_exception_block(
       const std::vector<std::pair<std::string, std::unordered_set<int64_t>>>& label_to_class_ids,
       const std::string& exception_return_label);
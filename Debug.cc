@@ -35,6 +35,15 @@ DebugFlag debug_flag_for_name(const char* name) {
   if (!strcasecmp(name, "NoInlineRefcounting")) {
     return DebugFlag::NoInlineRefcounting;
   }
+  if (!strcasecmp(name, "FusedMultiplyAdd")) {
+    return DebugFlag::FusedMultiplyAdd;
+  }
+  if (!strcasecmp(name, "NoVectorization")) {
+    return DebugFlag::NoVectorization;
+  }
+  if (!strcasecmp(name, "BaselineISA")) {
+    return DebugFlag::BaselineISA;
+  }
   if (!strcasecmp(name, "Code")) {
     return DebugFlag::Code;
   }
@@ -16,6 +16,9 @@ enum DebugFlag {
   ShowCodeSoFar       = 0x0000000000000100,
   ShowRefcountChanges = 0x0000000000000200,
   NoInlineRefcounting = 0x0000000000010000,
+  FusedMultiplyAdd    = 0x0000000000020000,
+  NoVectorization     = 0x0000000000040000,
+  BaselineISA         = 0x0000000000080000,
 
   Code                = 0x00000000000000F0, // transformation steps only
   Verbose             = 0x000000000000FFFF, // no behaviors, all debug info
@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "Types/Format.hh"
+#include "Types/Int.hh"
 #include "Types/Reference.hh"
 
 using namespace std;
@@ -336,6 +337,9 @@ Variable& Variable::operator=(const Variable& other) {
     if (this->type == ValueType::Instance) {
       this->class_id = other.class_id;
       this->instance = NULL;
+    } else if (this->type == ValueType::ExtensionTypeReference) {
+      // the index is part of the type, not the value
+      this->extension_type_index = other.extension_type_index;
     }
   }
 
@@ -397,6 +401,9 @@ Variable& Variable::operator=(Variable&& other) {
     if (this->type == ValueType::Instance) {
       this->class_id = other.class_id;
       this->instance = NULL;
+    } else if (this->type == ValueType::ExtensionTypeReference) {
+      // the index is part of the type, not the value
+      this->extension_type_index = other.extension_type_index;
     }
   }
 
@@ -457,6 +464,20 @@ Variable Variable::type_only() const {
   return ret;
 }
 
+static string extension_types_str(const vector<Variable>& extension_types) {
+  if (extension_types.empty()) {
+    return "";
+  }
+  string ret = "[";
+  for (const auto& type : extension_types) {
+    if (ret.size() > 1) {
+      ret += ", ";
+    }
+    ret += type.type_only().str();
+  }
+  return ret + "]";
+}
+
 string Variable::str() const {
   switch (this->type) {
     case ValueType::Indeterminate:
@@ -481,7 +502,7 @@ string Variable::str() const {
       if (this->value_known) {
         return string_printf("%lg", this->float_value);
       }
-      return "Int";
+      return "Float";
 
     case ValueType::Bytes:
       if (this->value_known) {
@@ -524,7 +545,7 @@ string Variable::str() const {
         }
         return ret + "]";
       }
-      return "List";
+      return "List" + extension_types_str(this->extension_types);
 
     case ValueType::Tuple:
       if (this->value_known) {
@@ -540,7 +561,7 @@ string Variable::str() const {
         }
         return ret + ")";
       }
-      return "Tuple";
+      return "Tuple" + extension_types_str(this->extension_types);
 
     case ValueType::Set:
       if (this->value_known) {
@@ -553,7 +574,7 @@ string Variable::str() const {
         }
         return ret + "}";
       }
-      return "Set";
+      return "Set" + extension_types_str(this->extension_types);
 
     case ValueType::Dict:
       if (this->value_known) {
@@ -568,7 +589,7 @@ string Variable::str() const {
         }
         return ret + "}";
       }
-      return "Dict";
+      return "Dict" + extension_types_str(this->extension_types);
 
     case ValueType::Function:
       if (!value_known) {
@@ -649,7 +670,16 @@ bool Variable::types_equal(const Variable& other) const {
     return this->class_id == other.class_id;
   }
 
-  return this->extension_types == other.extension_types;
+  // the extension types are types too, so their values don't matter either
+  if (this->extension_types.size() != other.extension_types.size()) {
+    return false;
+  }
+  for (size_t x = 0; x < this->extension_types.size(); x++) {
+    if (!this->extension_types[x].types_equal(other.extension_types[x])) {
+      return false;
+    }
+  }
+  return true;
 }
 
 bool Variable::operator==(const Variable& other) const {
@@ -661,7 +691,9 @@ bool Variable::operator==(const Variable& other) const {
     if ((this->type == ValueType::Instance) && (this->class_id != other.class_id)) {
       return false;
     }
-    return true; // types match, values are unknown
+    // for collections, the item types are part of the type too (so e.g. a
+    // function returning either List[Int] or List[Float] has two return types)
+    return this->extension_types == other.extension_types;
   }
   switch (this->type) {
     case ValueType::None:
@@ -708,7 +740,6 @@ bool type_has_refcount(ValueType type) {
   return (type != ValueType::Indeterminate) &&
          (type != ValueType::None) &&
          (type != ValueType::Bool) &&
-         (type != ValueType::Int) &&
          (type != ValueType::Float) &&
          (type != ValueType::Function) &&
          (type != ValueType::Class) &&
@@ -811,6 +842,73 @@ string type_signature_for_variables(const vector<Variable>& vars,
   return ret;
 }
 
+bool match_extension_type_references(const Variable& pattern,
+    const Variable& actual, vector<Variable>& bindings) {
+  if (pattern.type == ValueType::ExtensionTypeReference) {
+    size_t index = pattern.extension_type_index;
+    if (bindings.size() <= index) {
+      bindings.resize(index + 1);
+    }
+    Variable actual_type = actual.type_only();
+    if (bindings[index].type == ValueType::Indeterminate) {
+      bindings[index] = move(actual_type);
+      return true;
+    }
+    return bindings[index].types_equal(actual_type);
+  }
+
+  // Indeterminate in a built-in function's signature means any type
+  if (pattern.type == ValueType::Indeterminate) {
+    return true;
+  }
+
+  if ((pattern.type != actual.type) ||
+      (pattern.extension_types.size() != actual.extension_types.size())) {
+    return false;
+  }
+  if ((pattern.type == ValueType::Instance) && pattern.class_id &&
+      (pattern.class_id != actual.class_id)) {
+    return false;
+  }
+  for (size_t x = 0; x < pattern.extension_types.size(); x++) {
+    if (!match_extension_type_references(pattern.extension_types[x],
+        actual.extension_types[x], bindings)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Variable resolve_extension_type_references(const Variable& var,
+    const vector<Variable>& bindings) {
+  if (var.type == ValueType::ExtensionTypeReference) {
+    if (static_cast<size_t>(var.extension_type_index) >= bindings.size()) {
+      throw invalid_argument("extension type reference is not bound");
+    }
+    return bindings[var.extension_type_index];
+  }
+  if (var.extension_types.empty()) {
+    return var;
+  }
+  vector<Variable> extension_types;
+  for (const auto& ext_type : var.extension_types) {
+    extension_types.emplace_back(resolve_extension_type_references(ext_type, bindings));
+  }
+  return Variable(var.type, move(extension_types));
+}
+
+bool has_extension_type_references(const Variable& var) {
+  if (var.type == ValueType::ExtensionTypeReference) {
+    return true;
+  }
+  for (const auto& ext_type : var.extension_types) {
+    if (has_extension_type_references(ext_type)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 
 
 namespace std {
@@ -884,7 +982,7 @@ Variable execute_unary_operator(UnaryOperator oper, const Variable& var) {
 
       if (var.type == ValueType::Int) {
         if (var.value_known) {
-          return Variable(ValueType::Int, ~var.int_value);
+          return Variable(ValueType::Int, int_invert(var.int_value));
         } else {
           return Variable(ValueType::Int);
         }
@@ -941,7 +1039,7 @@ Variable execute_unary_operator(UnaryOperator oper, const Variable& var) {
 
       if (var.type == ValueType::Int) {
         if (var.value_known) {
-          return Variable(ValueType::Int, -var.int_value);
+          return Variable(ValueType::Int, int_negate(var.int_value));
         } else {
           return Variable(ValueType::Int);
         }
@@ -972,8 +1070,70 @@ Variable execute_unary_operator(UnaryOperator oper, const Variable& var) {
   }
 }
 
+// sets are only partially ordered (the ordered comparisons are subset tests),
+// so they can't be compared in terms of LessThan and Equality like other types
+static Variable execute_set_comparison(BinaryOperator oper,
+    const Variable& left, const Variable& right) {
+  if (!left.value_known || !right.value_known) {
+    return Variable(ValueType::Bool);
+  }
+
+  bool reverse = (oper == BinaryOperator::GreaterThan) ||
+      (oper == BinaryOperator::GreaterOrEqual);
+  const auto& a = reverse ? *right.set_value : *left.set_value;
+  const auto& b = reverse ? *left.set_value : *right.set_value;
+  bool strict = (oper == BinaryOperator::LessThan) ||
+      (oper == BinaryOperator::GreaterThan);
+  if (strict ? (a.size() >= b.size()) : (a.size() > b.size())) {
+    return Variable(ValueType::Bool, false);
+  }
+  for (const auto& item : a) {
+    if (!b.count(item)) {
+      return Variable(ValueType::Bool, false);
+    }
+  }
+  return Variable(ValueType::Bool, true);
+}
+
+// returns an unknown Int for division by zero, so the generated code raises
+// ZeroDivisionError at runtime
+static Variable floor_divide_ints(int64_t left, int64_t right, bool is_mod) {
+  if (right == 0) {
+    return Variable(ValueType::Int);
+  }
+  return Variable(ValueType::Int,
+      is_mod ? int_modulus(left, right) : int_floor_divide(left, right));
+}
+
+// promoted Ints (see Types/Int.hh) are folded with the int_* functions, but
+// they aren't converted to Floats at compile time since the conversion can
+// raise OverflowError
+static bool is_promoted_int(const Variable& var) {
+  return (var.type == ValueType::Int) && var.value_known &&
+      !int_is_direct(var.int_value);
+}
+
+// shifts and powers of known values are only folded if the result has at most
+// this many bits; larger results are computed at runtime
+static const int64_t MAX_FOLDED_INT_BITS = 4096;
+
 Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
     const Variable& right) {
+  if ((left.type == ValueType::Set) && (right.type == ValueType::Set) &&
+      ((oper == BinaryOperator::LessThan) ||
+       (oper == BinaryOperator::GreaterThan) ||
+       (oper == BinaryOperator::LessOrEqual) ||
+       (oper == BinaryOperator::GreaterOrEqual))) {
+    return execute_set_comparison(oper, left, right);
+  }
+
+  if ((is_promoted_int(left) && ((right.type == ValueType::Float) ||
+        (oper == BinaryOperator::Division))) ||
+      (is_promoted_int(right) && ((left.type == ValueType::Float) ||
+        (oper == BinaryOperator::Division)))) {
+    return execute_binary_operator(oper, left.type_only(), right.type_only());
+  }
+
   switch (oper) {
     case BinaryOperator::LogicalOr:
       // the result is the first argument if it's truthy, else the second
@@ -1021,7 +1181,8 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
         case ValueType::Bool:
         case ValueType::Int: {
           if ((right.type == ValueType::Bool) || (right.type == ValueType::Int)) {
-            return Variable(ValueType::Bool, left.int_value < right.int_value);
+            return Variable(ValueType::Bool,
+                int_compare(left.int_value, right.int_value) < 0);
           }
           if (right.type == ValueType::Float) {
             return Variable(ValueType::Bool, left.int_value < right.float_value);
@@ -1098,9 +1259,6 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
           throw invalid_argument(string_printf("can\'t compare %s < %s (left side list/tuple; right side not same type)", left_str.c_str(), right_str.c_str()));
         }
 
-        case ValueType::Set:
-          throw invalid_argument("subset operator not yet implemented");
-
         default: {
           string left_str = left.str();
           string right_str = right.str();
@@ -1176,6 +1334,9 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
           return Variable(ValueType::Bool, true);
         }
 
+        case ValueType::Set:
+          return Variable(ValueType::Bool, *left.set_value == *right.set_value);
+
         default: {
           string left_str = left.str();
           string right_str = right.str();
@@ -1308,7 +1469,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
           }
           return Variable(ValueType::Set, move(result));
         } else {
-          return Variable(ValueType::Set);
+          return left.type_only();
         }
       }
 
@@ -1342,14 +1503,14 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
       if (!left.value_known || !right.value_known) {
         return Variable(ValueType::Int);
       }
-      return Variable(ValueType::Int, left.int_value | right.int_value);
+      return Variable(ValueType::Int, int_or(left.int_value, right.int_value));
 
     case BinaryOperator::And:
       // handle set-intersection operation
       if ((left.type == ValueType::Set) && (right.type == ValueType::Set)) {
         if (left.value_known && right.value_known) {
           unordered_set<Variable> result = *left.set_value;
-          for (auto it = result.begin(); it != result.end(); it++) {
+          for (auto it = result.begin(); it != result.end();) {
             if (!right.set_value->count(*it)) {
               it = result.erase(it);
             } else {
@@ -1358,7 +1519,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
           }
           return Variable(ValueType::Set, move(result));
         } else {
-          return Variable(ValueType::Set);
+          return left.type_only();
         }
       }
 
@@ -1391,7 +1552,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
       if (!left.value_known || !right.value_known) {
         return Variable(ValueType::Int);
       }
-      return Variable(ValueType::Int, left.int_value & right.int_value);
+      return Variable(ValueType::Int, int_and(left.int_value, right.int_value));
 
     case BinaryOperator::Xor:
       // handle set-xor operation
@@ -1405,7 +1566,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
           }
           return Variable(ValueType::Set, move(result));
         } else {
-          return Variable(ValueType::Set);
+          return left.type_only();
         }
       }
 
@@ -1433,7 +1594,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
       if (!left.value_known || !right.value_known) {
         return Variable(ValueType::Int);
       }
-      return Variable(ValueType::Int, left.int_value ^ right.int_value);
+      return Variable(ValueType::Int, int_xor(left.int_value, right.int_value));
 
     case BinaryOperator::LeftShift:
       // if either side is Indeterminate, the result is Indeterminate
@@ -1449,10 +1610,12 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
         throw invalid_argument(string_printf("can\'t compute left shift of %s by %s", left_str.c_str(), right_str.c_str()));
       }
 
-      if (!left.value_known || !right.value_known) {
+      if (!left.value_known || !right.value_known ||
+          (right.int_value < 0) || (right.int_value > MAX_FOLDED_INT_BITS)) {
         return Variable(ValueType::Int);
       }
-      return Variable(ValueType::Int, left.int_value << right.int_value);
+      return Variable(ValueType::Int,
+          int_left_shift(left.int_value, right.int_value));
 
     case BinaryOperator::RightShift:
       // if either side is Indeterminate, the result is Indeterminate
@@ -1468,10 +1631,12 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
         throw invalid_argument(string_printf("can\'t compute right shift of %s by %s", left_str.c_str(), right_str.c_str()));
       }
 
-      if (!left.value_known || !right.value_known) {
+      if (!left.value_known || !right.value_known ||
+          (right.int_value < 0) || !int_is_direct(right.int_value)) {
         return Variable(ValueType::Int);
       }
-      return Variable(ValueType::Int, left.int_value >> right.int_value);
+      return Variable(ValueType::Int,
+          int_right_shift(left.int_value, right.int_value));
 
     case BinaryOperator::Addition:
       // if either side is Indeterminate, the result is Indeterminate
@@ -1486,7 +1651,8 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
             if (!left.value_known || !right.value_known) {
               return Variable(ValueType::Int);
             }
-            return Variable(ValueType::Int, left.int_value + right.int_value);
+            return Variable(ValueType::Int,
+                int_add(left.int_value, right.int_value));
           }
           if (right.type == ValueType::Float) {
             if (!left.value_known || !right.value_known) {
@@ -1579,7 +1745,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
           }
           return Variable(ValueType::Set, move(result));
         } else {
-          return Variable(ValueType::Set);
+          return left.type_only();
         }
       }
 
@@ -1641,7 +1807,8 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
             if (!left.value_known || !right.value_known) {
               return Variable(ValueType::Int);
             }
-            return Variable(ValueType::Int, left.int_value * right.int_value);
+            return Variable(ValueType::Int,
+                int_multiply(left.int_value, right.int_value));
           }
           if (right.type == ValueType::Float) {
             if (!left.value_known || !right.value_known) {
@@ -1767,7 +1934,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
             if (!left.value_known || !right.value_known) {
               return Variable(ValueType::Int);
             }
-            return Variable(ValueType::Int, left.int_value % right.int_value);
+            return floor_divide_ints(left.int_value, right.int_value, true);
           }
           if (right.type == ValueType::Float) {
             if (!left.value_known || !right.value_known) {
@@ -1822,7 +1989,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
             if (!left.value_known || !right.value_known) {
               return Variable(ValueType::Int);
             }
-            return Variable(ValueType::Int, left.int_value / right.int_value);
+            return floor_divide_ints(left.int_value, right.int_value, false);
           }
           if (right.type == ValueType::Float) {
             if (!left.value_known || !right.value_known) {
@@ -1887,7 +2054,7 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
             if (!left.value_known) {
               return Variable(ValueType::Int);
             }
-            if (!right.value_known) {
+            if (!right.value_known || !int_is_direct(right.int_value)) {
               return Variable(ValueType::Int);
             }
 
@@ -1897,17 +2064,12 @@ Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
                     static_cast<double>(right.int_value))));
             }
 
-            // TODO: factor this out somewhere? it's basically the same as
-            // what's in notes/pow.s
-            int64_t ret = 1, base = left.int_value, exponent = right.int_value;
-            for (; exponent > 0; exponent >>= 1) {
-              if (exponent & 1) {
-                ret *= base;
-              }
-              base *= base;
+            if (int_bit_length(left.int_value) >
+                MAX_FOLDED_INT_BITS / right.int_value) {
+              return Variable(ValueType::Int);
             }
-
-            return Variable(ValueType::Int, ret);
+            return Variable(ValueType::Int,
+                int_power(left.int_value, right.int_value));
           }
 
           if (right.type == ValueType::Float) {
@@ -129,6 +129,17 @@ bool type_has_refcount(ValueType type);
 std::string type_signature_for_variables(const std::vector<Variable>& vars,
     bool allow_indeterminate = false);
 
+// built-in functions can be generic over extension types (e.g. list.append
+// takes List[R0] and R0). this matches a call's argument type against such a
+// pattern, binding each ExtensionTypeReference to the type it corresponds to;
+// if a reference is already bound, the types must be equal
+bool match_extension_type_references(const Variable& pattern,
+    const Variable& actual, std::vector<Variable>& bindings);
+// replaces all ExtensionTypeReferences in var with their bound types
+Variable resolve_extension_type_references(const Variable& var,
+    const std::vector<Variable>& bindings);
+bool has_extension_type_references(const Variable& var);
+
 Variable execute_unary_operator(UnaryOperator oper, const Variable& var);
 Variable execute_binary_operator(BinaryOperator oper, const Variable& left,
     const Variable& right);
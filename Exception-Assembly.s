@@ -42,7 +42,7 @@ __unwind_exception_internal:
   # guarantee that something in the exception block will match, since all
   # exception blocks end with a spec that matches everything. use r8 as the
   # exception spec pointer
-  lea r8, [r14 + 40]
+  lea r8, [r14 + 48]
 
 0: __unwind_exception_internal__check_spec_match:
   mov r9, [r8 + 8]
@@ -70,11 +70,13 @@ __unwind_exception_internal:
   jmp 0b # __unwind_exception_internal__check_spec_match
 
 2: __unwind_exception_internal__restore_block:
-  # load rsp and rbp from the exception block, remove the exception block from
-  # the list in r14, and jump to the rip from the exception spec (r8)
+  # load rsp, rbp, and the other saved registers from the exception block,
+  # remove the exception block from the list in r14, and jump to the rip from
+  # the exception spec (r8)
   mov rsp, [r14 + 8]
   mov rbp, [r14 + 16]
   mov r12, [r14 + 24]
   mov r13, [r14 + 32]
+  mov rbx, [r14 + 40]
   mov r14, [r14]
   jmp [r8]
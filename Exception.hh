@@ -19,6 +19,9 @@ struct ExceptionBlock {
   void* resume_r12;
   void* resume_r13;
 
+  // for loops keep their item index in rbx, so it has to be restored too
+  void* resume_rbx;
+
   struct ExceptionBlockSpec {
     // start of the relevant except block's code
     const void* resume_rip;
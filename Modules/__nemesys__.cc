@@ -1,10 +1,13 @@
 #include "__nemesys__.hh"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <memory>
 #include <phosg/Time.hh>
@@ -17,6 +20,10 @@
 #include "../Analysis.hh"
 #include "../BuiltinFunctions.hh"
 #include "../CommonObjects.hh"
+#include "../StandardStreams.hh"
+#include "../Types/Instance.hh"
+#include "../Types/Int.hh"
+#include "../Types/List.hh"
 #include "../Types/Strings.hh"
 
 using namespace std;
@@ -35,6 +42,8 @@ static map<string, Variable> globals({
 
 std::shared_ptr<ModuleAnalysis> __nemesys___module(new ModuleAnalysis("__nemesys__", globals));
 
+int64_t stdin_lines_function_id = 0;
+
 
 
 static std::shared_ptr<ModuleAnalysis> get_module(UnicodeObject* module_name) {
@@ -55,8 +64,13 @@ static std::shared_ptr<ModuleAnalysis> get_module(UnicodeObject* module_name) {
 void __nemesys___initialize() {
   Variable None(ValueType::None);
   Variable Int(ValueType::Int);
+  Variable Int_Zero(ValueType::Int, static_cast<int64_t>(0));
+  Variable Float(ValueType::Float);
+  Variable Bool_True(ValueType::Bool, true);
   Variable Bytes(ValueType::Bytes);
   Variable Unicode(ValueType::Unicode);
+  Variable List_Any(ValueType::List, vector<Variable>({Variable()}));
+  Variable List_Unicode(ValueType::List, vector<Variable>({Unicode}));
 
   vector<BuiltinFunctionDefinition> module_function_defs({
     {"module_phase", {Unicode}, Int, void_fn_ptr([](UnicodeObject* module_name) -> int64_t {
@@ -116,6 +130,10 @@ void __nemesys___initialize() {
       return global->unicode_constants.size();
     }), false, false},
 
+    {"promoted_int_count", {}, Int, void_fn_ptr([]() -> int64_t {
+      return int_promoted_object_count();
+    }), false, false},
+
     {"debug_flags", {}, Int, void_fn_ptr([]() -> int64_t {
       return debug_flags;
     }), false, false},
@@ -131,9 +149,132 @@ void __nemesys___initialize() {
     {"errno", {}, Int, void_fn_ptr([]() -> int64_t {
       return errno;
     }), false, false},
+
+    {"stdout_buffer_size", {}, Int, void_fn_ptr([]() -> int64_t {
+      return stdout_buffer_size();
+    }), false, false},
+
+    // flushes any buffered output before changing the size. sizes below 64
+    // bytes are rounded up
+    {"set_stdout_buffer_size", {Int}, None, void_fn_ptr([](int64_t size) {
+      stdout_set_buffer_size((size < 0) ? 0 : size);
+    }), false, false},
+
+    {"flush_stdout", {}, None, void_fn_ptr([]() {
+      stdout_flush();
+    }), false, false},
+
+    {"list_growth_factor", {}, Float, void_fn_ptr([]() -> double {
+      return list_growth_factor();
+    }), false, false},
+
+    // affects all lists, including those that already exist. factors below
+    // 1.125 are rounded up
+    {"set_list_growth_factor", {Float}, None, void_fn_ptr([](double factor) {
+      list_set_growth_factor(factor);
+    }), false, false},
+
+    {"slice_view_ratio", {}, Int, void_fn_ptr([]() -> int64_t {
+      return string_slice_view_ratio();
+    }), false, false},
+
+    // bytes and unicode slices share their original object's data only if
+    // they're at least 1/ratio of its length; 0 means slices are always copied
+    {"set_slice_view_ratio", {Int}, None, void_fn_ptr([](int64_t ratio) {
+      string_set_slice_view_ratio((ratio < 0) ? 0 : ratio);
+    }), false, false},
+
+    // preallocates space in a list so that appending up to the given number of
+    // items doesn't reallocate
+    {"reserve_list", {List_Any, Int}, None, void_fn_ptr([](ListObject* l, int64_t capacity, ExceptionBlock* exc_block) {
+      if (capacity > 0) {
+        list_reserve(l, capacity, exc_block);
+      }
+      delete_reference(l);
+    }), true, false},
+
+    // reads up to max_lines lines from stdin, without their newlines; the
+    // list is empty at end of input. this is much faster than calling input()
+    // in a loop. if max_lines is 0 (the default), all of stdin is read, but a
+    // for loop over stdin_lines() doesn't call this; it reads the lines in
+    // chunks as it goes, so it doesn't hold all of stdin in memory
+    {"stdin_lines", {Int_Zero}, List_Unicode, void_fn_ptr([](int64_t max_lines, ExceptionBlock* exc_block) -> ListObject* {
+      return stdin_read_lines((max_lines < 0) ? 0 : max_lines, exc_block);
+    }), true, false},
+
+    // maps a file into memory and returns its contents as a Bytes object
+    // without copying them. if sequential is True, the kernel is told to read
+    // ahead aggressively and drop pages after they're used
+    {"map_file", {Unicode, Bool_True}, Bytes, void_fn_ptr([](UnicodeObject* path, bool sequential, ExceptionBlock* exc_block) -> BytesObject* {
+      BytesObject* path_bytes = unicode_encode_ascii(path);
+      delete_reference(path);
+
+      int fd = open(path_bytes->data, O_RDONLY);
+      delete_reference(path_bytes);
+      if (fd < 0) {
+        raise_python_exception(exc_block, create_single_attr_instance(
+            OSError_class_id, static_cast<int64_t>(errno)));
+      }
+
+      BytesObject* ret = bytes_map_file(fd, sequential);
+      int error = errno;
+      close(fd);
+      if (!ret) {
+        raise_python_exception(exc_block, create_single_attr_instance(
+            OSError_class_id, static_cast<int64_t>(error)));
+      }
+      return ret;
+    }), true, false},
+
+    // bit intrinsics. these treat their arguments as 64-bit unsigned values;
+    // ctz(0) and clz(0) are 64, and rotl's count is taken modulo 64. arguments
+    // outside the signed 64-bit range raise OverflowError. calls to these are
+    // compiled inline; the implementations here are only used for promoted
+    // values (which they release), or when the cpu doesn't have tzcnt/lzcnt
+    {"ctz", {Int}, Int, void_fn_ptr([](int64_t i, ExceptionBlock* exc_block) -> int64_t {
+      int64_t v = int_to_int64(i, exc_block);
+      int_delete_reference(i);
+      return v ? __builtin_ctzll(v) : 64;
+    }), true, false},
+
+    {"clz", {Int}, Int, void_fn_ptr([](int64_t i, ExceptionBlock* exc_block) -> int64_t {
+      int64_t v = int_to_int64(i, exc_block);
+      int_delete_reference(i);
+      return v ? __builtin_clzll(v) : 64;
+    }), true, false},
+
+    {"rotl", {Int, Int}, Int, void_fn_ptr([](int64_t i, int64_t count,
+        ExceptionBlock* exc_block) -> int64_t {
+      uint64_t u = int_to_int64(i, exc_block);
+      int64_t shift = int_to_int64(count, exc_block) & 63;
+      int_delete_reference(i);
+      int_delete_reference(count);
+      return int_from_int64((u << shift) | (u >> ((64 - shift) & 63)));
+    }), true, false},
+
+    {"bswap", {Int}, Int, void_fn_ptr([](int64_t i, ExceptionBlock* exc_block) -> int64_t {
+      uint64_t u = int_to_int64(i, exc_block);
+      int_delete_reference(i);
+      return int_from_int64(__builtin_bswap64(u));
+    }), true, false},
+  });
+
+  static const unordered_map<string, Intrinsic> name_to_intrinsic({
+    {"ctz", Intrinsic::CountTrailingZeroes},
+    {"clz", Intrinsic::CountLeadingZeroes},
+    {"rotl", Intrinsic::RotateLeft},
+    {"bswap", Intrinsic::ByteSwap},
   });
 
   for (auto& def : module_function_defs) {
-    __nemesys___module->create_builtin_function(def);
+    int64_t function_id = __nemesys___module->create_builtin_function(def);
+    if (!strcmp(def.name, "stdin_lines")) {
+      stdin_lines_function_id = function_id;
+    }
+    auto it = name_to_intrinsic.find(def.name);
+    if (it != name_to_intrinsic.end()) {
+      register_intrinsic(function_id, it->second);
+      register_promoted_int_function(function_id);
+    }
   }
 }
@@ -6,4 +6,8 @@
 
 extern std::shared_ptr<ModuleAnalysis> __nemesys___module;
 
+// for loops over stdin_lines() are compiled specially (see
+// CompilationVisitor::write_stdin_lines_for_statement)
+extern int64_t stdin_lines_function_id;
+
 void __nemesys___initialize();
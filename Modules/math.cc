@@ -6,8 +6,13 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "../Analysis.hh"
 #include "../BuiltinFunctions.hh"
+#include "../Types/Int.hh"
 #include "../Types/Tuple.hh"
 
 using namespace std;
@@ -76,45 +81,34 @@ void math_initialize() {
 
     // algorithms
 
-    {"factorial", {Int}, Int, void_fn_ptr([](int64_t a, ExceptionBlock* exc_block) -> int64_t {
-      if (a < 0) {
-        raise_python_exception(exc_block, create_instance(ValueError_class_id));
-      }
-      int64_t ret = 1;
-      for (; a > 1; a--) {
-        ret *= a;
-      }
+    {"factorial", {Int}, Int, void_fn_ptr([](int64_t v, ExceptionBlock* exc_block) -> int64_t {
+      int64_t ret = int_factorial(v, exc_block);
+      int_delete_reference(v);
       return ret;
     }), true, false},
 
     {"gcd", {Int, Int}, Int, void_fn_ptr([](int64_t a, int64_t b) -> int64_t {
-      if (a < 0) {
-        a = -a;
-      }
-      if (b < 0) {
-        b = -b;
-      }
-      while (b) {
-        int64_t t = b;
-        b = a % b;
-        a = t;
-      }
-      return a;
+      int64_t ret = int_gcd(a, b);
+      int_delete_reference(a);
+      int_delete_reference(b);
+      return ret;
     }), false, false},
 
-    // basic numerics
+    // basic numerics. calls to ceil, floor, trunc, fabs and sqrt are compiled
+    // inline when the arguments' types are supported. like python, ceil, floor
+    // and trunc raise ValueError for NaN and OverflowError for infinities
 
-    {"ceil", {Float}, Int, void_fn_ptr([](double x) -> int64_t {
-      return static_cast<int64_t>(ceil(x));
-    }), false, false},
+    {"ceil", {Float}, Int, void_fn_ptr([](double x, ExceptionBlock* exc_block) -> int64_t {
+      return int_from_double(ceil(x), exc_block);
+    }), true, false},
 
-    {"floor", {Float}, Int, void_fn_ptr([](double x) -> int64_t {
-      return static_cast<int64_t>(floor(x));
-    }), false, false},
+    {"floor", {Float}, Int, void_fn_ptr([](double x, ExceptionBlock* exc_block) -> int64_t {
+      return int_from_double(floor(x), exc_block);
+    }), true, false},
 
-    {"trunc", {Float}, Int, void_fn_ptr([](double x) -> int64_t {
-      return static_cast<int64_t>(trunc(x));
-    }), false, false},
+    {"trunc", {Float}, Int, void_fn_ptr([](double x, ExceptionBlock* exc_block) -> int64_t {
+      return int_from_double(trunc(x), exc_block);
+    }), true, false},
 
     {"copysign", {Float, Float}, Bool, void_fn_ptr([](double a, double b) -> double {
       return copysign(a, b);
@@ -198,11 +192,18 @@ void math_initialize() {
       return hypot(a, b);
     })}}, false, false},
 
-    {"sqrt", {{{Float}, Float, void_fn_ptr([](double a) -> double {
+    // unlike sqrt(3), these raise ValueError for negative arguments
+    {"sqrt", {{{Float}, Float, void_fn_ptr([](double a, ExceptionBlock* exc_block) -> double {
+      if (a < 0) {
+        raise_python_exception(exc_block, create_instance(ValueError_class_id));
+      }
       return sqrt(a);
-    })}, {{Int}, Float, void_fn_ptr([](int64_t a) -> double {
+    })}, {{Int}, Float, void_fn_ptr([](int64_t a, ExceptionBlock* exc_block) -> double {
+      if (a < 0) {
+        raise_python_exception(exc_block, create_instance(ValueError_class_id));
+      }
       return sqrt(a);
-    })}}, false, false},
+    })}}, true, false},
 
     // logarithms
 
@@ -360,7 +361,24 @@ void math_initialize() {
     })}}, false, false},
   });
 
+  static const unordered_map<string, Intrinsic> name_to_intrinsic({
+    {"ceil", Intrinsic::Ceil},
+    {"floor", Intrinsic::Floor},
+    {"trunc", Intrinsic::Truncate},
+    {"fabs", Intrinsic::FloatAbs},
+    {"sqrt", Intrinsic::SquareRoot},
+  });
+
+  static const unordered_set<string> promoted_int_functions({"factorial", "gcd"});
+
   for (auto& def : module_function_defs) {
-    math_module->create_builtin_function(def);
+    int64_t function_id = math_module->create_builtin_function(def);
+    auto it = name_to_intrinsic.find(def.name);
+    if (it != name_to_intrinsic.end()) {
+      register_intrinsic(function_id, it->second);
+    }
+    if (promoted_int_functions.count(def.name)) {
+      register_promoted_int_function(function_id);
+    }
   }
 }
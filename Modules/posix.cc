@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -13,8 +14,15 @@
 #include <sys/param.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#ifdef MACOSX
+#include <sys/socket.h>
+#else
+#include <sys/sendfile.h>
+#endif
+
 #include <memory>
 #include <phosg/Filesystem.hh>
 #include <string>
@@ -29,6 +37,7 @@
 #include "../Types/Dictionary.hh"
 
 using namespace std;
+using FragDef = BuiltinFragmentDefinition;
 
 
 
@@ -280,6 +289,8 @@ void posix_initialize() {
   Variable Float(ValueType::Float);
   Variable Bytes(ValueType::Bytes);
   Variable Unicode(ValueType::Unicode);
+  Variable List_Int(ValueType::List, vector<Variable>({Int}));
+  Variable List_Bytes(ValueType::List, vector<Variable>({Bytes}));
   Variable List_Unicode(ValueType::List, vector<Variable>({Unicode}));
   Variable Dict_Unicode_Unicode(ValueType::Dict, vector<Variable>({Unicode, Unicode}));
   Variable None(ValueType::None);
@@ -393,6 +404,17 @@ void posix_initialize() {
       return ret;
     }), true, false},
 
+    {"unlink", {Unicode}, None, void_fn_ptr([](UnicodeObject* path, ExceptionBlock* exc_block) {
+      BytesObject* path_bytes = unicode_encode_ascii(path);
+      delete_reference(path);
+
+      int ret = unlink(path_bytes->data);
+      delete_reference(path_bytes);
+      if (ret) {
+        raise_OSError(exc_block, errno);
+      }
+    }), true, false},
+
     {"read", {Int, Int}, Bytes, void_fn_ptr([](int64_t fd, int64_t buffer_size, ExceptionBlock* exc_block) -> BytesObject* {
       BytesObject* ret = bytes_new(NULL, buffer_size);
       ssize_t bytes_read = read(fd, ret->data, buffer_size);
@@ -414,6 +436,129 @@ void posix_initialize() {
       return bytes_written;
     }), true, false},
 
+    {"pread", {Int, Int, Int}, Bytes, void_fn_ptr([](int64_t fd, int64_t buffer_size, int64_t offset, ExceptionBlock* exc_block) -> BytesObject* {
+      BytesObject* ret = bytes_new(NULL, buffer_size);
+      ssize_t bytes_read = pread(fd, ret->data, buffer_size, offset);
+      if (bytes_read < 0) {
+        delete_reference(ret);
+        raise_OSError(exc_block, errno);
+      }
+      ret->count = bytes_read;
+      ret->data[bytes_read] = 0;
+      return ret;
+    }), true, false},
+
+    {"pwrite", {Int, Bytes, Int}, Int, void_fn_ptr([](int64_t fd, BytesObject* data, int64_t offset, ExceptionBlock* exc_block) -> int64_t {
+      ssize_t bytes_written = pwrite(fd, data->data, data->count, offset);
+      delete_reference(data);
+      if (bytes_written < 0) {
+        raise_OSError(exc_block, errno);
+      }
+      return bytes_written;
+    }), true, false},
+
+    // nemesys has no mutable buffer type, so it can't implement python's
+    // readv. instead, this takes a list of buffer sizes and returns a list of
+    // new Bytes objects. buffers past the end of the data read are truncated
+    // (and may be empty). like readv and writev, this raises EINVAL if there
+    // are more than IOV_MAX buffers
+    {"readv_sizes", {Int, List_Int}, List_Bytes, void_fn_ptr([](int64_t fd, ListObject* sizes, ExceptionBlock* exc_block) -> ListObject* {
+      size_t count = sizes->count;
+      if (count > IOV_MAX) {
+        delete_reference(sizes);
+        raise_OSError(exc_block, EINVAL);
+      }
+
+      ListObject* ret = list_new(count, true);
+      vector<struct iovec> iov(count);
+      for (size_t x = 0; x < count; x++) {
+        int64_t size = reinterpret_cast<int64_t>(sizes->items[x]);
+        BytesObject* buffer = bytes_new(NULL, (size < 0) ? 0 : size);
+        ret->items[x] = buffer;
+        iov[x].iov_base = buffer->data;
+        iov[x].iov_len = buffer->count;
+      }
+      delete_reference(sizes);
+
+      ssize_t bytes_read = readv(fd, iov.data(), count);
+      if (bytes_read < 0) {
+        delete_reference(ret);
+        raise_OSError(exc_block, errno);
+      }
+
+      for (size_t x = 0; x < count; x++) {
+        BytesObject* buffer = reinterpret_cast<BytesObject*>(ret->items[x]);
+        if (static_cast<size_t>(bytes_read) < buffer->count) {
+          buffer->count = bytes_read;
+        }
+        buffer->data[buffer->count] = 0;
+        bytes_read -= buffer->count;
+      }
+      return ret;
+    }), true, false},
+
+    // as with write, the caller has to handle short writes
+    {"writev", {Int, List_Bytes}, Int, void_fn_ptr([](int64_t fd, ListObject* buffers, ExceptionBlock* exc_block) -> int64_t {
+      size_t count = buffers->count;
+      if (count > IOV_MAX) {
+        delete_reference(buffers);
+        raise_OSError(exc_block, EINVAL);
+      }
+
+      vector<struct iovec> iov(count);
+      for (size_t x = 0; x < count; x++) {
+        BytesObject* buffer = reinterpret_cast<BytesObject*>(buffers->items[x]);
+        iov[x].iov_base = buffer->data;
+        iov[x].iov_len = buffer->count;
+      }
+
+      ssize_t bytes_written = writev(fd, iov.data(), count);
+      delete_reference(buffers);
+      if (bytes_written < 0) {
+        raise_OSError(exc_block, errno);
+      }
+      return bytes_written;
+    }), true, false},
+
+    // copies count bytes from in_fd to out_fd without passing them through
+    // user space. if offset is None, in_fd's file position is used (and
+    // advanced); otherwise, it's left unchanged
+    {"sendfile", {
+      FragDef({Int, Int, None, Int}, Int, void_fn_ptr([](int64_t out_fd, int64_t in_fd, void*, int64_t count, ExceptionBlock* exc_block) -> int64_t {
+#ifdef MACOSX
+        off_t offset = lseek(in_fd, 0, SEEK_CUR);
+        if (offset < 0) {
+          raise_OSError(exc_block, errno);
+        }
+        off_t bytes_sent = count;
+        if (sendfile(in_fd, out_fd, offset, &bytes_sent, NULL, 0) && !bytes_sent) {
+          raise_OSError(exc_block, errno);
+        }
+        lseek(in_fd, offset + bytes_sent, SEEK_SET);
+#else
+        ssize_t bytes_sent = sendfile(out_fd, in_fd, NULL, count);
+        if (bytes_sent < 0) {
+          raise_OSError(exc_block, errno);
+        }
+#endif
+        return bytes_sent;
+      })),
+      FragDef({Int, Int, Int, Int}, Int, void_fn_ptr([](int64_t out_fd, int64_t in_fd, int64_t offset, int64_t count, ExceptionBlock* exc_block) -> int64_t {
+#ifdef MACOSX
+        off_t bytes_sent = count;
+        if (sendfile(in_fd, out_fd, offset, &bytes_sent, NULL, 0) && !bytes_sent) {
+          raise_OSError(exc_block, errno);
+        }
+#else
+        off_t off = offset;
+        ssize_t bytes_sent = sendfile(out_fd, in_fd, &off, count);
+        if (bytes_sent < 0) {
+          raise_OSError(exc_block, errno);
+        }
+#endif
+        return bytes_sent;
+      }))}, true, false},
+
     {"execv", {Unicode, List_Unicode}, None, void_fn_ptr([](UnicodeObject* path, ListObject* args, ExceptionBlock* exc_block) {
 
       BytesObject* path_bytes = unicode_encode_ascii(path);
@@ -715,11 +860,8 @@ void posix_initialize() {
     // {"pipe2", Variable()}, // linux only
     // {"posix_fadvise", Variable()}, // linux only
     // {"posix_fallocate", Variable()}, // linux only
-    // {"pread", Variable()},
     // {"putenv", Variable()},
-    // {"pwrite", Variable()},
     // {"readlink", Variable()},
-    // {"readv", Variable()},
     // {"remove", Variable()},
     // {"removexattr", Variable()}, // linux only
     // {"rename", Variable()},
@@ -737,7 +879,6 @@ void posix_initialize() {
     // {"sched_setparam", Variable()}, // linux only
     // {"sched_setscheduler", Variable()}, // linux only
     // {"sched_yield", Variable()},
-    // {"sendfile", Variable()},
     // {"set_blocking", Variable()},
     // {"set_inheritable", Variable()},
     // {"setegid", Variable()},
@@ -769,7 +910,6 @@ void posix_initialize() {
     // {"umask", Variable()},
     // {"uname", Variable()},
     // {"uname_result", Variable()},
-    // {"unlink", Variable()},
     // {"unsetenv", Variable()},
     // {"urandom", Variable()},
     // {"utime", Variable()},
@@ -779,7 +919,6 @@ void posix_initialize() {
     // {"waitid", Variable()}, // linux only
     // {"waitid_result", Variable()}, // linux only
     // {"waitpid", Variable()},
-    // {"writev", Variable()},
   });
 
   for (auto& def : module_function_defs) {
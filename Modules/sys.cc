@@ -14,6 +14,7 @@
 
 #include "../Analysis.hh"
 #include "../BuiltinFunctions.hh"
+#include "../Types/Int.hh"
 #include "../Types/Strings.hh"
 #include "../Types/List.hh"
 
@@ -57,7 +58,7 @@ static map<string, Variable> globals({
   // {"last_traceback",       Variable()},
   // {"last_type",            Variable()},
   // {"last_value",           Variable()},
-  {"maxsize",              Variable(ValueType::Int, static_cast<int64_t>(0x7FFFFFFFFFFFFFFFLL))},
+  // maxsize is added by sys_initialize, since it's a promoted Int
   {"maxunicode",           Variable(ValueType::Int, static_cast<int64_t>(0x10FFFFLL))},
   // {"modules",              Variable()},
   // {"path",                 Variable()},
@@ -119,4 +120,8 @@ void sys_initialize() {
   for (auto& def : module_function_defs) {
     sys_module->create_builtin_function(def);
   }
+
+  // this is a constant, so it's never released (see Types/Int.hh)
+  sys_module->globals.emplace("maxsize", Variable(ValueType::Int,
+      int_from_int64(INT64_MAX)));
 }
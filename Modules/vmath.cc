@@ -0,0 +1,272 @@
+#include "vmath.hh"
+
+#include <emmintrin.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "../Analysis.hh"
+#include "../BuiltinFunctions.hh"
+#include "../Types/List.hh"
+
+using namespace std;
+
+
+
+static wstring __doc__ = L"Mathematical functions applied to every item of a list of floats.";
+
+static map<string, Variable> globals({
+  {"__doc__",     Variable(ValueType::Unicode, __doc__)},
+  {"__name__",    Variable(ValueType::Unicode, L"vmath")},
+  {"__package__", Variable(ValueType::Unicode, L"")},
+});
+
+std::shared_ptr<ModuleAnalysis> vmath_module(new ModuleAnalysis("vmath", globals));
+
+
+
+// each kernel computes dest[x] = f(src[x]) for count items. dest may be the
+// same as src. exp and log work on two items at a time with SSE2 and use their
+// own polynomial approximations, so their results can differ from the math
+// module's in the last bit. measured against long double results on random
+// inputs over their whole ranges:
+// - exp's error is at most 1.2 ULP
+// - log's error is at most 0.8 ULP
+// - sqrt is exact (it's sqrtpd)
+// items where the approximations don't apply (infinities, NaNs, and values
+// whose results aren't normal doubles) are done by libm, so they have the same
+// results as the math module's functions. like those, these don't raise
+// exceptions for domain errors; they return NaN or infinity instead
+
+typedef void (*Kernel)(double* dest, const double* src, size_t count);
+
+// applies a two-item kernel body to all items, including the last odd one
+template <__m128d (*Body)(__m128d)>
+static void apply_pairwise(double* dest, const double* src, size_t count) {
+  size_t x = 0;
+  for (; x + 2 <= count; x += 2) {
+    _mm_storeu_pd(&dest[x], Body(_mm_loadu_pd(&src[x])));
+  }
+  if (x < count) {
+    double lanes[2] = {src[x], src[x]};
+    _mm_storeu_pd(lanes, Body(_mm_loadu_pd(lanes)));
+    dest[x] = lanes[0];
+  }
+}
+
+// bodies compute approximations for both lanes, then replace the lanes where
+// in_range is false with libm's results
+template <double (*LibmFunction)(double)>
+static __m128d fix_out_of_range_lanes(__m128d v, __m128d result,
+    __m128d in_range) {
+  int mask = _mm_movemask_pd(in_range);
+  if (mask == 3) {
+    return result;
+  }
+  double inputs[2], outputs[2];
+  _mm_storeu_pd(inputs, v);
+  _mm_storeu_pd(outputs, result);
+  for (size_t lane = 0; lane < 2; lane++) {
+    if (!(mask & (1 << lane))) {
+      outputs[lane] = LibmFunction(inputs[lane]);
+    }
+  }
+  return _mm_loadu_pd(outputs);
+}
+
+static double libm_exp(double x) {
+  return exp(x);
+}
+
+static double libm_log(double x) {
+  return log(x);
+}
+
+// ln(2) split so that n * ln2_hi is exact for any exponent n
+static const double ln2_hi = 6.93147180369123816490e-01;
+static const double ln2_lo = 1.90821492927058770002e-10;
+
+// exp(x) = 2^n * exp(r), where n = round(x / ln(2)) and |r| <= ln(2) / 2.
+// exp(r) comes from its Taylor series up to r^13, whose truncation error is
+// far below 1 ULP on that interval. the range is limited so that 2^n and the
+// result are normal
+static __m128d exp_body(__m128d v) {
+  __m128d in_range = _mm_and_pd(_mm_cmpge_pd(v, _mm_set1_pd(-708.0)),
+      _mm_cmple_pd(v, _mm_set1_pd(709.0)));
+
+  __m128i n = _mm_cvtpd_epi32(_mm_mul_pd(v, _mm_set1_pd(1.4426950408889634)));
+  __m128d nd = _mm_cvtepi32_pd(n);
+  __m128d r = _mm_sub_pd(v, _mm_mul_pd(nd, _mm_set1_pd(ln2_hi)));
+  r = _mm_sub_pd(r, _mm_mul_pd(nd, _mm_set1_pd(ln2_lo)));
+
+  static const double coeffs[] = {
+      1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0,
+      1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0,
+      1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0};
+  __m128d p = _mm_set1_pd(coeffs[0]);
+  for (size_t x = 1; x < sizeof(coeffs) / sizeof(coeffs[0]); x++) {
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(coeffs[x]));
+  }
+
+  // 2^n is built directly from its exponent bits; n is in the low 32 bits of
+  // each 64-bit lane after unpacking, and n + 1023 is always positive here
+  __m128i biased = _mm_add_epi32(n, _mm_set1_epi32(1023));
+  __m128i scale_bits = _mm_slli_epi64(
+      _mm_unpacklo_epi32(biased, _mm_setzero_si128()), 52);
+  __m128d result = _mm_mul_pd(p, _mm_castsi128_pd(scale_bits));
+
+  return fix_out_of_range_lanes<libm_exp>(v, result, in_range);
+}
+
+// log(x) = e * ln(2) + log(m), where x = m * 2^e and sqrt(1/2) <= m < sqrt(2).
+// with f = m - 1 and s = f / (2 + f), log(m) = 2 * atanh(s) = 2s + s * R(s^2),
+// and |s| < 0.172, so the series for R up to s^22 is accurate to far below 1
+// ULP. like fdlibm, this is rearranged as f - (f^2/2 - s * (f^2/2 + R)) so
+// that the largest term is exact. subnormal inputs are done by libm, since
+// their exponent bits don't give e directly
+static __m128d log_body(__m128d v) {
+  __m128d in_range = _mm_and_pd(_mm_cmpge_pd(v, _mm_set1_pd(DBL_MIN)),
+      _mm_cmple_pd(v, _mm_set1_pd(DBL_MAX)));
+
+  __m128i bits = _mm_castpd_si128(v);
+  __m128i e64 = _mm_sub_epi64(_mm_srli_epi64(bits, 52), _mm_set1_epi64x(1023));
+  __m128d e = _mm_cvtepi32_pd(_mm_shuffle_epi32(e64, _MM_SHUFFLE(3, 1, 2, 0)));
+  __m128d m = _mm_castsi128_pd(_mm_or_si128(
+      _mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFF)),
+      _mm_set1_epi64x(0x3FF0000000000000)));
+
+  // move m from [1, 2) to [sqrt(1/2), sqrt(2))
+  __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(1.4142135623730951));
+  m = _mm_or_pd(_mm_andnot_pd(big, m),
+      _mm_and_pd(big, _mm_mul_pd(m, _mm_set1_pd(0.5))));
+  e = _mm_add_pd(e, _mm_and_pd(big, _mm_set1_pd(1.0)));
+
+  __m128d f = _mm_sub_pd(m, _mm_set1_pd(1.0));
+  __m128d s = _mm_div_pd(f, _mm_add_pd(f, _mm_set1_pd(2.0)));
+  __m128d z = _mm_mul_pd(s, s);
+  __m128d r = _mm_set1_pd(2.0 / 23.0);
+  for (int64_t k = 21; k >= 3; k -= 2) {
+    r = _mm_add_pd(_mm_mul_pd(r, z), _mm_set1_pd(2.0 / k));
+  }
+  r = _mm_mul_pd(r, z);
+  __m128d hfsq = _mm_mul_pd(_mm_set1_pd(0.5), _mm_mul_pd(f, f));
+
+  // e * ln2_hi - ((hfsq - (s * (hfsq + r) + e * ln2_lo)) - f)
+  __m128d correction = _mm_add_pd(_mm_mul_pd(s, _mm_add_pd(hfsq, r)),
+      _mm_mul_pd(e, _mm_set1_pd(ln2_lo)));
+  __m128d result = _mm_sub_pd(_mm_mul_pd(e, _mm_set1_pd(ln2_hi)),
+      _mm_sub_pd(_mm_sub_pd(hfsq, correction), f));
+
+  return fix_out_of_range_lanes<libm_log>(v, result, in_range);
+}
+
+static __m128d sqrt_body(__m128d v) {
+  return _mm_sqrt_pd(v);
+}
+
+// the trigonometric functions are just libm calls in a loop
+template <double (*LibmFunction)(double)>
+static void libm_kernel(double* dest, const double* src, size_t count) {
+  for (size_t x = 0; x < count; x++) {
+    dest[x] = LibmFunction(src[x]);
+  }
+}
+
+static double libm_sin(double x) {
+  return sin(x);
+}
+
+static double libm_cos(double x) {
+  return cos(x);
+}
+
+// lists at least this long are split into chunks that are done on separate
+// threads, up to one per cpu
+static const size_t parallel_threshold = 0x20000;
+
+static void apply_kernel(Kernel kernel, double* dest, const double* src,
+    size_t count) {
+  size_t thread_count = min<size_t>(thread::hardware_concurrency(),
+      count / parallel_threshold);
+  if (thread_count < 2) {
+    kernel(dest, src, count);
+    return;
+  }
+
+  // chunks have even sizes so pairs of items are the same as when the list is
+  // done all at once; the last chunk (done on this thread) gets the remainder.
+  // if a thread can't be started, this thread also does the chunks that
+  // weren't started yet
+  size_t chunk_size = (count / thread_count) & ~static_cast<size_t>(1);
+  vector<thread> threads;
+  threads.reserve(thread_count - 1);
+  size_t offset = 0;
+  for (size_t x = 0; x < thread_count - 1; x++, offset += chunk_size) {
+    try {
+      threads.emplace_back(kernel, dest + offset, src + offset, chunk_size);
+    } catch (const system_error&) {
+      break;
+    }
+  }
+  kernel(dest + offset, src + offset, count - offset);
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+// these take ownership of their arguments, like all builtin functions
+template <Kernel K>
+static ListObject* map_new(ListObject* l, ExceptionBlock* exc_block) {
+  ListObject* ret = list_new(l->count, false, exc_block);
+  apply_kernel(K, list_float_items(ret), list_float_items(l), l->count);
+  delete_reference(l);
+  return ret;
+}
+
+template <Kernel K>
+static void map_into(ListObject* l, ListObject* dest, ExceptionBlock* exc_block) {
+  if (l->count != dest->count) {
+    delete_reference(l);
+    delete_reference(dest);
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    throw invalid_argument("lists have different lengths");
+  }
+  apply_kernel(K, list_float_items(dest), list_float_items(l), l->count);
+  delete_reference(l);
+  delete_reference(dest);
+}
+
+
+
+void vmath_initialize() {
+  Variable None(ValueType::None);
+  Variable Float(ValueType::Float);
+  Variable List_Float(ValueType::List, vector<Variable>({Float}));
+
+  // each function f has two forms: f(List[Float]) returns a new list of the
+  // results, and f_into(List[Float], List[Float]) writes them to the second
+  // list, which must be the same length as the first (and may be the same list)
+  vector<BuiltinFunctionDefinition> module_function_defs({
+    {"exp", {List_Float}, List_Float, void_fn_ptr(&map_new<apply_pairwise<exp_body>>), true, false},
+    {"exp_into", {List_Float, List_Float}, None, void_fn_ptr(&map_into<apply_pairwise<exp_body>>), true, false},
+    {"log", {List_Float}, List_Float, void_fn_ptr(&map_new<apply_pairwise<log_body>>), true, false},
+    {"log_into", {List_Float, List_Float}, None, void_fn_ptr(&map_into<apply_pairwise<log_body>>), true, false},
+    {"sqrt", {List_Float}, List_Float, void_fn_ptr(&map_new<apply_pairwise<sqrt_body>>), true, false},
+    {"sqrt_into", {List_Float, List_Float}, None, void_fn_ptr(&map_into<apply_pairwise<sqrt_body>>), true, false},
+    {"sin", {List_Float}, List_Float, void_fn_ptr(&map_new<libm_kernel<libm_sin>>), true, false},
+    {"sin_into", {List_Float, List_Float}, None, void_fn_ptr(&map_into<libm_kernel<libm_sin>>), true, false},
+    {"cos", {List_Float}, List_Float, void_fn_ptr(&map_new<libm_kernel<libm_cos>>), true, false},
+    {"cos_into", {List_Float, List_Float}, None, void_fn_ptr(&map_into<libm_kernel<libm_cos>>), true, false},
+  });
+
+  for (auto& def : module_function_defs) {
+    vmath_module->create_builtin_function(def);
+  }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <memory>
+
+#include "../Analysis.hh"
+
+extern std::shared_ptr<ModuleAnalysis> vmath_module;
+void vmath_initialize();
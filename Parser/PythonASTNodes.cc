@@ -205,7 +205,7 @@ void UnaryOperation::accept(ASTVisitor* v) {
 BinaryOperation::BinaryOperation(BinaryOperator oper,
     shared_ptr<Expression> left, shared_ptr<Expression> right,
     size_t file_offset) : Expression(file_offset), oper(oper), left(left),
-    right(right) { }
+    right(right), format_known(false) { }
 
 static const char* binary_operator_names[] = {
   "or",
@@ -1035,7 +1035,7 @@ ForStatement::ForStatement(shared_ptr<Expression> variable,
     shared_ptr<Expression> collection, vector<shared_ptr<Statement>>&& items,
     shared_ptr<ElseStatement> else_suite, size_t file_offset) :
     CompoundStatement(move(items), file_offset), variable(variable),
-    collection(collection) { }
+    collection(collection), else_suite(else_suite), fused_iteration(false) { }
 
 string ForStatement::str() const {
   return "for " + this->variable->str() + " in " + this->collection->str() + ":";
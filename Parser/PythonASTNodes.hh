@@ -120,6 +120,13 @@ struct BinaryOperation : Expression {
   std::shared_ptr<Expression> left;
   std::shared_ptr<Expression> right;
 
+  // annotations
+  // for Modulus on a Bytes or Unicode value that's known at compile time, the
+  // format string (only the one matching the left type is used)
+  bool format_known;
+  std::string bytes_format;
+  std::wstring unicode_format;
+
   BinaryOperation(BinaryOperator oper, std::shared_ptr<Expression> left,
       std::shared_ptr<Expression> right, size_t file_offset);
 
@@ -647,6 +654,11 @@ struct ForStatement : CompoundStatement {
   std::shared_ptr<Expression> collection;
   std::shared_ptr<ElseStatement> else_suite; // may be NULL
 
+  // annotations
+  // true if collection is a call to enumerate() or zip() and variable unpacks
+  // each of its items; these loops iterate over the call's arguments directly
+  bool fused_iteration;
+
   ForStatement(std::shared_ptr<Expression> variable,
       std::shared_ptr<Expression> collection,
       std::vector<std::shared_ptr<Statement>>&& items,
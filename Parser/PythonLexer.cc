@@ -4,8 +4,10 @@
 #include <phosg/Strings.hh>
 #include <string>
 #include <set>
+#include <vector>
 
 #include "PythonLexer.hh"
+#include "../Types/Int.hh"
 
 using namespace std;
 
@@ -193,7 +195,7 @@ wstring unescape_unicode(const char* s, size_t size) {
               !isxdigit(s[x + 4]) || !isxdigit(s[x + 5])) {
             throw invalid_argument("invalid character in unicode16 escape sequence");
           }
-          ret += static_cast<char>((value_for_hex_char(s[x + 2]) << 12) |
+          ret += static_cast<wchar_t>((value_for_hex_char(s[x + 2]) << 12) |
                                    (value_for_hex_char(s[x + 3]) << 8) |
                                    (value_for_hex_char(s[x + 4]) << 4) |
                                    value_for_hex_char(s[x + 5]));
@@ -210,7 +212,7 @@ wstring unescape_unicode(const char* s, size_t size) {
               !isxdigit(s[x + 8]) || !isxdigit(s[x + 9])) {
             throw invalid_argument("invalid character in unicode32 escape sequence");
           }
-          ret += static_cast<char>((value_for_hex_char(s[x + 2]) << 28) |
+          ret += static_cast<wchar_t>((value_for_hex_char(s[x + 2]) << 28) |
                                    (value_for_hex_char(s[x + 3]) << 24) |
                                    (value_for_hex_char(s[x + 4]) << 20) |
                                    (value_for_hex_char(s[x + 5]) << 16) |
@@ -622,7 +624,7 @@ static size_t get_line_indent(const char* str) {
 
 
 PythonLexer::Token::Token(TokenType type, const string& string_data,
-    float float_data, int64_t int_data, size_t text_offset, size_t text_length)
+    double float_data, int64_t int_data, size_t text_offset, size_t text_length)
     : type(type), string_data(string_data), float_data(float_data),
     int_data(int_data), text_offset(text_offset), text_length(text_length) { }
 
@@ -835,8 +837,22 @@ PythonLexer::PythonLexer(shared_ptr<const SourceFile> source) : source(source) {
         token = Token(TokenType::_Float, string(str, match_length), data, 0,
             position, match_length);
       } else if (match_length && !float_match) {
-        long long data;
-        sscanf(str, hex_match ? "%llX" : "%lld", &data);
+        // literals that don't fit in 64 bits are promoted (see Types/Int.hh)
+        vector<uint8_t> digits;
+        for (size_t x = hex_match ? 2 : 0; x < match_length; x++) {
+          char ch = str[x];
+          if (is_digit(ch)) {
+            digits.emplace_back(ch - '0');
+          } else if ((ch >= 'a') && (ch <= 'f')) {
+            digits.emplace_back(ch - 'a' + 10);
+          } else if ((ch >= 'A') && (ch <= 'F')) {
+            digits.emplace_back(ch - 'A' + 10);
+          } else {
+            break; // the L suffix
+          }
+        }
+        int64_t data = int_from_digits(digits.data(), digits.size(),
+            hex_match ? 16 : 10, false);
         token = Token(TokenType::_Integer, string(str, match_length), 0,
             data, position, match_length);
       }
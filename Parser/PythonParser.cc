@@ -875,6 +875,16 @@ shared_ptr<Expression> PythonParser::parse_expression(ssize_t end_offset,
           ParseError::IncompleteParsing, "parenthesized section is incomplete");
       this->advance_token();
 
+      // if there's no comma, it's just a parenthesized expression, not a tuple
+      if ((this->token_num < end_offset - 1) &&
+          (this->find_bracketed_end(TokenType::_Comma, end_offset - 1) < 0)) {
+        auto expr = this->parse_expression(end_offset - 1);
+        this->expect_offset(end_offset - 1, ParseError::IncompleteParsing,
+            "parenthesized expression is incomplete");
+        this->advance_token();
+        return expr;
+      }
+
       // parse the tuple values
       auto items = this->parse_expression_list(end_offset - 1);
       this->expect_offset(end_offset - 1, ParseError::IncompleteParsing,
@@ -0,0 +1,423 @@
+#include "StandardStreams.hh"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "BuiltinFunctions.hh"
+#include "Types/Format.hh"
+#include "Types/Int.hh"
+
+using namespace std;
+
+
+
+struct OutputBuffer {
+  int fd;
+  char* data;
+  size_t size;
+  size_t used;
+  bool line_buffered;
+
+  OutputBuffer(int fd, size_t size) : fd(fd), data(NULL), size(size), used(0),
+      line_buffered(false) { }
+};
+
+static OutputBuffer stdout_buffer(1, 0x10000);
+
+static void stdout_flush_at_exit() {
+  stdout_flush();
+}
+
+// allocates the buffer on first use, so programs that never print don't pay
+// for it (and so the size can be changed before anything is written)
+static inline void stdout_prepare() {
+  if (!stdout_buffer.data) {
+    stdout_buffer.data = reinterpret_cast<char*>(malloc(stdout_buffer.size));
+    if (!stdout_buffer.data) {
+      throw bad_alloc();
+    }
+    stdout_buffer.line_buffered = isatty(stdout_buffer.fd);
+    static bool atexit_registered = false;
+    if (!atexit_registered) {
+      atexit(stdout_flush_at_exit);
+      atexit_registered = true;
+    }
+  }
+}
+
+// makes sure there are at least `size` bytes free in the buffer. size must not
+// be larger than the buffer
+static inline char* stdout_reserve(size_t size) {
+  stdout_prepare();
+  if (stdout_buffer.size - stdout_buffer.used < size) {
+    stdout_flush();
+  }
+  return &stdout_buffer.data[stdout_buffer.used];
+}
+
+void stdout_set_buffer_size(size_t size) {
+  if (size < 0x40) {
+    size = 0x40; // enough for any single number
+  }
+  stdout_flush();
+  free(stdout_buffer.data);
+  stdout_buffer.data = NULL;
+  stdout_buffer.size = size;
+}
+
+size_t stdout_buffer_size() {
+  return stdout_buffer.size;
+}
+
+void stdout_flush() {
+  size_t offset = 0;
+  while (offset < stdout_buffer.used) {
+    ssize_t bytes_written = write(stdout_buffer.fd,
+        &stdout_buffer.data[offset], stdout_buffer.used - offset);
+    if (bytes_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break; // there's nowhere to report the error; drop the data
+    }
+    offset += bytes_written;
+  }
+  stdout_buffer.used = 0;
+}
+
+void stdout_write(const char* data, size_t size) {
+  stdout_prepare();
+
+  // if the data doesn't fit, write whatever's buffered and then the data
+  // directly if it's still too large
+  if (stdout_buffer.size - stdout_buffer.used < size) {
+    stdout_flush();
+    if (size >= stdout_buffer.size) {
+      stdout_buffer.used = 0;
+      while (size) {
+        ssize_t bytes_written = write(stdout_buffer.fd, data, size);
+        if (bytes_written < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          return;
+        }
+        data += bytes_written;
+        size -= bytes_written;
+      }
+      return;
+    }
+  }
+
+  memcpy(&stdout_buffer.data[stdout_buffer.used], data, size);
+  stdout_buffer.used += size;
+  if (stdout_buffer.line_buffered && memchr(data, '\n', size)) {
+    stdout_flush();
+  }
+}
+
+void stdout_write_char(int64_t ch) {
+  if (ch >= 0x80) {
+    wchar_t wch = ch;
+    stdout_write_unicode(&wch, 1);
+    return;
+  }
+  char* out = stdout_reserve(1);
+  *out = ch;
+  stdout_buffer.used++;
+  if (stdout_buffer.line_buffered && (ch == '\n')) {
+    stdout_flush();
+  }
+}
+
+void stdout_write_none() {
+  stdout_write("None", 4);
+}
+
+void stdout_write_bool(bool value) {
+  if (value) {
+    stdout_write("True", 4);
+  } else {
+    stdout_write("False", 5);
+  }
+}
+
+void stdout_write_int(int64_t value) {
+  if (!int_is_direct(value)) {
+    static string digits;
+    if (int_format_digits(digits, value, 10)) {
+      stdout_write("-", 1);
+    }
+    stdout_write(digits.data(), digits.size());
+    return;
+  }
+  char* out = stdout_reserve(20);
+  stdout_buffer.used += format_decimal_int(out, value);
+}
+
+void stdout_write_float(double value) {
+  // %lg never produces more than about 15 characters, so this always fits
+  // python doesn't show the sign of a NaN
+  char* out = stdout_reserve(0x20);
+  stdout_buffer.used += snprintf(out, 0x20, "%lg", isnan(value) ? fabs(value) : value);
+}
+
+void stdout_write_bytes(const BytesObject* s) {
+  stdout_write(s->data, s->count);
+}
+
+void stdout_write_unicode(const UnicodeObject* s) {
+  stdout_write_unicode(s->data, s->count);
+}
+
+void stdout_write_unicode(const wchar_t* data, size_t count) {
+  stdout_prepare();
+
+  bool wrote_newline = false;
+  const wchar_t* end = data + count;
+  while (data != end) {
+    // encode as many characters as are guaranteed to fit in the buffer
+    size_t available = stdout_buffer.size - stdout_buffer.used;
+    if (available < 4) {
+      stdout_flush();
+      available = stdout_buffer.size;
+    }
+    const wchar_t* chunk_end = ((end - data) > static_cast<ssize_t>(available / 4)) ?
+        (data + available / 4) : end;
+
+    char* out = &stdout_buffer.data[stdout_buffer.used];
+    char* out_start = out;
+    for (; data != chunk_end; data++) {
+      uint32_t ch = *data;
+      if (ch < 0x80) {
+        *(out++) = ch;
+        wrote_newline |= (ch == '\n');
+      } else if (ch < 0x800) {
+        *(out++) = 0xC0 | (ch >> 6);
+        *(out++) = 0x80 | (ch & 0x3F);
+      } else if (ch < 0x10000) {
+        *(out++) = 0xE0 | (ch >> 12);
+        *(out++) = 0x80 | ((ch >> 6) & 0x3F);
+        *(out++) = 0x80 | (ch & 0x3F);
+      } else {
+        *(out++) = 0xF0 | ((ch >> 18) & 0x07);
+        *(out++) = 0x80 | ((ch >> 12) & 0x3F);
+        *(out++) = 0x80 | ((ch >> 6) & 0x3F);
+        *(out++) = 0x80 | (ch & 0x3F);
+      }
+    }
+    stdout_buffer.used += (out - out_start);
+  }
+
+  if (stdout_buffer.line_buffered && wrote_newline) {
+    stdout_flush();
+  }
+}
+
+
+
+struct InputBuffer {
+  int fd;
+  char* data;
+  size_t size;
+  size_t start; // offset of the first unconsumed byte
+  size_t end; // offset past the last byte read
+  bool eof;
+
+  InputBuffer(int fd, size_t size) : fd(fd), data(NULL), size(size), start(0),
+      end(0), eof(false) { }
+};
+
+static InputBuffer stdin_buffer(0, 0x10000);
+
+// reads more data into the buffer, moving the unconsumed data to the beginning
+// first and growing the buffer if it's full. returns false at end of input
+static bool stdin_fill(ExceptionBlock* exc_block) {
+  if (stdin_buffer.eof) {
+    return false;
+  }
+
+  if (stdin_buffer.start) {
+    memmove(stdin_buffer.data, &stdin_buffer.data[stdin_buffer.start],
+        stdin_buffer.end - stdin_buffer.start);
+    stdin_buffer.end -= stdin_buffer.start;
+    stdin_buffer.start = 0;
+  }
+  if (!stdin_buffer.data || (stdin_buffer.end == stdin_buffer.size)) {
+    size_t new_size = stdin_buffer.data ? (stdin_buffer.size * 2) : stdin_buffer.size;
+    char* new_data = reinterpret_cast<char*>(realloc(stdin_buffer.data, new_size));
+    if (!new_data) {
+      raise_python_exception(exc_block, &MemoryError_instance);
+      throw bad_alloc();
+    }
+    stdin_buffer.data = new_data;
+    stdin_buffer.size = new_size;
+  }
+
+  stdout_flush();
+  for (;;) {
+    ssize_t bytes_read = read(stdin_buffer.fd,
+        &stdin_buffer.data[stdin_buffer.end],
+        stdin_buffer.size - stdin_buffer.end);
+    if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      bytes_read = 0; // treat errors like end of input
+    }
+    if (bytes_read == 0) {
+      stdin_buffer.eof = true;
+      return false;
+    }
+    stdin_buffer.end += bytes_read;
+    return true;
+  }
+}
+
+// decodes size bytes of UTF-8 into out, or just counts the characters if out
+// is NULL. returns the number of characters
+static size_t utf8_decode(const uint8_t* data, size_t size, wchar_t* out) {
+  size_t count = 0;
+  const uint8_t* end = data + size;
+  while (data != end) {
+    uint32_t ch = *data;
+    if (ch < 0x80) {
+      data++;
+
+    } else {
+      size_t extra_bytes;
+      if ((ch & 0xE0) == 0xC0) {
+        extra_bytes = 1;
+        ch &= 0x1F;
+      } else if ((ch & 0xF0) == 0xE0) {
+        extra_bytes = 2;
+        ch &= 0x0F;
+      } else if ((ch & 0xF8) == 0xF0) {
+        extra_bytes = 3;
+        ch &= 0x07;
+      } else {
+        extra_bytes = 0; // continuation byte or invalid lead byte
+      }
+
+      size_t x = 0;
+      if (extra_bytes && (static_cast<size_t>(end - data) > extra_bytes)) {
+        for (x = 1; x <= extra_bytes; x++) {
+          if ((data[x] & 0xC0) != 0x80) {
+            break;
+          }
+          ch = (ch << 6) | (data[x] & 0x3F);
+        }
+      }
+      if (extra_bytes && (x == extra_bytes + 1)) {
+        data += x;
+      } else {
+        ch = 0xFFFD;
+        data++;
+      }
+    }
+
+    if (out) {
+      out[count] = ch;
+    }
+    count++;
+  }
+  return count;
+}
+
+static bool is_ascii(const uint8_t* data, size_t size) {
+  uint64_t high_bits = 0;
+  size_t x = 0;
+  for (; x + 8 <= size; x += 8) {
+    uint64_t word;
+    memcpy(&word, &data[x], 8);
+    high_bits |= word;
+  }
+  for (; x < size; x++) {
+    high_bits |= data[x];
+  }
+  return !(high_bits & 0x8080808080808080);
+}
+
+static UnicodeObject* unicode_from_utf8(const char* data, size_t size,
+    ExceptionBlock* exc_block) {
+  const uint8_t* udata = reinterpret_cast<const uint8_t*>(data);
+  if (is_ascii(udata, size)) {
+    UnicodeObject* ret = unicode_new(NULL, size, exc_block);
+    for (size_t x = 0; x < size; x++) {
+      ret->data[x] = udata[x];
+    }
+    ret->data[size] = 0;
+    return ret;
+  }
+
+  UnicodeObject* ret = unicode_new(NULL, utf8_decode(udata, size, NULL), exc_block);
+  utf8_decode(udata, size, ret->data);
+  ret->data[ret->count] = 0;
+  return ret;
+}
+
+UnicodeObject* stdin_read_line(ExceptionBlock* exc_block) {
+  size_t scan_offset = stdin_buffer.start;
+  for (;;) {
+    char* newline = (stdin_buffer.end == scan_offset) ? NULL :
+        reinterpret_cast<char*>(memchr(&stdin_buffer.data[scan_offset], '\n',
+          stdin_buffer.end - scan_offset));
+    if (newline) {
+      char* line = &stdin_buffer.data[stdin_buffer.start];
+      stdin_buffer.start = newline - stdin_buffer.data + 1;
+      return unicode_from_utf8(line, newline - line, exc_block);
+    }
+
+    // don't rescan the bytes we already looked at after reading more
+    scan_offset = stdin_buffer.end - stdin_buffer.start;
+    if (!stdin_fill(exc_block)) {
+      break;
+    }
+    scan_offset += stdin_buffer.start;
+  }
+
+  // the last line might not end with a newline
+  if (stdin_buffer.start == stdin_buffer.end) {
+    return NULL;
+  }
+  char* line = &stdin_buffer.data[stdin_buffer.start];
+  size_t size = stdin_buffer.end - stdin_buffer.start;
+  stdin_buffer.start = stdin_buffer.end;
+  return unicode_from_utf8(line, size, exc_block);
+}
+
+ListObject* stdin_read_lines(size_t max_lines, ExceptionBlock* exc_block) {
+  if (max_lines) {
+    ListObject* ret = list_new(0, true, exc_block);
+    while (ret->count < max_lines) {
+      UnicodeObject* line = stdin_read_line(exc_block);
+      if (!line) {
+        break;
+      }
+      list_append(ret, line, exc_block);
+      delete_reference(line); // list_append added a reference
+    }
+    return ret;
+  }
+
+  // read everything first, so the list can be allocated at its final size
+  while (stdin_fill(exc_block));
+
+  const char* data = &stdin_buffer.data[stdin_buffer.start];
+  const char* end = &stdin_buffer.data[stdin_buffer.end];
+  size_t line_count = 0;
+  for (const char* pos = data; pos != end; line_count++) {
+    const char* newline = reinterpret_cast<const char*>(memchr(pos, '\n', end - pos));
+    pos = newline ? (newline + 1) : end;
+  }
+
+  ListObject* ret = list_new(line_count, true, exc_block);
+  for (size_t x = 0; x < line_count; x++) {
+    ret->items[x] = stdin_read_line(exc_block);
+  }
+  return ret;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Types/List.hh"
+#include "Types/Strings.hh"
+
+
+// nemesys writes to stdout through its own buffer instead of through stdio, so
+// print() doesn't pay for stdio's locking or wide-character conversion. the
+// buffer is written with a single write(2) when it's full, before reading from
+// stdin, at exit, and after each newline if stdout is a terminal. Unicode is
+// encoded directly into the buffer as UTF-8.
+
+void stdout_set_buffer_size(size_t size);
+size_t stdout_buffer_size();
+void stdout_flush();
+
+void stdout_write(const char* data, size_t size);
+void stdout_write_char(int64_t ch);
+
+// these are called by compiled code to implement print(). the object arguments
+// are borrowed references
+void stdout_write_none();
+void stdout_write_bool(bool value);
+void stdout_write_int(int64_t value);
+void stdout_write_float(double value);
+void stdout_write_bytes(const BytesObject* s);
+void stdout_write_unicode(const UnicodeObject* s);
+void stdout_write_unicode(const wchar_t* data, size_t count);
+
+
+// stdin is read through a similar buffer. lines are found with memchr and
+// decoded from UTF-8 directly into the returned UnicodeObjects; invalid
+// sequences decode as U+FFFD. stdout is flushed before each read(2), so
+// prompts appear before the program blocks.
+
+// returns a new reference to the next line without its trailing newline, or
+// NULL at end of input
+UnicodeObject* stdin_read_line(ExceptionBlock* exc_block = NULL);
+
+// returns a new List[Unicode] with up to max_lines lines, trimmed as by
+// stdin_read_line; the list is empty at end of input. if max_lines is 0, this
+// reads all of stdin into memory before returning, so very large inputs should
+// be read in chunks instead
+ListObject* stdin_read_lines(size_t max_lines = 0,
+    ExceptionBlock* exc_block = NULL);
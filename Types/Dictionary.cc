@@ -5,6 +5,7 @@
 #include <phosg/Strings.hh>
 
 #include "Instance.hh"
+#include "Int.hh"
 
 using namespace std;
 
@@ -12,6 +13,9 @@ extern InstanceObject MemoryError_instance;
 extern int64_t KeyError_class_id;
 
 
+// 0 is never a valid version, so an empty DictionaryLookupCache never matches
+static uint64_t next_dictionary_version = 1;
+
 static size_t dictionary_default_key_length(const void* k) {
   // trim zero bytes off the end
   const uint8_t* b = reinterpret_cast<const uint8_t*>(&k);
@@ -44,6 +48,7 @@ DictionaryObject* dictionary_new(size_t (*key_length)(const void* k),
   d->count = 0;
   d->node_count = 0;
   d->flags = flags;
+  d->version = next_dictionary_version++;
   d->root = NULL;
   return d;
 }
@@ -55,6 +60,38 @@ void dictionary_delete(void* d) {
 
 
 
+static void dictionary_add_reference(void* x, bool is_object, bool is_int) {
+  if (is_object) {
+    add_reference(x);
+  } else if (is_int) {
+    int_add_reference(reinterpret_cast<int64_t>(x));
+  }
+}
+
+static void dictionary_delete_reference(void* x, bool is_object, bool is_int) {
+  if (is_object) {
+    delete_reference(x);
+  } else if (is_int) {
+    int_delete_reference(reinterpret_cast<int64_t>(x));
+  }
+}
+
+static void dictionary_add_references(const DictionaryObject* d, void* k,
+    void* v) {
+  dictionary_add_reference(k, d->flags & DictionaryFlag::KeysAreObjects,
+      d->flags & DictionaryFlag::KeysAreInts);
+  dictionary_add_reference(v, d->flags & DictionaryFlag::ValuesAreObjects,
+      d->flags & DictionaryFlag::ValuesAreInts);
+}
+
+static void dictionary_delete_references(const DictionaryObject* d, void* k,
+    void* v) {
+  dictionary_delete_reference(k, d->flags & DictionaryFlag::KeysAreObjects,
+      d->flags & DictionaryFlag::KeysAreInts);
+  dictionary_delete_reference(v, d->flags & DictionaryFlag::ValuesAreObjects,
+      d->flags & DictionaryFlag::ValuesAreInts);
+}
+
 void dictionary_insert(DictionaryObject* d, void* k, void* v,
     ExceptionBlock* exc_block) {
   // find and clear the slot offset for the key, creating it if necessary
@@ -71,23 +108,15 @@ void dictionary_insert(DictionaryObject* d, void* k, void* v,
     throw logic_error("creation traversal yielded a slot containing a node");
   }
   if (slot_contents.occupied) {
-    if (d->flags & DictionaryFlag::KeysAreObjects) {
-      delete_reference(slot_contents.key);
-    }
-    if (d->flags & DictionaryFlag::ValuesAreObjects) {
-      delete_reference(slot_contents.value);
-    }
+    dictionary_delete_references(d, slot_contents.key, slot_contents.value);
   } else {
+    // the traversal may have created or moved nodes for the new key
     d->count++;
+    d->version = next_dictionary_version++;
   }
 
   t.node->set_slot(t.ch, k, v, true, false);
-  if (d->flags & DictionaryFlag::KeysAreObjects) {
-    add_reference(k);
-  }
-  if (d->flags & DictionaryFlag::ValuesAreObjects) {
-    add_reference(v);
-  }
+  dictionary_add_references(d, k, v);
 }
 
 bool dictionary_erase(DictionaryObject* d, void* k) {
@@ -104,13 +133,9 @@ bool dictionary_erase(DictionaryObject* d, void* k) {
   }
 
   // delete the value
-  if (d->flags & DictionaryFlag::KeysAreObjects) {
-    delete_reference(slot_contents.key);
-  }
-  if (d->flags & DictionaryFlag::ValuesAreObjects) {
-    delete_reference(slot_contents.value);
-  }
+  dictionary_delete_references(d, slot_contents.key, slot_contents.value);
   d->count--;
+  d->version = next_dictionary_version++;
   t.node->set_slot(t.ch, NULL, NULL, false, false);
 
   // delete all empty nodes on the path, except the root, starting from the leaf
@@ -160,9 +185,6 @@ void dictionary_clear(DictionaryObject* d) {
     return;
   }
 
-  bool keys_are_objects = d->flags & DictionaryFlag::KeysAreObjects;
-  bool values_are_objects = d->flags & DictionaryFlag::ValuesAreObjects;
-
   vector<DictionaryObject::Node*> node_stack;
   node_stack.emplace_back(d->root);
   while (!node_stack.empty()) {
@@ -170,12 +192,7 @@ void dictionary_clear(DictionaryObject* d) {
     node_stack.pop_back();
 
     if (node->has_value) {
-      if (keys_are_objects) {
-        delete_reference(node->key);
-      }
-      if (values_are_objects) {
-        delete_reference(node->value);
-      }
+      dictionary_delete_references(d, node->key, node->value);
     }
 
     for (uint16_t x = node->start; x <= node->end; x++) {
@@ -188,12 +205,7 @@ void dictionary_clear(DictionaryObject* d) {
         node_stack.emplace_back(
             reinterpret_cast<DictionaryObject::Node*>(slot_contents.value));
       } else {
-        if (keys_are_objects) {
-          delete_reference(slot_contents.key);
-        }
-        if (values_are_objects) {
-          delete_reference(slot_contents.value);
-        }
+        dictionary_delete_references(d, slot_contents.key, slot_contents.value);
       }
     }
 
@@ -203,6 +215,7 @@ void dictionary_clear(DictionaryObject* d) {
   d->root = NULL;
   d->count = 0;
   d->node_count = 0;
+  d->version = next_dictionary_version++;
 }
 
 
@@ -235,6 +248,34 @@ void* dictionary_at(const DictionaryObject* d, void* k,
 }
 
 
+DictionaryLookupCache::DictionaryLookupCache() : version(0),
+    value_slot(NULL) { }
+
+void* dictionary_at_cached(const DictionaryObject* d, void* k,
+    DictionaryLookupCache* cache, ExceptionBlock* exc_block) {
+  auto t = d->traverse(k, false);
+  if (!t.node) {
+    raise_python_exception(exc_block, create_instance(KeyError_class_id));
+    throw out_of_range("key does not exist in dictionary");
+  }
+
+  auto slot_contents = t.node->get_slot(t.ch);
+  if (!slot_contents.occupied || slot_contents.is_subnode) {
+    raise_python_exception(exc_block, create_instance(KeyError_class_id));
+    throw out_of_range("key does not exist in dictionary");
+  }
+
+  // the value is either the node's own value or in one of its child slots
+  if (t.ch > 0xFF) {
+    cache->value_slot = &t.node->value;
+  } else {
+    cache->value_slot = &t.node->fields_array()[2 * (t.ch - t.node->start) + 1];
+  }
+  cache->version = d->version;
+  return slot_contents.value;
+}
+
+
 size_t dictionary_size(const DictionaryObject* d) {
   return d->count;
 }
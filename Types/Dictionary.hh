@@ -10,9 +10,13 @@
 #include "Reference.hh"
 
 
+// Int keys and values aren't objects, but the dictionary owns a reference to
+// each one that's promoted (see Int.hh)
 enum DictionaryFlag {
   KeysAreObjects   = 0x01,
   ValuesAreObjects = 0x02,
+  KeysAreInts      = 0x04,
+  ValuesAreInts    = 0x08,
 };
 
 struct DictionaryObject {
@@ -25,6 +29,11 @@ struct DictionaryObject {
   uint64_t node_count;
   uint64_t flags;
 
+  // changes whenever a key is added or removed. versions are unique across all
+  // dictionaries and never 0, so a DictionaryLookupCache can't be fooled by a
+  // different dictionary at the same address
+  uint64_t version;
+
   struct SlotContents {
     void* key;
     void* value;
@@ -89,6 +98,22 @@ void dictionary_clear(DictionaryObject* d);
 bool dictionary_exists(const DictionaryObject* d, void* k);
 void* dictionary_at(const DictionaryObject* d, void* k,
     ExceptionBlock* exc_block = NULL);
+
+// inline cache for lookups with a constant key. if version matches the
+// dictionary's version, value_slot still points to the key's value, so
+// generated code can skip the traversal entirely. replacing the value for an
+// existing key doesn't change the version, since it doesn't move the slot
+struct DictionaryLookupCache {
+  uint64_t version;
+  void* const* value_slot;
+
+  DictionaryLookupCache();
+};
+
+// like dictionary_at, but also fills in the cache on success. the caller is
+// expected to check the cache before calling this; this function doesn't
+void* dictionary_at_cached(const DictionaryObject* d, void* k,
+    DictionaryLookupCache* cache, ExceptionBlock* exc_block = NULL);
 bool dictionary_next_item(const DictionaryObject* d,
     DictionaryObject::SlotContents* item);
 size_t dictionary_size(const DictionaryObject* d);
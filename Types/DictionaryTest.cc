@@ -16,11 +16,12 @@
 
 using namespace std;
 
-// Dictionary.cc needs these to exist, but they don't need to be correct since
-// we never pass an exc_block in the unit tests
+// Dictionary.cc and Slice.cc need these to exist, but they don't need to be
+// correct since we never pass an exc_block in the unit tests
 InstanceObject MemoryError_instance;
 int64_t IndexError_class_id = 0;
 int64_t KeyError_class_id = 0;
+int64_t ValueError_class_id = 0;
 
 
 void expect_key_missing(const DictionaryObject* d, void* k) {
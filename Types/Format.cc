@@ -1,12 +1,15 @@
 #include "Format.hh"
 
 #include <inttypes.h>
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <phosg/Strings.hh>
 
 #include "../BuiltinFunctions.hh"
 #include "../Exception.hh"
+#include "Int.hh"
 #include "Strings.hh"
 
 using namespace std;
@@ -17,7 +20,7 @@ using namespace std;
  *
  * %[[-]width][.max_chars]s - string
  *     - means padding comes after
- * %[+| ][[0|-]width]d - int
+ * %[+| ][[0|-]width][.min_digits]d - int
  *     0 means padding is zeroes, not spaces
  *     + means write + before number if it's positive
  *     space means write space before number if it's positive
@@ -33,175 +36,131 @@ using namespace std;
  * case expect an int argument preceding the value
  */
 
-struct FormatSpecifier {
-  bool alternate_form;
-  bool zero_fill;
-  bool left_justify;
-  char sign_prefix; // either 0 (none), ' ', or '+'
-  ssize_t width; // 0 means no length limit
-  bool variable_width;
-  ssize_t precision; // -1 means no precision specified
-  bool variable_precision;
-  char format_code;
-
-  size_t offset;
-  size_t length;
-
-  FormatSpecifier() : alternate_form(false), zero_fill(false),
-      left_justify(false), sign_prefix(0), width(0), variable_width(false),
-      precision(-1), variable_precision(false), format_code(0), offset(0),
-      length(0) { }
-
-  string str(bool include_format = true, bool debug = false) const {
-    string ret = "%";
-    if (this->alternate_form) {
-      ret += '#';
-    }
-    if (this->zero_fill) {
-      ret += '0';
-    }
-    if (this->left_justify) {
-      ret += '-';
-    }
-    if (this->sign_prefix) {
-      ret += this->sign_prefix;
-    }
-    if (this->variable_width) {
-      ret += '*';
-    } else if (this->width) {
-      ret += string_printf("%zd", this->width);
-    }
-    if (this->variable_precision) {
-      ret += ".*";
-    } else if (this->precision >= 0) {
-      ret += string_printf(".%zd", this->width);
-    }
-    if (include_format) {
-      ret += this->format_code;
-    }
-    if (debug) {
-      ret += string_printf("(offset=%zd,length=%zd)", this->offset, this->length);
-    }
-    return ret;
-  }
-
-  wstring wstr(bool include_format = true, bool debug = false) const {
-    wstring ret = L"%";
-    if (this->alternate_form) {
-      ret += L'#';
-    }
-    if (this->zero_fill) {
-      ret += L'0';
-    }
-    if (this->left_justify) {
-      ret += L'-';
-    }
-    if (this->sign_prefix) {
-      ret += static_cast<wchar_t>(this->sign_prefix);
-    }
-    if (this->variable_width) {
-      ret += L'*';
-    } else if (this->width) {
-      ret += wstring_printf(L"%zd", this->width);
-    }
-    if (this->variable_precision) {
-      ret += L".*";
-    } else if (this->precision >= 0) {
-      ret += wstring_printf(L".%zd", this->width);
-    }
-    if (include_format) {
-      ret += static_cast<wchar_t>(this->format_code);
-    }
-    if (debug) {
-      ret += wstring_printf(L"(offset=%zd,length=%zd)", this->offset, this->length);
-    }
-    return ret;
-  }
-};
+FormatOperation::FormatOperation() : format_code(0), alternate_form(false),
+    zero_fill(false), left_justify(false), sign_prefix(0),
+    variable_width(false), variable_precision(false), width(0),
+    precision(-1), literal_offset(0), literal_count(0) { }
 
 enum class FormatParserState {
-  PrefixChars = 0,
+  Literal = 0,
+  PrefixChars,
   Width,
   Precision,
   FormatCode,
 };
 
-template <typename T>
-static vector<struct FormatSpecifier> extract_formats(T* format, size_t count) {
-  vector<struct FormatSpecifier> specs;
-  struct FormatSpecifier* current = NULL;
-
-  FormatParserState state = FormatParserState::PrefixChars;
+template <typename CharT>
+static FormatProgram<CharT> compile_format(const CharT* format, size_t count) {
+  FormatProgram<CharT> program;
+  program.literal_count = 0;
+  program.arg_count = 0;
+
+  FormatOperation current;
+  FormatParserState state = FormatParserState::Literal;
+
+  // appends a literal operation for any literal text that hasn't been emitted
+  // yet. adjacent literal runs (e.g. on either side of a %%) are merged
+  size_t literal_start = 0;
+  auto flush_literal = [&]() {
+    size_t literal_end = program.literals.size();
+    if (literal_end == literal_start) {
+      return;
+    }
+    program.operations.emplace_back();
+    auto& op = program.operations.back();
+    op.literal_offset = literal_start;
+    op.literal_count = literal_end - literal_start;
+    program.literal_count += op.literal_count;
+    literal_start = literal_end;
+  };
 
   for (size_t x = 0; x < count;) {
-    if (current == NULL) {
+    if (state == FormatParserState::Literal) {
       if (format[x] == '%') {
-        specs.emplace_back();
-        current = &specs.back();
-        current->offset = x;
+        current = FormatOperation();
+        state = FormatParserState::PrefixChars;
+      } else {
+        program.literals.push_back(format[x]);
       }
       x++;
 
     } else if (state == FormatParserState::PrefixChars) {
       if (format[x] == '+') {
-        current->sign_prefix = '+';
+        current.sign_prefix = '+';
         x++;
       } else if (format[x] == ' ') {
-        current->sign_prefix = ' ';
+        if (current.sign_prefix != '+') {
+          current.sign_prefix = ' ';
+        }
         x++;
       } else if (format[x] == '0') {
-        current->zero_fill = true;
+        current.zero_fill = true;
         x++;
       } else if (format[x] == '-') {
-        current->left_justify = true;
+        current.left_justify = true;
         x++;
       } else if (format[x] == '#') {
-        current->alternate_form = true;
+        current.alternate_form = true;
         x++;
       } else if (format[x] == '.') {
         state = FormatParserState::Precision;
+        x++;
       } else {
         state = FormatParserState::Width;
       }
 
     } else if (state == FormatParserState::Width) {
       if (format[x] == '*') {
-        current->variable_width = true;
+        current.variable_width = true;
         x++;
       } else if (isdigit(format[x])) {
-        current->width = current->width * 10 + (format[x] - '0');
+        current.width = current.width * 10 + (format[x] - '0');
         x++;
       } else if (format[x] == '.') {
         state = FormatParserState::Precision;
+        x++;
       } else {
         state = FormatParserState::FormatCode;
       }
 
     } else if (state == FormatParserState::Precision) {
       if (format[x] == '*') {
-        current->variable_precision = true;
+        current.variable_precision = true;
         x++;
       } else if (isdigit(format[x])) {
-        if (current->precision < 0) {
-          current->precision = 0;
+        if (current.precision < 0) {
+          current.precision = 0;
         }
-        current->precision = current->precision * 10 + (format[x] - '0');
+        current.precision = current.precision * 10 + (format[x] - '0');
         x++;
       } else {
+        // a bare . means the precision is zero
+        if (current.precision < 0 && !current.variable_precision) {
+          current.precision = 0;
+        }
         state = FormatParserState::FormatCode;
       }
 
     } else if (state == FormatParserState::FormatCode) {
-      if ((format[x] == 'd') || (format[x] == 'i') || (format[x] == 'o') ||
+      if (format[x] == '%') {
+        program.literals.push_back('%');
+        x++;
+        state = FormatParserState::Literal;
+
+      } else if ((format[x] == 'd') || (format[x] == 'i') || (format[x] == 'o') ||
           (format[x] == 'u') || (format[x] == 'x') || (format[x] == 'X') ||
           (format[x] == 'e') || (format[x] == 'E') || (format[x] == 'f') ||
           (format[x] == 'F') || (format[x] == 'g') || (format[x] == 'G') ||
-          (format[x] == 'c') || (format[x] == 's') || (format[x] == '%')) {
-        current->format_code = format[x];
+          (format[x] == 'c') || (format[x] == 's')) {
+        current.format_code = format[x];
         x++;
-        current->length = x - current->offset;
-        current = NULL;
-        state = FormatParserState::PrefixChars;
+
+        flush_literal();
+        program.operations.emplace_back(current);
+        program.arg_count += 1 + current.variable_width +
+            current.variable_precision;
+        state = FormatParserState::Literal;
+
       } else if ((format[x] == 'h') || (format[x] == 'l') || (format[x] == 'L')) {
         x++;
       } else {
@@ -213,17 +172,33 @@ static vector<struct FormatSpecifier> extract_formats(T* format, size_t count) {
     }
   }
 
-  if (current) {
+  if (state != FormatParserState::Literal) {
     throw invalid_argument("incomplete format specifier");
   }
+  flush_literal();
 
-  return specs;
+  return program;
 }
 
-void typecheck_format(const vector<FormatSpecifier>& specs, const vector<Variable>& types) {
+BytesFormatProgram bytes_compile_format(const string& format) {
+  return compile_format(format.data(), format.size());
+}
+
+UnicodeFormatProgram unicode_compile_format(const wstring& format) {
+  return compile_format(format.data(), format.size());
+}
+
+
+
+static void typecheck_format(const vector<FormatOperation>& operations,
+    const vector<Variable>& types, ValueType string_type) {
   size_t input_index = 0;
-  for (const auto& spec : specs) {
-    if (spec.variable_width) {
+  for (const auto& op : operations) {
+    if (op.format_code == 0) {
+      continue;
+    }
+
+    if (op.variable_width) {
       if (input_index >= types.size()) {
         throw invalid_argument("not enough arguments");
       }
@@ -232,7 +207,7 @@ void typecheck_format(const vector<FormatSpecifier>& specs, const vector<Variabl
       }
       input_index++;
     }
-    if (spec.variable_precision) {
+    if (op.variable_precision) {
       if (input_index >= types.size()) {
         throw invalid_argument("not enough arguments");
       }
@@ -242,24 +217,17 @@ void typecheck_format(const vector<FormatSpecifier>& specs, const vector<Variabl
       input_index++;
     }
 
-    // % doesn't take an argument
-    if (spec.format_code == '%') {
-      continue;
-    }
-
     if (input_index >= types.size()) {
       throw invalid_argument("not enough arguments");
     }
     ValueType input_type = types[input_index].type;
 
-    // s accepts Unicode only
-    // TODO: in python, s accepts
-    switch (spec.format_code) {
-      case 's':
-        if (input_type != ValueType::Unicode) {
+    switch (op.format_code) {
+      case 's': // also accepts other types in python; we only accept strings
+        if (input_type != string_type) {
           string type_str = types[input_index].str();
           throw invalid_argument(string_printf("incorrect type (%s) for %%%c",
-              type_str.c_str(), spec.format_code));
+              type_str.c_str(), op.format_code));
         }
         break;
 
@@ -269,211 +237,516 @@ void typecheck_format(const vector<FormatSpecifier>& specs, const vector<Variabl
         if (input_type != ValueType::Float) {
           string type_str = types[input_index].str();
           throw invalid_argument(string_printf("incorrect type (%s) for %%%c",
-              type_str.c_str(), spec.format_code));
+              type_str.c_str(), op.format_code));
         }
         break;
 
       case 'd': case 'i': case 'u': // also accepts Float in python; we only accept Int
       case 'c': // also accepts Unicode in python; we only accept Int
-      case 'b':
       case 'o':
       case 'x': case 'X':
         if ((input_type != ValueType::Int) && (input_type != ValueType::Bool)) {
           string type_str = types[input_index].str();
           throw invalid_argument(string_printf("incorrect type (%s) for %%%c",
-              type_str.c_str(), spec.format_code));
+              type_str.c_str(), op.format_code));
         }
         break;
 
       default:
         throw invalid_argument(string_printf("unknown format code %%%c",
-            spec.format_code));
+            op.format_code));
     }
     input_index++;
   }
 
   if (input_index != types.size()) {
     throw invalid_argument(string_printf("too many arguments (have %zu, expected %zu)",
-        input_index, types.size()));
+        types.size(), input_index));
   }
 }
 
-
-
 void bytes_typecheck_format(const string& format, const vector<Variable>& types) {
-  auto specs = extract_formats(format.data(), format.size());
-  typecheck_format(specs, types);
+  auto program = bytes_compile_format(format);
+  typecheck_format(program.operations, types, ValueType::Bytes);
 }
 
 void unicode_typecheck_format(const wstring& format, const vector<Variable>& types) {
-  auto specs = extract_formats(format.data(), format.size());
-  typecheck_format(specs, types);
+  auto program = unicode_compile_format(format);
+  typecheck_format(program.operations, types, ValueType::Unicode);
 }
 
 
 
-void execute_format_spec(string& output, struct FormatSpecifier spec,
-    const TupleObject* args, size_t& input_index) {
-  if (spec.format_code == '%') {
-    output += '%';
-    return;
+// numbers are rendered into an ASCII scratch buffer (even when the output is
+// Unicode) before the result object is allocated, so the result's length is
+// known exactly and it only has to be allocated once
+
+static const char decimal_digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const uint64_t uint_powers_of_ten[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+  100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+  1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+  1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+  1000000000000000000ULL, 10000000000000000000ULL};
+
+// writes the digits of value backward, ending just before end. returns a
+// pointer to the first digit
+static char* write_decimal_digits(char* end, uint64_t value) {
+  while (value >= 100) {
+    size_t index = (value % 100) * 2;
+    value /= 100;
+    *(--end) = decimal_digit_pairs[index + 1];
+    *(--end) = decimal_digit_pairs[index];
   }
-  if (spec.format_code == 's') {
-    throw runtime_error("%s is not yet implemented");
+  if (value >= 10) {
+    *(--end) = decimal_digit_pairs[value * 2 + 1];
+    *(--end) = decimal_digit_pairs[value * 2];
+  } else {
+    *(--end) = '0' + value;
   }
+  return end;
+}
 
-  if (spec.variable_width) {
-    spec.width = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-    spec.variable_width = false;
-    input_index++;
+size_t format_decimal_int(char* buf, int64_t value) {
+  char digits_buf[20];
+  char* end = &digits_buf[sizeof(digits_buf)];
+  uint64_t magnitude = value;
+  if (value < 0) {
+    magnitude = -magnitude;
   }
-  if (spec.variable_precision) {
-    spec.precision = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-    spec.variable_precision = false;
-    input_index++;
+  char* digits = write_decimal_digits(end, magnitude);
+  if (value < 0) {
+    *(--digits) = '-';
+  }
+  memcpy(buf, digits, end - digits);
+  return end - digits;
+}
+
+static char* write_power_of_two_digits(char* end, uint64_t value,
+    uint8_t bits_per_digit, bool uppercase) {
+  const char* digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+  uint64_t mask = (1 << bits_per_digit) - 1;
+  do {
+    *(--end) = digits[value & mask];
+    value >>= bits_per_digit;
+  } while (value);
+  return end;
+}
+
+// appends sign + prefix + digits to out, applying the width, zero fill and
+// justification rules. returns the number of spaces that the caller should
+// write after the field (for left-justified fields) or before it (otherwise)
+static size_t append_number(string& out, char sign, const char* prefix,
+    const char* digits, size_t digit_count, size_t min_digits, int64_t width,
+    bool zero_fill, bool left_justify) {
+  size_t prefix_count = strlen(prefix);
+  size_t zeroes = (min_digits > digit_count) ? (min_digits - digit_count) : 0;
+  size_t length = (sign != 0) + prefix_count + zeroes + digit_count;
+  size_t padding = (width > static_cast<int64_t>(length)) ? (width - length) : 0;
+  if (padding && zero_fill && !left_justify) {
+    zeroes += padding;
+    padding = 0;
   }
-  int64_t x = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-  input_index++;
-
-  if ((spec.format_code == 'd') || (spec.format_code == 'i') ||
-      (spec.format_code == 'u') || (spec.format_code == 'o') ||
-      (spec.format_code == 'X') || (spec.format_code == 'x') ||
-      (spec.format_code == 'c')) {
-    string format = (spec.str(false) + "ll") + spec.format_code;
-    output += string_printf(format.c_str(), x);
-
-  } else if ((spec.format_code == 'e') || (spec.format_code == 'E') ||
-      (spec.format_code == 'f') || (spec.format_code == 'F') ||
-      (spec.format_code == 'g') || (spec.format_code == 'G')) {
-    double f = *reinterpret_cast<double*>(&x);
-    string format = spec.str(false) + spec.format_code;
-    output += string_printf(format.c_str(), f);
+
+  if (sign) {
+    out.push_back(sign);
   }
+  out.append(prefix, prefix_count);
+  out.append(zeroes, '0');
+  out.append(digits, digit_count);
+  return padding;
 }
 
-// TODO: deduplicate this code with the above function
-void execute_format_spec(wstring& output, struct FormatSpecifier spec,
-    const TupleObject* args, size_t& input_index) {
-  if (spec.format_code == '%') {
-    output += L'%';
-    return;
+static size_t append_int(string& out, const FormatOperation& op, int64_t value,
+    int64_t width, int64_t precision, bool left_justify) {
+  const char* prefix = "";
+  uint8_t base = 10;
+  bool uppercase = (op.format_code == 'X');
+  switch (op.format_code) {
+    case 'o':
+      base = 8;
+      if (op.alternate_form) {
+        prefix = "0o";
+      }
+      break;
+    case 'x':
+    case 'X':
+      base = 16;
+      if (op.alternate_form) {
+        prefix = uppercase ? "0X" : "0x";
+      }
+      break;
   }
-  if (spec.format_code == 's') {
-    throw runtime_error("%s is not yet implemented");
+  size_t min_digits = (precision > 0) ? precision : 0;
+
+  // promoted values don't fit in the buffer below
+  if (!int_is_direct(value)) {
+    static string promoted_digits;
+    char sign = int_format_digits(promoted_digits, value, base, uppercase) ?
+        '-' : op.sign_prefix;
+    return append_number(out, sign, prefix, promoted_digits.data(),
+        promoted_digits.size(), min_digits, width, op.zero_fill, left_justify);
   }
 
-  if (spec.variable_width) {
-    spec.width = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-    spec.variable_width = false;
-    input_index++;
+  char buf[72];
+  char* end = &buf[sizeof(buf)];
+
+  char sign = op.sign_prefix;
+  uint64_t magnitude = value;
+  if (value < 0) {
+    sign = '-';
+    magnitude = -magnitude;
   }
-  if (spec.variable_precision) {
-    spec.precision = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-    spec.variable_precision = false;
-    input_index++;
+
+  char* digits = (base == 10) ? write_decimal_digits(end, magnitude) :
+      write_power_of_two_digits(end, magnitude, (base == 8) ? 3 : 4, uppercase);
+  return append_number(out, sign, prefix, digits, end - digits, min_digits,
+      width, op.zero_fill, left_justify);
+}
+
+static size_t append_float(string& out, const FormatOperation& op, double value,
+    int64_t width, int64_t precision, bool left_justify) {
+  if (precision < 0) {
+    precision = 6;
   }
-  int64_t x = reinterpret_cast<int64_t>(tuple_get_item(args, input_index));
-  input_index++;
-
-  if ((spec.format_code == 'd') || (spec.format_code == 'i') ||
-      (spec.format_code == 'u') || (spec.format_code == 'o') ||
-      (spec.format_code == 'X') || (spec.format_code == 'x') ||
-      (spec.format_code == 'c')) {
-    wstring format = (spec.wstr(false) + L"ll") + static_cast<wchar_t>(spec.format_code);
-
-    wchar_t buf[64]; // this is plenty of space, right?
-    if (spec.width > static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0]))) {
-      throw invalid_argument("formatted Ints may not be longer than 64 characters");
-    }
-    int len = swprintf(buf, sizeof(buf) / sizeof(buf[0]), format.c_str(), x);
-    if ((len < 0) || (len >= static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0])))) {
-      throw invalid_argument("formatted Int is too long");
-    }
-    output.append(buf, len);
 
-  } else if ((spec.format_code == 'e') || (spec.format_code == 'E') ||
-      (spec.format_code == 'f') || (spec.format_code == 'F') ||
-      (spec.format_code == 'g') || (spec.format_code == 'G')) {
-    double f = *reinterpret_cast<double*>(&x);
-    wstring format = spec.wstr(false) + static_cast<wchar_t>(spec.format_code);
+  // the sign of a NaN isn't meaningful (e.g. inf - inf has it set on x86), so
+  // like python, only the + or space flag can give NaN a sign
+  char sign = (signbit(value) && !isnan(value)) ? '-' : op.sign_prefix;
+  double magnitude = fabs(value);
+  bool uppercase = isupper(op.format_code);
+
+  if (!isfinite(magnitude)) {
+    const char* text = isnan(magnitude) ? (uppercase ? "NAN" : "nan") :
+        (uppercase ? "INF" : "inf");
+    return append_number(out, sign, "", text, 3, 0, width, op.zero_fill,
+        left_justify);
+  }
 
-    wchar_t buf[64]; // this is plenty of space, right?
-    if (spec.width > static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0]))) {
-      throw invalid_argument("formatted Floats may not be longer than 64 characters");
-    }
-    int len = swprintf(buf, sizeof(buf) / sizeof(buf[0]), format.c_str(), f);
-    if ((len < 0) || (len >= static_cast<ssize_t>(sizeof(buf) / sizeof(buf[0])))) {
-      throw invalid_argument("formatted Float is too long");
+  // fast path for %f: scale the value up by 10^precision and round it to an
+  // integer. the product is inexact, but fma() gives us the exact rounding
+  // error, which is enough to round correctly (half to even, like python does)
+  // since 0.5 is always representable at the product's precision
+  if (((op.format_code == 'f') || (op.format_code == 'F')) && (precision <= 19)) {
+    double scale = static_cast<double>(uint_powers_of_ten[precision]);
+    double product = magnitude * scale;
+    if (product < 4503599627370496.0) { // 2^52
+      double error = fma(magnitude, scale, -product);
+      double integer_part = floor(product);
+      double fraction_delta = (product - integer_part) - 0.5;
+      uint64_t scaled = integer_part;
+      if ((fraction_delta > 0) ||
+          ((fraction_delta == 0) && ((error > 0) || ((error == 0) && (scaled & 1))))) {
+        scaled++;
+      }
+
+      char buf[48];
+      char* end = &buf[sizeof(buf)];
+      char* digits = end;
+      if (precision) {
+        uint64_t divisor = uint_powers_of_ten[precision];
+        uint64_t fraction = scaled % divisor;
+        scaled /= divisor;
+        char* fraction_digits = write_decimal_digits(end, fraction);
+        while (end - fraction_digits < precision) {
+          *(--fraction_digits) = '0';
+        }
+        digits = fraction_digits;
+        *(--digits) = '.';
+      } else if (op.alternate_form) {
+        *(--digits) = '.';
+      }
+      digits = write_decimal_digits(digits, scaled);
+
+      return append_number(out, sign, "", digits, end - digits, 0, width,
+          op.zero_fill, left_justify);
     }
-    output.append(buf, len);
   }
+
+  // everything else goes through snprintf, but we still do the padding
+  // ourselves so the sign and zero fill work the same way as for ints
+  char format[8] = "%";
+  size_t format_offset = 1;
+  if (op.alternate_form) {
+    format[format_offset++] = '#';
+  }
+  format[format_offset++] = '.';
+  format[format_offset++] = '*';
+  format[format_offset++] = op.format_code;
+  format[format_offset] = 0;
+
+  char buf[64];
+  int length = snprintf(buf, sizeof(buf), format, static_cast<int>(precision),
+      magnitude);
+  if (length < 0) {
+    throw invalid_argument("cannot format Float");
+  }
+  if (length < static_cast<int>(sizeof(buf))) {
+    return append_number(out, sign, "", buf, length, 0, width, op.zero_fill,
+        left_justify);
+  }
+
+  string large_buf(length + 1, 0);
+  snprintf(const_cast<char*>(large_buf.data()), large_buf.size(), format,
+      static_cast<int>(precision), magnitude);
+  return append_number(out, sign, "", large_buf.data(), length, 0, width,
+      op.zero_fill, left_justify);
 }
 
-// TODO: this is a stupid template; make it require fewer arguments
-template <typename ObjectType, typename StringType,
-    ObjectType* (*string_new)(const StringType&)>
-ObjectType* string_format(ObjectType* format, TupleObject* args,
-    ExceptionBlock* exc_block, bool delete_tuple_reference = false) {
-  ObjectType* ret = NULL;
-  try {
-    auto specs = extract_formats(format->data, format->count);
-    size_t spec_index = 0;
-    size_t input_index = 0;
-    size_t format_index = 0;
-    StringType output;
-
-    while (format_index < format->count) {
-      if (format->data[format_index] == '%') {
-        auto& spec = specs[spec_index];
-        execute_format_spec(output, spec, args, input_index);
-        format_index += spec.length;
-        spec_index++;
-      } else {
-        output += format->data[format_index];
-        format_index++;
+
+
+
+
+
+template <typename CharT>
+struct StringObjectTraits;
+
+template <>
+struct StringObjectTraits<char> {
+  typedef BytesObject ObjectType;
+  static constexpr int64_t max_char = 0xFF;
+  static BytesObject* create(size_t count, ExceptionBlock* exc_block) {
+    return bytes_new(NULL, count, exc_block);
+  }
+};
+
+template <>
+struct StringObjectTraits<wchar_t> {
+  typedef UnicodeObject ObjectType;
+  static constexpr int64_t max_char = 0x10FFFF;
+  static UnicodeObject* create(size_t count, ExceptionBlock* exc_block) {
+    return unicode_new(NULL, count, exc_block);
+  }
+};
+
+// a converted argument. numbers are rendered into the scratch buffer; %s and %c
+// fields refer to their text directly
+template <typename CharT>
+struct FormatField {
+  const CharT* data; // NULL if the text is in the scratch buffer
+  size_t scratch_offset;
+  size_t count;
+  size_t padding; // spaces before the text (or after, if left_justify is set)
+  bool left_justify;
+  CharT ch; // for %c
+};
+
+template <typename CharT>
+static typename StringObjectTraits<CharT>::ObjectType* create_formatted_string(
+    const FormatProgram<CharT>* program, void* const* args, size_t arg_count,
+    ExceptionBlock* exc_block) {
+  typedef typename StringObjectTraits<CharT>::ObjectType ObjectType;
+
+  if (arg_count != program->arg_count) {
+    throw invalid_argument(string_printf(
+        "incorrect argument count (have %zu, expected %zu)", arg_count,
+        program->arg_count));
+  }
+
+  // nemesys is single-threaded and formatting never recurses, so we can reuse
+  // these between calls and avoid allocating them each time
+  static string scratch;
+  static vector<FormatField<CharT>> fields;
+  scratch.clear();
+  fields.clear();
+
+  // first pass: convert all the arguments and figure out how long the result
+  // will be
+  size_t result_count = program->literal_count;
+  size_t arg_index = 0;
+  for (const auto& op : program->operations) {
+    if (op.format_code == 0) {
+      continue;
+    }
+
+    bool left_justify = op.left_justify;
+    int64_t width = op.width;
+    if (op.variable_width) {
+      width = reinterpret_cast<int64_t>(args[arg_index++]);
+      if (width < 0) {
+        left_justify = true;
+        width = -width;
       }
     }
+    int64_t precision = op.precision;
+    if (op.variable_precision) {
+      precision = reinterpret_cast<int64_t>(args[arg_index++]);
+      if (precision < 0) {
+        precision = 0;
+      }
+    }
+    void* arg = args[arg_index++];
+
+    fields.emplace_back();
+    auto& field = fields.back();
+    field.data = NULL;
+    field.left_justify = left_justify;
+
+    switch (op.format_code) {
+      case 's': {
+        const ObjectType* s = reinterpret_cast<const ObjectType*>(arg);
+        field.data = s->data;
+        field.count = s->count;
+        if ((precision >= 0) && (static_cast<size_t>(precision) < field.count)) {
+          field.count = precision;
+        }
+        field.padding = (width > static_cast<int64_t>(field.count)) ?
+            (width - field.count) : 0;
+        break;
+      }
 
-    ret = string_new(output);
+      case 'c': {
+        int64_t ch = reinterpret_cast<int64_t>(arg);
+        if ((ch < 0) || (ch > StringObjectTraits<CharT>::max_char)) {
+          throw overflow_error("%c argument not in range");
+        }
+        field.ch = ch;
+        field.count = 1;
+        field.padding = (width > 1) ? (width - 1) : 0;
+        break;
+      }
 
-  } catch (const exception& e) {
-    if (delete_tuple_reference) {
-      delete_reference(args);
+      case 'e': case 'E':
+      case 'f': case 'F':
+      case 'g': case 'G': {
+        double value = *reinterpret_cast<const double*>(&arg);
+        field.scratch_offset = scratch.size();
+        field.padding = append_float(scratch, op, value, width, precision,
+            left_justify);
+        field.count = scratch.size() - field.scratch_offset;
+        break;
+      }
+
+      default: {
+        int64_t value = reinterpret_cast<int64_t>(arg);
+        field.scratch_offset = scratch.size();
+        field.padding = append_int(scratch, op, value, width, precision,
+            left_justify);
+        field.count = scratch.size() - field.scratch_offset;
+        break;
+      }
+    }
+
+    result_count += field.count + field.padding;
+  }
+
+  // second pass: allocate the result and copy everything into it
+  ObjectType* ret = StringObjectTraits<CharT>::create(result_count, exc_block);
+  CharT* out = ret->data;
+  const CharT* literals = program->literals.data();
+  auto field_it = fields.begin();
+  for (const auto& op : program->operations) {
+    if (op.format_code == 0) {
+      out = copy(&literals[op.literal_offset],
+          &literals[op.literal_offset + op.literal_count], out);
+      continue;
+    }
+
+    const auto& field = *(field_it++);
+    if (!field.left_justify) {
+      out = fill_n(out, field.padding, ' ');
+    }
+    if (op.format_code == 'c') {
+      *(out++) = field.ch;
+    } else if (field.data) {
+      out = copy(field.data, field.data + field.count, out);
+    } else {
+      const char* scratch_data = &scratch[field.scratch_offset];
+      out = copy(scratch_data, scratch_data + field.count, out);
+    }
+    if (field.left_justify) {
+      out = fill_n(out, field.padding, ' ');
     }
+  }
+  *out = 0;
+
+  return ret;
+}
+
+template <typename CharT>
+static typename StringObjectTraits<CharT>::ObjectType* execute_format_program(
+    const FormatProgram<CharT>* program, void* const* args, size_t arg_count,
+    ExceptionBlock* exc_block) {
+  try {
+    return create_formatted_string(program, args, arg_count, exc_block);
+  } catch (const bad_alloc& e) {
+    throw;
+  } catch (const overflow_error& e) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    throw;
+  } catch (const exception& e) {
     raise_python_exception(exc_block, create_instance(TypeError_class_id));
     throw;
   }
+}
+
+
 
-  if (delete_tuple_reference) {
-    delete_reference(args);
+BytesObject* bytes_format_compiled(const BytesFormatProgram* program,
+    TupleObject* args, ExceptionBlock* exc_block) {
+  return execute_format_program(program, args->items(), args->count, exc_block);
+}
+
+UnicodeObject* unicode_format_compiled(const UnicodeFormatProgram* program,
+    TupleObject* args, ExceptionBlock* exc_block) {
+  return execute_format_program(program, args->items(), args->count, exc_block);
+}
+
+BytesObject* bytes_format_compiled_one(const BytesFormatProgram* program,
+    void* arg, ExceptionBlock* exc_block) {
+  return execute_format_program(program, &arg, 1, exc_block);
+}
+
+UnicodeObject* unicode_format_compiled_one(const UnicodeFormatProgram* program,
+    void* arg, ExceptionBlock* exc_block) {
+  return execute_format_program(program, &arg, 1, exc_block);
+}
+
+// these versions are used when the format string isn't known at compile time,
+// so they have to compile it first
+
+template <typename CharT, typename ObjectType>
+static ObjectType* compile_and_execute_format(const ObjectType* format,
+    void* const* args, size_t arg_count, ExceptionBlock* exc_block) {
+  FormatProgram<CharT> program;
+  try {
+    program = compile_format(format->data, format->count);
+  } catch (const exception& e) {
+    raise_python_exception(exc_block, create_instance(TypeError_class_id));
+    throw;
   }
-  return ret;
+  return execute_format_program(&program, args, arg_count, exc_block);
 }
 
 BytesObject* bytes_format(BytesObject* format, TupleObject* args,
     ExceptionBlock* exc_block) {
-  return string_format<BytesObject, string, bytes_from_cxx_string>(
-      format, args, exc_block);
+  return compile_and_execute_format<char>(format, args->items(), args->count,
+      exc_block);
 }
 
 UnicodeObject* unicode_format(UnicodeObject* format, TupleObject* args,
     ExceptionBlock* exc_block) {
-  return string_format<UnicodeObject, wstring, unicode_from_cxx_wstring>(
-      format, args, exc_block);
+  return compile_and_execute_format<wchar_t>(format, args->items(),
+      args->count, exc_block);
 }
 
 BytesObject* bytes_format_one(BytesObject* format, void* arg, bool is_object,
     ExceptionBlock* exc_block) {
-  TupleObject* t = tuple_new(1, exc_block);
-  tuple_set_item(t, 0, arg, is_object, exc_block);
-  return string_format<BytesObject, string, bytes_from_cxx_string>(
-      format, t, exc_block, true);
+  return compile_and_execute_format<char>(format, &arg, 1, exc_block);
 }
 
 UnicodeObject* unicode_format_one(UnicodeObject* format, void* arg, bool is_object,
     ExceptionBlock* exc_block) {
-  TupleObject* t = tuple_new(1, exc_block);
-  tuple_set_item(t, 0, arg, is_object, exc_block);
-  return string_format<UnicodeObject, wstring, unicode_from_cxx_wstring>(
-      format, t, exc_block, true);
+  return compile_and_execute_format<wchar_t>(format, &arg, 1, exc_block);
 }
@@ -11,11 +11,54 @@
 #include "Tuple.hh"
 
 
+// format strings are compiled into a FormatProgram, which is a list of
+// operations that each either copy a run of literal text or convert one
+// argument. constant format strings are compiled once at compile time (see
+// GlobalAnalysis::get_or_create_format_program), so the runtime never has to
+// parse them. %% is folded into the literal text during compilation.
+
+struct FormatOperation {
+  char format_code; // 0 means this operation copies literal text
+  bool alternate_form;
+  bool zero_fill;
+  bool left_justify;
+  char sign_prefix; // either 0 (none), ' ', or '+'
+  bool variable_width;
+  bool variable_precision;
+  int64_t width; // 0 means no minimum width
+  int64_t precision; // -1 means no precision specified
+
+  size_t literal_offset;
+  size_t literal_count;
+
+  FormatOperation();
+};
+
+template <typename CharT>
+struct FormatProgram {
+  std::basic_string<CharT> literals;
+  std::vector<FormatOperation> operations;
+  size_t literal_count; // total characters copied from literals
+  size_t arg_count; // including variable widths and precisions
+};
+
+typedef FormatProgram<char> BytesFormatProgram;
+typedef FormatProgram<wchar_t> UnicodeFormatProgram;
+
+BytesFormatProgram bytes_compile_format(const std::string& format);
+UnicodeFormatProgram unicode_compile_format(const std::wstring& format);
+
 void bytes_typecheck_format(const std::string& format,
     const std::vector<Variable>& types);
 void unicode_typecheck_format(const std::wstring& format,
     const std::vector<Variable>& types);
 
+// writes the decimal representation of value (including a - if it's negative)
+// to buf, which must have room for 20 characters. returns the number of
+// characters written
+size_t format_decimal_int(char* buf, int64_t value);
+
+// these take borrowed references to all arguments and return a new reference
 BytesObject* bytes_format(BytesObject* format, TupleObject* args,
     ExceptionBlock* exc_block = NULL);
 UnicodeObject* unicode_format(UnicodeObject* format, TupleObject* args,
@@ -24,3 +67,13 @@ BytesObject* bytes_format_one(BytesObject* format, void* arg, bool is_object,
     ExceptionBlock* exc_block = NULL);
 UnicodeObject* unicode_format_one(UnicodeObject* format, void* arg, bool is_object,
     ExceptionBlock* exc_block = NULL);
+
+// same as above, but with precompiled format strings
+BytesObject* bytes_format_compiled(const BytesFormatProgram* program,
+    TupleObject* args, ExceptionBlock* exc_block = NULL);
+UnicodeObject* unicode_format_compiled(const UnicodeFormatProgram* program,
+    TupleObject* args, ExceptionBlock* exc_block = NULL);
+BytesObject* bytes_format_compiled_one(const BytesFormatProgram* program,
+    void* arg, ExceptionBlock* exc_block = NULL);
+UnicodeObject* unicode_format_compiled_one(const UnicodeFormatProgram* program,
+    void* arg, ExceptionBlock* exc_block = NULL);
@@ -0,0 +1,937 @@
+#include "Int.hh"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../BuiltinFunctions.hh"
+#include "Instance.hh"
+
+using namespace std;
+
+
+
+// magnitudes are vectors of 32-bit digits, least significant first, with no
+// leading zero digits (so zero has no digits at all)
+
+typedef vector<uint32_t> Digits;
+
+// shifts and powers that would produce more bits than this raise OverflowError
+// instead of trying to allocate the result
+static const uint64_t max_result_bits = 1ULL << 32;
+
+static void trim(Digits& a) {
+  while (!a.empty() && !a.back()) {
+    a.pop_back();
+  }
+}
+
+static Digits digits_for_uint64(uint64_t v) {
+  Digits ret;
+  for (; v; v >>= 32) {
+    ret.emplace_back(static_cast<uint32_t>(v));
+  }
+  return ret;
+}
+
+static uint64_t bit_length_of(const Digits& a) {
+  if (a.empty()) {
+    return 0;
+  }
+  return (a.size() * 32) - __builtin_clz(a.back());
+}
+
+static int compare_magnitudes(const Digits& a, const Digits& b) {
+  if (a.size() != b.size()) {
+    return (a.size() < b.size()) ? -1 : 1;
+  }
+  for (size_t x = a.size(); x > 0; x--) {
+    if (a[x - 1] != b[x - 1]) {
+      return (a[x - 1] < b[x - 1]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+static Digits add_magnitudes(const Digits& a, const Digits& b) {
+  const Digits& longer = (a.size() >= b.size()) ? a : b;
+  const Digits& shorter = (a.size() >= b.size()) ? b : a;
+  Digits ret;
+  ret.reserve(longer.size() + 1);
+  uint64_t carry = 0;
+  for (size_t x = 0; x < longer.size(); x++) {
+    carry += static_cast<uint64_t>(longer[x]) +
+        ((x < shorter.size()) ? shorter[x] : 0);
+    ret.emplace_back(static_cast<uint32_t>(carry));
+    carry >>= 32;
+  }
+  if (carry) {
+    ret.emplace_back(carry);
+  }
+  return ret;
+}
+
+// a must be at least as large as b
+static Digits subtract_magnitudes(const Digits& a, const Digits& b) {
+  Digits ret(a.size());
+  int64_t borrow = 0;
+  for (size_t x = 0; x < a.size(); x++) {
+    int64_t d = static_cast<int64_t>(a[x]) -
+        ((x < b.size()) ? b[x] : 0) - borrow;
+    borrow = (d < 0);
+    ret[x] = static_cast<uint32_t>(d);
+  }
+  trim(ret);
+  return ret;
+}
+
+static Digits multiply_magnitudes(const Digits& a, const Digits& b) {
+  if (a.empty() || b.empty()) {
+    return Digits();
+  }
+  Digits ret(a.size() + b.size(), 0);
+  for (size_t x = 0; x < a.size(); x++) {
+    uint64_t carry = 0;
+    for (size_t y = 0; y < b.size(); y++) {
+      // (2**32 - 1)**2 + 2 * (2**32 - 1) is exactly 2**64 - 1
+      uint64_t t = static_cast<uint64_t>(a[x]) * b[y] + ret[x + y] + carry;
+      ret[x + y] = static_cast<uint32_t>(t);
+      carry = t >> 32;
+    }
+    ret[x + b.size()] = carry;
+  }
+  trim(ret);
+  return ret;
+}
+
+// a = a * m + add
+static void multiply_add_small(Digits& a, uint32_t m, uint32_t add) {
+  uint64_t carry = add;
+  for (auto& d : a) {
+    uint64_t t = static_cast<uint64_t>(d) * m + carry;
+    d = static_cast<uint32_t>(t);
+    carry = t >> 32;
+  }
+  if (carry) {
+    a.emplace_back(carry);
+  }
+  trim(a);
+}
+
+// divides a by d in place and returns the remainder
+static uint32_t divide_small(Digits& a, uint32_t d) {
+  uint64_t remainder = 0;
+  for (size_t x = a.size(); x > 0; x--) {
+    uint64_t n = (remainder << 32) | a[x - 1];
+    a[x - 1] = n / d;
+    remainder = n % d;
+  }
+  trim(a);
+  return remainder;
+}
+
+static Digits shift_left_magnitude(const Digits& a, uint64_t bits) {
+  if (a.empty()) {
+    return Digits();
+  }
+  uint8_t shift = bits & 31;
+  Digits ret(bits / 32, 0);
+  ret.reserve(ret.size() + a.size() + 1);
+  if (!shift) {
+    ret.insert(ret.end(), a.begin(), a.end());
+    return ret;
+  }
+  uint32_t carry = 0;
+  for (uint32_t d : a) {
+    ret.emplace_back((d << shift) | carry);
+    carry = d >> (32 - shift);
+  }
+  ret.emplace_back(carry);
+  trim(ret);
+  return ret;
+}
+
+static Digits shift_right_magnitude(const Digits& a, uint64_t bits) {
+  uint64_t words = bits / 32;
+  if (words >= a.size()) {
+    return Digits();
+  }
+  uint8_t shift = bits & 31;
+  Digits ret(a.size() - words);
+  for (size_t x = 0; x < ret.size(); x++) {
+    uint64_t v = a[x + words] >> shift;
+    if (shift && (x + words + 1 < a.size())) {
+      v |= static_cast<uint64_t>(a[x + words + 1]) << (32 - shift);
+    }
+    ret[x] = static_cast<uint32_t>(v);
+  }
+  trim(ret);
+  return ret;
+}
+
+// returns true if any of the low bits of a are set
+static bool any_low_bits(const Digits& a, uint64_t bits) {
+  uint64_t words = bits / 32;
+  for (size_t x = 0; (x < words) && (x < a.size()); x++) {
+    if (a[x]) {
+      return true;
+    }
+  }
+  return (bits & 31) && (words < a.size()) &&
+      (a[words] & ((1U << (bits & 31)) - 1));
+}
+
+// truncating division; b must not be zero. this is algorithm D from Knuth
+// (TAOCP vol. 2, 4.3.1), as written in Hacker's Delight (divmnu64)
+static void divide_magnitudes(const Digits& a, const Digits& b, Digits* q,
+    Digits* r) {
+  if (compare_magnitudes(a, b) < 0) {
+    q->clear();
+    *r = a;
+    return;
+  }
+  if (b.size() == 1) {
+    *q = a;
+    uint32_t remainder = divide_small(*q, b[0]);
+    r->clear();
+    if (remainder) {
+      r->emplace_back(remainder);
+    }
+    return;
+  }
+
+  // normalize so the divisor's highest bit is set; the dividend gets an extra
+  // digit for the bits shifted out of it
+  size_t n = b.size(), m = a.size();
+  uint8_t s = __builtin_clz(b.back());
+  Digits vn(n), un(m + 1);
+  for (size_t x = n - 1; x > 0; x--) {
+    vn[x] = (b[x] << s) | (s ? (b[x - 1] >> (32 - s)) : 0);
+  }
+  vn[0] = b[0] << s;
+  un[m] = s ? (a[m - 1] >> (32 - s)) : 0;
+  for (size_t x = m - 1; x > 0; x--) {
+    un[x] = (a[x] << s) | (s ? (a[x - 1] >> (32 - s)) : 0);
+  }
+  un[0] = a[0] << s;
+
+  q->assign(m - n + 1, 0);
+  for (size_t j = m - n + 1; j > 0; j--) {
+    size_t jj = j - 1;
+
+    // estimate the quotient digit from the top two digits, then correct it; it
+    // can still be 1 too large after this
+    uint64_t numerator = (static_cast<uint64_t>(un[jj + n]) << 32) | un[jj + n - 1];
+    uint64_t qhat = numerator / vn[n - 1];
+    uint64_t rhat = numerator % vn[n - 1];
+    while ((qhat >> 32) ||
+        (qhat * vn[n - 2] > ((rhat << 32) | un[jj + n - 2]))) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat >> 32) {
+        break;
+      }
+    }
+
+    // multiply and subtract
+    int64_t k = 0, t;
+    for (size_t x = 0; x < n; x++) {
+      uint64_t p = qhat * vn[x];
+      t = static_cast<int64_t>(un[x + jj]) - k - static_cast<int64_t>(p & 0xFFFFFFFF);
+      un[x + jj] = static_cast<uint32_t>(t);
+      k = static_cast<int64_t>(p >> 32) - (t >> 32);
+    }
+    t = static_cast<int64_t>(un[jj + n]) - k;
+    un[jj + n] = static_cast<uint32_t>(t);
+
+    // if we subtracted too much, add the divisor back
+    (*q)[jj] = qhat;
+    if (t < 0) {
+      (*q)[jj]--;
+      k = 0;
+      for (size_t x = 0; x < n; x++) {
+        t = static_cast<int64_t>(un[x + jj]) + vn[x] + k;
+        un[x + jj] = static_cast<uint32_t>(t);
+        k = t >> 32;
+      }
+      un[jj + n] += k;
+    }
+  }
+  trim(*q);
+
+  // unnormalize the remainder
+  r->resize(n);
+  for (size_t x = 0; x < n; x++) {
+    (*r)[x] = (un[x] >> s) |
+        (s ? static_cast<uint32_t>(static_cast<uint64_t>(un[x + 1]) << (32 - s)) : 0);
+  }
+  trim(*r);
+}
+
+
+
+// signed values are a sign and a magnitude. zero is never negative
+
+struct BigInt {
+  bool negative;
+  Digits digits;
+
+  BigInt() : negative(false) { }
+  BigInt(bool negative, Digits&& digits) : negative(negative && !digits.empty()),
+      digits(move(digits)) { }
+};
+
+static BigInt add(const BigInt& a, const BigInt& b) {
+  if (a.negative == b.negative) {
+    return BigInt(a.negative, add_magnitudes(a.digits, b.digits));
+  }
+  if (compare_magnitudes(a.digits, b.digits) >= 0) {
+    return BigInt(a.negative, subtract_magnitudes(a.digits, b.digits));
+  }
+  return BigInt(b.negative, subtract_magnitudes(b.digits, a.digits));
+}
+
+static BigInt negated(const BigInt& a) {
+  return BigInt(!a.negative, Digits(a.digits));
+}
+
+static BigInt subtract(const BigInt& a, const BigInt& b) {
+  return add(a, negated(b));
+}
+
+static BigInt multiply(const BigInt& a, const BigInt& b) {
+  return BigInt(a.negative != b.negative,
+      multiply_magnitudes(a.digits, b.digits));
+}
+
+static int compare(const BigInt& a, const BigInt& b) {
+  if (a.negative != b.negative) {
+    return a.negative ? -1 : 1;
+  }
+  int ret = compare_magnitudes(a.digits, b.digits);
+  return a.negative ? -ret : ret;
+}
+
+// b must not be zero. the quotient is rounded toward negative infinity, so the
+// remainder has the same sign as the divisor
+static void floor_divide(const BigInt& a, const BigInt& b, BigInt* q, BigInt* r) {
+  Digits q_digits, r_digits;
+  divide_magnitudes(a.digits, b.digits, &q_digits, &r_digits);
+  *q = BigInt(a.negative != b.negative, move(q_digits));
+  *r = BigInt(a.negative, move(r_digits));
+  if (!r->digits.empty() && (a.negative != b.negative)) {
+    *q = subtract(*q, BigInt(false, Digits(1, 1)));
+    *r = add(*r, b);
+  }
+}
+
+// returns the low count digits of a's infinite two's complement representation.
+// count must be larger than a's digit count
+static Digits twos_complement(const BigInt& a, size_t count) {
+  Digits ret(a.digits);
+  ret.resize(count, 0);
+  if (a.negative) {
+    uint64_t carry = 1;
+    for (auto& d : ret) {
+      carry += static_cast<uint32_t>(~d);
+      d = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+  }
+  return ret;
+}
+
+static BigInt from_twos_complement(Digits&& d) {
+  bool negative = d.back() >> 31;
+  if (negative) {
+    uint64_t carry = 1;
+    for (auto& digit : d) {
+      carry += static_cast<uint32_t>(~digit);
+      digit = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+  }
+  trim(d);
+  return BigInt(negative, move(d));
+}
+
+static BigInt bitwise(const BigInt& a, const BigInt& b, char op) {
+  size_t count = max(a.digits.size(), b.digits.size()) + 1;
+  Digits a_digits = twos_complement(a, count);
+  Digits b_digits = twos_complement(b, count);
+  for (size_t x = 0; x < count; x++) {
+    if (op == '&') {
+      a_digits[x] &= b_digits[x];
+    } else if (op == '|') {
+      a_digits[x] |= b_digits[x];
+    } else {
+      a_digits[x] ^= b_digits[x];
+    }
+  }
+  return from_twos_complement(move(a_digits));
+}
+
+static BigInt right_shift(const BigInt& a, uint64_t count) {
+  if (!a.negative) {
+    return BigInt(false, shift_right_magnitude(a.digits, count));
+  }
+  // shifts round toward negative infinity: -x >> n == -(((x - 1) >> n) + 1)
+  Digits shifted = shift_right_magnitude(
+      subtract_magnitudes(a.digits, Digits(1, 1)), count);
+  return BigInt(true, add_magnitudes(shifted, Digits(1, 1)));
+}
+
+static BigInt power(const BigInt& base, uint64_t exponent) {
+  BigInt ret(false, Digits(1, 1));
+  BigInt square = base;
+  for (;;) {
+    if (exponent & 1) {
+      ret = multiply(ret, square);
+    }
+    exponent >>= 1;
+    if (!exponent) {
+      break;
+    }
+    square = multiply(square, square);
+  }
+  return ret;
+}
+
+// returns false if the value is too large to be a Float
+static bool to_double(const BigInt& a, double* value) {
+  uint64_t bits = bit_length_of(a.digits);
+  double ret;
+  if (bits <= 64) {
+    uint64_t v = 0;
+    for (size_t x = a.digits.size(); x > 0; x--) {
+      v = (v << 32) | a.digits[x - 1];
+    }
+    ret = static_cast<double>(v);
+  } else {
+    // keep the top 64 bits, and set the lowest of them if any of the discarded
+    // bits are set, so the conversion rounds the same way it would for the
+    // exact value. the scaling is exact
+    uint64_t shift = bits - 64;
+    Digits top = shift_right_magnitude(a.digits, shift);
+    uint64_t v = (static_cast<uint64_t>(top[1]) << 32) | top[0];
+    v |= any_low_bits(a.digits, shift);
+    ret = (shift > 2048) ? INFINITY : ldexp(static_cast<double>(v), shift);
+  }
+  if (isinf(ret)) {
+    return false;
+  }
+  *value = a.negative ? -ret : ret;
+  return true;
+}
+
+// value must be finite and integral
+static BigInt from_double(double value) {
+  bool negative = (value < 0);
+  int exponent;
+  double mantissa = frexp(fabs(value), &exponent);
+  if (exponent <= 53) {
+    return BigInt(negative, digits_for_uint64(static_cast<uint64_t>(fabs(value))));
+  }
+  Digits m = digits_for_uint64(static_cast<uint64_t>(ldexp(mantissa, 53)));
+  return BigInt(negative, shift_left_magnitude(m, exponent - 53));
+}
+
+
+
+// objects. live_objects is how values that merely look like promoted values
+// are told apart from real ones. objects_by_hash finds the existing object for
+// a value, but doesn't own it; an object removes itself when it's destroyed
+
+struct BigIntObject {
+  BasicObject basic;
+  bool negative;
+  Digits digits;
+
+  BigIntObject(bool negative, const Digits& digits);
+};
+
+static unordered_set<const BigIntObject*>& live_objects() {
+  static unordered_set<const BigIntObject*> objects;
+  return objects;
+}
+
+static unordered_multimap<uint64_t, BigIntObject*>& objects_by_hash() {
+  static unordered_multimap<uint64_t, BigIntObject*> objects;
+  return objects;
+}
+
+static uint64_t hash_of(bool negative, const Digits& digits) {
+  // fnv-1a over the digits
+  uint64_t ret = negative ? 0xCBF29CE484222325 : 0x84222325CBF29CE4;
+  for (uint32_t d : digits) {
+    ret = (ret ^ d) * 0x00000100000001B3;
+  }
+  return ret;
+}
+
+static void delete_promoted_object(void* o) {
+  BigIntObject* obj = reinterpret_cast<BigIntObject*>(o);
+  auto& objects = objects_by_hash();
+  auto its = objects.equal_range(hash_of(obj->negative, obj->digits));
+  for (auto it = its.first; it != its.second; it++) {
+    if (it->second == obj) {
+      objects.erase(it);
+      break;
+    }
+  }
+  live_objects().erase(obj);
+  delete obj;
+}
+
+BigIntObject::BigIntObject(bool negative, const Digits& digits) :
+    basic(&delete_promoted_object), negative(negative), digits(digits) { }
+
+static const BigIntObject* promoted_object(int64_t v) {
+  if (!int_is_promoted(v)) {
+    return NULL;
+  }
+  const BigIntObject* o = reinterpret_cast<const BigIntObject*>(
+      v & ~INT_PROMOTED_BIT);
+  return live_objects().count(o) ? o : NULL;
+}
+
+static BigInt unpack(int64_t v) {
+  const BigIntObject* o = promoted_object(v);
+  if (o) {
+    return BigInt(o->negative, Digits(o->digits));
+  }
+  uint64_t magnitude = (v < 0) ? -static_cast<uint64_t>(v) : v;
+  return BigInt(v < 0, digits_for_uint64(magnitude));
+}
+
+// returns a new reference if the value is promoted
+static int64_t pack(const BigInt& v) {
+  if (v.digits.size() <= 2) {
+    uint64_t magnitude = 0;
+    for (size_t x = v.digits.size(); x > 0; x--) {
+      magnitude = (magnitude << 32) | v.digits[x - 1];
+    }
+    if (magnitude < static_cast<uint64_t>(INT_PROMOTED_BIT)) {
+      return v.negative ? -static_cast<int64_t>(magnitude) : magnitude;
+    }
+    if (v.negative && (magnitude == static_cast<uint64_t>(INT_PROMOTED_BIT))) {
+      return -INT_PROMOTED_BIT;
+    }
+  }
+
+  auto& objects = objects_by_hash();
+  uint64_t hash = hash_of(v.negative, v.digits);
+  auto its = objects.equal_range(hash);
+  for (auto it = its.first; it != its.second; it++) {
+    if ((it->second->negative == v.negative) && (it->second->digits == v.digits)) {
+      add_reference(it->second);
+      return reinterpret_cast<int64_t>(it->second) | INT_PROMOTED_BIT;
+    }
+  }
+
+  BigIntObject* o = new BigIntObject(v.negative, v.digits);
+  objects.emplace(hash, o);
+  live_objects().emplace(o);
+  return reinterpret_cast<int64_t>(o) | INT_PROMOTED_BIT;
+}
+
+static bool is_promoted(int64_t v) {
+  return promoted_object(v) != NULL;
+}
+
+size_t int_promoted_object_count() {
+  return live_objects().size();
+}
+
+// returns false if the value doesn't fit in an int64_t
+static bool unpack_int64(int64_t v, int64_t* value) {
+  const BigIntObject* o = promoted_object(v);
+  if (!o) {
+    *value = v;
+    return true;
+  }
+  if (o->digits.size() > 2) {
+    return false;
+  }
+  uint64_t magnitude = (o->digits.size() == 2) ?
+      ((static_cast<uint64_t>(o->digits[1]) << 32) | o->digits[0]) : o->digits[0];
+  if (magnitude > static_cast<uint64_t>(INT64_MAX) + o->negative) {
+    return false;
+  }
+  *value = o->negative ? -magnitude : magnitude;
+  return true;
+}
+
+
+
+int64_t int_from_int64(int64_t v) {
+  if (int_is_direct(v)) {
+    return v;
+  }
+  uint64_t magnitude = (v < 0) ? -static_cast<uint64_t>(v) : v;
+  return pack(BigInt(v < 0, digits_for_uint64(magnitude)));
+}
+
+int64_t int_from_uint64(uint64_t v) {
+  if (v < static_cast<uint64_t>(INT_PROMOTED_BIT)) {
+    return v;
+  }
+  return pack(BigInt(false, digits_for_uint64(v)));
+}
+
+int64_t int_from_double(double v, ExceptionBlock* exc_block) {
+  if (isnan(v)) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    return 0;
+  }
+  if (isinf(v)) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    return 0;
+  }
+  v = trunc(v);
+  if ((v >= -9223372036854775808.0) && (v < 9223372036854775808.0)) {
+    return int_from_int64(static_cast<int64_t>(v));
+  }
+  return pack(from_double(v));
+}
+
+int64_t int_to_int64(int64_t v, ExceptionBlock* exc_block) {
+  int64_t ret;
+  if (!unpack_int64(v, &ret)) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    return 0;
+  }
+  return ret;
+}
+
+bool int_fits_int64(int64_t v) {
+  int64_t value;
+  return unpack_int64(v, &value);
+}
+
+static bool promoted_to_double(int64_t v, double* value) {
+  return to_double(unpack(v), value);
+}
+
+double int_to_double(int64_t v, ExceptionBlock* exc_block) {
+  if (!is_promoted(v)) {
+    return static_cast<double>(v);
+  }
+  double ret;
+  if (!promoted_to_double(v, &ret)) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    return 0.0;
+  }
+  return ret;
+}
+
+
+
+int64_t int_add(int64_t a, int64_t b) {
+  int64_t ret;
+  if (!is_promoted(a) && !is_promoted(b) && !__builtin_add_overflow(a, b, &ret)) {
+    return int_from_int64(ret);
+  }
+  return pack(add(unpack(a), unpack(b)));
+}
+
+int64_t int_subtract(int64_t a, int64_t b) {
+  int64_t ret;
+  if (!is_promoted(a) && !is_promoted(b) && !__builtin_sub_overflow(a, b, &ret)) {
+    return int_from_int64(ret);
+  }
+  return pack(subtract(unpack(a), unpack(b)));
+}
+
+int64_t int_multiply(int64_t a, int64_t b) {
+  int64_t ret;
+  if (!is_promoted(a) && !is_promoted(b) && !__builtin_mul_overflow(a, b, &ret)) {
+    return int_from_int64(ret);
+  }
+  return pack(multiply(unpack(a), unpack(b)));
+}
+
+static int64_t promoted_floor_divide(int64_t a, int64_t b, bool is_mod) {
+  BigInt q, r;
+  floor_divide(unpack(a), unpack(b), &q, &r);
+  return pack(is_mod ? r : q);
+}
+
+int64_t int_floor_divide(int64_t a, int64_t b, ExceptionBlock* exc_block) {
+  if (b == 0) {
+    raise_python_exception(exc_block, create_instance(ZeroDivisionError_class_id));
+    return 0;
+  }
+  return promoted_floor_divide(a, b, false);
+}
+
+int64_t int_modulus(int64_t a, int64_t b, ExceptionBlock* exc_block) {
+  if (b == 0) {
+    raise_python_exception(exc_block, create_instance(ZeroDivisionError_class_id));
+    return 0;
+  }
+  return promoted_floor_divide(a, b, true);
+}
+
+int64_t int_power(int64_t a, int64_t b, ExceptionBlock* exc_block) {
+  if (int_is_negative(b)) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    return 0;
+  }
+
+  // 0, 1 and -1 can be raised to any power; anything else raised to a power
+  // that doesn't fit in an int64_t has far too many bits
+  if ((a == 0) || (a == 1)) {
+    return (b == 0) ? 1 : a;
+  }
+  int64_t exponent;
+  if (a == -1) {
+    return (int_bit_count(int_and(b, 1))) ? -1 : 1;
+  }
+  if (!unpack_int64(b, &exponent) ||
+      (static_cast<unsigned __int128>(int_bit_length(a) - 1) * exponent >
+       max_result_bits)) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    return 0;
+  }
+  return pack(power(unpack(a), exponent));
+}
+
+int64_t int_negate(int64_t a) {
+  if (!is_promoted(a) && (a != INT64_MIN)) {
+    return int_from_int64(-a);
+  }
+  return pack(negated(unpack(a)));
+}
+
+int64_t int_absolute(int64_t a) {
+  return int_is_negative(a) ? int_negate(a) : int_add_reference(a);
+}
+
+int64_t int_invert(int64_t a) {
+  if (!is_promoted(a)) {
+    return int_from_int64(~a);
+  }
+  // ~x == -x - 1
+  return pack(subtract(negated(unpack(a)), BigInt(false, Digits(1, 1))));
+}
+
+int64_t int_and(int64_t a, int64_t b) {
+  if (!is_promoted(a) && !is_promoted(b)) {
+    return int_from_int64(a & b);
+  }
+  return pack(bitwise(unpack(a), unpack(b), '&'));
+}
+
+int64_t int_or(int64_t a, int64_t b) {
+  if (!is_promoted(a) && !is_promoted(b)) {
+    return int_from_int64(a | b);
+  }
+  return pack(bitwise(unpack(a), unpack(b), '|'));
+}
+
+int64_t int_xor(int64_t a, int64_t b) {
+  if (!is_promoted(a) && !is_promoted(b)) {
+    return int_from_int64(a ^ b);
+  }
+  return pack(bitwise(unpack(a), unpack(b), '^'));
+}
+
+int64_t int_left_shift(int64_t a, int64_t b, ExceptionBlock* exc_block) {
+  if (int_is_negative(b)) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    return 0;
+  }
+  if (a == 0) {
+    return 0;
+  }
+  int64_t count;
+  if (!unpack_int64(b, &count) ||
+      (static_cast<uint64_t>(count) > max_result_bits)) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    return 0;
+  }
+  BigInt v = unpack(a);
+  return pack(BigInt(v.negative, shift_left_magnitude(v.digits, count)));
+}
+
+int64_t int_right_shift(int64_t a, int64_t b, ExceptionBlock* exc_block) {
+  if (int_is_negative(b)) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    return 0;
+  }
+  int64_t count;
+  if (!unpack_int64(b, &count)) {
+    return int_is_negative(a) ? -1 : 0;
+  }
+  if (!is_promoted(a)) {
+    return (count > 63) ? (a >> 63) : int_from_int64(a >> count);
+  }
+  return pack(right_shift(unpack(a), count));
+}
+
+int64_t int_sum(const int64_t* items, size_t count, int64_t start) {
+  BigInt ret = unpack(start);
+  for (size_t x = 0; x < count; x++) {
+    ret = add(ret, unpack(items[x]));
+  }
+  return pack(ret);
+}
+
+int64_t int_compare(int64_t a, int64_t b) {
+  if (!is_promoted(a) && !is_promoted(b)) {
+    return (a < b) ? -1 : (a > b);
+  }
+  return compare(unpack(a), unpack(b));
+}
+
+bool int_is_negative(int64_t v) {
+  const BigIntObject* o = promoted_object(v);
+  return o ? o->negative : (v < 0);
+}
+
+
+
+int64_t int_bit_length(int64_t v) {
+  const BigIntObject* o = promoted_object(v);
+  if (o) {
+    return bit_length_of(o->digits);
+  }
+  uint64_t magnitude = (v < 0) ? -static_cast<uint64_t>(v) : v;
+  return magnitude ? (64 - __builtin_clzll(magnitude)) : 0;
+}
+
+int64_t int_bit_count(int64_t v) {
+  const BigIntObject* o = promoted_object(v);
+  if (o) {
+    int64_t ret = 0;
+    for (uint32_t d : o->digits) {
+      ret += __builtin_popcount(d);
+    }
+    return ret;
+  }
+  uint64_t magnitude = (v < 0) ? -static_cast<uint64_t>(v) : v;
+  return __builtin_popcountll(magnitude);
+}
+
+static int64_t promoted_factorial(uint64_t n) {
+  // multiply as many factors together as fit in a digit before multiplying
+  // them into the result, which cuts down the number of passes over it
+  Digits ret(1, 1);
+  uint64_t factors = 1;
+  for (uint64_t x = 2; x <= n; x++) {
+    if (factors * x > 0xFFFFFFFF) {
+      multiply_add_small(ret, factors, 0);
+      factors = 1;
+    }
+    factors *= x;
+  }
+  multiply_add_small(ret, factors, 0);
+  return pack(BigInt(false, move(ret)));
+}
+
+int64_t int_factorial(int64_t v, ExceptionBlock* exc_block) {
+  if (int_is_negative(v)) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    return 0;
+  }
+  // the factors have to fit in a digit (and the result in memory)
+  if (is_promoted(v) || (v > 0xFFFFFFFF)) {
+    raise_python_exception(exc_block, create_instance(OverflowError_class_id));
+    return 0;
+  }
+
+  int64_t ret = 1;
+  for (int64_t x = 2; x <= v; x++) {
+    if (__builtin_mul_overflow(ret, x, &ret) || !int_is_direct(ret)) {
+      return promoted_factorial(v);
+    }
+  }
+  return ret;
+}
+
+int64_t int_gcd(int64_t a, int64_t b) {
+  if (!is_promoted(a) && !is_promoted(b)) {
+    uint64_t x = (a < 0) ? -static_cast<uint64_t>(a) : a;
+    uint64_t y = (b < 0) ? -static_cast<uint64_t>(b) : b;
+    while (y) {
+      uint64_t t = y;
+      y = x % y;
+      x = t;
+    }
+    return int_from_uint64(x);
+  }
+
+  Digits x = unpack(a).digits, y = unpack(b).digits;
+  while (!y.empty()) {
+    Digits q, r;
+    divide_magnitudes(x, y, &q, &r);
+    x = move(y);
+    y = move(r);
+  }
+  return pack(BigInt(false, move(x)));
+}
+
+
+
+bool int_format_digits(string& out, int64_t v, uint8_t base, bool uppercase) {
+  const char* alphabet = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+  BigInt value = unpack(v);
+  out.clear();
+
+  if (base == 10) {
+    // 9 digits at a time, least significant first
+    Digits& d = value.digits;
+    while (!d.empty()) {
+      uint32_t chunk = divide_small(d, 1000000000);
+      for (size_t x = 0; (x < 9) && (chunk || !d.empty()); x++) {
+        out.push_back('0' + (chunk % 10));
+        chunk /= 10;
+      }
+    }
+
+  } else {
+    uint8_t bits = (base == 2) ? 1 : ((base == 8) ? 3 : 4);
+    uint64_t length = bit_length_of(value.digits);
+    for (uint64_t offset = 0; offset < length; offset += bits) {
+      uint64_t word = offset / 32;
+      uint64_t digit = value.digits[word] >> (offset & 31);
+      if (((offset & 31) + bits > 32) && (word + 1 < value.digits.size())) {
+        digit |= static_cast<uint64_t>(value.digits[word + 1]) << (32 - (offset & 31));
+      }
+      out.push_back(alphabet[digit & ((1 << bits) - 1)]);
+    }
+  }
+
+  if (out.empty()) {
+    out.push_back('0');
+  }
+  reverse(out.begin(), out.end());
+  return value.negative;
+}
+
+int64_t int_from_digits(const uint8_t* digits, size_t count, uint8_t base,
+    bool negative) {
+  // combine as many digits as fit in 32 bits before multiplying them into the
+  // result
+  uint32_t chunk_limit = 0xFFFFFFFF / base;
+  Digits ret;
+  uint32_t chunk = 0, chunk_scale = 1;
+  for (size_t x = 0; x < count; x++) {
+    if (chunk_scale > chunk_limit) {
+      multiply_add_small(ret, chunk_scale, chunk);
+      chunk = 0;
+      chunk_scale = 1;
+    }
+    chunk = chunk * base + digits[x];
+    chunk_scale *= base;
+  }
+  multiply_add_small(ret, chunk_scale, chunk);
+  return pack(BigInt(negative, move(ret)));
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "../Exception.hh"
+#include "Reference.hh"
+
+
+// Ints are 64-bit values, but only values in [-2**62, 2**62) are stored
+// directly. a value outside that range is promoted to a bignum object, and the
+// Int holds the object's address with INT_PROMOTED_BIT set. addresses are below
+// 2**47, so promoted values are always in [2**62, 2**63): doubling a direct
+// value never overflows, and doubling a promoted value always does, so
+// generated code can check its operands with `add r, r; jo`, and can check a
+// result by doing the arithmetic on doubled operands.
+//
+// bignum objects are reference counted like other objects, so a promoted Int
+// owns a reference to its object wherever it's stored, and temporaries are
+// freed when the last reference is deleted. there's still only one live object
+// for each value (a table that doesn't own its objects finds the existing one),
+// so == and hashing can compare the raw values, and containers can store Ints
+// as they are - they just add and delete references for the promoted ones. the
+// int_* functions below borrow their arguments and return new references.
+// constants (literals and folded expressions) are never released, so they
+// live until the program exits.
+//
+// any 64-bit value that isn't a promoted value is treated as itself, even if
+// it's outside the direct range. these functions accept such values, but they
+// only return direct or promoted values.
+
+#define INT_PROMOTED_BIT 0x4000000000000000LL
+
+inline bool int_is_direct(int64_t v) {
+  return (v >= -INT_PROMOTED_BIT) && (v < INT_PROMOTED_BIT);
+}
+
+inline bool int_is_promoted(int64_t v) {
+  return (v & 0xC000000000000000LL) == INT_PROMOTED_BIT;
+}
+
+// these do nothing for values that aren't promoted. add_reference and
+// delete_reference clear INT_PROMOTED_BIT themselves
+inline int64_t int_add_reference(int64_t v) {
+  if (int_is_promoted(v)) {
+    add_reference(reinterpret_cast<void*>(v));
+  }
+  return v;
+}
+
+inline void int_delete_reference(int64_t v) {
+  if (int_is_promoted(v)) {
+    delete_reference(reinterpret_cast<void*>(v));
+  }
+}
+
+// conversions. int_from_double truncates toward zero, and raises ValueError for
+// NaN and OverflowError for infinities. int_to_int64 and int_to_double raise
+// OverflowError if the value doesn't fit
+int64_t int_from_int64(int64_t v);
+int64_t int_from_uint64(uint64_t v);
+int64_t int_from_double(double v, ExceptionBlock* exc_block = NULL);
+int64_t int_to_int64(int64_t v, ExceptionBlock* exc_block = NULL);
+bool int_fits_int64(int64_t v);
+double int_to_double(int64_t v, ExceptionBlock* exc_block = NULL);
+
+// arithmetic, with the same semantics as python's operators. floor division
+// and modulus raise ZeroDivisionError; shifts by negative counts and negative
+// exponents raise ValueError (nemesys Ints can't become Floats); results too
+// large to represent raise OverflowError
+int64_t int_add(int64_t a, int64_t b);
+int64_t int_subtract(int64_t a, int64_t b);
+int64_t int_multiply(int64_t a, int64_t b);
+int64_t int_floor_divide(int64_t a, int64_t b, ExceptionBlock* exc_block = NULL);
+int64_t int_modulus(int64_t a, int64_t b, ExceptionBlock* exc_block = NULL);
+int64_t int_power(int64_t a, int64_t b, ExceptionBlock* exc_block = NULL);
+int64_t int_negate(int64_t a);
+int64_t int_absolute(int64_t a);
+int64_t int_invert(int64_t a);
+int64_t int_and(int64_t a, int64_t b);
+int64_t int_or(int64_t a, int64_t b);
+int64_t int_xor(int64_t a, int64_t b);
+int64_t int_left_shift(int64_t a, int64_t b, ExceptionBlock* exc_block = NULL);
+int64_t int_right_shift(int64_t a, int64_t b, ExceptionBlock* exc_block = NULL);
+
+// adds start and all the items. this is faster than calling int_add for each
+// item when the partial sums are promoted, since they aren't packed into
+// objects
+int64_t int_sum(const int64_t* items, size_t count, int64_t start);
+
+// returns -1, 0 or 1
+int64_t int_compare(int64_t a, int64_t b);
+bool int_is_negative(int64_t v);
+
+int64_t int_bit_length(int64_t v);
+int64_t int_bit_count(int64_t v);
+int64_t int_factorial(int64_t v, ExceptionBlock* exc_block = NULL);
+int64_t int_gcd(int64_t a, int64_t b);
+
+// writes the digits of |v| in base 2, 8, 10 or 16 to out (replacing its
+// contents) and returns true if v is negative
+bool int_format_digits(std::string& out, int64_t v, uint8_t base,
+    bool uppercase = false);
+
+// returns the number of bignum objects that are currently allocated, including
+// constants
+size_t int_promoted_object_count();
+
+// builds an Int from digit values (not characters), most significant first.
+// every digit must be less than base
+int64_t int_from_digits(const uint8_t* digits, size_t count, uint8_t base,
+    bool negative);
@@ -1,16 +1,49 @@
 #include "List.hh"
 
+#include <emmintrin.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <phosg/Strings.hh>
 
 #include "../BuiltinFunctions.hh"
+#include "Int.hh"
+#include "Slice.hh"
+#include "Strings.hh"
 
 using namespace std;
 
 
+// lists grow geometrically so that appending is O(1) amortized, and shrink
+// only when they're much less than full so that alternating appends and pops
+// at a capacity boundary don't reallocate every time
+static double growth_factor = 1.5;
+
+void list_set_growth_factor(double factor) {
+  // factors too close to 1 would make growth effectively linear
+  growth_factor = (factor < 1.125) ? 1.125 : factor;
+}
+
+double list_growth_factor() {
+  return growth_factor;
+}
+
+// the capacity a list with the given number of items grows to. this is always
+// larger than the count, so lists made by list_new don't reallocate on their
+// first append
+static uint64_t grown_capacity(uint64_t count) {
+  uint64_t capacity = count * growth_factor;
+  if (capacity < 2 * LIST_INLINE_CAPACITY) {
+    capacity = 2 * LIST_INLINE_CAPACITY;
+  }
+  if (capacity <= count) {
+    capacity = count + 1;
+  }
+  return capacity;
+}
+
 ListObject* list_new(uint64_t count, bool items_are_objects,
     ExceptionBlock* exc_block) {
   ListObject* l = reinterpret_cast<ListObject*>(malloc(sizeof(ListObject)));
@@ -21,23 +54,38 @@ ListObject* list_new(uint64_t count, bool items_are_objects,
   l->basic.refcount = 1;
   l->basic.destructor = reinterpret_cast<void (*)(void*)>(list_delete);
   l->count = count;
-  l->capacity = count;
   l->items_are_objects = items_are_objects;
-  if (l->count) {
-    l->items = reinterpret_cast<void**>(malloc(l->count * sizeof(void*)));
+  l->items_are_ints = false;
+  if (count <= LIST_INLINE_CAPACITY) {
+    l->capacity = LIST_INLINE_CAPACITY;
+    l->items = l->inline_items;
   } else {
-    l->items = NULL;
+    l->capacity = grown_capacity(count);
+    l->items = reinterpret_cast<void**>(malloc(l->capacity * sizeof(void*)));
+    if (!l->items) {
+      free(l);
+      raise_python_exception(exc_block, &MemoryError_instance);
+      throw bad_alloc();
+    }
   }
   return l;
 }
 
-void list_delete(ListObject* l) {
-  if (l->items) {
-    if (l->items_are_objects) {
-      for (uint64_t x = 0; x < l->count; x++) {
+// deletes the list's references to items [start, end)
+static void list_delete_item_references(ListObject* l, uint64_t start,
+    uint64_t end) {
+  if (l->items_are_objects || l->items_are_ints) {
+    for (uint64_t x = start; x < end; x++) {
+      if (list_item_has_refcount(l, l->items[x])) {
         delete_reference(l->items[x]);
       }
     }
+  }
+}
+
+void list_delete(ListObject* l) {
+  list_delete_item_references(l, 0, l->count);
+  if (l->items != l->inline_items) {
     free(l->items);
   }
   free(l);
@@ -54,7 +102,7 @@ void* list_get_item(const ListObject* l, int64_t position,
     throw out_of_range("index out of range for list object");
   }
   void* ret = l->items[position];
-  if (l->items_are_objects) {
+  if (list_item_has_refcount(l, ret)) {
     add_reference(ret);
   }
   return ret;
@@ -69,15 +117,59 @@ void list_set_item(ListObject* l, int64_t position, void* value,
     raise_python_exception(exc_block, create_instance(IndexError_class_id));
     throw out_of_range("index out of range for list object");
   }
-  if (l->items_are_objects && l->items[position]) {
+  if (list_item_has_refcount(l, l->items[position])) {
     delete_reference(l->items[position]);
   }
   l->items[position] = value;
-  if (l->items_are_objects) {
+  if (list_item_has_refcount(l, value)) {
     add_reference(value);
   }
 }
 
+static void list_set_capacity(ListObject* l, uint64_t capacity,
+    ExceptionBlock* exc_block) {
+  // move the items back inline if they fit
+  if (capacity <= LIST_INLINE_CAPACITY) {
+    if (l->items != l->inline_items) {
+      memcpy(l->inline_items, l->items, l->count * sizeof(void*));
+      free(l->items);
+      l->items = l->inline_items;
+    }
+    l->capacity = LIST_INLINE_CAPACITY;
+    return;
+  }
+
+  // realloc can often extend the array in place, avoiding the copy. this
+  // doesn't apply to inline items, which always have to be copied out
+  void** new_items;
+  if (l->items == l->inline_items) {
+    new_items = reinterpret_cast<void**>(malloc(capacity * sizeof(void*)));
+    if (new_items) {
+      memcpy(new_items, l->inline_items, l->count * sizeof(void*));
+    }
+  } else {
+    new_items = reinterpret_cast<void**>(realloc(l->items,
+        capacity * sizeof(void*)));
+  }
+  if (!new_items) {
+    raise_python_exception(exc_block, &MemoryError_instance);
+    throw bad_alloc();
+  }
+  l->items = new_items;
+  l->capacity = capacity;
+}
+
+void list_reserve(ListObject* l, uint64_t capacity, ExceptionBlock* exc_block) {
+  if (capacity > l->capacity) {
+    list_set_capacity(l, capacity, exc_block);
+  }
+}
+
+// makes room for at least one more item
+static void list_grow(ListObject* l, ExceptionBlock* exc_block) {
+  list_set_capacity(l, grown_capacity(l->capacity), exc_block);
+}
+
 void list_insert(ListObject* l, int64_t position, void* value,
     ExceptionBlock* exc_block) {
 
@@ -89,39 +181,31 @@ void list_insert(ListObject* l, int64_t position, void* value,
     throw out_of_range("index out of range for list insert");
   }
 
-  if (l->count <= l->capacity) {
-    memmove(&l->items[position + 1], &l->items[position],
-        (l->count - position) * sizeof(void*));
-    l->items[position] = value;
-    l->count++;
-
-  } else {
-    // TODO: maybe we can do something smarter than just doubling the capacity
-    size_t new_capacity = (l->capacity == 0) ? 1 : (2 * l->capacity);
-    void** new_items = reinterpret_cast<void**>(malloc(new_capacity * sizeof(void*)));
-    if (!new_items) {
-      raise_python_exception(exc_block, &MemoryError_instance);
-      throw bad_alloc();
-    }
+  if (l->count == l->capacity) {
+    list_grow(l, exc_block);
+  }
 
-    memcpy(new_items, l->items, position * sizeof(void*));
-    new_items[position] = value;
-    memcpy(&new_items[position + 1], &l->items[position],
+  if (position < static_cast<ssize_t>(l->count)) {
+    memmove(&l->items[position + 1], &l->items[position],
         (l->count - position) * sizeof(void*));
-
-    free(l->items);
-    l->items = new_items;
-    l->capacity = new_capacity;
-    l->count++;
   }
+  l->items[position] = value;
+  l->count++;
 
-  if (l->items_are_objects) {
+  if (list_item_has_refcount(l, value)) {
     add_reference(value);
   }
 }
 
 void list_append(ListObject* l, void* value, ExceptionBlock* exc_block) {
-  list_insert(l, l->count, value, exc_block);
+  if (l->count == l->capacity) {
+    list_grow(l, exc_block);
+  }
+  l->items[l->count++] = value;
+
+  if (list_item_has_refcount(l, value)) {
+    add_reference(value);
+  }
 }
 
 void* list_pop(ListObject* l, int64_t position, ExceptionBlock* exc_block) {
@@ -134,22 +218,26 @@ void* list_pop(ListObject* l, int64_t position, ExceptionBlock* exc_block) {
   }
 
   void* ret = l->items[position];
+  l->count--;
+  if (position < static_cast<ssize_t>(l->count)) {
+    memmove(&l->items[position], &l->items[position + 1],
+        (l->count - position) * sizeof(void*));
+  }
 
-  // if less than 50% of the list will be in use after popping, shrink it to fit
-  if (l->count <= l->capacity / 2) {
-    void** new_items = reinterpret_cast<void**>(malloc((l->count - 1) * sizeof(void*)));
-    if (!new_items) {
-      raise_python_exception(exc_block, &MemoryError_instance);
-      throw bad_alloc();
+  // if less than 25% of the list is in use, shrink it to 50%. shrinking can't
+  // fail, so if realloc does, just keep the larger array
+  if ((l->capacity > LIST_INLINE_CAPACITY) && (l->count < l->capacity / 4)) {
+    uint64_t new_capacity = l->count * 2;
+    if (new_capacity <= LIST_INLINE_CAPACITY) {
+      list_set_capacity(l, LIST_INLINE_CAPACITY, exc_block);
+    } else {
+      void** new_items = reinterpret_cast<void**>(realloc(l->items,
+          new_capacity * sizeof(void*)));
+      if (new_items) {
+        l->items = new_items;
+        l->capacity = new_capacity;
+      }
     }
-    memcpy(new_items, l->items, position * sizeof(void*));
-    memcpy(&new_items[position], &l->items[position + 1],
-        (l->count - position - 1) * sizeof(void*));
-
-  } else {
-    memmove(&l->items[position], &l->items[position + 1],
-        (l->count - position - 1) * sizeof(void*));
-    l->count--;
   }
 
   // no need to mess with references - the reference formerly owned by the list
@@ -158,16 +246,575 @@ void* list_pop(ListObject* l, int64_t position, ExceptionBlock* exc_block) {
 }
 
 void list_clear(ListObject* l) {
-  if (l->items_are_objects) {
-    for (uint64_t x = 0; x < l->count; x++) {
-      delete_reference(l->items[x]);
-    }
+  list_delete_item_references(l, 0, l->count);
+  if (l->items != l->inline_items) {
+    free(l->items);
   }
-  free(l->items);
-  l->items = NULL;
+  l->items = l->inline_items;
   l->count = 0;
+  l->capacity = LIST_INLINE_CAPACITY;
+}
+
+ListObject* list_slice(const ListObject* l, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block) {
+  int64_t count = slice_adjust_indices(l->count, &start, &stop, step,
+      exc_block);
+
+  // the slice is allocated at exactly its final size, and since items are
+  // unboxed, copying them is just a memcpy (plus references for objects)
+  ListObject* ret = list_new(count, l->items_are_objects, exc_block);
+  ret->items_are_ints = l->items_are_ints;
+  if (step == 1) {
+    memcpy(ret->items, &l->items[start], count * sizeof(void*));
+  } else {
+    for (int64_t x = 0; x < count; x++, start += step) {
+      ret->items[x] = l->items[start];
+    }
+  }
+  if (l->items_are_objects || l->items_are_ints) {
+    for (int64_t x = 0; x < count; x++) {
+      if (list_item_has_refcount(ret, ret->items[x])) {
+        add_reference(ret->items[x]);
+      }
+    }
+  }
+  return ret;
+}
+
+void list_set_slice(ListObject* l, int64_t start, int64_t stop, int64_t step,
+    const ListObject* value, ExceptionBlock* exc_block) {
+  // in l[x:y] = l, the items would move while we're copying them
+  if (value == l) {
+    ListObject* value_copy = list_slice(l, SLICE_INDEX_OMITTED,
+        SLICE_INDEX_OMITTED, 1, exc_block);
+    try {
+      list_set_slice(l, start, stop, step, value_copy, exc_block);
+    } catch (...) {
+      delete_reference(value_copy);
+      throw;
+    }
+    delete_reference(value_copy);
+    return;
+  }
+
+  int64_t count = slice_adjust_indices(l->count, &start, &stop, step,
+      exc_block);
+
+  // extended slices must be replaced with the same number of items
+  if (step != 1) {
+    if (static_cast<uint64_t>(count) != value->count) {
+      raise_python_exception(exc_block, create_instance(ValueError_class_id));
+      throw invalid_argument("extended slice assignment changes list length");
+    }
+    for (int64_t x = 0; x < count; x++, start += step) {
+      if (list_item_has_refcount(l, l->items[start])) {
+        delete_reference(l->items[start]);
+      }
+      if (list_item_has_refcount(l, value->items[x])) {
+        add_reference(value->items[x]);
+      }
+      l->items[start] = value->items[x];
+    }
+    return;
+  }
+
+  // simple slices can change the list's length. count is the number of items
+  // being replaced
+  list_delete_item_references(l, start, start + count);
+  uint64_t new_count = l->count - count + value->count;
+  if (new_count > l->capacity) {
+    uint64_t new_capacity = l->capacity * growth_factor;
+    list_reserve(l, (new_capacity > new_count) ? new_capacity : new_count,
+        exc_block);
+  }
+  memmove(&l->items[start + value->count], &l->items[start + count],
+      (l->count - start - count) * sizeof(void*));
+  memcpy(&l->items[start], value->items, value->count * sizeof(void*));
+  if (l->items_are_objects || l->items_are_ints) {
+    for (uint64_t x = 0; x < value->count; x++) {
+      if (list_item_has_refcount(l, value->items[x])) {
+        add_reference(value->items[x]);
+      }
+    }
+  }
+  l->count = new_count;
 }
 
 size_t list_size(const ListObject* l) {
   return l->count;
 }
+
+
+
+// lists shorter than this are insertion sorted; the radix sort's fixed cost
+// (histograms and the temporary buffer) isn't worth it for them
+#define LIST_SORT_INSERTION_THRESHOLD 32
+
+static void* list_sort_buffer(uint64_t count, ExceptionBlock* exc_block) {
+  void* buffer = malloc(count * sizeof(void*));
+  if (!buffer) {
+    raise_python_exception(exc_block, &MemoryError_instance);
+    throw bad_alloc();
+  }
+  return buffer;
+}
+
+// Key maps an item to a uint64_t whose unsigned order is the items' order
+template <typename Key>
+static void list_insertion_sort(uint64_t* items, uint64_t count, Key key) {
+  for (uint64_t x = 1; x < count; x++) {
+    uint64_t item = items[x];
+    uint64_t item_key = key(item);
+    uint64_t y = x;
+    for (; (y > 0) && (key(items[y - 1]) > item_key); y--) {
+      items[y] = items[y - 1];
+    }
+    items[y] = item;
+  }
+}
+
+// LSD radix sort on 8-bit digits. the histograms for all digits are built in
+// one pass, and digits that are the same for every item (e.g. the high bytes
+// of small numbers) are skipped entirely, so lists of small numbers take only
+// a few passes
+template <typename Key>
+static void list_radix_sort(uint64_t* items, uint64_t count, Key key,
+    ExceptionBlock* exc_block) {
+  if (count < LIST_SORT_INSERTION_THRESHOLD) {
+    list_insertion_sort(items, count, key);
+    return;
+  }
+
+  uint64_t counts[8][0x100];
+  memset(counts, 0, sizeof(counts));
+  for (uint64_t x = 0; x < count; x++) {
+    uint64_t k = key(items[x]);
+    for (size_t digit = 0; digit < 8; digit++) {
+      counts[digit][(k >> (digit * 8)) & 0xFF]++;
+    }
+  }
+
+  uint64_t* buffer = reinterpret_cast<uint64_t*>(list_sort_buffer(count,
+      exc_block));
+  uint64_t* src = items;
+  uint64_t* dest = buffer;
+  for (size_t digit = 0; digit < 8; digit++) {
+    size_t shift = digit * 8;
+    uint64_t* digit_counts = counts[digit];
+    if (digit_counts[(key(src[0]) >> shift) & 0xFF] == count) {
+      continue;
+    }
+
+    // convert the counts to starting offsets, then distribute the items
+    uint64_t offset = 0;
+    for (size_t x = 0; x < 0x100; x++) {
+      uint64_t digit_count = digit_counts[x];
+      digit_counts[x] = offset;
+      offset += digit_count;
+    }
+    for (uint64_t x = 0; x < count; x++) {
+      dest[digit_counts[(key(src[x]) >> shift) & 0xFF]++] = src[x];
+    }
+    swap(src, dest);
+  }
+
+  if (src != items) {
+    memcpy(items, src, count * sizeof(uint64_t));
+  }
+  free(buffer);
+}
+
+// promoted Ints don't sort by their bits, so lists that contain any are
+// merge sorted with int_compare instead
+static bool any_promoted_ints(const int64_t* items, uint64_t count) {
+  for (uint64_t x = 0; x < count; x++) {
+    if (!int_is_direct(items[x])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void list_sort_ints(ListObject* l, ExceptionBlock* exc_block) {
+  int64_t* items = list_int_items(l);
+  if (any_promoted_ints(items, l->count)) {
+    stable_sort(items, items + l->count, [](int64_t a, int64_t b) -> bool {
+      return int_compare(a, b) < 0;
+    });
+    return;
+  }
+
+  // flipping the sign bit makes signed order the same as unsigned order
+  list_radix_sort(reinterpret_cast<uint64_t*>(l->items), l->count,
+      [](uint64_t item) -> uint64_t {
+    return item ^ 0x8000000000000000;
+  }, exc_block);
+}
+
+void list_sort_floats(ListObject* l, ExceptionBlock* exc_block) {
+  // positive numbers sort correctly by their bits once the sign bit is set;
+  // negative numbers sort in reverse, so all their bits are flipped. -0.0 gets
+  // the same key as 0.0 so their order is preserved, as in Python
+  list_radix_sort(reinterpret_cast<uint64_t*>(l->items), l->count,
+      [](uint64_t item) -> uint64_t {
+    if (item == 0x8000000000000000) {
+      return 0x8000000000000000;
+    }
+    return (item & 0x8000000000000000) ? ~item : (item | 0x8000000000000000);
+  }, exc_block);
+}
+
+// Compare returns a negative number if its first argument is less than its
+// second. this is a bottom-up merge sort, with runs of
+// LIST_SORT_INSERTION_THRESHOLD items insertion sorted first
+template <typename ObjectType, int64_t (*Compare)(const ObjectType*, const ObjectType*)>
+static void list_merge_sort(ListObject* l, ExceptionBlock* exc_block) {
+  ObjectType** items = reinterpret_cast<ObjectType**>(l->items);
+  uint64_t count = l->count;
+  auto less = [](const ObjectType* a, const ObjectType* b) -> bool {
+    return Compare(a, b) < 0;
+  };
+
+  for (uint64_t start = 0; start < count;
+       start += LIST_SORT_INSERTION_THRESHOLD) {
+    uint64_t end = min<uint64_t>(start + LIST_SORT_INSERTION_THRESHOLD, count);
+    for (uint64_t x = start + 1; x < end; x++) {
+      ObjectType* item = items[x];
+      uint64_t y = x;
+      for (; (y > start) && less(item, items[y - 1]); y--) {
+        items[y] = items[y - 1];
+      }
+      items[y] = item;
+    }
+  }
+  if (count <= LIST_SORT_INSERTION_THRESHOLD) {
+    return;
+  }
+
+  ObjectType** buffer = reinterpret_cast<ObjectType**>(list_sort_buffer(count,
+      exc_block));
+  ObjectType** src = items;
+  ObjectType** dest = buffer;
+  for (uint64_t width = LIST_SORT_INSERTION_THRESHOLD; width < count;
+       width *= 2) {
+    for (uint64_t start = 0; start < count; start += 2 * width) {
+      uint64_t middle = min<uint64_t>(start + width, count);
+      uint64_t end = min<uint64_t>(start + 2 * width, count);
+
+      // taking from the left run on ties keeps the sort stable
+      merge(src + start, src + middle, src + middle, src + end, dest + start,
+          less);
+    }
+    swap(src, dest);
+  }
+
+  if (src != items) {
+    memcpy(items, src, count * sizeof(ObjectType*));
+  }
+  free(buffer);
+}
+
+void list_sort_bytes(ListObject* l, ExceptionBlock* exc_block) {
+  list_merge_sort<BytesObject, bytes_compare>(l, exc_block);
+}
+
+void list_sort_unicodes(ListObject* l, ExceptionBlock* exc_block) {
+  list_merge_sort<UnicodeObject, unicode_compare>(l, exc_block);
+}
+
+
+
+// reductions. these work on two SSE2 vectors (four items) per step and handle
+// the last few items one at a time
+
+int64_t list_sum_ints(const ListObject* l, int64_t start) {
+  const int64_t* items = reinterpret_cast<const int64_t*>(l->items);
+  uint64_t count = l->count;
+
+  // a lane overflows if the item and the old sum have the same sign but the
+  // new sum's sign differs; the sign bits of overflow record whether that ever
+  // happened in each lane. an item is promoted if its top two bits differ, so
+  // the sign bits of item ^ (item << 1) go into overflow too
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  __m128i overflow = _mm_setzero_si128();
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i item0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x]));
+    __m128i item1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x + 2]));
+    __m128i sum0 = _mm_add_epi64(acc0, item0);
+    __m128i sum1 = _mm_add_epi64(acc1, item1);
+    overflow = _mm_or_si128(overflow, _mm_and_si128(
+        _mm_xor_si128(acc0, sum0), _mm_xor_si128(item0, sum0)));
+    overflow = _mm_or_si128(overflow, _mm_and_si128(
+        _mm_xor_si128(acc1, sum1), _mm_xor_si128(item1, sum1)));
+    overflow = _mm_or_si128(overflow, _mm_or_si128(
+        _mm_xor_si128(item0, _mm_slli_epi64(item0, 1)),
+        _mm_xor_si128(item1, _mm_slli_epi64(item1, 1))));
+    acc0 = sum0;
+    acc1 = sum1;
+  }
+  bool overflowed = _mm_movemask_pd(_mm_castsi128_pd(overflow)) ||
+      !int_is_direct(start);
+
+  int64_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&lanes[0]), acc0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&lanes[2]), acc1);
+  int64_t ret = start;
+  for (size_t z = 0; z < 4; z++) {
+    overflowed |= __builtin_add_overflow(ret, lanes[z], &ret);
+  }
+  for (; x < count; x++) {
+    overflowed |= __builtin_add_overflow(ret, items[x], &ret);
+    overflowed |= !int_is_direct(items[x]);
+  }
+
+  // an intermediate sum overflowed or some items are promoted, so add
+  // everything again as bignums
+  if (overflowed) {
+    return int_sum(items, count, start);
+  }
+  return int_from_int64(ret);
+}
+
+double list_sum_floats(const ListObject* l) {
+  const double* items = reinterpret_cast<const double*>(l->items);
+  uint64_t count = l->count;
+
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_loadu_pd(&items[x]));
+    acc1 = _mm_add_pd(acc1, _mm_loadu_pd(&items[x + 2]));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+
+  double ret = lanes[0] + lanes[1];
+  for (; x < count; x++) {
+    ret += items[x];
+  }
+  return ret;
+}
+
+// SSE2 has no 64-bit integer comparison, so this builds one from 32-bit
+// comparisons: a > b if the high halves are greater (signed), or if they're
+// equal and the low halves are greater (unsigned). the result has all bits set
+// in each lane where a > b
+static inline __m128i int64_greater(__m128i a, __m128i b) {
+  const __m128i low_sign_bits = _mm_set_epi32(0, 0x80000000, 0, 0x80000000);
+  __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, low_sign_bits),
+      _mm_xor_si128(b, low_sign_bits));
+  __m128i eq = _mm_cmpeq_epi32(a, b);
+  __m128i high_gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i high_eq = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i low_gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+  return _mm_or_si128(high_gt, _mm_and_si128(high_eq, low_gt));
+}
+
+static inline __m128i int64_select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template <bool Max>
+static int64_t list_extreme_int(const ListObject* l) {
+  const int64_t* items = reinterpret_cast<const int64_t*>(l->items);
+  uint64_t count = l->count;
+
+  if (any_promoted_ints(items, count)) {
+    int64_t ret = items[0];
+    for (uint64_t x = 1; x < count; x++) {
+      int64_t c = int_compare(items[x], ret);
+      if (Max ? (c > 0) : (c < 0)) {
+        ret = items[x];
+      }
+    }
+    return int_add_reference(ret);
+  }
+
+  __m128i acc0 = _mm_set1_epi64x(items[0]);
+  __m128i acc1 = acc0;
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x]));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x + 2]));
+    acc0 = Max ? int64_select(int64_greater(v0, acc0), v0, acc0)
+               : int64_select(int64_greater(acc0, v0), v0, acc0);
+    acc1 = Max ? int64_select(int64_greater(v1, acc1), v1, acc1)
+               : int64_select(int64_greater(acc1, v1), v1, acc1);
+  }
+  int64_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&lanes[0]), acc0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&lanes[2]), acc1);
+
+  int64_t ret = lanes[0];
+  for (size_t y = 1; y < 4; y++) {
+    ret = Max ? max(ret, lanes[y]) : min(ret, lanes[y]);
+  }
+  for (; x < count; x++) {
+    ret = Max ? max(ret, items[x]) : min(ret, items[x]);
+  }
+  return ret;
+}
+
+int64_t list_min_ints(const ListObject* l) {
+  return list_extreme_int<false>(l);
+}
+
+int64_t list_max_ints(const ListObject* l) {
+  return list_extreme_int<true>(l);
+}
+
+// Python's min and max keep the first of equal items and skip any item that
+// doesn't compare less (or greater) than the current result. minpd/maxpd
+// return their second operand when either operand is NaN or when they're
+// equal, so with the accumulator as the second operand, NaN items are skipped
+// the same way. the only difference is which of 0.0 and -0.0 is returned when
+// both are present, since the lanes are combined out of order; when the result
+// is zero, the list is scanned again in order
+template <bool Max>
+static double list_extreme_float(const ListObject* l) {
+  const double* items = reinterpret_cast<const double*>(l->items);
+  uint64_t count = l->count;
+
+  // if the first item is NaN, nothing compares less or greater than it
+  if (items[0] != items[0]) {
+    return items[0];
+  }
+
+  __m128d acc0 = _mm_set1_pd(items[0]);
+  __m128d acc1 = acc0;
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128d v0 = _mm_loadu_pd(&items[x]);
+    __m128d v1 = _mm_loadu_pd(&items[x + 2]);
+    acc0 = Max ? _mm_max_pd(v0, acc0) : _mm_min_pd(v0, acc0);
+    acc1 = Max ? _mm_max_pd(v1, acc1) : _mm_min_pd(v1, acc1);
+  }
+  double lanes[4];
+  _mm_storeu_pd(&lanes[0], acc0);
+  _mm_storeu_pd(&lanes[2], acc1);
+
+  double ret = lanes[0];
+  for (size_t y = 1; y < 4; y++) {
+    if (Max ? (lanes[y] > ret) : (lanes[y] < ret)) {
+      ret = lanes[y];
+    }
+  }
+  for (; x < count; x++) {
+    if (Max ? (items[x] > ret) : (items[x] < ret)) {
+      ret = items[x];
+    }
+  }
+
+  if (ret == 0.0) {
+    ret = items[0];
+    for (x = 1; x < count; x++) {
+      if (Max ? (items[x] > ret) : (items[x] < ret)) {
+        ret = items[x];
+      }
+    }
+  }
+  return ret;
+}
+
+double list_min_floats(const ListObject* l) {
+  return list_extreme_float<false>(l);
+}
+
+double list_max_floats(const ListObject* l) {
+  return list_extreme_float<true>(l);
+}
+
+// an Int is zero if both of its 32-bit halves are zero. the result has all
+// bits set in each lane that's zero
+static inline __m128i int64_is_zero(__m128i v) {
+  __m128i eq = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+  return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+bool list_any_ints(const ListObject* l) {
+  const int64_t* items = reinterpret_cast<const int64_t*>(l->items);
+  uint64_t count = l->count;
+
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i v = _mm_or_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x])),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x + 2])));
+    if (_mm_movemask_epi8(int64_is_zero(v)) != 0xFFFF) {
+      return true;
+    }
+  }
+  for (; x < count; x++) {
+    if (items[x]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool list_all_ints(const ListObject* l) {
+  const int64_t* items = reinterpret_cast<const int64_t*>(l->items);
+  uint64_t count = l->count;
+
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i z = _mm_or_si128(
+        int64_is_zero(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x]))),
+        int64_is_zero(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&items[x + 2]))));
+    if (_mm_movemask_epi8(z)) {
+      return false;
+    }
+  }
+  for (; x < count; x++) {
+    if (!items[x]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// NaN is true, and compares unequal to zero, so it's handled correctly here
+bool list_any_floats(const ListObject* l) {
+  const double* items = reinterpret_cast<const double*>(l->items);
+  uint64_t count = l->count;
+
+  const __m128d zero = _mm_setzero_pd();
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128d nonzero = _mm_or_pd(_mm_cmpneq_pd(_mm_loadu_pd(&items[x]), zero),
+        _mm_cmpneq_pd(_mm_loadu_pd(&items[x + 2]), zero));
+    if (_mm_movemask_pd(nonzero)) {
+      return true;
+    }
+  }
+  for (; x < count; x++) {
+    if (items[x] != 0.0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool list_all_floats(const ListObject* l) {
+  const double* items = reinterpret_cast<const double*>(l->items);
+  uint64_t count = l->count;
+
+  const __m128d zero = _mm_setzero_pd();
+  uint64_t x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128d is_zero = _mm_or_pd(_mm_cmpeq_pd(_mm_loadu_pd(&items[x]), zero),
+        _mm_cmpeq_pd(_mm_loadu_pd(&items[x + 2]), zero));
+    if (_mm_movemask_pd(is_zero)) {
+      return false;
+    }
+  }
+  for (; x < count; x++) {
+    if (items[x] == 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -7,17 +7,35 @@
 #include <vector>
 
 #include "../Exception.hh"
+#include "Int.hh"
 #include "Reference.hh"
 
 
+// list items are stored unboxed in 8-byte slots: Ints as int64_t, Floats as
+// the bits of a double, and everything else as object pointers (in which case
+// items_are_objects is true and the list owns a reference to each item). Int
+// lists have items_are_ints set instead, and own references only to the items
+// that are promoted (see Int.hh). so for numeric lists, items is a contiguous
+// int64_t/double array that generated code and bulk builtins can operate on
+// directly (see list_int_items and list_float_items).
+//
+// small lists keep their items in inline_items, in the same allocation as the
+// header; items points there until the list grows beyond it. generated code
+// always goes through items, so it doesn't need to care where they are.
+
+#define LIST_INLINE_CAPACITY 4
+
 struct ListObject {
   BasicObject basic;
   uint64_t count;
   uint64_t capacity;
   bool items_are_objects;
+  bool items_are_ints;
   void** items;
+  void* inline_items[LIST_INLINE_CAPACITY];
 };
 
+// items_are_ints starts out false; callers making Int lists set it
 ListObject* list_new(uint64_t count, bool items_are_objects,
     ExceptionBlock* exc_block = NULL);
 void list_delete(ListObject* l);
@@ -32,4 +50,62 @@ void list_append(ListObject* l, void* value, ExceptionBlock* exc_block = NULL);
 void* list_pop(ListObject* l, int64_t position, ExceptionBlock* exc_block);
 void list_clear(ListObject* l);
 
+// slices are always copies, since generated code stores list items directly
+// and couldn't tell if a list shared its items with another. omitted indexes
+// are passed as described in Slice.hh. these borrow their list arguments
+ListObject* list_slice(const ListObject* l, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block = NULL);
+void list_set_slice(ListObject* l, int64_t start, int64_t stop, int64_t step,
+    const ListObject* value, ExceptionBlock* exc_block = NULL);
+
+// makes sure the list can hold at least capacity items without reallocating
+void list_reserve(ListObject* l, uint64_t capacity,
+    ExceptionBlock* exc_block = NULL);
+
+// when a full list grows, its capacity is multiplied by this factor (which is
+// clamped to be at least 1.125). list_new leaves the same room for appends
+void list_set_growth_factor(double factor);
+double list_growth_factor();
+
 size_t list_size(const ListObject* d);
+
+// sorting. all of these sort the list in place and are stable, like Python's
+// sort. Int and Float lists are radix sorted (Floats by a key that orders like
+// their values, with -0.0 equal to 0.0), except that Int lists containing
+// promoted values are sorted with int_compare; Bytes and Unicode lists are merge
+// sorted with bytes_compare/unicode_compare. short lists use insertion sort
+void list_sort_ints(ListObject* l, ExceptionBlock* exc_block = NULL);
+void list_sort_floats(ListObject* l, ExceptionBlock* exc_block = NULL);
+void list_sort_bytes(ListObject* l, ExceptionBlock* exc_block = NULL);
+void list_sort_unicodes(ListObject* l, ExceptionBlock* exc_block = NULL);
+
+// reductions over Int and Float lists, used by sum, min, max, any and all.
+// these use SSE2 to process several items at once, so Float sums are added in
+// a different order than Python would add them and may round differently.
+// list_sum_ints adds start to the items; lists with promoted Ints (see Int.hh)
+// or sums that overflow fall back to bignum addition. min and max must not be
+// called for empty lists, and return new references to promoted items
+int64_t list_sum_ints(const ListObject* l, int64_t start);
+double list_sum_floats(const ListObject* l);
+int64_t list_min_ints(const ListObject* l);
+int64_t list_max_ints(const ListObject* l);
+double list_min_floats(const ListObject* l);
+double list_max_floats(const ListObject* l);
+bool list_any_ints(const ListObject* l);
+bool list_all_ints(const ListObject* l);
+bool list_any_floats(const ListObject* l);
+bool list_all_floats(const ListObject* l);
+
+// true if the list owns a reference to the item
+inline bool list_item_has_refcount(const ListObject* l, const void* item) {
+  return l->items_are_objects ||
+      (l->items_are_ints && int_is_promoted(reinterpret_cast<int64_t>(item)));
+}
+
+inline int64_t* list_int_items(ListObject* l) {
+  return reinterpret_cast<int64_t*>(l->items);
+}
+
+inline double* list_float_items(ListObject* l) {
+  return reinterpret_cast<double*>(l->items);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Strings.hh"
+
+
+// these parse the entire contents of a string as a number, following the same
+// rules as python's int() and float(): surrounding whitespace and a sign are
+// allowed, and so are single underscores between digits. int() also accepts a
+// 0x, 0o or 0b prefix if base is 0 or matches the prefix (base 0 otherwise
+// means decimal), and float() accepts inf, infinity and nan in any case. ints
+// too large to store directly are promoted (see Int.hh). unicode strings may
+// also use decimal digits from any script and unicode whitespace.
+//
+// decimal digits are converted 8 at a time when possible, and floats are
+// converted with the Eisel-Lemire algorithm instead of strtod, which is only
+// used for the rare numbers with more than 19 significant digits where the
+// digits that don't fit could change the result.
+//
+// none of these raise exceptions, so callers can release their references to
+// the string before raising one. the result is written to *value only if the
+// string is valid.
+
+enum class NumberParseResult {
+  Valid = 0,
+  Invalid, // not a number, or an invalid base (ValueError)
+};
+
+NumberParseResult bytes_parse_int(const BytesObject* s, int64_t base,
+    int64_t* value);
+NumberParseResult unicode_parse_int(const UnicodeObject* s, int64_t base,
+    int64_t* value);
+NumberParseResult bytes_parse_float(const BytesObject* s, double* value);
+NumberParseResult unicode_parse_float(const UnicodeObject* s, double* value);
@@ -6,6 +6,7 @@
 #include <atomic>
 
 #include "../Debug.hh"
+#include "Int.hh"
 
 using namespace std;
 
@@ -15,8 +16,17 @@ BasicObject::BasicObject(void (*destructor)(void*)) : refcount(1),
     destructor(destructor) { }
 
 
+// promoted Ints are object addresses with INT_PROMOTED_BIT set (see Int.hh), so
+// containers that track which of their items have references (like tuples) can
+// pass them here too
+
+static inline BasicObject* object_for_reference(void* o) {
+  return reinterpret_cast<BasicObject*>(
+      reinterpret_cast<int64_t>(o) & ~INT_PROMOTED_BIT);
+}
+
 void* add_reference(void* o) {
-  BasicObject* obj = reinterpret_cast<BasicObject*>(o);
+  BasicObject* obj = object_for_reference(o);
   if (debug_flags & DebugFlag::ShowRefcountChanges) {
     fprintf(stderr, "[refcount] %p++ == %" PRId64 "\n", o, ++obj->refcount);
   } else {
@@ -26,7 +36,7 @@ void* add_reference(void* o) {
 }
 
 void delete_reference(void* o, ExceptionBlock* exc_block) {
-  BasicObject* obj = reinterpret_cast<BasicObject*>(o);
+  BasicObject* obj = object_for_reference(o);
   if (!obj) {
     return;
   }
@@ -39,6 +49,6 @@ void delete_reference(void* o, ExceptionBlock* exc_block) {
 
   if (count == 0) {
     // TODO: pass the exception block into the destructor somehow
-    obj->destructor(o);
+    obj->destructor(obj);
   }
 }
@@ -0,0 +1,648 @@
+#include "Set.hh"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../BuiltinFunctions.hh"
+#include "Int.hh"
+#include "Strings.hh"
+
+using namespace std;
+
+
+
+// the table functions below are templates over the slot layout, so the Int
+// and object versions of each operation compile to separate tight loops.
+// lookups construct a slot for the key being looked up, so key equality is
+// always a comparison between two slots
+
+struct IntSlots {
+  typedef int64_t Slot;
+
+  static inline Slot slot_for_key(const SetObject*, void* key) {
+    return reinterpret_cast<int64_t>(key);
+  }
+  static inline void* key_for_slot(const Slot& slot) {
+    return reinterpret_cast<void*>(slot);
+  }
+  static inline Slot empty_slot_value() {
+    return SET_EMPTY_INT_SLOT;
+  }
+  static inline bool is_empty(const Slot& slot) {
+    return slot == SET_EMPTY_INT_SLOT;
+  }
+  static inline void fill_empty(Slot* slots, uint64_t count) {
+    for (uint64_t x = 0; x < count; x++) {
+      slots[x] = SET_EMPTY_INT_SLOT;
+    }
+  }
+  static inline uint64_t hash(const Slot& slot) {
+    return set_int_hash(slot);
+  }
+  static inline bool equal(const SetObject*, const Slot& a, const Slot& b) {
+    return a == b;
+  }
+  static inline void add_reference(const Slot& slot) {
+    int_add_reference(slot);
+  }
+  static inline void delete_reference(const Slot& slot) {
+    int_delete_reference(slot);
+  }
+};
+
+static uint64_t hash_data(const void* data, size_t size) {
+  // 8 bytes at a time, with a multiply-xorshift round for each word and the
+  // MurmurHash3 finalizer at the end
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+  uint64_t h = 0x9E3779B97F4A7C15 ^ size;
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    h = (h ^ word) * 0xFF51AFD7ED558CCD;
+    h ^= h >> 32;
+  }
+  if (size) {
+    uint64_t word = 0;
+    memcpy(&word, p, size);
+    h = (h ^ word) * 0xFF51AFD7ED558CCD;
+  }
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53;
+  return h ^ (h >> 33);
+}
+
+struct ObjectSlots {
+  typedef SetObject::ObjectSlot Slot;
+
+  static inline Slot slot_for_key(const SetObject* s, void* key) {
+    Slot ret;
+    if (s->key_type == SetKeyType::Bytes) {
+      const BytesObject* b = reinterpret_cast<const BytesObject*>(key);
+      ret.hash = hash_data(b->data, b->count);
+    } else {
+      const UnicodeObject* u = reinterpret_cast<const UnicodeObject*>(key);
+      ret.hash = hash_data(u->data, u->count * sizeof(wchar_t));
+    }
+    ret.key = key;
+    return ret;
+  }
+  static inline void* key_for_slot(const Slot& slot) {
+    return slot.key;
+  }
+  static inline Slot empty_slot_value() {
+    Slot ret = {0, NULL};
+    return ret;
+  }
+  static inline bool is_empty(const Slot& slot) {
+    return !slot.key;
+  }
+  static inline void fill_empty(Slot* slots, uint64_t count) {
+    memset(slots, 0, count * sizeof(Slot));
+  }
+  static inline uint64_t hash(const Slot& slot) {
+    return slot.hash;
+  }
+  static inline bool equal(const SetObject* s, const Slot& a, const Slot& b) {
+    if (a.hash != b.hash) {
+      return false;
+    }
+    if (a.key == b.key) {
+      return true;
+    }
+    if (s->key_type == SetKeyType::Bytes) {
+      const BytesObject* a_b = reinterpret_cast<const BytesObject*>(a.key);
+      const BytesObject* b_b = reinterpret_cast<const BytesObject*>(b.key);
+      return (a_b->count == b_b->count) &&
+          !memcmp(a_b->data, b_b->data, a_b->count);
+    }
+    const UnicodeObject* a_u = reinterpret_cast<const UnicodeObject*>(a.key);
+    const UnicodeObject* b_u = reinterpret_cast<const UnicodeObject*>(b.key);
+    return (a_u->count == b_u->count) &&
+        !memcmp(a_u->data, b_u->data, a_u->count * sizeof(wchar_t));
+  }
+  static inline void add_reference(const Slot& slot) {
+    ::add_reference(slot.key);
+  }
+  static inline void delete_reference(const Slot& slot) {
+    ::delete_reference(slot.key);
+  }
+};
+
+template <typename Slots>
+static inline typename Slots::Slot* table_slots(const SetObject* s) {
+  return reinterpret_cast<typename Slots::Slot*>(s->slots);
+}
+
+template <typename Slots>
+static void table_allocate(SetObject* s, uint64_t capacity,
+    ExceptionBlock* exc_block) {
+  typename Slots::Slot* slots = reinterpret_cast<typename Slots::Slot*>(
+      malloc(capacity * sizeof(typename Slots::Slot)));
+  if (!slots) {
+    raise_python_exception(exc_block, &MemoryError_instance);
+    throw bad_alloc();
+  }
+  Slots::fill_empty(slots, capacity);
+  s->slots = slots;
+  s->capacity_mask = capacity - 1;
+}
+
+// calls fn for each item in the set, including the Int that can't be stored in
+// a slot. the slot passed to fn is still owned by the set
+template <typename Slots, typename Fn>
+static inline void table_for_each(const SetObject* s, Fn fn) {
+  if (s->contains_empty_slot_value) {
+    fn(Slots::empty_slot_value());
+  }
+  const typename Slots::Slot* slots = table_slots<Slots>(s);
+  for (uint64_t x = 0; x <= s->capacity_mask; x++) {
+    if (!Slots::is_empty(slots[x])) {
+      fn(slots[x]);
+    }
+  }
+}
+
+template <typename Slots>
+static bool table_contains(const SetObject* s,
+    const typename Slots::Slot& key) {
+  if (Slots::is_empty(key)) {
+    return s->contains_empty_slot_value;
+  }
+  const typename Slots::Slot* slots = table_slots<Slots>(s);
+  for (uint64_t x = Slots::hash(key) & s->capacity_mask;
+       !Slots::is_empty(slots[x]); x = (x + 1) & s->capacity_mask) {
+    if (Slots::equal(s, slots[x], key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// inserts an item that's known not to be in the set, without comparing it to
+// any existing items. the table must have room for it. doesn't add a reference
+template <typename Slots>
+static void table_insert_new(SetObject* s, const typename Slots::Slot& key) {
+  s->count++;
+  if (Slots::is_empty(key)) {
+    s->contains_empty_slot_value = true;
+    return;
+  }
+  typename Slots::Slot* slots = table_slots<Slots>(s);
+  uint64_t x = Slots::hash(key) & s->capacity_mask;
+  while (!Slots::is_empty(slots[x])) {
+    x = (x + 1) & s->capacity_mask;
+  }
+  slots[x] = key;
+}
+
+template <typename Slots>
+static void table_resize(SetObject* s, uint64_t capacity,
+    ExceptionBlock* exc_block) {
+  typename Slots::Slot* old_slots = table_slots<Slots>(s);
+  uint64_t old_capacity = s->capacity_mask + 1;
+  table_allocate<Slots>(s, capacity, exc_block);
+
+  // the Int that can't be stored in a slot doesn't move
+  s->count = s->contains_empty_slot_value ? 1 : 0;
+  for (uint64_t x = 0; x < old_capacity; x++) {
+    if (!Slots::is_empty(old_slots[x])) {
+      table_insert_new<Slots>(s, old_slots[x]);
+    }
+  }
+  free(old_slots);
+}
+
+static inline uint64_t capacity_for_count(uint64_t count) {
+  uint64_t capacity = SET_MIN_CAPACITY;
+  while (capacity < count * 2) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+// makes sure count more items can be inserted without resizing
+template <typename Slots>
+static inline void table_reserve(SetObject* s, uint64_t count,
+    ExceptionBlock* exc_block) {
+  if ((s->count + count) * 2 > s->capacity_mask + 1) {
+    table_resize<Slots>(s, capacity_for_count(s->count + count), exc_block);
+  }
+}
+
+// returns true if the item was added, in which case the set now owns a
+// reference to it
+template <typename Slots>
+static bool table_insert(SetObject* s, const typename Slots::Slot& key,
+    ExceptionBlock* exc_block) {
+  if (table_contains<Slots>(s, key)) {
+    return false;
+  }
+  table_reserve<Slots>(s, 1, exc_block);
+  table_insert_new<Slots>(s, key);
+  Slots::add_reference(key);
+  return true;
+}
+
+// returns true if the item was removed. the set's reference to it is released
+template <typename Slots>
+static bool table_erase(SetObject* s, const typename Slots::Slot& key) {
+  if (Slots::is_empty(key)) {
+    if (!s->contains_empty_slot_value) {
+      return false;
+    }
+    s->contains_empty_slot_value = false;
+    s->count--;
+    return true;
+  }
+
+  typename Slots::Slot* slots = table_slots<Slots>(s);
+  uint64_t mask = s->capacity_mask;
+  uint64_t x = Slots::hash(key) & mask;
+  for (; !Slots::is_empty(slots[x]); x = (x + 1) & mask) {
+    if (Slots::equal(s, slots[x], key)) {
+      break;
+    }
+  }
+  if (Slots::is_empty(slots[x])) {
+    return false;
+  }
+  Slots::delete_reference(slots[x]);
+  s->count--;
+
+  // there are no tombstones; instead, move later items in the probe sequence
+  // back into the hole if their home slot isn't cyclically in (hole, y]
+  for (uint64_t y = (x + 1) & mask; !Slots::is_empty(slots[y]);
+       y = (y + 1) & mask) {
+    uint64_t home = Slots::hash(slots[y]) & mask;
+    bool home_in_range = (x <= y) ? ((x < home) && (home <= y)) :
+        ((x < home) || (home <= y));
+    if (!home_in_range) {
+      slots[x] = slots[y];
+      x = y;
+    }
+  }
+  Slots::fill_empty(&slots[x], 1);
+  return true;
+}
+
+template <typename Slots>
+static void table_clear(SetObject* s) {
+  typename Slots::Slot* slots = table_slots<Slots>(s);
+  for (uint64_t x = 0; x <= s->capacity_mask; x++) {
+    if (!Slots::is_empty(slots[x])) {
+      Slots::delete_reference(slots[x]);
+    }
+  }
+  Slots::fill_empty(slots, s->capacity_mask + 1);
+  s->count = 0;
+  s->contains_empty_slot_value = false;
+}
+
+
+
+// the public functions dispatch to the appropriate template instantiation
+
+#define DISPATCH(s, fn, ...) \
+  (((s)->key_type == SetKeyType::Int) ? \
+    fn<IntSlots>(__VA_ARGS__) : fn<ObjectSlots>(__VA_ARGS__))
+
+SetObject* set_new(SetKeyType key_type, uint64_t count_hint,
+    ExceptionBlock* exc_block) {
+  SetObject* s = reinterpret_cast<SetObject*>(malloc(sizeof(SetObject)));
+  if (!s) {
+    raise_python_exception(exc_block, &MemoryError_instance);
+    throw bad_alloc();
+  }
+  s->basic.refcount = 1;
+  s->basic.destructor = reinterpret_cast<void (*)(void*)>(set_delete);
+  s->count = 0;
+  s->key_type = key_type;
+  s->contains_empty_slot_value = false;
+  try {
+    if (key_type == SetKeyType::Int) {
+      table_allocate<IntSlots>(s, capacity_for_count(count_hint), exc_block);
+    } else {
+      table_allocate<ObjectSlots>(s, capacity_for_count(count_hint), exc_block);
+    }
+  } catch (const bad_alloc&) {
+    free(s);
+    throw;
+  }
+  return s;
+}
+
+void set_delete(SetObject* s) {
+  set_clear(s);
+  free(s->slots);
+  free(s);
+}
+
+bool set_add(SetObject* s, void* key, ExceptionBlock* exc_block) {
+  if (s->key_type == SetKeyType::Int) {
+    return table_insert<IntSlots>(s, IntSlots::slot_for_key(s, key), exc_block);
+  }
+  return table_insert<ObjectSlots>(s, ObjectSlots::slot_for_key(s, key),
+      exc_block);
+}
+
+bool set_contains(const SetObject* s, void* key) {
+  if (s->key_type == SetKeyType::Int) {
+    return table_contains<IntSlots>(s, IntSlots::slot_for_key(s, key));
+  }
+  return table_contains<ObjectSlots>(s, ObjectSlots::slot_for_key(s, key));
+}
+
+bool set_discard(SetObject* s, void* key) {
+  if (s->key_type == SetKeyType::Int) {
+    return table_erase<IntSlots>(s, IntSlots::slot_for_key(s, key));
+  }
+  return table_erase<ObjectSlots>(s, ObjectSlots::slot_for_key(s, key));
+}
+
+void set_remove(SetObject* s, void* key, ExceptionBlock* exc_block) {
+  if (!set_discard(s, key)) {
+    raise_python_exception(exc_block, create_instance(KeyError_class_id));
+    throw out_of_range("key not in set");
+  }
+}
+
+template <typename Slots>
+static void* table_pop(SetObject* s, ExceptionBlock* exc_block) {
+  if (s->contains_empty_slot_value) {
+    s->contains_empty_slot_value = false;
+    s->count--;
+    return Slots::key_for_slot(Slots::empty_slot_value());
+  }
+  const typename Slots::Slot* slots = table_slots<Slots>(s);
+  for (uint64_t x = 0; x <= s->capacity_mask; x++) {
+    if (!Slots::is_empty(slots[x])) {
+      // the set's reference becomes the caller's
+      typename Slots::Slot slot = slots[x];
+      Slots::add_reference(slot);
+      table_erase<Slots>(s, slot);
+      return Slots::key_for_slot(slot);
+    }
+  }
+  raise_python_exception(exc_block, create_instance(KeyError_class_id));
+  throw out_of_range("pop from empty set");
+}
+
+void* set_pop(SetObject* s, ExceptionBlock* exc_block) {
+  return DISPATCH(s, table_pop, s, exc_block);
+}
+
+void set_clear(SetObject* s) {
+  if (s->key_type == SetKeyType::Int) {
+    table_clear<IntSlots>(s);
+  } else {
+    table_clear<ObjectSlots>(s);
+  }
+}
+
+size_t set_size(const SetObject* s) {
+  return s->count;
+}
+
+
+
+// bulk operations
+
+template <typename Slots>
+static SetObject* table_copy(const SetObject* s, ExceptionBlock* exc_block) {
+  // same capacity, so the slots can just be copied
+  SetObject* ret = set_new(s->key_type, 0, exc_block);
+  free(ret->slots);
+  ret->slots = NULL;
+  try {
+    table_allocate<Slots>(ret, s->capacity_mask + 1, exc_block);
+  } catch (const bad_alloc&) {
+    free(ret);
+    throw;
+  }
+  memcpy(ret->slots, s->slots,
+      (s->capacity_mask + 1) * sizeof(typename Slots::Slot));
+  ret->count = s->count;
+  ret->contains_empty_slot_value = s->contains_empty_slot_value;
+  table_for_each<Slots>(ret, [&](const typename Slots::Slot& slot) {
+    Slots::add_reference(slot);
+  });
+  return ret;
+}
+
+template <typename Slots>
+static void table_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block) {
+  table_reserve<Slots>(s, other->count, exc_block);
+  table_for_each<Slots>(other, [&](const typename Slots::Slot& slot) {
+    if (!table_contains<Slots>(s, slot)) {
+      table_insert_new<Slots>(s, slot);
+      Slots::add_reference(slot);
+    }
+  });
+}
+
+template <typename Slots>
+static SetObject* table_union(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  // copy the larger set and add the smaller one's items to it
+  if (a->count < b->count) {
+    const SetObject* t = a;
+    a = b;
+    b = t;
+  }
+  SetObject* ret = table_copy<Slots>(a, exc_block);
+  table_update<Slots>(ret, b, exc_block);
+  return ret;
+}
+
+// collects the items of `from` that are (or aren't) in `probe`
+template <typename Slots>
+static SetObject* table_filter(const SetObject* from, const SetObject* probe,
+    bool keep_if_present, ExceptionBlock* exc_block) {
+  SetObject* ret = set_new(from->key_type, from->count, exc_block);
+  table_for_each<Slots>(from, [&](const typename Slots::Slot& slot) {
+    if (table_contains<Slots>(probe, slot) == keep_if_present) {
+      table_insert_new<Slots>(ret, slot);
+      Slots::add_reference(slot);
+    }
+  });
+  return ret;
+}
+
+template <typename Slots>
+static SetObject* table_intersection(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  return (a->count <= b->count) ? table_filter<Slots>(a, b, true, exc_block) :
+      table_filter<Slots>(b, a, true, exc_block);
+}
+
+template <typename Slots>
+static SetObject* table_difference(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  return table_filter<Slots>(a, b, false, exc_block);
+}
+
+template <typename Slots>
+static SetObject* table_symmetric_difference(const SetObject* a,
+    const SetObject* b, ExceptionBlock* exc_block) {
+  SetObject* ret = set_new(a->key_type, a->count + b->count, exc_block);
+  auto add_missing = [&](const SetObject* from, const SetObject* probe) {
+    table_for_each<Slots>(from, [&](const typename Slots::Slot& slot) {
+      if (!table_contains<Slots>(probe, slot)) {
+        table_insert_new<Slots>(ret, slot);
+        Slots::add_reference(slot);
+      }
+    });
+  };
+  add_missing(a, b);
+  add_missing(b, a);
+  return ret;
+}
+
+template <typename Slots>
+static bool table_is_subset(const SetObject* a, const SetObject* b) {
+  if (a->count > b->count) {
+    return false;
+  }
+  bool ret = true;
+  table_for_each<Slots>(a, [&](const typename Slots::Slot& slot) {
+    ret = ret && table_contains<Slots>(b, slot);
+  });
+  return ret;
+}
+
+template <typename Slots>
+static bool table_is_disjoint(const SetObject* a, const SetObject* b) {
+  if (a->count > b->count) {
+    const SetObject* t = a;
+    a = b;
+    b = t;
+  }
+  bool ret = true;
+  table_for_each<Slots>(a, [&](const typename Slots::Slot& slot) {
+    ret = ret && !table_contains<Slots>(b, slot);
+  });
+  return ret;
+}
+
+// replaces s's contents with those of replacement, which is then destroyed
+static void set_replace_contents(SetObject* s, SetObject* replacement) {
+  set_clear(s);
+  free(s->slots);
+  s->count = replacement->count;
+  s->capacity_mask = replacement->capacity_mask;
+  s->contains_empty_slot_value = replacement->contains_empty_slot_value;
+  s->slots = replacement->slots;
+  free(replacement);
+}
+
+SetObject* set_copy(const SetObject* s, ExceptionBlock* exc_block) {
+  return DISPATCH(s, table_copy, s, exc_block);
+}
+
+SetObject* set_union(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  return DISPATCH(a, table_union, a, b, exc_block);
+}
+
+SetObject* set_intersection(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  return DISPATCH(a, table_intersection, a, b, exc_block);
+}
+
+SetObject* set_difference(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  return DISPATCH(a, table_difference, a, b, exc_block);
+}
+
+SetObject* set_symmetric_difference(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block) {
+  return DISPATCH(a, table_symmetric_difference, a, b, exc_block);
+}
+
+void set_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block) {
+  if (s->key_type == SetKeyType::Int) {
+    table_update<IntSlots>(s, other, exc_block);
+  } else {
+    table_update<ObjectSlots>(s, other, exc_block);
+  }
+}
+
+void set_intersection_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block) {
+  set_replace_contents(s, set_intersection(s, other, exc_block));
+}
+
+void set_difference_update(SetObject* s, const SetObject* other) {
+  if (s == other) {
+    set_clear(s);
+    return;
+  }
+  if (s->key_type == SetKeyType::Int) {
+    table_for_each<IntSlots>(other, [&](const IntSlots::Slot& slot) {
+      table_erase<IntSlots>(s, slot);
+    });
+  } else {
+    table_for_each<ObjectSlots>(other, [&](const ObjectSlots::Slot& slot) {
+      table_erase<ObjectSlots>(s, slot);
+    });
+  }
+}
+
+void set_symmetric_difference_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block) {
+  set_replace_contents(s, set_symmetric_difference(s, other, exc_block));
+}
+
+bool set_equal(const SetObject* a, const SetObject* b) {
+  return (a->count == b->count) && set_is_subset(a, b);
+}
+
+bool set_is_subset(const SetObject* a, const SetObject* b) {
+  return DISPATCH(a, table_is_subset, a, b);
+}
+
+bool set_is_proper_subset(const SetObject* a, const SetObject* b) {
+  return (a->count < b->count) && set_is_subset(a, b);
+}
+
+bool set_is_disjoint(const SetObject* a, const SetObject* b) {
+  return DISPATCH(a, table_is_disjoint, a, b);
+}
+
+SetIteration set_next_item(const SetObject* s, uint64_t position) {
+  // positions 1 through capacity refer to the slots; capacity + 1 refers to the
+  // Int that can't be stored in a slot
+  SetIteration ret;
+  uint64_t capacity = s->capacity_mask + 1;
+  if (s->key_type == SetKeyType::Int) {
+    const int64_t* slots = table_slots<IntSlots>(s);
+    for (; position < capacity; position++) {
+      if (!IntSlots::is_empty(slots[position])) {
+        ret.position = position + 1;
+        ret.key = IntSlots::key_for_slot(slots[position]);
+        return ret;
+      }
+    }
+    if ((position == capacity) && s->contains_empty_slot_value) {
+      ret.position = capacity + 1;
+      ret.key = IntSlots::key_for_slot(SET_EMPTY_INT_SLOT);
+      return ret;
+    }
+
+  } else {
+    const SetObject::ObjectSlot* slots = table_slots<ObjectSlots>(s);
+    for (; position < capacity; position++) {
+      if (!ObjectSlots::is_empty(slots[position])) {
+        ret.position = position + 1;
+        ret.key = slots[position].key;
+        return ret;
+      }
+    }
+  }
+
+  ret.position = 0;
+  ret.key = NULL;
+  return ret;
+}
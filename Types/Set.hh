@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../Exception.hh"
+#include "Reference.hh"
+
+
+// sets are open-addressing hash tables with linear probing. the table is never
+// more than half full, so probe sequences stay short and every probe loop is
+// guaranteed to find an empty slot. capacity is always a power of two.
+//
+// the slot layout depends on the item type, which is fixed when the set is
+// created:
+// - Int (and Bool) sets store their items unboxed, one int64_t per slot. empty
+//   slots contain SET_EMPTY_INT_SLOT; since that's also a valid Int, whether
+//   the set contains it is tracked in contains_empty_slot_value instead. the
+//   layout is simple enough that generated code probes it inline for `in` and
+//   `not in` (see CompilationVisitor::visit(BinaryOperation*)). the set owns a
+//   reference to each promoted item (see Int.hh).
+// - Bytes and Unicode sets store {hash, object} pairs, so each item is hashed
+//   only once and most mismatches are rejected without comparing the strings.
+//   empty slots have a NULL object. the set owns a reference to each item.
+
+#define SET_EMPTY_INT_SLOT INT64_MIN
+#define SET_MIN_CAPACITY 8
+
+enum class SetKeyType : uint8_t {
+  Int = 0,
+  Bytes,
+  Unicode,
+};
+
+struct SetObject {
+  BasicObject basic;
+  uint64_t count;
+  uint64_t capacity_mask; // capacity - 1
+  SetKeyType key_type;
+  bool contains_empty_slot_value;
+  void* slots;
+
+  struct ObjectSlot {
+    uint64_t hash;
+    void* key;
+  };
+};
+
+// generated code computes the same function inline, so if this changes, the
+// code in CompilationVisitor must change too
+inline uint64_t set_int_hash(int64_t key) {
+  uint64_t h = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15;
+  return h ^ (h >> 32);
+}
+
+// these borrow all of their object arguments. keys are passed as void*, even
+// for Int sets
+SetObject* set_new(SetKeyType key_type, uint64_t count_hint,
+    ExceptionBlock* exc_block = NULL);
+void set_delete(SetObject* s);
+
+bool set_add(SetObject* s, void* key, ExceptionBlock* exc_block = NULL);
+bool set_contains(const SetObject* s, void* key);
+bool set_discard(SetObject* s, void* key);
+void set_remove(SetObject* s, void* key, ExceptionBlock* exc_block = NULL);
+void* set_pop(SetObject* s, ExceptionBlock* exc_block = NULL);
+void set_clear(SetObject* s);
+size_t set_size(const SetObject* s);
+
+// bulk operations. these walk the smaller table and probe the larger one where
+// the result allows it, and insert into the result without comparing keys when
+// the items are known to be distinct
+SetObject* set_copy(const SetObject* s, ExceptionBlock* exc_block = NULL);
+SetObject* set_union(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block = NULL);
+SetObject* set_intersection(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block = NULL);
+SetObject* set_difference(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block = NULL);
+SetObject* set_symmetric_difference(const SetObject* a, const SetObject* b,
+    ExceptionBlock* exc_block = NULL);
+void set_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block = NULL);
+void set_intersection_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block = NULL);
+void set_difference_update(SetObject* s, const SetObject* other);
+void set_symmetric_difference_update(SetObject* s, const SetObject* other,
+    ExceptionBlock* exc_block = NULL);
+
+bool set_equal(const SetObject* a, const SetObject* b);
+bool set_is_subset(const SetObject* a, const SetObject* b);
+bool set_is_proper_subset(const SetObject* a, const SetObject* b);
+bool set_is_disjoint(const SetObject* a, const SetObject* b);
+
+// iteration: position starts at 0, and each call returns the next item and the
+// position to pass to the next call. the returned position is 0 when there are
+// no more items. this is returned in rax:rdx, so generated code doesn't need
+// any stack space for the iterator
+struct SetIteration {
+  uint64_t position;
+  void* key;
+};
+SetIteration set_next_item(const SetObject* s, uint64_t position);
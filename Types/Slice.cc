@@ -0,0 +1,50 @@
+#include "Slice.hh"
+
+#include <stdexcept>
+
+#include "../BuiltinFunctions.hh"
+
+using namespace std;
+
+
+static int64_t slice_adjust_index(int64_t length, int64_t index, int64_t step,
+    bool is_start) {
+  if (index == SLICE_INDEX_OMITTED) {
+    if (is_start) {
+      return (step < 0) ? (length - 1) : 0;
+    }
+    return (step < 0) ? -1 : length;
+  }
+
+  if (index < 0) {
+    index += length;
+    if (index < 0) {
+      return (step < 0) ? -1 : 0;
+    }
+  } else if (index >= length) {
+    return (step < 0) ? (length - 1) : length;
+  }
+  return index;
+}
+
+int64_t slice_adjust_indices(int64_t length, int64_t* start, int64_t* stop,
+    int64_t step, ExceptionBlock* exc_block) {
+  if (step == 0) {
+    raise_python_exception(exc_block, create_instance(ValueError_class_id));
+    throw invalid_argument("slice step cannot be zero");
+  }
+
+  *start = slice_adjust_index(length, *start, step, true);
+  *stop = slice_adjust_index(length, *stop, step, false);
+
+  if (step < 0) {
+    if (*stop < *start) {
+      // negate the step as unsigned, since -INT64_MIN overflows
+      return static_cast<uint64_t>(*start - *stop - 1) /
+          (0 - static_cast<uint64_t>(step)) + 1;
+    }
+  } else if (*start < *stop) {
+    return (*stop - *start - 1) / step + 1;
+  }
+  return 0;
+}
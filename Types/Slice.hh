@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../Exception.hh"
+
+
+// omitted slice indexes (as in x[:y] or x[y:]) are passed to the slice
+// functions as this value. like None in CPython, what it means depends on the
+// sign of the step: an omitted start is the first item for positive steps and
+// the last item for negative steps, and vice versa for an omitted stop
+#define SLICE_INDEX_OMITTED INT64_MIN
+
+// resolves negative and omitted indexes and clamps start and stop to the
+// sequence's length, as Python does. returns the number of items in the slice.
+// raises ValueError if step is zero
+int64_t slice_adjust_indices(int64_t length, int64_t* start, int64_t* stop,
+    int64_t step, ExceptionBlock* exc_block = NULL);
@@ -1,20 +1,26 @@
 #include "Strings.hh"
 
+#include <errno.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <phosg/Strings.hh>
 
 #include "../Debug.hh"
 #include "../Exception.hh"
 #include "../BuiltinFunctions.hh"
+#include "Slice.hh"
 
 using namespace std;
 
 
 
-BytesObject::BytesObject() : basic(free), count(0) { }
+BytesObject::BytesObject() : basic(free), count(0), data(this->inline_data),
+    base(NULL) { }
 
 BytesObject* bytes_new(const char* data, ssize_t count,
     ExceptionBlock* exc_block) {
@@ -31,12 +37,14 @@ BytesObject* bytes_new(const char* data, ssize_t count,
   s->basic.refcount = 1;
   s->basic.destructor = free;
   s->count = count;
+  s->data = s->inline_data;
+  s->base = NULL;
   if (data) {
     memcpy(s->data, data, sizeof(char) * count);
     s->data[s->count] = 0;
     if (debug_flags & DebugFlag::ShowRefcountChanges) {
       fprintf(stderr, "[refcount:create] created Bytes object %p: %s\n",
-          s, data);
+          s, s->data);
     }
   } else if (debug_flags & DebugFlag::ShowRefcountChanges) {
     fprintf(stderr, "[refcount:create] created Bytes object %p with %zd bytes\n",
@@ -59,6 +67,66 @@ BytesObject* bytes_concat(const BytesObject* a, const BytesObject* b,
   return s;
 }
 
+static size_t mapped_bytes_page_size = sysconf(_SC_PAGESIZE);
+
+static size_t mapped_bytes_total_size(size_t count) {
+  size_t page_mask = mapped_bytes_page_size - 1;
+  return mapped_bytes_page_size + ((count + 1 + page_mask) & ~page_mask);
+}
+
+static void mapped_bytes_delete(BytesObject* s) {
+  uint8_t* base = reinterpret_cast<uint8_t*>(s->data) - mapped_bytes_page_size;
+  munmap(base, mapped_bytes_total_size(s->count));
+}
+
+BytesObject* bytes_map_file(int fd, bool sequential) {
+  struct stat st;
+  if (fstat(fd, &st)) {
+    return NULL;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    errno = ENODEV;
+    return NULL;
+  }
+
+  // reserve the entire range first so the header page and the file mapping
+  // are guaranteed to be adjacent
+  size_t total_size = mapped_bytes_total_size(st.st_size);
+  uint8_t* base = reinterpret_cast<uint8_t*>(mmap(NULL, total_size,
+      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  uint8_t* data = base + mapped_bytes_page_size;
+  if (st.st_size) {
+    // the mapping is private and writable only so that nothing can fault by
+    // writing to it; bytes objects are never modified in place
+    if (mmap(data, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+        fd, 0) == MAP_FAILED) {
+      int error = errno;
+      munmap(base, total_size);
+      errno = error;
+      return NULL;
+    }
+    if (sequential) {
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+    }
+  }
+
+  BytesObject* s = reinterpret_cast<BytesObject*>(data - sizeof(BytesObject));
+  s->basic.refcount = 1;
+  s->basic.destructor = reinterpret_cast<void (*)(void*)>(mapped_bytes_delete);
+  s->count = st.st_size;
+  s->data = reinterpret_cast<char*>(data);
+  s->base = NULL;
+  if (debug_flags & DebugFlag::ShowRefcountChanges) {
+    fprintf(stderr, "[refcount:create] created mapped Bytes object %p with %zu bytes\n",
+        s, static_cast<size_t>(s->count));
+  }
+  return s;
+}
+
 char bytes_at(const BytesObject* s, size_t which,
     ExceptionBlock* exc_block) {
   if (which >= s->count) {
@@ -68,6 +136,18 @@ char bytes_at(const BytesObject* s, size_t which,
   return s->data[which];
 }
 
+int64_t bytes_get_item(const BytesObject* s, int64_t index,
+    ExceptionBlock* exc_block) {
+  if (index < 0) {
+    index += s->count;
+  }
+  if ((index < 0) || (index >= static_cast<ssize_t>(s->count))) {
+    raise_python_exception(exc_block, create_instance(IndexError_class_id));
+    throw out_of_range("index out of range for bytes object");
+  }
+  return static_cast<uint8_t>(s->data[index]);
+}
+
 size_t bytes_length(const BytesObject* s) {
   return s->count;
 }
@@ -111,7 +191,8 @@ string bytes_to_cxx_string(const BytesObject* s) {
 
 
 
-UnicodeObject::UnicodeObject() : basic(free), count(0) { }
+UnicodeObject::UnicodeObject() : basic(free), count(0),
+    data(this->inline_data), base(NULL) { }
 
 UnicodeObject* unicode_new(const wchar_t* data, ssize_t count,
     ExceptionBlock* exc_block) {
@@ -127,12 +208,14 @@ UnicodeObject* unicode_new(const wchar_t* data, ssize_t count,
   s->basic.refcount = 1;
   s->basic.destructor = free;
   s->count = count;
+  s->data = s->inline_data;
+  s->base = NULL;
   if (data) {
     memcpy(s->data, data, sizeof(wchar_t) * count);
     s->data[s->count] = 0;
     if (debug_flags & DebugFlag::ShowRefcountChanges) {
       fprintf(stderr, "[refcount:create] created Unicode object %p: %ls\n",
-          s, data);
+          s, s->data);
     }
   } else if (debug_flags & DebugFlag::ShowRefcountChanges) {
     fprintf(stderr, "[refcount:create] created Unicode object %p with %zd chars\n",
@@ -165,6 +248,18 @@ wchar_t unicode_at(const UnicodeObject* s, size_t which,
   return s->data[which];
 }
 
+UnicodeObject* unicode_get_item(const UnicodeObject* s, int64_t index,
+    ExceptionBlock* exc_block) {
+  if (index < 0) {
+    index += s->count;
+  }
+  if ((index < 0) || (index >= static_cast<ssize_t>(s->count))) {
+    raise_python_exception(exc_block, create_instance(IndexError_class_id));
+    throw out_of_range("index out of range for unicode object");
+  }
+  return unicode_new(&s->data[index], 1, exc_block);
+}
+
 size_t unicode_length(const UnicodeObject* s) {
   return s->count;
 }
@@ -243,3 +338,116 @@ UnicodeObject* bytes_decode_ascii(const char* s, ssize_t count) {
   ret->data[count] = 0;
   return ret;
 }
+
+
+
+// slices shorter than this many bytes are always copied
+static const size_t slice_view_min_bytes = 0x40;
+static size_t slice_view_ratio = 4;
+
+void string_set_slice_view_ratio(size_t ratio) {
+  slice_view_ratio = ratio;
+}
+
+size_t string_slice_view_ratio() {
+  return slice_view_ratio;
+}
+
+template <typename ObjectT>
+static void string_view_delete(ObjectT* s) {
+  // if the view was converted to a C string, it owns its data instead
+  if (s->base) {
+    delete_reference(s->base);
+  } else {
+    free(s->data);
+  }
+  free(s);
+}
+
+template <typename ObjectT, typename CharT>
+static ObjectT* string_slice(ObjectT* s, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block,
+    ObjectT* (*new_fn)(const CharT*, ssize_t, ExceptionBlock*)) {
+  int64_t count = slice_adjust_indices(s->count, &start, &stop, step,
+      exc_block);
+
+  if (step == 1) {
+    // strings are immutable, so s[:] can just be s
+    if (static_cast<uint64_t>(count) == s->count) {
+      return reinterpret_cast<ObjectT*>(add_reference(s));
+    }
+
+    ObjectT* base = s->base ? s->base : s;
+    if (slice_view_ratio &&
+        (count * sizeof(CharT) >= slice_view_min_bytes) &&
+        (static_cast<uint64_t>(count) * slice_view_ratio >= base->count)) {
+      ObjectT* ret = reinterpret_cast<ObjectT*>(malloc(sizeof(ObjectT)));
+      if (!ret) {
+        raise_python_exception(exc_block, &MemoryError_instance);
+        throw bad_alloc();
+      }
+      ret->basic.refcount = 1;
+      ret->basic.destructor = reinterpret_cast<void (*)(void*)>(
+          string_view_delete<ObjectT>);
+      ret->count = count;
+      ret->data = s->data + start;
+      ret->base = reinterpret_cast<ObjectT*>(add_reference(base));
+      if (debug_flags & DebugFlag::ShowRefcountChanges) {
+        fprintf(stderr, "[refcount:create] created view %p of %p with %" PRId64 " items\n",
+            ret, base, count);
+      }
+      return ret;
+    }
+    return new_fn(s->data + start, count, exc_block);
+  }
+
+  ObjectT* ret = new_fn(NULL, count, exc_block);
+  for (int64_t x = 0; x < count; x++, start += step) {
+    ret->data[x] = s->data[start];
+  }
+  ret->data[count] = 0;
+  return ret;
+}
+
+template <typename ObjectT, typename CharT>
+static const CharT* string_c_str(ObjectT* s, ExceptionBlock* exc_block) {
+  // only views can be unterminated, and even they don't need to be copied if
+  // the base's next character is a null (e.g. if the view is a suffix)
+  if (!s->data[s->count]) {
+    return s->data;
+  }
+
+  CharT* data = reinterpret_cast<CharT*>(malloc(sizeof(CharT) * (s->count + 1)));
+  if (!data) {
+    raise_python_exception(exc_block, &MemoryError_instance);
+    throw bad_alloc();
+  }
+  memcpy(data, s->data, sizeof(CharT) * s->count);
+  data[s->count] = 0;
+
+  ObjectT* base = s->base;
+  s->data = data;
+  s->base = NULL;
+  delete_reference(base);
+  return data;
+}
+
+BytesObject* bytes_slice(BytesObject* s, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block) {
+  return string_slice<BytesObject, char>(s, start, stop, step, exc_block,
+      bytes_new);
+}
+
+const char* bytes_c_str(BytesObject* s, ExceptionBlock* exc_block) {
+  return string_c_str<BytesObject, char>(s, exc_block);
+}
+
+UnicodeObject* unicode_slice(UnicodeObject* s, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block) {
+  return string_slice<UnicodeObject, wchar_t>(s, start, stop, step, exc_block,
+      unicode_new);
+}
+
+const wchar_t* unicode_c_str(UnicodeObject* s, ExceptionBlock* exc_block) {
+  return string_c_str<UnicodeObject, wchar_t>(s, exc_block);
+}
@@ -10,12 +10,22 @@
 // string and bytes objects are null-terminated for convenience (so we can use
 // C standard library functions on them). this means that the number of
 // allocated characters is actually (count + 1).
+//
+// the exception is slices. a slice usually shares the data of the object it
+// was taken from (its base) instead of copying it, so slicing is O(1). in this
+// case data points into the base object's data and isn't necessarily
+// null-terminated; code that needs a C string should use bytes_c_str or
+// unicode_c_str. views always refer to the original object, never to another
+// view. for objects that aren't views, base is NULL and data usually points to
+// inline_data (but not always; see bytes_map_file).
 
 struct BytesObject {
   BasicObject basic;
 
   uint64_t count;
-  char data[0];
+  char* data;
+  BytesObject* base;
+  char inline_data[0];
 
   BytesObject();
 };
@@ -24,7 +34,9 @@ struct UnicodeObject {
   BasicObject basic;
 
   uint64_t count;
-  wchar_t data[0];
+  wchar_t* data;
+  UnicodeObject* base;
+  wchar_t inline_data[0];
 
   UnicodeObject();
 };
@@ -33,10 +45,28 @@ struct UnicodeObject {
 BytesObject* bytes_new(const char* data, ssize_t count,
     ExceptionBlock* exc_block = NULL);
 BytesObject* bytes_from_cxx_string(const std::string& data);
+
+// maps the file open on fd into memory and returns a BytesObject whose data is
+// the mapping itself, so the file's contents are never copied. the object is
+// an ordinary BytesObject in every other way. the header lives at the end of
+// an anonymous page immediately before the mapping, and the null terminator
+// comes from the zero-filled remainder of the last page (or an extra page if
+// the file's size is a multiple of the page size). returns NULL and sets errno
+// on failure
+BytesObject* bytes_map_file(int fd, bool sequential = true);
+// returns a new reference to s[start:stop:step] (see Slice.hh for how
+// omitted indexes are passed). s is borrowed
+BytesObject* bytes_slice(BytesObject* s, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block = NULL);
+// returns s's data as a null-terminated string. if s is a view, this copies its
+// data so it no longer refers to its base
+const char* bytes_c_str(BytesObject* s, ExceptionBlock* exc_block = NULL);
 BytesObject* bytes_concat(const BytesObject* a, const BytesObject* b,
     ExceptionBlock* exc_block = NULL);
 char bytes_at(const BytesObject* s, size_t which,
     ExceptionBlock* exc_block = NULL);
+int64_t bytes_get_item(const BytesObject* s, int64_t index,
+    ExceptionBlock* exc_block = NULL);
 size_t bytes_length(const BytesObject* s);
 bool bytes_equal(const BytesObject* a, const BytesObject* b);
 int64_t bytes_compare(const BytesObject* a, const BytesObject* b);
@@ -46,10 +76,15 @@ std::string bytes_to_cxx_string(const BytesObject* s);
 UnicodeObject* unicode_new(const wchar_t* data, ssize_t count,
     ExceptionBlock* exc_block = NULL);
 UnicodeObject* unicode_from_cxx_wstring(const std::wstring& data);
+UnicodeObject* unicode_slice(UnicodeObject* s, int64_t start, int64_t stop,
+    int64_t step, ExceptionBlock* exc_block = NULL);
+const wchar_t* unicode_c_str(UnicodeObject* s, ExceptionBlock* exc_block = NULL);
 UnicodeObject* unicode_concat(const UnicodeObject* a, const UnicodeObject* b,
     ExceptionBlock* exc_block = NULL);
 wchar_t unicode_at(const UnicodeObject* s, size_t which,
     ExceptionBlock* exc_block = NULL);
+UnicodeObject* unicode_get_item(const UnicodeObject* s, int64_t index,
+    ExceptionBlock* exc_block = NULL);
 size_t unicode_length(const UnicodeObject* s);
 bool unicode_equal(const UnicodeObject* a, const UnicodeObject* b);
 int64_t unicode_compare(const UnicodeObject* a, const UnicodeObject* b);
@@ -60,3 +95,10 @@ BytesObject* unicode_encode_ascii(const UnicodeObject* s);
 BytesObject* unicode_encode_ascii(const wchar_t* s, ssize_t size = -1);
 UnicodeObject* bytes_decode_ascii(const BytesObject* s);
 UnicodeObject* bytes_decode_ascii(const char* s, ssize_t size = -1);
+
+// a slice is only a view if it's at least a minimum length (shorter slices are
+// as cheap to copy as to refer to) and at least 1/ratio of its base's length,
+// so a small slice can't keep a much larger object alive. a ratio of 0 means
+// slices are always copied
+void string_set_slice_view_ratio(size_t ratio);
+size_t string_slice_view_ratio();
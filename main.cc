@@ -49,6 +49,9 @@ Options:\n\
         Verbose - all debug info, no behavior changes\n\
       Flags which modify behavior:\n\
         NoInlineRefcounting - disable inline refcounting\n\
+        FusedMultiplyAdd - use fma for Float a * b + c (rounds differently)\n\
+        NoVectorization - don\'t vectorize simple loops over lists\n\
+        BaselineISA - only use SSE2, even if the cpu supports AVX etc.\n\
         All - enable all behavior flags and debug info\n\
       -X may be used multiple times to enable multiple flags.\n\
 \n\
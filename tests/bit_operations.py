@@ -0,0 +1,78 @@
+# int.bit_count and int.bit_length are compiled inline as single instructions
+# when the cpu has them; these check them against values where the absolute
+# value matters and against a slow version that uses shifts
+
+def slow_bit_count(x=0):
+  if x < 0:
+    x = -x
+  count = 0
+  while x:
+    count = count + (x & 1)
+    x = x >> 1
+  return count
+
+def slow_bit_length(x=0):
+  if x < 0:
+    x = -x
+  length = 0
+  while x:
+    length = length + 1
+    x = x >> 1
+  return length
+
+values = [0, 1, -1, 2, 7, -8, 255, 256, 1 << 40, -(1 << 40) - 1, 12345678901234,
+    9223372036854775807, -9223372036854775807]
+for v in values:
+  print('%d: %d %d' % (v, v.bit_count(), v.bit_length()))
+  if (v.bit_count() != slow_bit_count(v)) or (v.bit_length() != slow_bit_length(v)):
+    print('mismatch for %d' % v)
+
+# the minimum Int's absolute value doesn't fit in an Int, but its bits do
+smallest = -9223372036854775807 - 1
+print('%d %d' % (smallest.bit_count(), smallest.bit_length()))
+
+# the value can be any Int expression, including calls
+def square(x=0):
+  return x * x
+big = 1 << 40
+print('%d %d %d' % ((3 + 4).bit_count(), square(1000).bit_length(), (big - 1).bit_count()))
+
+# a small bitset: count the members of a few sets of numbers
+bits = 0
+for n in [1, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61]:
+  bits = bits | (1 << n)
+total = 0
+for mask in [0xFF, 0xFF00, 0xFFFFFFFF, 0x7FFFFFFFFFFFFFFF]:
+  total = total * 100 + (bits & mask).bit_count()
+print('primes %d, highest %d, total %d' % (bits.bit_count(), bits.bit_length() - 1, total))
+
+# the __nemesys__ bit intrinsics treat values as 64-bit unsigned, so negative
+# values have their high bits set. ctz and clz of 0 are 64, and rotate counts
+# are taken modulo 64 (so negative counts rotate right). these are compiled
+# inline too; with -XBaselineISA, ctz and clz call the builtins instead
+import __nemesys__
+
+for v in [0, 1, -1, 2, 0x80, 0x0123456789ABCDEF, 1 << 40, -(1 << 40),
+    9223372036854775807, smallest]:
+  print('%d: ctz %d clz %d bswap %d' % (v, __nemesys__.ctz(v), __nemesys__.clz(v),
+      __nemesys__.bswap(v)))
+  if __nemesys__.bswap(__nemesys__.bswap(v)) != v:
+    print('bswap mismatch for %d' % v)
+
+for count in [0, 1, 4, 63, 64, 65, 127, 1000, -1, -4, -64, -65]:
+  print('rotl by %d: %d %d %d' % (count, __nemesys__.rotl(1, count),
+      __nemesys__.rotl(0x0123456789ABCDEF, count), __nemesys__.rotl(smallest, count)))
+
+# variable counts go through cl, so try them with the count in a variable, as
+# an expression, and with the value coming from a call
+def rotate_all(v=0):
+  total = 0
+  for count in range(-70, 70):
+    total = total ^ __nemesys__.rotl(v, count) ^ __nemesys__.rotl(square(v), count + 3)
+  return total
+print('%d %d' % (rotate_all(0x1234), rotate_all(-3)))
+
+# rotating left by n and then by 64 - n gets back the original value
+for n in range(64):
+  if __nemesys__.rotl(__nemesys__.rotl(0x0123456789ABCDEF, n), 64 - n) != 0x0123456789ABCDEF:
+    print('rotate mismatch for %d' % n)
@@ -0,0 +1,12 @@
+# functions called with lists of different item types are compiled separately
+# for each type, so each call sees its own items
+
+def first(values):
+  return values[0]
+
+def last(values):
+  return values[-1]
+
+print(first([3, 4]), first([2.5, 4.5]), first(['x', 'y']))
+print(last([1, 2, 3]), last([0.25, 0.5]), last(['a', 'b']))
+print(first([3, 4]) + 1, first([2.5, 4.5]) + 1.0, last(['p', 'q']) + 'r')
@@ -0,0 +1,80 @@
+# comprehensions over lists, tuples and ranges
+l = [1, 2, 3, 4, 5]
+squares = [x * x for x in l]
+print(len(squares), squares[0], squares[4])
+halves = [x / 2 for x in l]
+print(halves[0], halves[2])
+evens = [x for x in l if x % 2 == 0]
+print(len(evens), evens[0], evens[1])
+
+t = ('a', 'b', 'c')
+doubled = [s + s for s in t]
+print(len(doubled), doubled[0], doubled[2])
+nonempty = [s for s in t if s != 'b']
+print(len(nonempty), nonempty[0], nonempty[1])
+
+r = [i * 3 for i in range(6)]
+print(len(r), r[0], r[5])
+r = [i for i in range(10, 0, -3)]
+print(len(r), r[0], r[1], r[2], r[3])
+r = [i for i in range(5, 10) if i != 7]
+print(len(r), r[0], r[2], r[3])
+print(len([i for i in range(0)]), len([i for i in range(5, 2)]))
+try:
+  print(len([i for i in range(1, 5, 0)]))
+except ValueError:
+  print('ValueError')
+
+# a materialized range
+m = range(2, 8, 2)
+print(len(m), m[0], m[1], m[2])
+
+# nested comprehensions and comprehensions over comprehensions
+words = ['ab', 'cde', 'f']
+lengths = [len(w) for w in words]
+print(lengths[0], lengths[1], lengths[2])
+longer = [n + 1 for n in [len(w) for w in words] if n > 1]
+print(len(longer), longer[0], longer[1])
+
+def scaled(values, factor):
+  return [v * factor for v in values]
+sc = scaled(l, 10)
+print(len(sc), sc[0], sc[4])
+
+# dict comprehensions
+d = {w: len(w) for w in words}
+print(len(d), d['ab'], d['cde'], d['f'])
+sq = {i: i * i for i in range(5) if i > 1}
+print(len(sq), sq[2], sq[3], sq[4])
+empty = {w: w for w in words if len(w) > 5}
+print(len(empty))
+
+# comprehension variables are private to the comprehension, so they don't
+# overwrite variables with the same name outside, and the same name can be used
+# with different types in different comprehensions and loops
+x = 'outer'
+xs = [x * 2 for x in range(3)]
+print(x, xs[0], xs[2])
+fs = [x + 0.25 for x in [0.5, 1.5]]
+print(x, fs[0], fs[1])
+ws = {x: x + '!' for x in words}
+print(x, ws['ab'], ws['f'])
+zs = [z * 3 for z in range(2)]
+for z in [0.25, 0.75]:
+  print(z, zs[1])
+
+def shadowed(values):
+  v = 'local'
+  ints = [v + 1 for v in values]
+  strs = [v for v in ['p', 'q']]
+  print(v, ints[0], strs[1])
+shadowed(l)
+
+# the source of a nested comprehension is evaluated in the enclosing
+# comprehension's scope, even when both use the same name
+grid = [[x * 10 + y for y in range(x)] for x in range(1, 4)]
+print(len(grid), len(grid[2]), grid[2][0], grid[2][2])
+rows = [[x + 1 for x in x] for x in [[1, 2], [3, 4, 5]]]
+print(len(rows), rows[0][1], rows[1][2], x, z)
+total = [x * y for x, y in [(1, 2), (3, 4), (5, 5)] if x != y]
+print(total[0], total[1], x)
@@ -0,0 +1,48 @@
+config = {'timeout': 30, 'retries': 4, 'scale': 7}
+print(len(config), config['timeout'], config['retries'], config['scale'])
+
+# the same keys are looked up many times at the same sites
+total = 0
+for i in range(100000):
+  total = total + config['timeout'] * config['scale'] - config['retries']
+print(total)
+
+# replacing a value is visible at sites that have already looked up the key
+config['timeout'] = 10
+print(config['timeout'])
+
+# adding keys that share a prefix with an existing key moves its value
+config['timeouts'] = 5
+print(config['timeout'], config['timeouts'])
+config['time'] = 2
+print(config['timeout'], config['timeouts'], config['time'], len(config))
+
+# a site sees every dict passed to it, including new dicts that may be
+# allocated at the same address as freed ones
+def get_k(d):
+  return d['k']
+print(get_k({'k': 1, 'j': 2}), get_k({'j': 3, 'k': 4}))
+total = 0
+for i in range(100):
+  total = total + get_k({'k': i, 'kk': i * 2})
+print(total)
+
+ids = {1: 'one', 2: 'two', 300: 'three hundred'}
+for i in range(3):
+  print(ids[300], ids[1])
+ids[2] = 'TWO'
+print(ids[2], len(ids))
+
+names = {b'x': 1, b'xy': 2}
+print(names[b'x'], names[b'xy'])
+
+values = {'a': 'x' + 'yz', 'b': 'w'}
+joined = ''
+for i in range(5):
+  joined = joined + values['a'] + values['b']
+print(joined)
+
+try:
+  print(config['missing'])
+except KeyError:
+  print('KeyError for missing key')
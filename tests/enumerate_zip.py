@@ -0,0 +1,52 @@
+values = [10, 20, 30]
+for i, x in enumerate(values):
+  print(i, x)
+for j, word in enumerate(('alpha', 'beta', 'gamma'), 5):
+  print(j, word)
+for k, f in enumerate([0.5, 1.25], -2):
+  print(k, f)
+for k, f in enumerate([0.75, 2.5], start=7):
+  print(k, f)
+
+# zip stops at the shortest source, and can take more than two
+names = ['x', 'y', 'z', 'w']
+for name, v, g in zip(names, values, (0.5, 1.5, 2.5, 3.5)):
+  print(name, v, g)
+total = 0
+for a, b in zip(range(1000), range(0, 3000, 3)):
+  total = total + a * b
+print(total)
+
+def index_of(words, target):
+  for i, w in enumerate(words):
+    if w == target:
+      return i
+  return -1
+print(index_of(names, 'z'), index_of(names, 'q'))
+
+def first_mismatch(xs, ys):
+  for x, y in zip(xs, ys):
+    for n, c in enumerate(['-', '+']):
+      if (x > y) == (n == 1):
+        continue
+      if x != y:
+        return c + repr(x) + repr(y)
+  return 'none'
+print(first_mismatch([1, 2, 3], [1, 5, 3]), first_mismatch([1], [1, 2]))
+
+for i, x in enumerate(values):
+  if x == 20:
+    break
+else:
+  print('not printed')
+print(i)
+for i, x in enumerate(values):
+  pass
+else:
+  print('done at', i)
+
+# used as values rather than unpacked, they return lists of tuples
+for p in enumerate(names):
+  print(p[0], p[1])
+for q in zip(values, names):
+  print(q[0], q[1])
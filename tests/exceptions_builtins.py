@@ -11,3 +11,20 @@ try:
   print('somehow managed to close ridiculous fd')
 except OSError as e:
   print('can\'t close ridiculous fd; errno=' + repr(e.errno) + ' (' + posix.strerror(e.errno) + ')')
+
+# built-in exceptions can be raised from python code too, including from inside
+# functions and in the middle of expressions
+def check_length(l=[0], n=0):
+  if len(l) != n:
+    raise ValueError()
+  return n
+
+try:
+  print(check_length([1, 2, 3], 3) + check_length([1, 2], 3))
+except ValueError:
+  print('wrong length')
+
+try:
+  raise KeyError()
+except KeyError:
+  print('raised KeyError')
@@ -0,0 +1,48 @@
+# constant Int exponents are expanded into multiplications at compile time;
+# variable ones use a square-and-multiply loop. Float results only use a
+# multiplication for squares, and call pow() otherwise
+
+ints = [0, 1, -1, 2, -3, 7, 10, -12]
+for x in ints:
+  print('%d: %d %d %d %d %d %d' % (x, x ** 0, x ** 1, x ** 2, x ** 3, x ** 5, x ** 13))
+  print('  %g %g %g' % (x ** 2.0, x ** 3.0, x ** 0.0))
+  if x != 0:
+    print('  %g' % (x ** -2.0))
+  for e in [0, 1, 2, 3, 7]:
+    print('  %d ** %d = %d' % (x, e, x ** e))
+
+floats = [0.0, -0.0, 1.5, -2.25, 3.0, 0.1, 100.0, -7.5]
+for y in floats:
+  print('%g: %g %g %g %g %g %g' % (y, y ** 0, y ** 1, y ** 2, y ** 3, y ** 4, y ** 10))
+  print('  %g %g %g %g' % (y ** 1.0, y ** 2.0, y ** 17.0, y ** 64))
+  if y > 0.0:
+    print('  %g %g %g %g' % (y ** -1, y ** -3, y ** 0.5, y ** 1.5))
+    print('  %g %g' % (y ** -2.5, y ** 0.25))
+  for e in [0, 1, 2, 3, -1, -2, 9, 31]:
+    if y != 0.0 or e >= 0:
+      print('  %g ** %d = %g' % (y, e, y ** e))
+
+print('%g %g %g' % (16 ** 0.5, 2 ** 0.5, (-0.0) ** 0.5))
+
+# distance between two points
+dx = 3.0
+dy = -4.0
+print('%g' % ((dx ** 2 + dy ** 2) ** 0.5))
+
+b = 3
+print('%d %d' % (b ** 39, 2 ** 62))
+
+# large exponents call pow() so the result is correctly rounded
+e = 300
+print('%f' % (10.0 ** e))
+print('%g %g %g' % (1.5 ** -e, 10.0 ** 40, 2.0 ** 70.0))
+
+# multiplication chains would round at each step, so these would be off in the
+# last few bits if they were used for exponents other than 2 and -1
+def power(y=0.0, e=0):
+  return y ** e
+for y in [1.1, 0.7, 3.3, 1.0000001, 2.718281828459045, 0.123456789, 9.87654321]:
+  print('%.17g %.17g %.17g %.17g %.17g %.17g' % (y ** 2, y ** -1, y ** 3, y ** 5,
+      y ** -2, y ** 16.0))
+  for e in range(-17, 18):
+    print('  %d %.17g' % (e, power(y, e)))
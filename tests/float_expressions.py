@@ -0,0 +1,57 @@
+# float expression trees are evaluated in xmm registers; these cover nesting,
+# mixed Int/Float operands, calls inside operands, and deep trees that run out
+# of temporary registers
+
+def scale(x=0.0, k=0.0):
+  return x * k
+
+def halve(x=0.0):
+  return x / 2
+
+g = 0.25
+
+def poly(x=0.0, y=0.0):
+  a = 1.5
+  b = -0.75
+  c = 2.0
+  p = a * x * x + b * x + c
+  q = (x + y) * (x - y) / (y + 4.0)
+  r = x * a - y * b
+  s = c - a * b
+  t = x / 4 + 3 * y - g
+  print('%g %g %g %g %g' % (p, q, r, s, t))
+  return p + q + r + s + t
+
+total = 0.0
+for i in range(-3, 4):
+  x = i / 2
+  y = 1.0 - x
+  total = total + poly(x, y)
+print('total %g' % total)
+
+# operands that call functions have to keep the other operand alive
+v = 3.0
+print('%g %g' % (v * scale(v, 2.0) + halve(v), halve(v) - scale(v, v) / v))
+print('%g' % (scale(v, halve(v) + 1.0) * (halve(10.0) - g)))
+
+# int operands are converted where they're used
+n = 7
+m = 2
+print('%g %g %g %g' % (n / m, n * 0.5 + m, n - m * 1.5, (n + 1) / (m - 0.5)))
+print('%g %g' % (True + 0.5, -v + n / 4))
+
+# deeper than the number of temporary registers
+w = 0.5
+deep = 1.0 + (2.0 + (3.0 + (4.0 + (5.0 + (6.0 + (7.0 + (8.0 + (9.0 + (10.0 + (w * 2.0 - 1.0) * w) * w) * w) * w) * w) * w) * w) * w) * w)
+print('deep %g' % deep)
+deep2 = ((((((((((w - 1.0) / 2.0 - 3.0) / 4.0 - 5.0) / 6.0 - 7.0) / 8.0 - 9.0) / 10.0 - 11.0) / 12.0 - 13.0) / 14.0) - 15.0) / 16.0)
+print('deep2 %.12g' % deep2)
+
+# a numerical integral of x * x over [0, 1]
+steps = 1000
+h = 1 / steps
+acc = 0.0
+for k in range(steps):
+  xm = (k + 0.5) * h
+  acc = acc + xm * xm * h
+print('integral %.6f' % acc)
@@ -0,0 +1,34 @@
+# integers
+print('%d is prime' % 7)
+print('[%5d] [%-5d] [%05d] [%+d] [% d] [%.3d]' % (42, 42, -42, 42, 42, 7))
+print('[%x] [%X] [%#x] [%#X] [%o] [%#o] [%#08x]' % (255, 255, 255, 255, 8, 8, 255))
+print('[%x] [%d] [%u] [%i]' % (-255, -9223372036854775807, 123456789, 0))
+print('[%c%c%c] [%3c]' % (110, 101, 109, 65))
+print('[%*d] [%-*d] [%*d]' % (6, 1, 4, 2, -4, 3))
+print('%d%% done' % 50)
+
+# floats
+print('[%f] [%.2f] [%.0f] [%#.0f] [%.1f]' % (1.5, 0.125, 2.5, 2.0, -0.05))
+print('[%10.3f] [%-10.3f] [%010.3f] [%+.3f] [% .3f]' % (3.14159, 3.14159, -3.14159, 2.0, 2.0))
+print('[%f] [%F] [%f] [%05f]' % (float('inf'), float('-inf'), float('nan'), float('inf')))
+inf = float('inf')
+print('[%g] [%+g] [% g] [%05g] [%-6G] [%f]' % (inf - inf, inf - inf, -(inf - inf), inf - inf, inf - inf, -float('nan')))
+print(inf - inf)
+print(repr(inf - inf) + ' ' + repr(-inf) + ' ' + repr(2.0))
+print('[%.*f] [%f] [%.3f]' % (4, 2.0 / 3.0, 123456789 / 1000, 10.0 ** 15))
+print('[%e] [%.3E] [%g] [%G] [%#g]' % (12345.678, 0.000123, 0.0001, 1e20, 2.0))
+print('[%f]' % (10.0 ** 300))
+
+# strings
+print('[%s] [%10s] [%-10s] [%.3s]' % ('abc', 'right', 'left', 'truncated'))
+
+# %c arguments outside the character range raise OverflowError, as in python
+for ch in [0x110000, -1]:
+  try:
+    print('[%c]' % ch)
+  except OverflowError:
+    print('%d is out of range for %%c' % ch)
+try:
+  print(b'[%c]' % 256)
+except OverflowError:
+  print('256 is out of range for bytes %c')
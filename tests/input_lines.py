@@ -0,0 +1,21 @@
+print('reading lines')
+first = input()
+print('first line: ' + first)
+second = input('> ')
+print('second line: ' + second)
+third = input()
+print('third line has ' + repr(len(third)) + ' characters')
+print(third)
+fourth = input()
+print('fourth line: ' + fourth)
+print('done')
+
+# input() raises EOFError when there are no more lines
+extra_lines = 0
+while True:
+  try:
+    line = input()
+  except EOFError:
+    break
+  extra_lines = extra_lines + 1
+print('%d more lines' % extra_lines)
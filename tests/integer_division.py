@@ -0,0 +1,39 @@
+# constant divisors are compiled without idiv; these check that the results
+# still round toward negative infinity like python does
+
+values = [0, 1, -1, 2, -2, 7, -7, 10, -10, 99, -100, 12345, -12345,
+    9223372036854775807, -9223372036854775807 - 1, -4611686018427387905]
+
+for x in values:
+  print('%d: %d %d %d %d' % (x, x // 1, x % 1, x // 2, x % 2))
+  print('  %d %d %d %d' % (x // 16, x % 16, x // 4294967296, x % 4294967296))
+  print('  %d %d %d %d' % (x // 3, x % 3, x // 7, x % 7))
+  print('  %d %d %d %d' % (x // 10, x % 10, x // 641, x % 641))
+  print('  %d %d' % (x // 1000000007, x % 1000000007))
+  print('  %d %d' % (x // 6148914691236517205, x % 6148914691236517205))
+  print('  %d %d' % (x // 9223372036854775807, x % 9223372036854775807))
+
+  # variable and negative divisors use idiv with a floor correction
+  for d in [3, -3, 10, -10, 1]:
+    print('  %d: %d %d' % (d, x // d, x % d))
+
+# digits in reverse order
+n = 9876543210
+reversed_n = 0
+while n:
+  reversed_n = reversed_n * 10 + n % 10
+  n = n // 10
+print('%d' % reversed_n)
+
+# constant expressions are folded with the same semantics
+print('%d %d %d %d' % (-7 // 2, -7 % 2, 7 // -2, 7 % -2))
+
+zero = 0
+try:
+  print(5 // zero)
+except ZeroDivisionError:
+  print('5 // 0 raised ZeroDivisionError')
+try:
+  print(5 % zero)
+except ZeroDivisionError:
+  print('5 % 0 raised ZeroDivisionError')
@@ -0,0 +1,46 @@
+import __nemesys__
+
+# promoted values (bignums) are freed when they're no longer referenced, so
+# long loops over large values don't accumulate the intermediate results
+
+def factorial(n):
+  ret = 1
+  for x in range(2, n + 1):
+    ret = ret * x
+  return ret
+
+def fnv(data_len):
+  h = 14695981039346656037
+  for x in range(data_len):
+    h = ((h ^ (x & 0xFF)) * 1099511628211) % 18446744073709551616
+  return h
+
+def check(name='', before=0):
+  extra = __nemesys__.promoted_int_count() - before
+  if extra > 10:
+    print('%s: %d promoted values still allocated' % (name, extra))
+  else:
+    print('%s: bounded' % name)
+
+before = __nemesys__.promoted_int_count()
+f = factorial(2000)
+print(f.bit_length())
+check('factorial', before)
+
+for x in range(20):
+  f = factorial(300) // factorial(298)
+print(f)
+check('repeated factorials', before)
+
+print(fnv(100000))
+check('fnv', before)
+
+# values stored in containers live as long as the containers do
+l = [factorial(30), factorial(31), factorial(30) + 1]
+d = {factorial(32): factorial(33)}
+t = (factorial(34), 5)
+print('%d %d %d' % (l[0] == factorial(30), d[factorial(32)] == factorial(33), t[0] == factorial(34)))
+l = [0]
+d = {1: 1}
+t = (0, 0)
+check('containers', before)
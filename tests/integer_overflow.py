@@ -0,0 +1,188 @@
+import math
+
+# ints are 64-bit in the common case; operations that leave that range produce
+# promoted values (bignums) instead of wrapping around, as in python
+
+big = 9223372036854775807
+small = -big - 1
+
+def show(name, r):
+  print(name + ' = ' + repr(r))
+
+def check_add(a, b):
+  show(repr(a) + ' + ' + repr(b), a + b)
+
+def check_sub(a, b):
+  show(repr(a) + ' - ' + repr(b), a - b)
+
+def check_mul(a, b):
+  show(repr(a) + ' * ' + repr(b), a * b)
+
+def check_shl(a, b):
+  show(repr(a) + ' << ' + repr(b), a << b)
+
+def check_pow(a, b):
+  show(repr(a) + ' ** ' + repr(b), a ** b)
+
+def check_floordiv(a, b):
+  show(repr(a) + ' // ' + repr(b), a // b)
+
+def check_mod(a, b):
+  show(repr(a) + ' % ' + repr(b), a % b)
+
+def check_neg(a):
+  show('-(' + repr(a) + ')', -a)
+
+check_add(big, 0)
+check_add(big, 1)
+check_add(small, -1)
+check_add(-5, 3)
+check_sub(small, 1)
+check_sub(0, small)
+check_sub(-1, small)
+check_sub(big, big)
+check_mul(4294967296, 2147483647)
+check_mul(4294967296, 2147483648)
+check_mul(-4294967296, 2147483648)
+check_mul(small, -1)
+check_shl(1, 62)
+check_shl(1, 63)
+check_shl(-1, 63)
+check_shl(3, 62)
+check_shl(1, 64)
+check_shl(5, 3)
+check_pow(2, 62)
+check_pow(2, 63)
+check_pow(-2, 63)
+check_pow(3, 39)
+check_pow(3, 40)
+check_pow(10, 18)
+check_pow(10, 19)
+check_floordiv(small, -1)
+check_floordiv(big, -1)
+check_floordiv(-7, -1)
+check_floordiv(small, -2)
+check_mod(small, -1)
+check_mod(big, -1)
+check_mod(-7, -1)
+check_mod(small, -2)
+check_neg(small)
+show('abs(small)', abs(small))
+show('abs(small + 1)', abs(small + 1))
+check_neg(big)
+
+# values just inside and outside the range stored directly (+/-2**62)
+edge = 4611686018427387904
+check_add(edge - 1, 0)
+check_add(edge - 1, 1)
+check_sub(-edge, 1)
+check_neg(-edge)
+check_mul(edge // 2, 2)
+check_shl(1, 61)
+check_shl(-1, 62)
+show('~(edge - 1)', ~(edge - 1))
+show('~(-edge - 1)', ~(-edge - 1))
+
+def factorial(n):
+  ret = 1
+  for x in range(2, n + 1):
+    ret = ret * x
+  return ret
+
+print(repr(factorial(20)))
+show('factorial(21)', factorial(21))
+show('factorial(30)', factorial(30))
+print(repr(math.factorial(20)))
+show('math.factorial(21)', math.factorial(21))
+show('math.factorial(25)', math.factorial(25))
+show('factorial(100) // math.factorial(98)', factorial(100) // math.factorial(98))
+print('%d %s %s' % (factorial(25), hex(factorial(25)), bin(-factorial(22))))
+print(oct(2 ** 64) + ' ' + hex(-(2 ** 64)))
+
+# large values can be compared, hashed, and stored in containers
+f = factorial(30)
+print(repr(f == math.factorial(30)) + ' ' + repr(f != factorial(29) * 30))
+print(repr(f > big) + ' ' + repr(-f < small) + ' ' + repr(f > factorial(29)))
+print(repr(-f < -factorial(29)) + ' ' + repr(f < 2 ** 110))
+values = {f: 'thirty', big + 1: 'big + 1'}
+print(values[factorial(30)] + ' ' + values[2 ** 63])
+l = [2 ** 80, -(2 ** 70), 5, big + 2, small - 1]
+l.sort()
+s = 'sorted'
+for v in l:
+  s = s + ' ' + repr(v)
+print(s)
+print('%d %d %d' % (min(l), max(l), sum(l)))
+
+# bitwise operations and shifts on large values
+x = 2 ** 100 + 12345
+show('x & 0xffff', x & 0xffff)
+show('x | 1', x | 1)
+show('x ^ x', x ^ x)
+show('x >> 90', x >> 90)
+show('x >> 200', x >> 200)
+show('-x >> 200', -x >> 200)
+show('~x', ~x)
+show('x.bit_length()', x.bit_length())
+show('x.bit_count()', x.bit_count())
+show('x // 7', x // 7)
+show('x % 7', x % 7)
+show('-x // 7', -x // 7)
+show('-x % 7', -x % 7)
+show('x // -(2 ** 70)', x // -(2 ** 70))
+show('x - x + 3', x - x + 3)
+
+# large values convert to and from Floats and strings
+print('%.17g %.17g' % (float(x), x / 2 ** 64))
+print('%.17g' % (x + 0.5))
+show('int(1e20)', int(1e20))
+show('math.floor(1e19)', math.floor(1e19))
+show('int(\'123456789012345678901234567890\')', int('123456789012345678901234567890'))
+show('int(\'-ffffffffffffffffff\', 16)', int('-ffffffffffffffffff', 16))
+show('literal', 123456789012345678901234567890)
+show('hex literal', 0x123456789abcdef0123456789)
+print('%d %s' % (2 ** 64, repr(-(2 ** 64))))
+
+# constant exponents are unrolled, but still checked
+x = 3
+show('x ** 40', x ** 40)
+show('x * big', x * big)
+
+# constant expressions are folded (or computed at runtime) the same way
+show('big + 1', 9223372036854775807 + 1)
+show('2 ** 200', 2 ** 200)
+show('(2 ** 70) // 3', (2 ** 70) // 3)
+
+# an overflow inside a loop in a function, called in a loop in the caller
+def product(values):
+  ret = 1
+  for v in values:
+    ret = ret * v
+  return ret
+
+factors = [4294967296]
+for count in range(1, 5):
+  show('product of ' + repr(count), product(factors))
+  factors.append(4294967296)
+
+# sum() is exact even when the partial sums are large
+def check_sum(name, values, start):
+  show(name, sum(values, start))
+
+check_sum('sum of big and 1', [big, 1], 0)
+check_sum('sum of small and -1', [-1, small], 0)
+check_sum('sum of big, 1 and -1', [big, 1, -1], 0)
+check_sum('sum of bigs and smalls', [big, big, big, 1, small, small, small, 5], 0)
+check_sum('sum of many bigs', [big, big, big, big, big, big, big, big, -big], 0)
+check_sum('sum of small values from big', [1, 2, 3, 4, 5, 6, 7, 8, 9], big - 44)
+check_sum('sum of small values from big', [1, 2, 3, 4, 5, 6, 7, 8, 9], big - 45)
+ints = {big, 2, 3}
+show('sum of set', sum(ints, -5))
+show('sum of set', sum(ints))
+
+# functions that don't accept large values raise OverflowError, as python does
+# when a value doesn't fit in a C integer
+try:
+  print(chr(2 ** 70))
+except OverflowError:
+  print('chr(2 ** 70) overflowed')
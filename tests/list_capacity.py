@@ -0,0 +1,55 @@
+import __nemesys__
+
+# lists made with a known number of items leave room for appends, and grow by
+# the growth factor when they fill up. the items must come through unchanged
+# however the capacity changes
+
+def check(name='', l=[0]):
+  wrong = 0
+  for x in range(len(l)):
+    if l[x] != x:
+      wrong = wrong + 1
+  print('%s: %d items, %d wrong' % (name, len(l), wrong))
+
+def append_range(l=[0], start=0, end=0):
+  for x in range(start, end):
+    l.append(x)
+
+# list literals and comprehensions of several sizes, appended to right away
+l = [0, 1, 2, 3, 4, 5, 6, 7, 8]
+append_range(l, 9, 100)
+check('literal', l)
+l = [x for x in range(1000)]
+append_range(l, 1000, 1001)
+check('comprehension', l)
+
+# reserving room ahead of time, including less room than is already used, no
+# room, and a negative amount
+l = [x for x in range(0)]
+__nemesys__.reserve_list(l, 10000)
+append_range(l, 0, 10000)
+check('reserved', l)
+__nemesys__.reserve_list(l, 5)
+__nemesys__.reserve_list(l, 0)
+__nemesys__.reserve_list(l, -1)
+append_range(l, 10000, 10010)
+check('reserved again', l)
+strs = ['a']
+__nemesys__.reserve_list(strs, 100)
+for x in range(100):
+  strs.append('b')
+print('%d items: ' % len(strs) + strs[0] + strs[1] + strs[100])
+
+# factors below 1.125 are rounded up, and affect lists that already exist
+print('%g' % __nemesys__.list_growth_factor())
+for factor in [1.0, 0.0, -3.0, 1.125, 4.0, 1.5]:
+  __nemesys__.set_list_growth_factor(factor)
+  print('%g -> %g' % (factor, __nemesys__.list_growth_factor()))
+  append_range(l, len(l), len(l) + 5000)
+  check('factor %g' % factor, l)
+
+# shrinking by popping, then growing again
+while len(l) > 3:
+  l.pop()
+append_range(l, 3, 50)
+check('popped', l)
@@ -0,0 +1,65 @@
+# appends, inserts, and pops across many capacity boundaries
+
+def show(l):
+  s = ''
+  for x in l:
+    s = s + ' ' + repr(x)
+  print('%d items:%s' % (len(l), s))
+
+def show_strs(l):
+  s = ''
+  for x in l:
+    s = s + ' ' + x
+  print('%d items:%s' % (len(l), s))
+
+# (empty list literals don't have a known item type, so start with one item)
+l = [0]
+l.pop()
+i = 0
+while i < 1000:
+  l.append(i)
+  i = i + 1
+print(len(l), l[0], l[999])
+
+i = 0
+while i < 990:
+  l.pop()
+  i = i + 1
+print(len(l), l[-1])
+
+# grow and shrink at the same boundary repeatedly
+i = 0
+while i < 100:
+  l.append(i)
+  x = l.pop()
+  i = i + 1
+print(len(l), l[-1], x)
+
+l.insert(0, -1)
+l.insert(5, -5)
+l.insert(len(l), -100)
+show(l)
+print(l.pop(0), l.pop(4), l.pop(-1))
+show(l)
+
+# popping everything and starting over
+while len(l):
+  l.pop(0)
+show(l)
+l.append(7)
+show(l)
+
+strs = ['']
+strs.pop()
+i = 0
+while i < 200:
+  strs.append('item %d' % i)
+  i = i + 1
+while len(strs) > 3:
+  strs.pop(1)
+show_strs(strs)
+
+l.clear()
+l.append(3)
+l.insert(0, 2)
+show(l)
@@ -0,0 +1,44 @@
+l = [1, 2, 3]
+l[0] = 10
+l[-1] = 30
+print(l[0], l[1], l[2], l[-3])
+f = [1.5, 2.5]
+f[1] = 7.25
+print(f[0], f[1])
+s = ['a', 'b']
+s[0] = 'x' + 'y'
+print(s[0], s[1], s[-1])
+i = 0
+while i < 10:
+  l.append(i)
+  i = i + 1
+l[12] = 99
+print(l[12], len(l))
+try:
+  l[13] = 5
+except IndexError:
+  print('IndexError store')
+try:
+  print(l[-14])
+except IndexError:
+  print('IndexError load')
+
+# lists that start out small and grow past their inline storage
+def squares(n):
+  l = [0]
+  i = 1
+  while i < n:
+    l.append(i * i)
+    i = i + 1
+  return l
+
+sq = squares(20)
+total = 0
+for x in sq:
+  total = total + x
+print(total, sq[3], sq[4], sq[19])
+sq[4] = sq[3] + sq[19]
+print(sq[4])
+while len(sq) > 2:
+  sq.pop()
+print(len(sq), sq[0], sq[1])
@@ -0,0 +1,35 @@
+import __nemesys__
+
+# maps this file and checks that the result works like any other Bytes object
+
+data = __nemesys__.map_file('map_file.py')
+print('%d bytes' % len(data))
+print('%d %d %d' % (data[0], data[7], data[-1]))
+print(data[0:6] == b'import')
+print(data[-1:] == b'\n')
+print(data[7:18] + b'!' == b'__nemesys__!')
+print(len(data[::2]) == (len(data) + 1) // 2)
+print(b'map_file' in data)
+print((b'not in ' + b'this file') in data)
+
+# the kernel isn't told to read ahead, but the contents are the same
+unsequential = __nemesys__.map_file('map_file.py', False)
+print(len(unsequential) == len(data))
+print(unsequential == data)
+print(unsequential[100:200] == data[100:200])
+
+# many mappings of the same file, each released before the next
+total = 0
+for x in range(100):
+  total = total + len(__nemesys__.map_file('map_file.py'))
+print(total == 100 * len(data))
+
+def try_map(path=''):
+  try:
+    print('%s: %d bytes' % (path, len(__nemesys__.map_file(path))))
+  except OSError:
+    print('%s: OSError' % path)
+
+try_map('map_file.py')
+try_map('nonexistent_file_for_map_file_test')
+try_map('.')
@@ -0,0 +1,67 @@
+import math
+
+# sqrt, floor, ceil, trunc and fabs are compiled inline instead of being called;
+# these check them in expressions, as arguments to other calls, and in
+# functions where the values are locals
+
+values = [0.0, 0.5, -0.5, 1.0, 2.25, -2.25, 2.75, -2.75, 1e10 + 0.5, -7.0]
+for v in values:
+  print('%g: %d %d %d %g' % (v, math.floor(v), math.ceil(v), math.trunc(v), math.fabs(v)))
+
+print('%g %g' % (math.fabs(-0.0), math.fabs(-math.inf)))
+print('%g %g %g %g' % (math.sqrt(2.25), math.sqrt(16), math.sqrt(0.0), math.sqrt(1e-8)))
+
+def hypotenuse(a=0.0, b=0.0):
+  return math.sqrt(a * a + b * b)
+
+def add(a=0, b=0.0, c=0, d=0.0):
+  return a + b + c + d
+
+x = 3.0
+print('%g' % hypotenuse(x, 4.0))
+print('%g' % add(math.floor(x / 2), math.sqrt(x * 3), math.ceil(-x / 2), math.fabs(x - 10)))
+print('%g' % (math.sqrt(hypotenuse(math.fabs(-x), x + 1)) * math.trunc(7.9)))
+
+# the results are Ints where they should be, so integer operations work on them
+total = 0
+for i in range(20):
+  total = total + math.floor(i * 0.3) * 3 + math.ceil(i / 7) - math.trunc(-i / 4)
+print('total %d' % total)
+
+def integer_sqrt(n=0):
+  return math.floor(math.sqrt(n))
+print('%d %d %d' % (integer_sqrt(99), integer_sqrt(100), integer_sqrt(1000001)))
+
+# NaN and infinities can't be converted to an Int; large values are promoted
+def show_conversions(v=0.0):
+  for name in ['floor', 'ceil', 'trunc']:
+    try:
+      if name == 'floor':
+        n = math.floor(v)
+      elif name == 'ceil':
+        n = math.ceil(v)
+      else:
+        n = math.trunc(v)
+      print('%s(%g) = %d' % (name, v, n))
+    except OverflowError:
+      print('%s(%g) overflowed' % (name, v))
+    except ValueError:
+      print('%s(%g) raised ValueError' % (name, v))
+
+for v in [math.inf, -math.inf, math.nan, 1e300, -1e19, 9.2233720368547748e18,
+    -9223372036854775808.0, -9223372036854775808.5, 9223372036854775808.0]:
+  show_conversions(v)
+
+def show_sqrt(v=0.0):
+  try:
+    print('sqrt(%g) = %g' % (v, math.sqrt(v)))
+  except ValueError:
+    print('sqrt(%g) raised ValueError' % v)
+
+for v in [-1.0, -0.0, -1e-300, -math.inf, math.nan, math.inf, 4.0]:
+  show_sqrt(v)
+for i in [-1, 0, 9, -9223372036854775807]:
+  try:
+    print('sqrt(%d) = %g' % (i, math.sqrt(i)))
+  except ValueError:
+    print('sqrt(%d) raised ValueError' % i)
@@ -0,0 +1,97 @@
+# int() and float() parse strings themselves instead of calling strtoll and
+# strtod; these check that they accept and reject the same strings as python
+
+def show_int(s, base=10):
+  try:
+    print('int(%s, %d) = %d' % (repr(s), base, int(s, base)))
+  except ValueError:
+    print('int(%s, %d) raised ValueError' % (repr(s), base))
+
+def show_float(s):
+  try:
+    print('float(%s) = %.17g' % (repr(s), float(s)))
+  except ValueError:
+    print('float(%s) raised ValueError' % repr(s))
+
+# long runs of digits are converted 8 at a time; these have runs of every length
+# around 8 and 16, with and without underscores breaking them up
+for s in ['1', '12345678', '123456789', '1234567890123456', '12345678901234567',
+    '9223372036854775807', '-9223372036854775808', '00000000000000000042',
+    '1_2345_6789', '12_345_678_901_234_567', '  -77 ', '\t+5\n', '0', '-0']:
+  show_int(s)
+
+for s in ['', ' ', '-', '1_', '_1', '1__2', '12345678x', '1 2', '0x10', '1.5']:
+  show_int(s)
+
+# prefixes and other bases
+for s in ['0x1f', '-0X1F', '0o17', '0b101', '0x_ff', '0b', '010', '00', '0_0', '1_000']:
+  show_int(s, 0)
+show_int('0b1', 16)
+show_int('0x1f', 16)
+print('%d %d' % (int('ff', base=16), int(b'-777', base=8)))
+show_int('zz', 36)
+show_int('777', 8)
+show_int('778', 8)
+show_int('5', 1)
+print('%d %d' % (int(b'12345678901'), int(b' -0x7f ', 0)))
+
+# without a base, strings are decimal: leading zeroes are allowed (as in
+# zero-padded fields) and prefixes aren't
+def show_int_default_base(s):
+  try:
+    print('int(%s) = %d' % (repr(s), int(s)))
+  except ValueError:
+    print('int(%s) raised ValueError' % repr(s))
+
+for s in ['010', '09', ' -0345 ', '0000', '0_7', '0x1f', '0b1', '0o7', '12']:
+  show_int_default_base(s)
+print('%d %d' % (int(b'007'), int(b'0250') + 1))
+
+# floats that are exact, that need rounding, that have more digits than fit in
+# 64 bits, and that are subnormal or out of range
+for s in ['1.5', '-0.0', '.5', '5.', '1e10', '1E-10', '0.1', '3.141592653589793',
+    '123456789012345678901234567890', '0.30000000000000004',
+    '9007199254740993', '2.2250738585072011e-308', '4.9406564584124654e-324',
+    '2.4703282292062327e-324', '1.7976931348623157e308', '1e-400', '1e400',
+    '1_000.000_1', '1e1_0', '  2.5  ', '00000000000000000000000001.25',
+    '0.000000000000000000000000000000000000000000123456789']:
+  show_float(s)
+
+for s in ['', '.', 'e5', '1e', '1e+', '1._5', '1_.5', '1e_5', '0x1p3', 'infi', '1.2.3']:
+  show_float(s)
+
+for s in ['inf', '-Infinity', 'nan', '+NaN']:
+  print('%s %g' % (s, float(s)))
+print('%.17g %.17g' % (float(b'6.02214076e23'), float(b'-1e-5')))
+
+# values read from a string in a loop, like a line of a data file
+line = '17,3.25,-8,0.125,1000000,2.5e-3'
+fields = [line[0:2], line[3:7], line[8:10], line[11:16], line[17:24], line[25:]]
+int_total = int(fields[0]) + int(fields[2]) + int(fields[4])
+float_total = 0.0
+for field in fields:
+  float_total = float_total + float(field)
+print('%d %.17g' % (int_total, float_total))
+
+# unicode strings may use decimal digits from other scripts and unicode spaces
+def show_unicode(name, s):
+  try:
+    print(name + ': int = %d' % int(s))
+  except ValueError:
+    print(name + ': int raised ValueError')
+  try:
+    print(name + ': float = %.17g' % float(s))
+  except ValueError:
+    print(name + ': float raised ValueError')
+
+show_unicode('arabic-indic 3', '\u0663')
+show_unicode('devanagari 1024', '\u0967\u0966\u0968\u096a')
+show_unicode('fullwidth -42 in ideographic spaces', '\u3000\uff0d\uff14\uff12\u3000')
+show_unicode('fullwidth 42 in ideographic spaces', '\u3000\uff14\uff12\u3000')
+show_unicode('mixed scripts 1_2.5', '\u0661_2.\u0e55')
+show_unicode('mathematical bold 7 in no-break spaces', '\u00a0\U0001d7d5\u00a0')
+show_unicode('ASCII separators around 8 (not spaces)', '\x1c8\x1f')
+show_unicode('superscript 2', '\u00b2')
+show_unicode('roman numeral 4', '\u2163')
+show_unicode('ethiopic 1 (not decimal)', '\u1369')
+print('int(\'\u0661\u0660\', 16) = %d' % int('\u0661\u0660', 16))
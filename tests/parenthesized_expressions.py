@@ -0,0 +1,13 @@
+# parentheses without a comma just group an expression; they don't make a
+# 1-tuple
+x = (3)
+print(x + 1)
+print((1 + 2) * 3)
+y = (x * (x - (1))) // (2)
+print(y)
+s = ('abc')
+print(len(s), s[(1)])
+l = ([1, 2, 3])
+print(len((l)), l[(2)])
+print(repr((x < 5) and (y > 2)))
+
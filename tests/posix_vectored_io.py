@@ -0,0 +1,57 @@
+import posix
+
+filename = '/tmp/nemesys_posix_vectored_io_test'
+fd = posix.open(filename, posix.O_RDWR | posix.O_CREAT | posix.O_TRUNC, 420)
+
+print(posix.writev(fd, [b'hello ', b'', b'vectored ', b'world\n']))
+print(posix.pwrite(fd, b'HELLO', 0))
+print(posix.pread(fd, 8, 6) == b'vectored')
+print(posix.pread(fd, 100, 15) == b'world\n')
+print(len(posix.pread(fd, 100, 1000)))
+
+out_filename = '/tmp/nemesys_posix_vectored_io_test_out'
+out_fd = posix.open(out_filename, posix.O_RDWR | posix.O_CREAT | posix.O_TRUNC, 420)
+print(posix.sendfile(out_fd, fd, 6, 9))
+print(posix.lseek(fd, 0, 1))
+posix.lseek(fd, 0, 0)
+print(posix.sendfile(out_fd, fd, None, 5))
+print(posix.lseek(fd, 0, 1))
+print(posix.pread(out_fd, 100, 0) == b'vectored HELLO')
+
+posix.close(fd)
+posix.close(out_fd)
+
+# readv_sizes splits what it reads across the buffers, in order; buffers past
+# the end of the data are truncated or empty
+fd = posix.open(filename, posix.O_RDONLY)
+parts = posix.readv_sizes(fd, [5, 1, 9, 0, 3])
+print(len(parts))
+print(parts[0] == b'HELLO')
+print(parts[1] == b' ')
+print(parts[2] == b'vectored ')
+print(len(parts[3]))
+print(parts[4] == b'wor')
+parts = posix.readv_sizes(fd, [2, 10, 4])
+print(parts[0] == b'ld')
+print(parts[1] == b'\n')
+print(len(parts[2]))
+posix.close(fd)
+
+# more than IOV_MAX buffers is an error for both
+fd = posix.open(filename, posix.O_RDWR)
+try:
+  posix.writev(fd, [b'x' for t in range(5000)])
+except OSError as e:
+  print('writev: errno=' + repr(e.errno))
+try:
+  posix.readv_sizes(fd, [1 for t in range(5000)])
+except OSError as e:
+  print('readv_sizes: errno=' + repr(e.errno))
+posix.close(fd)
+
+posix.unlink(filename)
+posix.unlink(out_filename)
+try:
+  posix.unlink(filename)
+except OSError:
+  print('already unlinked')
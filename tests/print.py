@@ -0,0 +1,14 @@
+def noisy(x):
+  print('evaluating', x)
+  return x
+
+print()
+print(None, True, False, 1, -20, 'three')
+print(1, 2, 3, sep=', ')
+print('no newline', end='')
+print(' - continued', end='!\n')
+print('a', 'b', sep='', end='\n\n')
+print(noisy(1), noisy(2))
+print(2.5, 1 / 4)
+x = 7
+print('x is', x, 'and x * 3 is', x * 3)
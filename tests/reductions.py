@@ -0,0 +1,52 @@
+ints = [x * 3 - 50 for x in range(1001)]
+print(sum(ints), min(ints), max(ints), any(ints), all(ints))
+print(sum(ints, 1000), sum([1, 2, 3]), sum([5]))
+
+# items at every position relative to the vector width
+for n in range(1, 10):
+  values = [(x * 37) % 11 - 5 for x in range(n)]
+  print(n, sum(values), min(values), max(values), any(values), all(values))
+
+# the extremes are found by comparing full 64-bit values, not their halves
+big = [4294967296, -1, 4294967295, -4294967296, 2147483648, -2147483649, 0]
+print(min(big), max(big))
+print(min([-9223372036854775807 - 1, 9223372036854775807, 0, 5]),
+    max([-9223372036854775807 - 1, 9223372036854775807, 0, 5]))
+print(min([7, 7, 7, 7, 7]), max([-3, -3, -3, -3, -3, -3]))
+
+zeros = [0, 0, 0, 0, 0, 0, 0, 0, 0]
+print(any(zeros), all(zeros))
+zeros.append(4294967296)
+print(any(zeros), all(zeros))
+ones = [1, 1, 1, 1, 1, 1, 1, 1, 4294967296]
+print(any(ones), all(ones))
+ones[7] = 0
+print(any(ones), all(ones))
+
+floats = [x * 0.25 - 30.125 for x in range(500)]
+print(sum(floats) + 0.5, min(floats), max(floats), any(floats), all(floats))
+print(sum(floats, 0.5), sum([1.5, 2.25]))
+print(min([0.5, -2.5, 3.0, -2.5, 8.5]), max([0.5, -2.5, 3.0, -2.5, 8.5]))
+fzeros = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]
+print(any(fzeros), all(fzeros))
+fzeros.append(0.125)
+print(any(fzeros), all(fzeros))
+
+bools = [x % 3 == 0 for x in range(100)]
+print(sum(bools), any(bools), all(bools))
+print(all([x >= 0 for x in range(100)]), any([x < 0 for x in range(100)]))
+
+words = ['pear', 'apple', 'fig', 'banana']
+print(min(words), max(words), any(words), all(words))
+print(all(['a', '', 'b']), any(['', '']))
+print(repr(min([b'xyz', b'abc', b'ab'])), repr(max([b'xyz', b'abc', b'ab'])))
+
+squares = {x * x for x in range(20)}
+print(sum(squares), min(squares), max(squares), sum(squares, -1000))
+
+print(min(3, 8), max(3, 8), min(-2.5, 1.5), max(-2.5, 1.5))
+
+try:
+  print(max([0, 1][0:0]))
+except ValueError:
+  print('ValueError for empty list')
@@ -0,0 +1,40 @@
+# a return statement inside for loops has to clean up each loop's state (the
+# collection being iterated and the saved loop register) before returning.
+# these run many times so that a leaked collection or a misaligned stack would
+# be noticed
+
+def index_of(l=[0], x=0):
+  for i in range(len(l)):
+    if l[i] == x:
+      return i
+  return -1
+
+def first_pair_with_sum(l=[0], total=0):
+  for a in l:
+    for b in l:
+      if a + b == total:
+        return a * 1000 + b
+  return -1
+
+def first_long_word(words=['']):
+  for w in words:
+    if len(w) > 4:
+      return w
+  return ''
+
+values = [4, 8, 15, 16, 23, 42]
+words = ['a', 'bird', 'in', 'the', 'hand', 'is', 'worth', 'two']
+checksum = 0
+for n in range(2000):
+  checksum = checksum + index_of(values, 23) + index_of(values, 7)
+  checksum = checksum + first_pair_with_sum(values, 31) % 97
+  checksum = checksum + len(first_long_word(words))
+print(checksum)
+print(index_of(values, 4), index_of(values, 42), index_of(values, 5))
+print(first_pair_with_sum(values, 57), first_pair_with_sum(values, 1))
+print(first_long_word(words) + ' ' + repr(first_long_word(['x', 'y'])))
+
+# the loop variables and other locals still work after the loops return
+for w in words:
+  if index_of(values, len(w) * 4) >= 0:
+    print(w + ' ' + repr(index_of(values, len(w) * 4)))
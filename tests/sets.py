@@ -0,0 +1,96 @@
+s = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5}
+print(len(s), 4 in s, 7 in s, 7 not in s, 0 in s)
+
+# enough items that the table has to grow several times
+squares = {x * x for x in range(1000)}
+print(len(squares), 961 in squares, 962 in squares, -1 in squares)
+total = 0
+for x in squares:
+  total = total + x
+print(total)
+
+# negative numbers and the table's empty-slot value are items like any other
+extremes = {-9223372036854775807 - 1, -1, 0, 9223372036854775807}
+print(len(extremes), -9223372036854775807 - 1 in extremes, 1 in extremes)
+count = 0
+for x in extremes:
+  if x < 0:
+    count = count + 1
+print(count)
+
+# dedup and membership filtering
+data = [x % 37 for x in range(500)]
+unique = {x for x in data}
+print(len(unique))
+blocked = {3, 5, 7, 11, 13}
+kept = [x for x in data if x not in blocked]
+print(len(kept))
+evens = {x for x in data if x % 2 == 0}
+print(len(evens), 36 in evens, 35 in evens)
+
+a = {1, 2, 3, 4, 5, 6}
+b = {4, 5, 6, 7, 8}
+print(len(a | b), len(a & b), len(a - b), len(b - a), len(a ^ b))
+print(7 in a | b, 3 in a & b, 3 in a - b, 5 in a ^ b)
+print(a == {6, 5, 4, 3, 2, 1}, a != b, {4, 5} <= b, {4, 5} < b, b > {4, 5},
+    a >= b, b <= b, b < b)
+
+a.add(10)
+a.add(1)
+a.discard(2)
+a.discard(200)
+a.remove(3)
+print(len(a), 10 in a, 2 in a, 3 in a)
+try:
+  a.remove(3)
+except KeyError:
+  print('KeyError for missing item')
+
+# results of generic methods can't have their attributes looked up yet, so c
+# comes from an operator instead of from a.copy()
+c = a | {1}
+c.update(b)
+print(len(a), len(c), len(a.copy()), len(a.union(b)), len(a.intersection(b)),
+    len(a.difference(b)), len(a.symmetric_difference(b)))
+print(a.issubset(c), c.issuperset(a), a.isdisjoint(b), a.isdisjoint({100}))
+c.difference_update(b)
+print(len(c), 4 in c, 1 in c)
+c.intersection_update({1, 10, 11})
+print(len(c), 1 in c, 10 in c)
+c.symmetric_difference_update({10, 12})
+print(len(c), 10 in c, 12 in c)
+c.clear()
+print(len(c))
+if c:
+  print('wrong truth value for empty set')
+if not a:
+  print('wrong truth value for nonempty set')
+
+# removing items has to keep later items in the same probe sequence findable
+r = {x for x in range(200)}
+for x in range(0, 200, 3):
+  r.discard(x)
+found = 0
+for x in range(200):
+  if x in r:
+    found = found + 1
+print(len(r), found)
+while len(r) > 0:
+  r.pop()
+print(len(r))
+
+words = {'apple', 'banana', 'cherry', 'apple'}
+print(len(words), 'banana' in words, 'durian' in words, 'durian' not in words)
+letters = {w[0:1] for w in ['alpha', 'beta', 'gamma', 'another', 'bravo']}
+print(len(letters), 'a' in letters, 'c' in letters)
+words.add('durian')
+words.discard('apple')
+print(len(words), 'durian' in words, 'apple' in words)
+print(len(words | letters), len(words & {'banana', 'fig'}))
+lengths = 0
+for w in words:
+  lengths = lengths + len(w)
+print(lengths)
+
+bs = {b'abc', b'de', b'abc'}
+print(len(bs), b'de' in bs, b'd' in bs)
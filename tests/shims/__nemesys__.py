@@ -0,0 +1,68 @@
+# a reference version of nemesys's built-in __nemesys__ module, so python3 can
+# run the tests that use it. most of these only tune performance in nemesys, so
+# here they do nothing
+
+growth_factor = 1.5
+
+def list_growth_factor():
+  return growth_factor
+
+def set_list_growth_factor(factor=0.0):
+  global growth_factor
+  growth_factor = 1.125 if (factor < 1.125) else factor
+
+def reserve_list(l=[], capacity=0):
+  pass
+
+import sys
+
+stdout_size = 0x10000
+
+def stdout_buffer_size():
+  return stdout_size
+
+def set_stdout_buffer_size(size=0):
+  global stdout_size
+  sys.stdout.flush()
+  stdout_size = 0x40 if (size < 0x40) else size
+
+def flush_stdout():
+  sys.stdout.flush()
+
+def stdin_lines(max_lines=0):
+  lines = []
+  while (max_lines <= 0) or (len(lines) < max_lines):
+    line = sys.stdin.readline()
+    if not line:
+      break
+    lines.append(line[:-1] if line.endswith('\n') else line)
+  return lines
+
+def map_file(path='', sequential=True):
+  with open(path, 'rb') as f:
+    return f.read()
+
+# the bit intrinsics treat their arguments as 64-bit unsigned values, and
+# return signed 64-bit results
+def to_signed(u):
+  u &= 0xFFFFFFFFFFFFFFFF
+  return u - (1 << 64) if (u >> 63) else u
+
+def ctz(i=0):
+  u = i & 0xFFFFFFFFFFFFFFFF
+  return ((u & -u).bit_length() - 1) if u else 64
+
+def clz(i=0):
+  return 64 - (i & 0xFFFFFFFFFFFFFFFF).bit_length()
+
+def rotl(i=0, count=0):
+  u = i & 0xFFFFFFFFFFFFFFFF
+  count &= 63
+  return to_signed((u << count) | (u >> (64 - count)))
+
+def bswap(i=0):
+  return to_signed(int.from_bytes((i & 0xFFFFFFFFFFFFFFFF).to_bytes(8, 'little'), 'big'))
+
+# python frees large ints when they're no longer used, so none are counted
+def promoted_int_count():
+  return 0
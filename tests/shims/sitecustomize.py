@@ -0,0 +1,21 @@
+# python3 imports this at startup. it adds the functions that nemesys's versions
+# of python's built-in modules have but python's don't, so the tests can use
+# them. it doesn't change anything python already has. (the modules themselves
+# can't be replaced by files in shims/, since built-in modules are found before
+# anything on the path)
+
+import posix
+
+# nemesys has no mutable buffer type, so instead of readv it has readv_sizes,
+# which takes a list of buffer sizes and returns a list of Bytes objects,
+# truncated to the data that was read
+def readv_sizes(fd, sizes):
+  buffers = [bytearray(max(size, 0)) for size in sizes]
+  bytes_read = posix.readv(fd, buffers)
+  ret = []
+  for buf in buffers:
+    ret.append(bytes(buf[:max(min(bytes_read, len(buf)), 0)]))
+    bytes_read -= len(ret[-1])
+  return ret
+
+posix.readv_sizes = readv_sizes
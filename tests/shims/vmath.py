@@ -0,0 +1,48 @@
+# a reference version of nemesys's built-in vmath module, so python3 can run
+# the tests that use it. nemesys always imports its built-in module instead
+
+import math
+
+def check_lengths(l=[0.0], dest=[0.0]):
+  if len(l) != len(dest):
+    raise ValueError()
+
+def exp(l=[0.0]):
+  return [math.exp(exp_x) for exp_x in l]
+
+def exp_into(l=[0.0], dest=[0.0]):
+  check_lengths(l, dest)
+  for i in range(len(l)):
+    dest[i] = math.exp(l[i])
+
+def log(l=[0.0]):
+  return [math.log(log_x) for log_x in l]
+
+def log_into(l=[0.0], dest=[0.0]):
+  check_lengths(l, dest)
+  for i in range(len(l)):
+    dest[i] = math.log(l[i])
+
+def sqrt(l=[0.0]):
+  return [math.sqrt(sqrt_x) for sqrt_x in l]
+
+def sqrt_into(l=[0.0], dest=[0.0]):
+  check_lengths(l, dest)
+  for i in range(len(l)):
+    dest[i] = math.sqrt(l[i])
+
+def sin(l=[0.0]):
+  return [math.sin(sin_x) for sin_x in l]
+
+def sin_into(l=[0.0], dest=[0.0]):
+  check_lengths(l, dest)
+  for i in range(len(l)):
+    dest[i] = math.sin(l[i])
+
+def cos(l=[0.0]):
+  return [math.cos(cos_x) for cos_x in l]
+
+def cos_into(l=[0.0], dest=[0.0]):
+  check_lengths(l, dest)
+  for i in range(len(l)):
+    dest[i] = math.cos(l[i])
@@ -0,0 +1,83 @@
+u = 'hello world'
+print(u[0:5], u[6:], u[:5], u[-5:], u[:-6], u[:])
+print(u[::2], u[1::3], u[::-1], u[-2:2:-2], u[8:3:-1])
+print(len(u[5:5]), len(u[20:]), len(u[3:1]), u[-100:3], u[8:100])
+
+b = b'abcdefghij'
+print(len(b[2:5]), b[2:5][0], b[::-3][1], b[-1:][0])
+
+# long enough that slices share the original's data
+line = 'let x = 12345; let y = 678; let zz = 9; '
+text = line + line + line
+print(len(text))
+tail = text[40:]
+print(len(tail), tail[0:5], int(tail[8:11]))
+middle = tail[10:70]
+print(len(middle), middle[:8], middle[-4:])
+print(int(text[8:13]) + int(text[23:26]))
+text = ''
+
+# a tokenizer that repeatedly drops the consumed prefix
+def tokenize(s):
+  count = 0
+  total = 0
+  while len(s) > 0:
+    if s[0] == ' ' or s[0] == ';' or s[0] == '=':
+      s = s[1:]
+      continue
+    n = 0
+    while n < len(s) and s[n] != ' ' and s[n] != ';':
+      n = n + 1
+    token = s[:n]
+    if token[0] >= '0' and token[0] <= '9':
+      total = total + int(token)
+    count = count + 1
+    s = s[n:]
+  return count * 1000000 + total
+source = ''
+for i in range(20):
+  source = source + line
+print(tokenize(source))
+
+data = b'0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz'
+view = data[4:70]
+print(len(view), view[0], view[-1], int(view[:6]), float(view[2:5]) + 0.5)
+data = b''
+print(view[10], len(view[5:]))
+
+l = [1, 2, 3, 4, 5, 6, 7, 8, 9]
+m = l[2:6]
+m[0] = 100
+print(len(m), m[0], m[3], l[2])
+r = l[::-2]
+print(len(r), r[0], r[1], r[-1])
+n = l[7:2]
+print(len(n))
+
+f = [0.5, 1.5, 2.5, 3.5]
+g = f[1:]
+print(len(g), g[0], g[-1])
+
+s = ['a', 'b', 'c', 'd']
+t = s[1:3]
+print(t[0] + t[1], len(s[::2]))
+
+l[1:3] = [20, 30, 40, 50]
+print(len(l), l[0], l[1], l[4], l[5], l[-1])
+l[2:6] = [7]
+print(len(l), l[1], l[2], l[3])
+l[::2] = [0, 0, 0, 0]
+print(len(l), l[0], l[1], l[2], l[6])
+l[:0] = l
+print(len(l), l[0], l[7], l[8])
+s[1:1] = ['x', 'y']
+print(len(s), s[0] + s[1] + s[2] + s[3] + s[4] + s[5])
+
+try:
+  print(u[::0])
+except ValueError:
+  print('ValueError for zero step')
+try:
+  l[::2] = [1, 2]
+except ValueError:
+  print('ValueError for extended slice size mismatch')
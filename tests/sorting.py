@@ -0,0 +1,86 @@
+l = [5, -3, 9, 0, -9223372036854775807 - 1, 9223372036854775807, 2, 2]
+s = sorted(l)
+print(len(s), s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7])
+print(l[0], l[4])
+l.sort()
+print(l[0], l[1], l[7])
+
+# long enough to use the radix sort. values cover the full range, so every
+# digit is used
+def check_sorted_ints(values):
+  for i in range(1, len(values)):
+    if values[i - 1] > values[i]:
+      return False
+  return True
+
+x = 12345
+randoms = [0]
+randoms.pop()
+for i in range(5000):
+  x = (x * 1103515245 + 12345) % 2147483648
+  high = x - 1073741824
+  x = (x * 1103515245 + 12345) % 2147483648
+  randoms.append(high * 8589934592 + x)
+ordered = sorted(randoms)
+print(len(ordered), check_sorted_ints(ordered), check_sorted_ints(randoms))
+total = 0
+for v in randoms:
+  total = total + v % 1000
+for v in ordered:
+  total = total - v % 1000
+print(total)
+
+# small numbers only use the low digits
+small = [(i * 7919) % 1000 - 500 for i in range(3000)]
+small.sort()
+print(small[0], small[1], small[1499], small[2999], check_sorted_ints(small))
+
+f = [2.5, 0.5, -1.5, 3.25, 1000.75, -1000.25, 0.001]
+g = sorted(f)
+print(g[0], g[1], g[2], g[3], g[4], g[5], g[6])
+floats = [((i * 7919) % 1000) / 8 - 60 for i in range(1000)]
+floats.sort()
+ok = True
+for i in range(1, len(floats)):
+  if floats[i - 1] > floats[i]:
+    ok = False
+print(floats[0] + 0.5, floats[999], ok)
+
+w = sorted(['pear', 'apple', 'fig', 'banana', 'apple', 'Zebra', ''])
+print(len(w), w[0] + '|' + w[1] + '|' + w[2] + '|' + w[3] + '|' + w[6])
+words = [repr((i * 7919) % 997) for i in range(500)]
+words.sort()
+print(words[0], words[1], words[2], words[499])
+bs = sorted([b'xyz', b'abc', b'ab', b'b'])
+print(len(bs), bs[0][1], bs[1][2], bs[3][0])
+
+u = sorted({30, 10, 20, -5})
+print(len(u), u[0], u[1], u[2], u[3])
+letters = sorted({'b', 'c', 'a'})
+print(letters[0] + letters[1] + letters[2])
+print(len(sorted([1])))
+
+# reverse=True sorts in descending order, but equal items keep their original
+# order, so 0.0 and -0.0 come out in the order they were in
+r = sorted(l, reverse=True)
+print(r[0], r[1], r[7], l[0])
+zeroes = [0.0, 1.5, -0.0, -2.5, 0.0]
+rz = sorted(zeroes, reverse=True)
+zeroes.sort(reverse=True)
+line = ''
+for z in rz:
+  line = line + ' %g' % z
+for z in zeroes:
+  line = line + ' %g' % z
+print(line)
+randoms.sort(reverse=True)
+print(randoms[0] == ordered[4999], randoms[4999] == ordered[0])
+w.sort(reverse=True)
+print(w[0] + '|' + w[1] + '|' + w[6])
+rs = sorted({'b', 'c', 'a'}, reverse=True)
+print(rs[0] + rs[1] + rs[2])
+descending = len(l) > 5
+rv = sorted([3, 1, 2], reverse=descending)
+print(rv[0], rv[1], rv[2])
+rv = sorted([3, 1, 2], reverse=False)
+print(rv[0], rv[1], rv[2])
@@ -0,0 +1,17 @@
+import __nemesys__
+
+# reads a line with input(), a few chunks of lines, then the rest in bulk.
+# input() and stdin_lines share a buffer, so no lines are skipped or repeated
+
+def show(name='', lines=['']):
+  print('%s: %d lines' % (name, len(lines)))
+  for line in lines:
+    print('  [' + line + '] %d' % len(line))
+
+print('first line: ' + input())
+show('chunk 1', __nemesys__.stdin_lines(3))
+show('chunk 2', __nemesys__.stdin_lines(1))
+print('next line: ' + input())
+show('rest', __nemesys__.stdin_lines())
+show('after end', __nemesys__.stdin_lines())
+show('chunk after end', __nemesys__.stdin_lines(5))
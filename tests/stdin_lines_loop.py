@@ -0,0 +1,35 @@
+import __nemesys__
+
+# a for loop over stdin_lines() reads stdin in chunks as it goes instead of
+# reading it all first. the inputs are long enough to need several chunks, and
+# one ends exactly at the end of a chunk. (lines after the chunk where a loop
+# stops early are still unread, unlike in python, so these don't read any
+# more after that)
+
+def summarize(stop=''):
+  count = 0
+  total = 0
+  longest = ''
+  for line in __nemesys__.stdin_lines():
+    if line == 'skip':
+      continue
+    if line == stop:
+      print('stopped after %d lines' % count)
+      return -1
+    if line == 'end':
+      break
+    count = count + 1
+    total = total + len(line)
+    if len(line) > len(longest):
+      longest = line
+  else:
+    print('read to the end')
+  print('%d lines, %d characters, longest is %s' % (count, total, repr(longest)))
+  return count
+
+print('first line: ' + input())
+if summarize('stop') >= 0:
+  for line in __nemesys__.stdin_lines():
+    print('unexpected line after the end: ' + line)
+  else:
+    print('no lines after the end')
@@ -0,0 +1,51 @@
+import __nemesys__
+import posix
+
+# print() is buffered, but posix.write goes straight to the fd, so the direct
+# writes here only come out in the right place if everything before them was
+# flushed. changing the buffer size flushes too
+
+def direct(s=b''):
+  posix.write(1, s)
+
+print('default size %d' % __nemesys__.stdout_buffer_size())
+print('buffered 1')
+__nemesys__.flush_stdout()
+direct(b'direct 1\n')
+
+# a small buffer, with lines shorter than it, longer than it, and that don't
+# fit in what's left of it
+print('buffered 2')
+__nemesys__.set_stdout_buffer_size(100)
+direct(b'direct 2\n')
+print('size %d' % __nemesys__.stdout_buffer_size())
+long_line = ''
+for x in range(15):
+  long_line = long_line + '0123456789'
+print(long_line)
+for x in range(30):
+  print(x, end=' ')
+print(12345.5, end=' ')
+print('unicode', True, None)
+__nemesys__.flush_stdout()
+direct(b'direct 3\n')
+
+# sizes below 64 are rounded up
+for size in [0, -5, 63, 64, 65]:
+  __nemesys__.set_stdout_buffer_size(size)
+  print('%d -> %d' % (size, __nemesys__.stdout_buffer_size()), end='')
+  print(' ' + long_line[0:70])
+__nemesys__.flush_stdout()
+direct(b'direct 4\n')
+
+# flushing an empty buffer, and changing the size back, with output pending
+__nemesys__.flush_stdout()
+__nemesys__.flush_stdout()
+print('buffered 3')
+__nemesys__.set_stdout_buffer_size(0x10000)
+direct(b'direct 5\n')
+for x in range(1000):
+  print('line %d' % x)
+__nemesys__.flush_stdout()
+direct(b'direct 6\n')
+print('buffered at exit')
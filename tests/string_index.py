@@ -0,0 +1,30 @@
+b = b'abc\xff'
+print(b[0])
+print(b[3])
+print(b[-1] + b[-4])
+
+u = 'hello world'
+print(u[0] + u[-1])
+i = 0
+while i < len(u):
+  print(u[i])
+  i = i + 1
+
+def count_byte(data, value):
+  n = 0
+  i = 0
+  while i < len(data):
+    if data[i] == value:
+      n = n + 1
+    i = i + 1
+  return n
+print(count_byte(b'abracadabra', 97))
+
+try:
+  print(b[4])
+except IndexError:
+  print('IndexError for bytes')
+try:
+  print(u[-12])
+except IndexError:
+  print('IndexError for unicode')
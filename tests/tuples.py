@@ -38,3 +38,39 @@ print('c[0] is ' + repr(c[0]))
 print('c[1] is ' + repr(c[1]))
 print('c[2] is ' + repr(c[2]))
 print('c[3] is ' + repr(c[3]))
+
+# tuples that are unpacked as soon as they're constructed are never built
+def gcd(a, b):
+  while b:
+    a, b = b, a % b
+  return a
+print('gcd is ' + repr(gcd(1071, 462)) + ' and ' + repr(gcd(17, 5)))
+d, e, f = 1, 'two', 3.5
+print(d, e, f)
+e, d = 'swapped', 7
+print(d, e)
+g, h = 0.25, 0.5
+g, h = h, g
+print(g, h)
+l = ['', '']
+l[0], l[1] = 'x' + 'y', 'z'
+print(l[0], l[1])
+
+# tuples and lists that already exist can be unpacked too
+def divide(a, b):
+  return (a // b, a % b)
+q, r = divide(17, 5)
+print(q, r)
+pairs = [(1, 'a'), (2, 'b')]
+for n, s in pairs:
+  print(n, s)
+letters = [s for n, s in pairs]
+print(letters[0] + letters[1])
+def difference(v):
+  a, b = v
+  return a - b
+print(difference([9, 4]))
+try:
+  print(difference([1, 2, 3]))
+except ValueError:
+  print('ValueError for wrong length')
@@ -0,0 +1,119 @@
+# loops that only store items computed from other lists' items are done several
+# items at a time; these check that the results (and errors) are the same as if
+# each item were done separately
+
+def show(name, l):
+  s = name
+  for x in l:
+    s = s + (' %g' % x)
+  print(s)
+
+def show_ints(name, l):
+  s = name
+  for x in l:
+    s = s + (' %d' % x)
+  print(s)
+
+# 7 items leaves some for the scalar loop, whether 2 or 4 are done at a time
+n = 7
+a = [float(t) for t in range(n)]
+b = [w * 0.5 for w in a]
+out = [0.0 for t in range(n)]
+k = 3
+for i in range(n):
+  out[i] = a[i] * k + b[i]
+show('axpy', out)
+print('i %d' % i)
+
+# several statements, constants, invariants and negation
+c = [0.0 for t in range(n)]
+d = [0.0 for t in range(n)]
+scale = 0.25
+for i in range(n):
+  c[i] = -a[i] / 2.0 + scale
+  d[i] = (a[i] - b[i]) * (a[i] + 1) - c[i] * 0.0 + b[i]
+show('c', c)
+show('d', d)
+
+# in-place updates, and a loop that doesn't run at all
+for i in range(n):
+  a[i] = a[i] * 2.0
+show('doubled', a)
+i = 100
+for i in range(0):
+  a[i] = 0.0
+print('i %d' % i)
+
+# Int lists, with an overflow in the middle of a group of items; the vector
+# loop stops there and the scalar loop promotes the result
+u = [1, 2, 3, 4, 5, 6, 7, 8]
+v = [10, 20, 30, 40, 50, 60, 70, 80]
+z = [0 for t in range(8)]
+m = 5
+for i in range(8):
+  z[i] = (u[i] + v[i]) ^ m | 1
+show_ints('z', z)
+for i in range(8):
+  z[i] = v[i] - u[i] & -m
+show_ints('z', z)
+
+big = [1, 2, 3, 4, 5, 6, 7, 8]
+big[5] = 9223372036854775800
+for i in range(8):
+  z[i] = big[i] + 10
+show_ints('z', z)
+
+big[6] = -9223372036854775807 - 1
+for i in range(8):
+  z[i] = -big[i] - 1
+show_ints('z', z)
+
+# results and items that don't overflow 64 bits but are too large to store
+# directly, and a promoted loop-invariant value
+for i in range(8):
+  z[i] = u[i] + 4611686018427387900
+show_ints('z', z)
+for i in range(8):
+  z[i] = big[i] & 15
+show_ints('z', z)
+n = 2 ** 70
+for i in range(8):
+  z[i] = u[i] ^ n
+show_ints('z', z)
+
+# a list that's too short only raises when its missing item is reached
+short = [1.0, 2.0, 3.0]
+e = [0.0 for t in range(5)]
+try:
+  for i in range(5):
+    e[i] = short[i] + 1.0
+except IndexError:
+  print('index error at %d' % i)
+show('e', e)
+
+# a list written by one statement and read by a later one under another name
+# must see the new values
+p = [1.0, 2.0, 3.0, 4.0]
+q = p
+r = [0.0 for t in range(4)]
+for i in range(4):
+  p[i] = p[i] + 10.0
+  r[i] = q[i] * 2.0
+show('p', p)
+show('r', r)
+
+# the same thing in a function, with local variables
+def saxpy(xs=[0.0], ys=[0.0], alpha=0.0):
+  for j in range(len(xs)):
+    ys[j] = alpha * xs[j] + ys[j]
+  return ys
+
+show('saxpy', saxpy([1.0, 2.0, 3.0, 4.0, 5.0], [0.5, 0.5, 0.5, 0.5, 0.5], 2.0))
+
+# loops over other ranges still work normally
+total = 0
+for i in range(3, 20, 4):
+  total = total + i
+for i in range(10, 0, -3):
+  total = total * 2 + i
+print('total %d' % total)
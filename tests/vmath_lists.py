@@ -0,0 +1,46 @@
+import vmath
+
+# vmath applies a function to every item of a Float list at once. exp and log
+# are approximations that can differ from the math module's in the last bit,
+# so results are printed with fewer digits than a double has
+
+def show(name, l):
+  s = name
+  for x in l:
+    s = s + (' %.14g' % x)
+  print(s)
+
+xs = [-20.0, -1.5, -0.001, 0.0, 1e-10, 0.5, 1.0, 2.0, 10.0, 100.5, 700.0]
+show('exp', vmath.exp(xs))
+ps = [1e-300, 1e-10, 0.3, 0.7071067811865476, 1.0, 1.0000001, 1.5, 2.0, 1e10, 1.7e308]
+show('log', vmath.log(ps))
+show('sqrt', vmath.sqrt(ps))
+show('sin', vmath.sin(xs))
+show('cos', vmath.cos(xs))
+
+# empty and odd-length lists
+show('empty', vmath.exp(xs[0:0]))
+show('one', vmath.log([2.718281828459045]))
+
+# the _into forms write into an existing list, which can be the argument
+ys = [0.0 for t in range(len(xs))]
+vmath.exp_into(xs, ys)
+vmath.log_into(ys, ys)
+show('roundtrip', ys)
+try:
+  vmath.sqrt_into(ps, ys)
+except ValueError:
+  print('lengths must match')
+
+# long lists are split between threads; the results must be the same as when
+# each item is done separately
+n = 300001
+big = [(t % 1000) * 0.01 - 5.0 for t in range(n)]
+big_exp = vmath.exp(big)
+big_log = vmath.log(big_exp)
+mismatches = 0
+for k in [0, 1, 2, 65535, 131072, 150000, 299999, 300000]:
+  if (big_exp[k] != vmath.exp([big[k]])[0]) or (big_log[k] != vmath.log([big_exp[k]])[0]):
+    mismatches = mismatches + 1
+print('%d items, %d mismatches' % (len(big_exp), mismatches))
+print('%.6f %.6f' % (sum(big_exp) / n, sum(big_log) / n))